@@ -0,0 +1,130 @@
+#include <benchmark/benchmark.h>
+
+#include <cstddef>
+#include <sstream>
+#include <string>
+
+#include "../src/backend/bytecode_program.hpp"
+#include "../src/backend/code_generator/code_generator.hpp"
+#include "../src/backend/interpreter/register_machine.hpp"
+#include "../src/backend/opcode.hpp"
+#include "../src/frontend/lexer/lexer.hpp"
+#include "../src/frontend/parser/parser.hpp"
+#include "representative_programs.hpp"
+
+namespace
+{
+// A loop counting down from n_iterations, whose body consists of body_size ADDs. Every
+// iteration dispatches body_size + 2 instructions (body, DEC, conditional jump).
+bytecode_program make_dispatch_loop(value_t n_iterations, std::size_t body_size)
+{
+    bytecode_program program;
+    program.constants = {n_iterations, 0, 1};
+
+    program.code.push_back({opcode::SETLIT, 0, 0, 0});
+    program.code.push_back({opcode::SETLIT, 1, 1, 0});
+    program.code.push_back({opcode::SETLIT, 2, 2, 0});
+
+    const auto loop_head = static_cast<std::int32_t>(program.code.size());
+
+    for (std::size_t i = 0; i < body_size; ++i)
+    {
+        program.code.push_back({opcode::ADD, 2, 2, 2});
+    }
+
+    program.code.push_back({opcode::DEC, 0, 0, 0});
+    program.code.push_back({opcode::JUMPGREATER, loop_head, 0, 1});
+    program.code.push_back({opcode::RET, 2, 0, 0});
+
+    program.functions.push_back({"main", 0, 0, 3});
+
+    return program;
+}
+}    // namespace
+
+// Reports the average cost of a single dispatch, build with -DMVPL_SWITCH_DISPATCH=ON to
+// compare against the switch based fallback.
+static void BM_RegisterMachineDispatch(benchmark::State& state)
+{
+    constexpr value_t n_iterations = 100'000;
+    const auto        body_size    = static_cast<std::size_t>(state.range(0));
+
+    auto             program = make_dispatch_loop(n_iterations, body_size);
+    register_machine vm(program);
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(vm.run());
+    }
+
+    const auto n_dispatches =
+        static_cast<double>(n_iterations) * static_cast<double>(body_size + 2) + 4;
+
+    state.counters["time_per_instruction"] = benchmark::Counter(
+        n_dispatches,
+        benchmark::Counter::kIsIterationInvariantRate | benchmark::Counter::kInvert);
+}
+BENCHMARK(BM_RegisterMachineDispatch)->Arg(0)->Arg(1)->Arg(8)->Arg(64);
+
+// Call and return heavy code, dominated by frame setup
+static void BM_RegisterMachineCall(benchmark::State& state)
+{
+    bytecode_program program;
+    program.constants = {20, 2, 1};
+    program.code      = {
+        {opcode::SETLIT, 0, 0, 0},
+        {opcode::CALL, 0, 1, 0},
+        {opcode::RET, 0, 0, 0},
+        // fib
+        {opcode::SETLIT, 1, 1, 0},
+        {opcode::JUMPGEQ, 6, 0, 1},
+        {opcode::RET, 0, 0, 0},
+        {opcode::SETLIT, 2, 2, 0},
+        {opcode::SUB, 3, 0, 2},
+        {opcode::CALL, 3, 1, 3},
+        {opcode::SUB, 4, 0, 1},
+        {opcode::CALL, 4, 1, 4},
+        {opcode::ADD, 0, 3, 4},
+        {opcode::RET, 0, 0, 0},
+    };
+    program.functions = {{"main", 0, 0, 1}, {"fib", 3, 1, 5}};
+
+    register_machine vm(program);
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(vm.run());
+    }
+}
+BENCHMARK(BM_RegisterMachineCall);
+
+// End to end execution of the representative programs with (1) and without (0)
+// superinstructions. The interpreter built with -DMVPL_DISPATCH_STATISTICS=ON additionally
+// reports the number of dispatches per run, which shows the dispatch reduction.
+static void BM_RepresentativeProgram(benchmark::State& state)
+{
+    const auto& representative = REPRESENTATIVE_PROGRAMS[static_cast<std::size_t>(state.range(0))];
+
+    std::string source(representative.source);
+    lexer       lexer(source);
+    auto        token_stream = lexer.lex();
+    auto        program      = generate_code(*parse(token_stream),
+                                   {.form_superinstructions = state.range(1) != 0});
+
+    register_machine vm(program);
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(vm.run());
+    }
+
+    state.SetLabel(std::string(representative.name));
+#ifdef MVPL_DISPATCH_STATISTICS
+    state.counters["dispatches"] = benchmark::Counter(
+        static_cast<double>(vm.get_dispatch_statistics().get_n_dispatches()),
+        benchmark::Counter::kAvgIterations);
+#endif
+}
+BENCHMARK(BM_RepresentativeProgram)
+    ->ArgsProduct({benchmark::CreateDenseRange(0, REPRESENTATIVE_PROGRAMS.size() - 1, 1), {0, 1}})
+    ->Unit(benchmark::kMillisecond);
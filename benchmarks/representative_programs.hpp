@@ -0,0 +1,131 @@
+#pragma once
+
+#include <array>
+#include <string_view>
+
+// Small MVPL programs covering the typical mix of recursion, counting loops, nested loops
+// and arithmetic. They drive the opcode pair/triple profile superinstructions are chosen
+// from (see the README) and the end to end benchmarks.
+struct representative_program
+{
+    std::string_view name;
+    std::string_view source;
+};
+
+inline constexpr std::array REPRESENTATIVE_PROGRAMS{
+    representative_program{"fib", R"(
+function fib(n)
+{
+    if (n < 2)
+    {
+        return n;
+    }
+    let a = n - 1;
+    let b = n - 2;
+    return fib(a) + fib(b);
+}
+function main()
+{
+    return fib(24);
+}
+)"},
+    representative_program{"primes", R"(
+function is_prime(n)
+{
+    for (let d = 2; d * d <= n; ++d)
+    {
+        if (n % d == 0)
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+function main()
+{
+    let count = 0;
+    for (let i = 2; i < 20000; ++i)
+    {
+        count = count + is_prime(i);
+    }
+    return count;
+}
+)"},
+    representative_program{"collatz", R"(
+function main()
+{
+    let total = 0;
+    for (let i = 1; i < 3000; ++i)
+    {
+        let n = i;
+        while (n != 1)
+        {
+            if (n % 2 == 0)
+            {
+                n = n / 2;
+            }
+            else
+            {
+                n = 3 * n + 1;
+            }
+            ++total;
+        }
+    }
+    return total;
+}
+)"},
+    representative_program{"nested_loops", R"(
+function main()
+{
+    let sum = 0;
+    for (let i = 0; i < 300; ++i)
+    {
+        for (let j = 0; j < 300; ++j)
+        {
+            sum = sum + (i * j) % 7;
+        }
+    }
+    return sum;
+}
+)"},
+    representative_program{"gcd", R"(
+function gcd(a, b)
+{
+    while (b != 0)
+    {
+        let t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+function main()
+{
+    let sum = 0;
+    for (let i = 1; i < 200; ++i)
+    {
+        for (let j = 1; j < 200; ++j)
+        {
+            sum = sum + gcd(i, j);
+        }
+    }
+    return sum;
+}
+)"},
+    representative_program{"bit_count", R"(
+function main()
+{
+    let total = 0;
+    for (let i = 0; i < 50000; ++i)
+    {
+        let n = i;
+        while (n > 0)
+        {
+            total = total + (n & 1);
+            n = n >> 1;
+        }
+    }
+    return total;
+}
+)"},
+};
@@ -0,0 +1,333 @@
+// Copyright © 2021-2022 Jonas Muehlmann
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include "bytecode_image.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+#include "opcode.hpp"
+
+#ifdef __unix__
+#    include <fcntl.h>
+#    include <sys/mman.h>
+#    include <sys/stat.h>
+#    include <unistd.h>
+#else
+#    include <iterator>
+#endif
+
+namespace
+{
+constexpr char MAGIC[8] = {'\x7f', 'M', 'V', 'P', 'L', 'C', '\r', '\n'};
+
+static_assert(std::is_trivially_copyable_v<instruction>);
+static_assert(std::is_trivially_copyable_v<function_layout>);
+static_assert(sizeof(bytecode_image_header) <= BYTECODE_IMAGE_ALIGNMENT);
+
+std::uint64_t align(std::uint64_t offset)
+{
+    return (offset + BYTECODE_IMAGE_ALIGNMENT - 1) / BYTECODE_IMAGE_ALIGNMENT
+           * BYTECODE_IMAGE_ALIGNMENT;
+}
+
+// Lays out the sections one after another in the order of the header
+class image_writer
+{
+ public:
+    explicit image_writer(const std::string& path_) : path{path_}, stream{path_, std::ios::binary}
+    {
+        if (!stream)
+        {
+            throw std::runtime_error("Could not write " + path);
+        }
+    }
+
+    template <typename T>
+    bytecode_image_section reserve(std::size_t count)
+    {
+        const bytecode_image_section section{align(end), count};
+
+        end = section.offset + count * sizeof(T);
+
+        return section;
+    }
+
+    void write_header(const bytecode_image_header& header)
+    {
+        put(&header, sizeof(header));
+    }
+
+    template <typename T>
+    void write(const bytecode_image_section& section, const T* entries)
+    {
+        pad_to(section.offset);
+        put(entries, section.count * sizeof(T));
+    }
+
+    void finish()
+    {
+        pad_to(end);
+
+        if (!stream.flush())
+        {
+            throw std::runtime_error("Could not write " + path);
+        }
+    }
+
+ private:
+    std::string   path;
+    std::ofstream stream;
+    // The header occupies the first page
+    std::uint64_t end{BYTECODE_IMAGE_ALIGNMENT};
+    std::uint64_t written{0};
+
+    void put(const void* data, std::size_t size)
+    {
+        stream.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+        written += size;
+    }
+
+    void pad_to(std::uint64_t offset)
+    {
+        static const std::vector<char> zeros(BYTECODE_IMAGE_ALIGNMENT);
+
+        while (written < offset)
+        {
+            put(zeros.data(), std::min<std::uint64_t>(offset - written, zeros.size()));
+        }
+    }
+};
+}    // namespace
+
+//****************************************************************************//
+//                                   Writer                                   //
+//****************************************************************************//
+void write_bytecode_image(const bytecode_program& program,
+                          const std::string&      path,
+                          bool                    with_debug_information)
+{
+    const auto functions = get_function_layouts(program);
+
+    std::vector<bytecode_image_name> names;
+    std::string                      strings;
+    std::span<const std::uint32_t>   lines;
+
+    if (with_debug_information)
+    {
+        for (const auto& function : program.functions)
+        {
+            names.push_back({strings.size(), function.name.size()});
+            strings += function.name;
+        }
+
+        if (program.lines.size() == program.code.size())
+        {
+            lines = program.lines;
+        }
+    }
+
+    image_writer          writer(path);
+    bytecode_image_header header{};
+
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version       = BYTECODE_IMAGE_VERSION;
+    header.byte_order    = BYTECODE_IMAGE_BYTE_ORDER;
+    header.n_opcodes     = static_cast<std::uint32_t>(ALL_OPCODES.size());
+    header.main_function = program.main_function;
+    header.functions     = writer.reserve<function_layout>(functions.size());
+    header.constants     = writer.reserve<value_t>(program.constants.size());
+    header.code          = writer.reserve<instruction>(program.code.size());
+    header.names         = writer.reserve<bytecode_image_name>(names.size());
+    header.strings       = writer.reserve<char>(strings.size());
+    header.lines         = writer.reserve<std::uint32_t>(lines.size());
+
+    writer.write_header(header);
+    writer.write(header.functions, functions.data());
+    writer.write(header.constants, program.constants.data());
+    writer.write(header.code, program.code.data());
+    writer.write(header.names, names.data());
+    writer.write(header.strings, strings.data());
+    writer.write(header.lines, lines.data());
+    writer.finish();
+}
+
+//****************************************************************************//
+//                                   Image                                    //
+//****************************************************************************//
+#ifdef __unix__
+bytecode_image::bytecode_image(const std::string& path) : memory{nullptr}, size{0}, program{}
+{
+    const int file = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+
+    if (file == -1)
+    {
+        throw std::runtime_error("Could not open " + path);
+    }
+
+    struct stat status = {};
+
+    if (fstat(file, &status) != 0
+        || static_cast<std::size_t>(status.st_size) < sizeof(bytecode_image_header))
+    {
+        close(file);
+
+        throw std::runtime_error(path + " is no compiled program");
+    }
+
+    size = static_cast<std::size_t>(status.st_size);
+
+    // Pages are only read from the file, once the program touches them
+    void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file, 0);
+    close(file);
+
+    if (mapping == MAP_FAILED)
+    {
+        throw std::runtime_error("Could not map " + path);
+    }
+
+    memory = static_cast<std::byte*>(mapping);
+
+    try
+    {
+        validate();
+    }
+    catch (const std::runtime_error&)
+    {
+        munmap(memory, size);
+
+        throw std::runtime_error(path + " is no compiled program of this version");
+    }
+}
+
+bytecode_image::~bytecode_image()
+{
+    munmap(memory, size);
+}
+#else
+// Without mmap the image is read at once, new aligns it well enough for any of the entries
+bytecode_image::bytecode_image(const std::string& path) : memory{nullptr}, size{0}, program{}
+{
+    std::ifstream stream(path, std::ios::binary);
+
+    const std::vector<char> content((std::istreambuf_iterator<char>(stream)),
+                                    std::istreambuf_iterator<char>());
+
+    if (!stream.eof() || content.size() < sizeof(bytecode_image_header))
+    {
+        throw std::runtime_error(path + " is no compiled program");
+    }
+
+    size   = content.size();
+    memory = new std::byte[size];
+    std::memcpy(memory, content.data(), size);
+
+    try
+    {
+        validate();
+    }
+    catch (const std::runtime_error&)
+    {
+        delete[] memory;
+
+        throw std::runtime_error(path + " is no compiled program of this version");
+    }
+}
+
+bytecode_image::~bytecode_image()
+{
+    delete[] memory;
+}
+#endif
+
+bytecode_view bytecode_image::get_program() const
+{
+    return program;
+}
+
+std::string_view bytecode_image::get_function_name(std::size_t function) const
+{
+    const auto& header = *reinterpret_cast<const bytecode_image_header*>(memory);
+
+    if (function >= header.names.count)
+    {
+        return {};
+    }
+
+    const auto* names = reinterpret_cast<const bytecode_image_name*>(memory + header.names.offset);
+    const auto& name  = names[function];
+
+    return {reinterpret_cast<const char*>(memory + header.strings.offset + name.offset),
+            name.length};
+}
+
+void bytecode_image::validate()
+{
+    const auto& header = *reinterpret_cast<const bytecode_image_header*>(memory);
+
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0
+        || header.version != BYTECODE_IMAGE_VERSION
+        || header.byte_order != BYTECODE_IMAGE_BYTE_ORDER
+        || header.n_opcodes != ALL_OPCODES.size())
+    {
+        throw std::runtime_error("Invalid header");
+    }
+
+    auto fits = [this](const bytecode_image_section& section, std::size_t entry_size) {
+        return section.offset % BYTECODE_IMAGE_ALIGNMENT == 0 && section.offset <= size
+               && section.count <= (size - section.offset) / entry_size;
+    };
+
+    if (!fits(header.functions, sizeof(function_layout))
+        || !fits(header.constants, sizeof(value_t)) || !fits(header.code, sizeof(instruction))
+        || !fits(header.names, sizeof(bytecode_image_name)) || !fits(header.strings, 1)
+        || !fits(header.lines, sizeof(std::uint32_t))
+        || (header.names.count != 0 && header.names.count != header.functions.count)
+        || (header.lines.count != 0 && header.lines.count != header.code.count))
+    {
+        throw std::runtime_error("Invalid section");
+    }
+
+    const auto* names = reinterpret_cast<const bytecode_image_name*>(memory + header.names.offset);
+
+    if (std::any_of(names, names + header.names.count, [&](const bytecode_image_name& name) {
+            return name.offset > header.strings.count
+                   || name.length > header.strings.count - name.offset;
+        }))
+    {
+        throw std::runtime_error("Invalid name");
+    }
+
+    const auto* code      = reinterpret_cast<const instruction*>(memory + header.code.offset);
+    const auto* constants = reinterpret_cast<const value_t*>(memory + header.constants.offset);
+    const auto* functions =
+        reinterpret_cast<const function_layout*>(memory + header.functions.offset);
+    const auto* lines = reinterpret_cast<const std::uint32_t*>(memory + header.lines.offset);
+
+    program = {{code, header.code.count},
+               {constants, header.constants.count},
+               {functions, header.functions.count},
+               header.main_function,
+               {lines, header.lines.count}};
+}
@@ -0,0 +1,111 @@
+// Copyright © 2021-2022 Jonas Muehlmann
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "bytecode_program.hpp"
+
+// Compiled programs are stored as images (.mvplc), which are executed in place after mapping
+// them into memory. All numbers are in the byte order of the machine writing the image,
+// every section starts at a multiple of BYTECODE_IMAGE_ALIGNMENT, so that its entries can be
+// used where they are:
+//
+//     header        bytecode_image_header
+//     functions     function_layout[functions.count]
+//     constants     value_t[constants.count]
+//     code          instruction[code.count]
+//     names         bytecode_image_name[names.count], optional debug information
+//     strings       char[strings.count], the names' characters
+//     lines         uint32_t[lines.count], optional source line of every instruction
+//
+// The version changes with the layout of any of the sections. Images of a build with
+// different opcodes are rejected as well.
+inline constexpr std::uint32_t BYTECODE_IMAGE_VERSION    = 2;
+inline constexpr std::size_t   BYTECODE_IMAGE_ALIGNMENT  = 4096;
+inline constexpr std::uint32_t BYTECODE_IMAGE_BYTE_ORDER = 0x01020304;
+
+struct bytecode_image_section
+{
+    // From the start of the image
+    std::uint64_t offset;
+    // Number of entries
+    std::uint64_t count;
+};
+
+struct bytecode_image_header
+{
+    char                   magic[8];
+    std::uint32_t          version;
+    std::uint32_t          byte_order;
+    std::uint32_t          n_opcodes;
+    std::uint32_t          reserved;
+    std::uint64_t          main_function;
+    bytecode_image_section functions;
+    bytecode_image_section constants;
+    bytecode_image_section code;
+    bytecode_image_section names;
+    bytecode_image_section strings;
+    bytecode_image_section lines;
+};
+
+// Name of the function with the same index, a range of the strings section
+struct bytecode_image_name
+{
+    std::uint64_t offset;
+    std::uint64_t length;
+};
+
+// Throws std::runtime_error if the file can not be written
+void write_bytecode_image(const bytecode_program& program,
+                          const std::string&      path,
+                          bool                    with_debug_information = true);
+
+// A read only mapping of an image. Loading only checks, that the header matches this build
+// and that the sections lie within the file. Like the output of the code generator, the code
+// itself is trusted beyond the checks of the register machine.
+class bytecode_image
+{
+ public:
+    // Methods
+    // Throws std::runtime_error if the file can not be mapped or is no valid image
+    explicit bytecode_image(const std::string& path);
+    ~bytecode_image();
+
+    bytecode_image(const bytecode_image&)            = delete;
+    bytecode_image& operator=(const bytecode_image&) = delete;
+
+    // Valid as long as the image exists
+    [[nodiscard]] bytecode_view get_program() const;
+    // Empty if the image has no debug information
+    [[nodiscard]] std::string_view get_function_name(std::size_t function) const;
+
+ private:
+    // Variables
+    std::byte*    memory;
+    std::size_t   size;
+    bytecode_view program;
+
+    // Methods
+    void validate();
+};
@@ -0,0 +1,75 @@
+// Copyright © 2021-2022 Jonas Muehlmann
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include "bytecode_program.hpp"
+
+#include <algorithm>
+#include <iterator>
+#include <numeric>
+
+std::vector<function_layout> get_function_layouts(const bytecode_program& program)
+{
+    std::vector<function_layout> layouts;
+    layouts.reserve(program.functions.size());
+
+    std::ranges::transform(
+        program.functions, std::back_inserter(layouts), [](const function_entry& function) {
+            return function_layout{function.entry, function.n_parameters, function.n_registers};
+        });
+
+    return layouts;
+}
+
+std::vector<std::string> get_function_names(const bytecode_program& program)
+{
+    std::vector<std::string> names;
+    names.reserve(program.functions.size());
+
+    std::ranges::transform(program.functions,
+                           std::back_inserter(names),
+                           [](const function_entry& function) { return function.name; });
+
+    return names;
+}
+
+std::vector<std::size_t> get_instruction_owners(const bytecode_view& program)
+{
+    std::vector<std::size_t> by_entry(program.functions.size());
+    std::iota(by_entry.begin(), by_entry.end(), 0);
+    std::ranges::sort(by_entry, {}, [&program](std::size_t function) {
+        return program.functions[function].entry;
+    });
+
+    std::vector<std::size_t> owners(program.code.size(), 0);
+
+    for (std::size_t i = 0; i < by_entry.size(); ++i)
+    {
+        const auto next = i + 1 < by_entry.size() ? program.functions[by_entry[i + 1]].entry
+                                                  : program.code.size();
+
+        for (auto index = program.functions[by_entry[i]].entry;
+             index < next && index < owners.size();
+             ++index)
+        {
+            owners[index] = by_entry[i];
+        }
+    }
+
+    return owners;
+}
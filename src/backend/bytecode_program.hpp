@@ -0,0 +1,94 @@
+// Copyright © 2021-2022 Jonas Muehlmann
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "common/macros.hpp"
+#include "instruction.hpp"
+#include "value.hpp"
+#include <nlohmann/json.hpp>
+
+using json = nlohmann::ordered_json;
+
+struct function_entry
+{
+    std::string name;
+    // Index of the first instruction in bytecode_program::code
+    std::size_t entry;
+    std::size_t n_parameters;
+    // Size of the register window, parameters occupy the first n_parameters registers
+    std::size_t n_registers;
+
+    bool operator==(const function_entry&) const = default;
+};
+
+// All functions share one code vector, so jump targets and function entries are plain
+// instruction indices.
+struct bytecode_program
+{
+    std::vector<instruction>    code;
+    std::vector<value_t>        constants;
+    std::vector<function_entry> functions;
+    std::size_t                 main_function{};
+    // Source line of every instruction, 0 if unknown. Debug information like the names, it
+    // is neither part of the JSON nor required, programs without lines leave it empty.
+    std::vector<std::uint32_t>  lines{};
+
+    bool operator==(const bytecode_program&) const = default;
+};
+
+// A function_entry without its name, which is only needed for debugging. Having a fixed
+// layout, tables of them can be used straight from a compiled image (see bytecode_image).
+struct function_layout
+{
+    std::uint64_t entry;
+    std::uint64_t n_parameters;
+    std::uint64_t n_registers;
+};
+
+// What the interpreter executes: the sections of a bytecode_program or of a memory mapped
+// image, which have to outlive the view
+struct bytecode_view
+{
+    std::span<const instruction>     code;
+    std::span<const value_t>         constants;
+    std::span<const function_layout> functions;
+    std::size_t                      main_function{};
+    // Empty or parallel to code, see bytecode_program::lines
+    std::span<const std::uint32_t>   lines{};
+};
+
+std::vector<function_layout> get_function_layouts(const bytecode_program& program);
+std::vector<std::string>     get_function_names(const bytecode_program& program);
+
+// Function of every instruction, a function's code reaches up to the next function's entry
+std::vector<std::size_t> get_instruction_owners(const bytecode_view& program);
+
+NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE_UNORDERED(
+    function_entry, name, entry, n_parameters, n_registers);
+
+NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE_UNORDERED(
+    bytecode_program, main_function, functions, constants, code);
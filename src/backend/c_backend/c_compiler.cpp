@@ -0,0 +1,130 @@
+// Copyright © 2021-2022 Jonas Muehlmann
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include "c_compiler.hpp"
+
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#ifdef __unix__
+#    include <spawn.h>
+#    include <sys/wait.h>
+
+extern char** environ;
+#endif
+
+namespace
+{
+std::vector<std::string> split_command(const std::string& command)
+{
+    std::vector<std::string> words;
+    std::istringstream       stream(command);
+
+    for (std::string word; stream >> word;)
+    {
+        words.push_back(word);
+    }
+
+    return words;
+}
+
+std::vector<std::string> compiler_command(const c_compiler_options& options)
+{
+    if (!options.compiler.empty())
+    {
+        return split_command(options.compiler);
+    }
+
+    const char* cc      = std::getenv("CC");
+    auto        command = split_command(cc != nullptr ? cc : "");
+
+    return command.empty() ? std::vector<std::string>{"cc"} : command;
+}
+
+// Runs the command without a shell, so paths need no quoting, and returns its exit status
+int run(const std::vector<std::string>& command)
+{
+#ifdef __unix__
+    std::vector<char*> argv;
+
+    for (const auto& word : command)
+    {
+        argv.push_back(const_cast<char*>(word.c_str()));
+    }
+    argv.push_back(nullptr);
+
+    pid_t pid{};
+
+    if (posix_spawnp(&pid, argv[0], nullptr, nullptr, argv.data(), environ) != 0)
+    {
+        throw std::runtime_error("Could not start the C compiler " + command[0]);
+    }
+
+    int status{};
+
+    if (waitpid(pid, &status, 0) == -1)
+    {
+        throw std::runtime_error("Could not wait for the C compiler");
+    }
+
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+#else
+    (void)command;
+
+    throw std::runtime_error("Invoking the C compiler is not supported on this platform");
+#endif
+}
+}    // namespace
+
+void compile_c(std::string_view          source,
+               const std::string&        output,
+               const c_compiler_options& options)
+{
+    const auto source_file = output + ".c";
+
+    {
+        std::ofstream stream(source_file);
+
+        if (!(stream << source))
+        {
+            throw std::runtime_error("Could not write " + source_file);
+        }
+    }
+
+    auto command = compiler_command(options);
+
+    command.insert(command.end(), options.flags.begin(), options.flags.end());
+
+    if (options.kind == c_output_kind::SHARED_OBJECT)
+    {
+        command.insert(command.end(), {"-shared", "-fPIC", "-DMVPL_SHARED"});
+    }
+
+    command.insert(command.end(), {"-o", output, source_file});
+
+    if (auto status = run(command); status != 0)
+    {
+        throw std::runtime_error("The C compiler failed with exit status "
+                                 + std::to_string(status));
+    }
+}
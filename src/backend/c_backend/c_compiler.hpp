@@ -0,0 +1,46 @@
+// Copyright © 2021-2022 Jonas Muehlmann
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+enum class c_output_kind
+{
+    EXECUTABLE,
+    // Position independent, with MVPL_SHARED defined, see c_translator.hpp
+    SHARED_OBJECT,
+};
+
+struct c_compiler_options
+{
+    c_output_kind            kind{c_output_kind::EXECUTABLE};
+    // Empty for the compiler named by the CC environment variable or cc, split at spaces
+    std::string              compiler;
+    std::vector<std::string> flags{"-O2"};
+};
+
+// Writes the C source next to the output (output with ".c" appended), where it is kept for
+// inspection, and runs the system's C compiler on it. Throws, if the compiler can not be
+// started or fails, whose diagnostics go to stderr.
+void compile_c(std::string_view          source,
+               const std::string&        output,
+               const c_compiler_options& options = {});
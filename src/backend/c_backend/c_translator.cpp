@@ -0,0 +1,1099 @@
+// Copyright © 2021-2022 Jonas Muehlmann
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include "c_translator.hpp"
+
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <variant>
+#include <vector>
+
+#include "backend/interpreter/builtin_functions.hpp"
+#include "backend/value.hpp"
+#include "frontend/lexer/token_type.hpp"
+#include "optimizer/ast_queries.hpp"
+
+namespace
+{
+//****************************************************************************//
+//                                  Runtime                                   //
+//****************************************************************************//
+// Everything the generated code needs, see c_translator.hpp. Names starting with mvpl_ are
+// reserved for the runtime, variables are named v<number>_<name> and temporaries t<number>.
+constexpr std::string_view RUNTIME = R"(#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#if defined(__GNUC__) || defined(__clang__)
+#    define MVPL_NORETURN __attribute__((noreturn))
+#else
+#    define MVPL_NORETURN
+#endif
+
+/* Deeper calls trap, the C stack is not guarded like the interpreter's */
+#ifndef MVPL_MAX_CALL_DEPTH
+#    define MVPL_MAX_CALL_DEPTH 10000
+#endif
+
+typedef int64_t mvpl_value;
+typedef void (*mvpl_trap_handler)(const char* message);
+
+static void mvpl_default_trap_handler(const char* message)
+{
+    fprintf(stderr, "%s\n", message);
+    exit(EXIT_FAILURE);
+}
+
+static mvpl_trap_handler mvpl_on_trap = mvpl_default_trap_handler;
+static FILE*             mvpl_output;
+static long              mvpl_depth;
+
+void mvpl_set_trap_handler(mvpl_trap_handler handler)
+{
+    mvpl_on_trap = handler != NULL ? handler : mvpl_default_trap_handler;
+}
+
+void mvpl_set_output(FILE* output)
+{
+    mvpl_output = output;
+}
+
+static MVPL_NORETURN void mvpl_trap(const char* message)
+{
+    mvpl_on_trap(message);
+    abort();
+}
+
+/* Signed overflow is undefined in C, so arithmetic wraps around in unsigned */
+static inline mvpl_value mvpl_add(mvpl_value lhs, mvpl_value rhs)
+{
+    return (mvpl_value)((uint64_t)lhs + (uint64_t)rhs);
+}
+
+static inline mvpl_value mvpl_sub(mvpl_value lhs, mvpl_value rhs)
+{
+    return (mvpl_value)((uint64_t)lhs - (uint64_t)rhs);
+}
+
+static inline mvpl_value mvpl_mul(mvpl_value lhs, mvpl_value rhs)
+{
+    return (mvpl_value)((uint64_t)lhs * (uint64_t)rhs);
+}
+
+static inline mvpl_value mvpl_div(mvpl_value lhs, mvpl_value rhs)
+{
+    if (rhs == 0)
+    {
+        mvpl_trap("Division by zero");
+    }
+    if (rhs == -1)
+    {
+        return mvpl_sub(0, lhs);
+    }
+
+    return lhs / rhs;
+}
+
+static inline mvpl_value mvpl_mod(mvpl_value lhs, mvpl_value rhs)
+{
+    if (rhs == 0)
+    {
+        mvpl_trap("Modulo by zero");
+    }
+    if (rhs == -1)
+    {
+        return 0;
+    }
+
+    return lhs % rhs;
+}
+
+static inline mvpl_value mvpl_shl(mvpl_value lhs, mvpl_value rhs)
+{
+    return (mvpl_value)((uint64_t)lhs << (rhs & 63));
+}
+
+/* Arithmetic, which C leaves to the implementation, but every common compiler does */
+static inline mvpl_value mvpl_shr(mvpl_value lhs, mvpl_value rhs)
+{
+    return lhs >> (rhs & 63);
+}
+
+static inline void mvpl_print(mvpl_value value)
+{
+    fprintf(mvpl_output != NULL ? mvpl_output : stdout, "%" PRId64 "\n", value);
+}
+
+/* 0 at the end of the input, like the interpreter's read */
+static inline mvpl_value mvpl_read(void)
+{
+    mvpl_value value = 0;
+    int        n_read = scanf("%" SCNd64, &value);
+
+    if (n_read == EOF)
+    {
+        return 0;
+    }
+    if (n_read != 1)
+    {
+        mvpl_trap("Invalid input");
+    }
+
+    return value;
+}
+
+static inline void mvpl_enter(void)
+{
+    if (++mvpl_depth > MVPL_MAX_CALL_DEPTH)
+    {
+        mvpl_trap("Stack overflow");
+    }
+}
+
+static inline mvpl_value mvpl_leave(mvpl_value value)
+{
+    --mvpl_depth;
+    return value;
+}
+)";
+
+constexpr std::string_view ENTRY_POINT = R"(
+mvpl_value mvpl_run(void)
+{
+    mvpl_depth = 0;
+    return mvpl_f_main();
+}
+
+#ifndef MVPL_SHARED
+int main(void)
+{
+    mvpl_run();
+    return EXIT_SUCCESS;
+}
+#endif
+)";
+
+//****************************************************************************//
+//                                  Helpers                                   //
+//****************************************************************************//
+struct function_signature
+{
+    std::size_t n_parameters;
+    bool        returns_value;
+};
+
+using function_table_t = std::unordered_map<std::string_view, function_signature>;
+
+// Operations, which might overflow or trap, are implemented by the runtime
+std::optional<std::string_view> to_runtime_function(token_type token)
+{
+    switch (token)
+    {
+        case token_type::PLUS:
+            return "mvpl_add";
+        case token_type::MINUS:
+            return "mvpl_sub";
+        case token_type::MULTIPLICATION:
+            return "mvpl_mul";
+        case token_type::DIVISION:
+            return "mvpl_div";
+        case token_type::MODULO:
+            return "mvpl_mod";
+        case token_type::LSHIFT:
+            return "mvpl_shl";
+        case token_type::RSHIFT:
+            return "mvpl_shr";
+        default:
+            return std::nullopt;
+    }
+}
+
+std::optional<std::string_view> to_c_operator(token_type token)
+{
+    switch (token)
+    {
+        case token_type::BINARY_AND:
+            return "&";
+        case token_type::BINARY_OR:
+            return "|";
+        case token_type::XOR:
+            return "^";
+        default:
+            return std::nullopt;
+    }
+}
+
+std::optional<std::string_view> to_c_comparison(token_type token)
+{
+    switch (token)
+    {
+        case token_type::LESS:
+            return "<";
+        case token_type::LESSEQ:
+            return "<=";
+        case token_type::GREATER:
+            return ">";
+        case token_type::GREATEREQ:
+            return ">=";
+        case token_type::EQUAL:
+            return "==";
+        case token_type::NEQUAL:
+            return "!=";
+        default:
+            return std::nullopt;
+    }
+}
+
+std::optional<std::string_view> to_runtime_builtin(opcode op)
+{
+    switch (op)
+    {
+        case opcode::PRINT:
+            return "mvpl_print";
+        case opcode::READ:
+            return "mvpl_read";
+        default:
+            return std::nullopt;
+    }
+}
+
+value_t parse_literal(std::string_view literal)
+{
+    value_t value{};
+    auto [end, error] = std::from_chars(literal.data(), literal.data() + literal.size(), value);
+
+    if (error != std::errc{} || end != literal.data() + literal.size())
+    {
+        throw std::runtime_error("Invalid integer literal " + std::string(literal));
+    }
+
+    return value;
+}
+
+// Literals computed by the constant folder might be negative
+bool is_literal(std::string_view argument)
+{
+    return !argument.empty()
+           && (argument.front() == '-' || (argument.front() >= '0' && argument.front() <= '9'));
+}
+
+// The most negative value can not be written as a negated literal in C
+std::string format_literal(value_t value)
+{
+    if (value == std::numeric_limits<value_t>::min())
+    {
+        return "INT64_MIN";
+    }
+    if (value >= std::numeric_limits<std::int32_t>::min()
+        && value <= std::numeric_limits<std::int32_t>::max())
+    {
+        return std::to_string(value);
+    }
+
+    return "INT64_C(" + std::to_string(value) + ")";
+}
+
+bool is_missing(const std::shared_ptr<ast_node_t>& node)
+{
+    return node == nullptr || std::holds_alternative<missing_optional_node>(*node);
+}
+
+//****************************************************************************//
+//                            Function translator                             //
+//****************************************************************************//
+// Expressions are broken up into one temporary per operation, so that C evaluates them in
+// the same order as the interpreter, e.g. x + (++x) reads x before incrementing it.
+// Every declaration gets a C variable of its own, since MVPL allows to redeclare variables
+// in the same scope and initializers refer to the variable they shadow.
+class function_translator
+{
+ public:
+    // Methods
+    function_translator(std::string&            out_,
+                        const function_table_t& functions_,
+                        std::string_view        name_);
+
+    void translate(const signature_node& signature, const block_node& body);
+
+ private:
+    // Variables
+    std::string&                                                    out;
+    const function_table_t&                                         functions;
+    std::string_view                                                name;
+    std::string                                                     code;
+    std::size_t                                                     indentation{1};
+    std::vector<std::unordered_map<std::string_view, std::string>> scopes;
+    std::vector<std::string>                                        parameters;
+    std::size_t                                                     n_variables{0};
+    std::size_t                                                     n_temporaries{0};
+    // Self recursive tail calls jump back to the start instead
+    bool                                                            has_tail_calls{false};
+
+    // Methods
+    void line(std::string_view text);
+    void open();
+    void close();
+
+    std::string        declare_variable(std::string_view identifier);
+    const std::string& lookup_variable(std::string_view identifier) const;
+    std::string        temporary(const std::string& value);
+
+    //**************************    Expressions    *************************//
+    std::string        expression(const ast_node_t& node);
+    std::string        condition(const ast_node_t& node);
+    std::string        logical_operator(const binary_op_node& node);
+    const std::string& increment(const unary_op_node& node);
+    std::string        argument(std::string_view argument_) const;
+    std::string        call(const call_node& node, bool needs_value);
+
+    //**************************    Statements    **************************//
+    void statement(const std::shared_ptr<ast_node_t>& node);
+    void block(const block_node& node);
+    void body(const std::shared_ptr<ast_node_t>& node);
+    void if_chain(const std::vector<std::shared_ptr<ast_node_t>>& statements, std::size_t& i);
+    void loop(const std::shared_ptr<ast_node_t>& condition_,
+              const std::shared_ptr<ast_node_t>& body_,
+              const std::shared_ptr<ast_node_t>& update);
+    void switch_(const switch_node& node);
+    void return_(const return_stmt_node& node);
+    bool tail_call(const return_stmt_node& node);
+
+    friend struct expression_visitor;
+    friend struct statement_visitor;
+};
+
+function_translator::function_translator(std::string&            out_,
+                                         const function_table_t& functions_,
+                                         std::string_view        name_)
+    : out(out_), functions(functions_), name(name_)
+{
+}
+
+void function_translator::line(std::string_view text)
+{
+    code.append(4 * indentation, ' ');
+    code += text;
+    code += '\n';
+}
+
+void function_translator::open()
+{
+    line("{");
+    ++indentation;
+}
+
+void function_translator::close()
+{
+    --indentation;
+    line("}");
+}
+
+std::string function_translator::declare_variable(std::string_view identifier)
+{
+    auto variable = "v" + std::to_string(n_variables++) + "_" + std::string(identifier);
+
+    scopes.back()[identifier] = variable;
+
+    return variable;
+}
+
+const std::string& function_translator::lookup_variable(std::string_view identifier) const
+{
+    for (auto scope = scopes.rbegin(); scope != scopes.rend(); ++scope)
+    {
+        if (auto it = scope->find(identifier); it != scope->end())
+        {
+            return it->second;
+        }
+    }
+
+    throw std::runtime_error("Use of undeclared variable " + std::string(identifier));
+}
+
+std::string function_translator::temporary(const std::string& value)
+{
+    auto temporary_ = "t" + std::to_string(n_temporaries++);
+
+    line("const mvpl_value " + temporary_ + " = " + value + ";");
+
+    return temporary_;
+}
+
+// Increment and decrement assign the new value to their operand, which is returned
+const std::string& function_translator::increment(const unary_op_node& node)
+{
+    const auto& operand = std::get<leaf_node>(*node.operand);
+
+    if (operand.token != token_type::IDENTIFIER)
+    {
+        throw std::runtime_error("Operand of increment/decrement must be a variable");
+    }
+
+    const auto& variable = lookup_variable(operand.value);
+    const auto* function =
+        get_operator(node.operator_) == token_type::INCREMENT ? "mvpl_add" : "mvpl_sub";
+
+    line(variable + " = " + function + "(" + variable + ", 1);");
+
+    return variable;
+}
+
+//****************************************************************************//
+//                                Expressions                                 //
+//****************************************************************************//
+struct expression_visitor
+{
+    function_translator& translator;
+
+    std::string operator()(const leaf_node& node)
+    {
+        if (node.token == token_type::LITERAL)
+        {
+            return format_literal(parse_literal(node.value));
+        }
+        if (node.token == token_type::IDENTIFIER)
+        {
+            return translator.temporary(translator.lookup_variable(node.value));
+        }
+
+        throw std::runtime_error("Unexpected token in expression");
+    }
+
+    std::string operator()(const binary_op_node& node)
+    {
+        auto token = get_operator(node.operator_);
+
+        if (token == token_type::LOGICAL_AND || token == token_type::LOGICAL_OR)
+        {
+            return translator.logical_operator(node);
+        }
+
+        auto function   = to_runtime_function(token);
+        auto operator_  = to_c_operator(token);
+        auto comparison = to_c_comparison(token);
+
+        if (!function && !operator_ && !comparison)
+        {
+            throw std::runtime_error("Unexpected binary operator");
+        }
+
+        auto lhs = translator.expression(*node.lhs);
+        auto rhs = translator.expression(*node.rhs);
+
+        if (function)
+        {
+            return translator.temporary(std::string(*function) + "(" + lhs + ", " + rhs + ")");
+        }
+
+        return translator.temporary(lhs + " " + std::string(operator_ ? *operator_ : *comparison)
+                                    + " " + rhs);
+    }
+
+    std::string operator()(const unary_op_node& node)
+    {
+        auto token = get_operator(node.operator_);
+
+        if (token == token_type::NOT)
+        {
+            return translator.temporary("!" + translator.expression(*node.operand));
+        }
+
+        return translator.temporary(translator.increment(node));
+    }
+
+    std::string operator()(const call_node& node)
+    {
+        return translator.temporary(translator.call(node, true));
+    }
+
+    std::string operator()([[maybe_unused]] const auto& node)
+    {
+        throw std::runtime_error("Unexpected node in expression");
+    }
+};
+
+// Returns a literal or a temporary holding the value
+std::string function_translator::expression(const ast_node_t& node)
+{
+    return std::visit(expression_visitor{*this}, node);
+}
+
+// Returns a C expression, which is true if the condition holds. Comparisons are used right
+// away instead of materializing their value.
+std::string function_translator::condition(const ast_node_t& node)
+{
+    if (const auto* binary_op = std::get_if<binary_op_node>(&node))
+    {
+        if (auto comparison = to_c_comparison(get_operator(binary_op->operator_)))
+        {
+            auto lhs = expression(*binary_op->lhs);
+            auto rhs = expression(*binary_op->rhs);
+
+            return lhs + " " + std::string(*comparison) + " " + rhs;
+        }
+    }
+
+    if (const auto* unary_op = std::get_if<unary_op_node>(&node))
+    {
+        if (get_operator(unary_op->operator_) == token_type::NOT)
+        {
+            return "!(" + condition(*unary_op->operand) + ")";
+        }
+    }
+
+    return expression(node);
+}
+
+// The right operand is only evaluated, if the left one does not decide the result
+std::string function_translator::logical_operator(const binary_op_node& node)
+{
+    const bool is_and = get_operator(node.operator_) == token_type::LOGICAL_AND;
+    auto       result = "t" + std::to_string(n_temporaries++);
+
+    line("mvpl_value " + result + " = " + (is_and ? "0" : "1") + ";");
+
+    auto lhs = condition(*node.lhs);
+
+    line(is_and ? "if (" + lhs + ")" : "if (!(" + lhs + "))");
+    open();
+    line(result + " = (" + condition(*node.rhs) + ") != 0;");
+    close();
+
+    return result;
+}
+
+// Arguments are variables or literals, which can be passed as they are
+std::string function_translator::argument(std::string_view argument_) const
+{
+    return is_literal(argument_) ? format_literal(parse_literal(argument_))
+                                 : lookup_variable(argument_);
+}
+
+// Returns the C call
+std::string function_translator::call(const call_node& node, bool needs_value)
+{
+    const auto& arguments = std::get<parameter_pass_node>(*node.parameter_pass).parameter_list;
+
+    auto check = [&](std::size_t n_parameters, bool returns_value) {
+        if (arguments.size() != n_parameters)
+        {
+            throw std::runtime_error("Wrong number of arguments passed to "
+                                     + std::string(node.identifier));
+        }
+        if (needs_value && !returns_value)
+        {
+            throw std::runtime_error("Procedure " + std::string(node.identifier)
+                                     + " does not return a value");
+        }
+    };
+
+    std::string function;
+
+    if (auto it = functions.find(node.identifier); it != functions.end())
+    {
+        check(it->second.n_parameters, it->second.returns_value);
+        function = "mvpl_f_" + std::string(node.identifier);
+    }
+    else if (auto builtin = find_builtin_function(node.identifier))
+    {
+        check(builtin->n_parameters, builtin->returns_value);
+
+        auto runtime_function = to_runtime_builtin(builtin->op);
+
+        if (!runtime_function)
+        {
+            throw std::runtime_error("Builtin " + std::string(node.identifier)
+                                     + " is not supported by the C translator");
+        }
+        function = *runtime_function;
+    }
+    else
+    {
+        throw std::runtime_error("Call to undefined function " + std::string(node.identifier));
+    }
+
+    function += "(";
+
+    for (std::size_t i = 0; i < arguments.size(); ++i)
+    {
+        function += (i == 0 ? "" : ", ") + argument(arguments[i]);
+    }
+
+    return function + ")";
+}
+
+//****************************************************************************//
+//                                 Statements                                 //
+//****************************************************************************//
+struct statement_visitor
+{
+    function_translator& translator;
+
+    void operator()(const block_node& node)
+    {
+        translator.block(node);
+    }
+
+    void operator()(const var_decl_node& node)
+    {
+        translator.line("mvpl_value " + translator.declare_variable(node.identifier) + " = 0;");
+    }
+
+    void operator()(const var_init_node& node)
+    {
+        // Translated before declaring, the initializer might refer to a shadowed variable
+        auto value = translator.expression(*node.value);
+
+        translator.line("mvpl_value " + translator.declare_variable(node.identifier) + " = "
+                        + value + ";");
+    }
+
+    void operator()(const var_assignment_node& node)
+    {
+        const auto& variable = translator.lookup_variable(node.identifier);
+
+        translator.line(variable + " = " + translator.expression(*node.value) + ";");
+    }
+
+    void operator()(const call_node& node)
+    {
+        translator.line(translator.call(node, false) + ";");
+    }
+
+    void operator()(const binary_op_node& node)
+    {
+        discard(expression_visitor{translator}(node));
+    }
+
+    void operator()(const unary_op_node& node)
+    {
+        if (get_operator(node.operator_) == token_type::NOT)
+        {
+            discard(expression_visitor{translator}(node));
+        }
+        else
+        {
+            translator.increment(node);
+        }
+    }
+
+    void operator()(const leaf_node& node)
+    {
+        discard(expression_visitor{translator}(node));
+    }
+
+    void operator()(const return_stmt_node& node)
+    {
+        translator.return_(node);
+    }
+
+    void operator()(const while_loop_node& node)
+    {
+        translator.loop(node.condition, node.body, nullptr);
+    }
+
+    void operator()(const for_loop_node& node)
+    {
+        translator.open();
+        translator.scopes.emplace_back();
+
+        translator.statement(node.init_stmt);
+        translator.loop(node.test_expression, node.body, node.update_expression);
+
+        translator.scopes.pop_back();
+        translator.close();
+    }
+
+    void operator()(const switch_node& node)
+    {
+        translator.switch_(node);
+    }
+
+    void operator()([[maybe_unused]] const missing_optional_node& node) {}
+
+    void operator()([[maybe_unused]] const auto& node)
+    {
+        throw std::runtime_error("Unexpected node in statement");
+    }
+
+    // Keeps the C compiler from warning about unused temporaries
+    void discard(const std::string& value)
+    {
+        translator.line("(void)" + value + ";");
+    }
+};
+
+void function_translator::statement(const std::shared_ptr<ast_node_t>& node)
+{
+    if (node != nullptr)
+    {
+        std::visit(statement_visitor{*this}, *node);
+    }
+}
+
+void function_translator::block(const block_node& node)
+{
+    open();
+    scopes.emplace_back();
+
+    const auto& statements = node.statements;
+
+    for (std::size_t i = 0; i < statements.size(); ++i)
+    {
+        if (std::holds_alternative<if_stmt_node>(*statements[i]))
+        {
+            if_chain(statements, i);
+        }
+        else
+        {
+            statement(statements[i]);
+        }
+    }
+
+    scopes.pop_back();
+    close();
+}
+
+// Bodies of ifs, loops and cases are always braced
+void function_translator::body(const std::shared_ptr<ast_node_t>& node)
+{
+    if (node != nullptr && std::holds_alternative<block_node>(*node))
+    {
+        block(std::get<block_node>(*node));
+
+        return;
+    }
+
+    open();
+    statement(node);
+    close();
+}
+
+// else if and else statements follow their if statement in the same block, i is left at the
+// last statement of the chain. The condition of an else if is evaluated in the else branch
+// of its predecessor.
+void function_translator::if_chain(const std::vector<std::shared_ptr<ast_node_t>>& statements,
+                                   std::size_t&                                    i)
+{
+    std::size_t n_open = 0;
+
+    for (bool first = true;; first = false, ++i)
+    {
+        const auto& statement_ = *statements[i];
+        const auto* if_stmt    = std::get_if<if_stmt_node>(&statement_);
+        const auto* else_if    = std::get_if<else_if_stmt_node>(&statement_);
+
+        const auto& condition_ = first ? if_stmt->condition : else_if->condition;
+        const auto& body_      = first ? if_stmt->body : else_if->body;
+
+        line("if (" + condition(*condition_) + ")");
+        body(body_);
+
+        bool continues = i + 1 < statements.size()
+                         && (std::holds_alternative<else_if_stmt_node>(*statements[i + 1])
+                             || std::holds_alternative<else_stmt_node>(*statements[i + 1]));
+
+        if (!continues)
+        {
+            break;
+        }
+
+        line("else");
+
+        if (const auto* else_stmt = std::get_if<else_stmt_node>(statements[i + 1].get()))
+        {
+            body(else_stmt->body);
+            ++i;
+            break;
+        }
+
+        open();
+        ++n_open;
+    }
+
+    for (; n_open > 0; --n_open)
+    {
+        close();
+    }
+}
+
+void function_translator::loop(const std::shared_ptr<ast_node_t>& condition_,
+                               const std::shared_ptr<ast_node_t>& body_,
+                               const std::shared_ptr<ast_node_t>& update)
+{
+    line("for (;;)");
+    open();
+
+    if (!is_missing(condition_))
+    {
+        line("if (!(" + condition(*condition_) + "))");
+        open();
+        line("break;");
+        close();
+    }
+
+    body(body_);
+    statement(update);
+    close();
+}
+
+// Literal cases become a C switch, which the C compiler lowers like the code generator
+// would, otherwise the cases are compared in order. A duplicate value belongs to its first
+// case.
+void function_translator::switch_(const switch_node& node)
+{
+    const auto& cases = std::get<block_node>(*node.body).statements;
+    auto        value = expression(*node.expression);
+
+    bool all_literal = true;
+
+    for (const auto& case_ : cases)
+    {
+        all_literal = all_literal && get_literal_value(*std::get<case_node>(*case_).value);
+    }
+
+    if (all_literal)
+    {
+        std::unordered_set<value_t> seen;
+
+        line("switch (" + value + ")");
+        open();
+
+        for (const auto& case_ : cases)
+        {
+            const auto& case_node_  = std::get<case_node>(*case_);
+            auto        case_value = *get_literal_value(*case_node_.value);
+
+            if (seen.insert(case_value).second)
+            {
+                line("case " + format_literal(case_value) + ":");
+                body(case_node_.body);
+                line("break;");
+            }
+        }
+
+        close();
+
+        return;
+    }
+
+    std::size_t n_open = 0;
+
+    for (std::size_t i = 0; i < cases.size(); ++i)
+    {
+        const auto& case_node_ = std::get<case_node>(*cases[i]);
+
+        if (i > 0)
+        {
+            line("else");
+            open();
+            ++n_open;
+        }
+
+        line("if (" + value + " == " + expression(*case_node_.value) + ")");
+        body(case_node_.body);
+    }
+
+    for (; n_open > 0; --n_open)
+    {
+        close();
+    }
+}
+
+void function_translator::return_(const return_stmt_node& node)
+{
+    if (tail_call(node))
+    {
+        return;
+    }
+
+    auto value = node.value != nullptr ? expression(*node.value) : "0";
+
+    line("return mvpl_leave(" + value + ");");
+}
+
+// A function returning the result of calling itself assigns the arguments to its
+// parameters and starts over, so deep tail recursion neither overflows the C stack nor hits
+// the call depth limit, like in the interpreter after eliminate_tail_recursion
+bool function_translator::tail_call(const return_stmt_node& node)
+{
+    const auto* call_ = node.value != nullptr ? std::get_if<call_node>(node.value.get())
+                                              : nullptr;
+
+    if (call_ == nullptr || call_->identifier != name)
+    {
+        return false;
+    }
+
+    call(*call_, true);
+
+    // Copied first, since the arguments might be parameters themselves
+    const auto& arguments = std::get<parameter_pass_node>(*call_->parameter_pass).parameter_list;
+
+    std::vector<std::string> values;
+
+    for (auto argument_ : arguments)
+    {
+        values.push_back(temporary(argument(argument_)));
+    }
+    for (std::size_t i = 0; i < values.size(); ++i)
+    {
+        line(parameters[i] + " = " + values[i] + ";");
+    }
+    line("goto mvpl_start;");
+
+    has_tail_calls = true;
+
+    return true;
+}
+
+void function_translator::translate(const signature_node& signature, const block_node& body_)
+{
+    const auto& parameter_names =
+        std::get<parameter_def_node>(*signature.parameter_list).parameter_list;
+
+    scopes.emplace_back();
+
+    for (auto parameter : parameter_names)
+    {
+        parameters.push_back(declare_variable(parameter));
+    }
+
+    block(body_);
+
+    // Falling off the end returns 0
+    line("return mvpl_leave(0);");
+
+    out += "static mvpl_value mvpl_f_" + std::string(name) + "(";
+
+    for (std::size_t i = 0; i < parameters.size(); ++i)
+    {
+        out += (i == 0 ? "mvpl_value " : ", mvpl_value ") + parameters[i];
+    }
+
+    out += parameters.empty() ? "void)\n{\n" : ")\n{\n";
+    out += "    mvpl_enter();\n";
+
+    if (has_tail_calls)
+    {
+        out += "mvpl_start:;\n";
+    }
+
+    out += code + "}\n\n";
+}
+
+//****************************************************************************//
+//                                 Functions                                  //
+//****************************************************************************//
+// Returns signature and body of function and procedure definitions
+std::optional<std::pair<const signature_node*, const block_node*>>
+get_definition(const ast_node_t& node)
+{
+    auto split = [](const auto& definition) {
+        return std::pair{&std::get<signature_node>(*definition.signature),
+                         &std::get<block_node>(*definition.body)};
+    };
+
+    if (const auto* function = std::get_if<func_def_node>(&node))
+    {
+        return split(*function);
+    }
+    if (const auto* procedure = std::get_if<procedure_def_node>(&node))
+    {
+        return split(*procedure);
+    }
+
+    return std::nullopt;
+}
+
+std::string declare_function(std::string_view name, std::size_t n_parameters)
+{
+    std::string declaration = "static mvpl_value mvpl_f_" + std::string(name) + "(";
+
+    for (std::size_t i = 0; i < n_parameters; ++i)
+    {
+        declaration += i == 0 ? "mvpl_value" : ", mvpl_value";
+    }
+
+    return declaration + (n_parameters == 0 ? "void);\n" : ");\n");
+}
+}    // namespace
+
+//****************************************************************************//
+//                                Entry point                                 //
+//****************************************************************************//
+std::string translate_to_c(const ast_node_t& ast)
+{
+    const auto& globals = std::get<program_node>(ast).globals;
+
+    function_table_t functions;
+
+    std::string out = "/* Generated by mvpl */\n" + std::string(RUNTIME) + "\n";
+
+    for (const auto& global : globals)
+    {
+        auto definition = get_definition(*global);
+
+        if (!definition.has_value())
+        {
+            throw std::runtime_error("Global variables are not supported by the C translator");
+        }
+
+        auto [signature, body] = *definition;
+        auto n_parameters      = std::get<parameter_def_node>(*signature->parameter_list)
+                                .parameter_list.size();
+        auto [it, inserted]    = functions.try_emplace(
+            signature->identifier,
+            function_signature{n_parameters, std::holds_alternative<func_def_node>(*global)});
+
+        if (!inserted)
+        {
+            throw std::runtime_error("Redefinition of function "
+                                     + std::string(signature->identifier));
+        }
+
+        out += declare_function(signature->identifier, n_parameters);
+    }
+
+    if (!functions.contains("main"))
+    {
+        throw std::runtime_error("Program does not define a main function");
+    }
+
+    out += "\n";
+
+    for (const auto& global : globals)
+    {
+        auto [signature, body] = *get_definition(*global);
+
+        function_translator(out, functions, signature->identifier).translate(*signature, *body);
+    }
+
+    return out + std::string(ENTRY_POINT.substr(1));
+}
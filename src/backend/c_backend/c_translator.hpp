@@ -0,0 +1,40 @@
+// Copyright © 2021-2022 Jonas Muehlmann
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#pragma once
+
+#include <string>
+
+#include "frontend/parser/ast_node.hpp"
+
+// Translates the program ahead of time to portable C (C99), one C function per MVPL function
+// or procedure. The runtime the generated code needs is part of the translation unit:
+// wrapping arithmetic, division and modulo trapping on zero, shifts taken modulo 64, print,
+// read from stdin and a limit of MVPL_MAX_CALL_DEPTH nested calls (10000 unless defined).
+// Compiled as an executable, the program runs main and exits with a failure status after
+// printing the message of a trap to stderr.
+// Compiled with MVPL_SHARED defined, the translation unit has no C main and exports instead:
+//
+//     int64_t mvpl_run(void);                          runs main and returns its result
+//     void    mvpl_set_output(FILE* output);           where print writes to, stdout if NULL
+//     void    mvpl_set_trap_handler(void (*)(const char* message));
+//
+// A trap handler must not return (it might longjmp out of the program), otherwise the
+// process is aborted.
+std::string translate_to_c(const ast_node_t& ast);
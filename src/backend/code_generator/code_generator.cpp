@@ -18,3 +18,130 @@
 // TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
 // OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "code_generator.hpp"
+
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+
+#include "backend/instruction.hpp"
+#include "backend/ir/cleanup_passes.hpp"
+#include "backend/ir/inliner.hpp"
+#include "backend/ir/ir_builder.hpp"
+#include "backend/ir/loop_invariant_code_motion.hpp"
+#include "backend/ir/pass_manager.hpp"
+#include "backend/ir/strength_reduction.hpp"
+#include "backend/ir/tail_calls.hpp"
+#include "backend/value.hpp"
+#include "constant_division.hpp"
+#include "ir_lowering.hpp"
+#include "lowered_function.hpp"
+#include "peephole_optimizer.hpp"
+#include "superinstructions.hpp"
+
+//****************************************************************************//
+//                                Entry point                                 //
+//****************************************************************************//
+bytecode_program generate_code(const ast_node_t&             ast,
+                               const code_generator_options& options,
+                               code_generator_report*        report)
+{
+    code_generator_report local_report;
+
+    auto ir = build_ir(ast,
+                       {.select_switch_strategies = options.optimization_level >= 1},
+                       &local_report.switches);
+
+    pass_manager passes(options.verify_ir);
+
+    if (options.optimization_level >= 1)
+    {
+        // Loops made from tail recursion no longer call themselves and can be inlined
+        passes.add_pass("eliminate_tail_recursion", eliminate_tail_recursion);
+        passes.add_pass("inline_calls", [&options](ir_program& program) {
+            return inline_calls(program, options.inlining);
+        });
+        passes.add_pass("hoist_loop_invariants", hoist_loop_invariants);
+        passes.add_pass("reduce_strength", reduce_strength);
+        passes.add_function_pass("eliminate_dead_values", eliminate_dead_values);
+    }
+
+    local_report.ir_passes = passes.run(ir);
+
+    bytecode_program                          program;
+    std::unordered_map<value_t, std::int32_t> constant_indices;
+
+    program.main_function = ir.main_function;
+
+    for (auto& ir_function : ir.functions)
+    {
+        auto function = lower_ir_function(std::move(ir_function),
+                                          program.constants,
+                                          constant_indices,
+                                          options.optimization_level >= 1);
+
+        // The peephole optimizer runs again after forming superinstructions, since folding
+        // immediates leaves behind ADDI r, r, 1 and similar
+        if (options.optimization_level >= 1)
+        {
+            local_report.peephole += optimize_peephole(function, program.constants);
+        }
+
+        if (options.optimization_level >= 1 && options.form_superinstructions)
+        {
+            form_superinstructions(function, program.constants);
+            reduce_constant_divisions(function, program.constants);
+            local_report.peephole += optimize_peephole(function, program.constants);
+        }
+
+        apply_register_allocation(function,
+                                  allocate_registers(function, options.register_budget));
+
+        // Labels become absolute instruction indices
+        const auto entry = program.code.size();
+
+        // Jump tables are appended to the constant pool
+        std::vector<std::int32_t> table_offsets;
+
+        for (const auto& table : function.jump_tables)
+        {
+            table_offsets.push_back(static_cast<std::int32_t>(program.constants.size()));
+
+            for (auto label : table)
+            {
+                program.constants.push_back(static_cast<value_t>(entry + function.labels[label]));
+            }
+        }
+
+        for (auto i : function.code)
+        {
+            if (is_jump(i.op))
+            {
+                i.a = static_cast<std::int32_t>(entry + function.labels[static_cast<std::size_t>(i.a)]);
+            }
+            if (i.op == opcode::JUMPTABLE)
+            {
+                i.b = table_offsets[static_cast<std::size_t>(i.b)];
+            }
+            program.code.push_back(i);
+        }
+
+        if (function.lines.size() == function.code.size())
+        {
+            program.lines.insert(program.lines.end(), function.lines.begin(), function.lines.end());
+        }
+        else
+        {
+            program.lines.resize(program.code.size(), 0);
+        }
+
+        program.functions.push_back(
+            {function.name, entry, function.n_parameters, function.n_registers});
+    }
+
+    if (report != nullptr)
+    {
+        *report = local_report;
+    }
+
+    return program;
+}
@@ -19,3 +19,55 @@
 // OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 #pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "backend/bytecode_program.hpp"
+#include "backend/ir/inliner.hpp"
+#include "backend/ir/pass_manager.hpp"
+#include "backend/ir/switch_strategy.hpp"
+#include "frontend/parser/ast_node.hpp"
+#include "peephole_optimizer.hpp"
+#include "register_allocator.hpp"
+#include <nlohmann/json.hpp>
+
+using json = nlohmann::ordered_json;
+
+struct code_generator_options
+{
+    // Maximum number of registers per frame, excluding spill slots and outgoing arguments
+    std::size_t     register_budget{DEFAULT_REGISTER_BUDGET};
+    bool            form_superinstructions{true};
+    // 0 disables all optimizations (superinstructions included), 1 enables the IR passes,
+    // the peephole optimizer and switch strategies other than comparing the cases in order
+    std::size_t     optimization_level{1};
+    // Runs the IR verifier before and after every IR pass
+    bool            verify_ir{true};
+    inliner_options inlining;
+};
+
+// What the optimizations did, summed over all functions
+struct code_generator_report
+{
+    std::vector<ir_pass_statistics> ir_passes;
+    peephole_statistics             peephole;
+    // Strategy of every switch, in the order of the source
+    std::vector<switch_report>      switches;
+};
+
+inline void to_json(json& j, const code_generator_report& report)
+{
+    j = json{{"ir_passes", report.ir_passes},
+             {"peephole", report.peephole},
+             {"switches", report.switches}};
+}
+
+// Lowers every function of the program to register bytecode. The program is translated to
+// the SSA form IR (see ir.hpp) first, where the IR passes run. Out of SSA, functions use an
+// unbounded number of virtual registers, which are then mapped to at most register_budget
+// registers per frame by a linear scan allocator. If report is given, it is filled with
+// statistics of the optimizations.
+bytecode_program generate_code(const ast_node_t&             ast,
+                               const code_generator_options& options = {},
+                               code_generator_report*        report  = nullptr);
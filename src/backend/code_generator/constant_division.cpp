@@ -0,0 +1,117 @@
+// Copyright © 2021-2022 Jonas Muehlmann
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include "constant_division.hpp"
+
+#include <bit>
+#include <cstdint>
+#include <unordered_map>
+
+#include "backend/opcode.hpp"
+
+magic_divisor compute_magic_divisor(value_t divisor)
+{
+    constexpr std::uint64_t TWO_TO_63 = std::uint64_t{1} << 63;
+
+    const auto magnitude = divisor < 0 ? std::uint64_t{0} - static_cast<std::uint64_t>(divisor)
+                                       : static_cast<std::uint64_t>(divisor);
+    const auto t         = TWO_TO_63 + (static_cast<std::uint64_t>(divisor) >> 63);
+    // Absolute value of the largest dividend, whose remainder is magnitude - 1
+    const auto dividend  = t - 1 - t % magnitude;
+
+    int           p  = 63;
+    std::uint64_t q1 = TWO_TO_63 / dividend;
+    std::uint64_t r1 = TWO_TO_63 - q1 * dividend;
+    std::uint64_t q2 = TWO_TO_63 / magnitude;
+    std::uint64_t r2 = TWO_TO_63 - q2 * magnitude;
+    std::uint64_t delta{};
+
+    // Smallest p, for which 2^p / magnitude is close enough to an integer
+    do
+    {
+        ++p;
+        q1 *= 2;
+        r1 *= 2;
+        if (r1 >= dividend)
+        {
+            ++q1;
+            r1 -= dividend;
+        }
+        q2 *= 2;
+        r2 *= 2;
+        if (r2 >= magnitude)
+        {
+            ++q2;
+            r2 -= magnitude;
+        }
+        delta = magnitude - r2;
+    } while (q1 < delta || (q1 == delta && r1 == 0));
+
+    auto multiplier = static_cast<value_t>(q2 + 1);
+
+    return {divisor < 0 ? wrapping_sub(0, multiplier) : multiplier, p - 64};
+}
+
+std::size_t reduce_constant_divisions(lowered_function& function, std::vector<value_t>& constants)
+{
+    // Index of the magic numbers of every divisor in the constant pool
+    std::unordered_map<value_t, std::int32_t> magic_indices;
+    std::size_t                               n_rewritten = 0;
+
+    for (auto& i : function.code)
+    {
+        if (i.op != opcode::DIVI && i.op != opcode::MODI)
+        {
+            continue;
+        }
+
+        const auto divisor   = static_cast<value_t>(i.c);
+        const auto magnitude = static_cast<std::uint64_t>(divisor < 0 ? -divisor : divisor);
+
+        if (magnitude < 2)
+        {
+            continue;
+        }
+
+        // The remainder only depends on the magnitude of the divisor
+        if (std::has_single_bit(magnitude) && (divisor > 0 || i.op == opcode::MODI))
+        {
+            i.op = i.op == opcode::DIVI ? opcode::DIVPOW2I : opcode::MODPOW2I;
+            i.c  = std::countr_zero(magnitude);
+        }
+        else
+        {
+            auto [it, inserted] =
+                magic_indices.try_emplace(divisor, static_cast<std::int32_t>(constants.size()));
+
+            if (inserted)
+            {
+                const auto magic = compute_magic_divisor(divisor);
+
+                constants.insert(constants.end(), {magic.multiplier, magic.shift, divisor});
+            }
+
+            i.op = i.op == opcode::DIVI ? opcode::DIVMAGIC : opcode::MODMAGIC;
+            i.c  = it->second;
+        }
+        ++n_rewritten;
+    }
+
+    return n_rewritten;
+}
@@ -0,0 +1,46 @@
+// Copyright © 2021-2022 Jonas Muehlmann
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "backend/value.hpp"
+#include "lowered_function.hpp"
+
+// Multiplier and shift, which replace a signed division by a constant with a multiplication
+// keeping the upper half of the product (see divide_by_magic() in value.hpp)
+struct magic_divisor
+{
+    value_t multiplier;
+    value_t shift;
+};
+
+// Magic numbers by Granlund and Montgomery as derived in Hacker's Delight 10-4, for divisors
+// with an absolute value of at least 2, which is not a power of two
+magic_divisor compute_magic_divisor(value_t divisor);
+
+// Division is the most expensive arithmetic instruction. Rewrites DIVI and MODI formed by
+// the superinstructions, whose divisor is not 0, 1 or -1:
+//   - by a power of two, to DIVPOW2I and MODPOW2I, which shift and mask the dividend
+//   - by anything else to DIVMAGIC and MODMAGIC, which multiply with the divisor's magic
+//     number. The magic numbers are appended to the constant pool.
+// Returns the number of rewritten instructions.
+std::size_t reduce_constant_divisions(lowered_function& function, std::vector<value_t>& constants);
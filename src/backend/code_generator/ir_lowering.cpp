@@ -0,0 +1,876 @@
+// Copyright © 2021-2022 Jonas Muehlmann
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include "ir_lowering.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <numeric>
+#include <stdexcept>
+#include <utility>
+
+#include "backend/instruction.hpp"
+#include "backend/ir/tail_calls.hpp"
+#include "backend/opcode.hpp"
+
+namespace
+{
+//****************************************************************************//
+//                                  Helpers                                   //
+//****************************************************************************//
+opcode to_opcode(ir_opcode op)
+{
+    switch (op)
+    {
+        case ir_opcode::ADD:
+            return opcode::ADD;
+        case ir_opcode::SUB:
+            return opcode::SUB;
+        case ir_opcode::MUL:
+            return opcode::MUL;
+        case ir_opcode::DIV:
+            return opcode::DIV;
+        case ir_opcode::MOD:
+            return opcode::MOD;
+        case ir_opcode::AND:
+            return opcode::AND;
+        case ir_opcode::OR:
+            return opcode::OR;
+        case ir_opcode::XOR:
+            return opcode::XOR;
+        case ir_opcode::LSHIFT:
+            return opcode::LSHIFT;
+        case ir_opcode::RSHIFT:
+            return opcode::RSHIFT;
+        case ir_opcode::NOT:
+            return opcode::NOT;
+        default:
+            throw std::runtime_error("IR opcode has no bytecode equivalent");
+    }
+}
+
+opcode to_conditional_jump(ir_condition condition)
+{
+    switch (condition)
+    {
+        case ir_condition::EQUAL:
+            return opcode::JUMPEQ;
+        case ir_condition::NEQUAL:
+            return opcode::JUMPNEQ;
+        case ir_condition::LESS:
+            return opcode::JUMPLESS;
+        case ir_condition::LESSEQ:
+            return opcode::JUMPLEQ;
+        case ir_condition::GREATER:
+            return opcode::JUMPGREATER;
+        case ir_condition::GREATEREQ:
+            return opcode::JUMPGEQ;
+        default:
+            throw std::runtime_error("Invalid condition");
+    }
+}
+
+// Splits the edges from blocks with several successors into blocks with phis. The new
+// blocks are laid out right before their target, so their copies fall through into it.
+void split_critical_edges(ir_function& function)
+{
+    auto n_blocks = function.blocks.size();
+
+    std::vector<std::vector<ir_block_id>> inserted_before(n_blocks);
+
+    for (ir_block_id block = 0; block < n_blocks; ++block)
+    {
+        if (function.blocks[block].count_phis() == 0)
+        {
+            continue;
+        }
+
+        for (std::size_t i = 0; i < function.blocks[block].predecessors.size(); ++i)
+        {
+            auto predecessor = function.blocks[block].predecessors[i];
+
+            if (function.blocks[predecessor].successors.size() > 1)
+            {
+                inserted_before[block].push_back(split_edge(function, predecessor, block));
+            }
+        }
+    }
+
+    std::vector<ir_block_id> order;
+
+    for (ir_block_id block = 0; block < n_blocks; ++block)
+    {
+        order.insert(order.end(), inserted_before[block].begin(), inserted_before[block].end());
+        order.push_back(block);
+    }
+
+    reorder_blocks(function, order);
+}
+
+//****************************************************************************//
+//                                 Coalescing                                 //
+//****************************************************************************//
+// Groups values into classes, which share one virtual register. Only values connected by
+// phis or copies are candidates for sharing, so liveness is only tracked for those.
+class value_coalescer
+{
+ public:
+    // Methods
+    explicit value_coalescer(const ir_function& function_)
+        : function(function_), classes(function_.n_values), members(function_.n_values)
+    {
+        std::iota(classes.begin(), classes.end(), 0);
+
+        for (ir_value_id value = 0; value < function.n_values; ++value)
+        {
+            members[value] = {value};
+        }
+
+        find_candidates();
+        compute_interference();
+    }
+
+    void coalesce()
+    {
+        for (const auto& block : function.blocks)
+        {
+            for (const auto& instruction : block.instructions)
+            {
+                if (instruction.op == ir_opcode::PHI || instruction.op == ir_opcode::COPY)
+                {
+                    for (auto operand : instruction.operands)
+                    {
+                        try_merge(instruction.result, operand);
+                    }
+                }
+            }
+        }
+    }
+
+    ir_value_id get_class(ir_value_id value) const
+    {
+        return classes[value];
+    }
+
+ private:
+    // Variables
+    const ir_function&                    function;
+    std::vector<ir_value_id>              classes;
+    std::vector<std::vector<ir_value_id>> members;
+    // Index of each candidate or NO_VALUE
+    std::vector<ir_value_id>              candidate_index;
+    std::size_t                           n_candidates{};
+    std::vector<std::vector<ir_value_id>> interference;
+    std::vector<bool>                     is_parameter;
+
+    // Methods
+    void find_candidates()
+    {
+        candidate_index.assign(function.n_values, NO_VALUE);
+        is_parameter.assign(function.n_values, false);
+
+        auto add = [this](ir_value_id value) {
+            if (candidate_index[value] == NO_VALUE)
+            {
+                candidate_index[value] = static_cast<ir_value_id>(n_candidates++);
+            }
+        };
+
+        for (const auto& block : function.blocks)
+        {
+            for (const auto& instruction : block.instructions)
+            {
+                if (instruction.op == ir_opcode::PARAMETER)
+                {
+                    is_parameter[instruction.result] = true;
+                }
+                if (instruction.op == ir_opcode::PHI || instruction.op == ir_opcode::COPY)
+                {
+                    add(instruction.result);
+                    std::ranges::for_each(instruction.operands, add);
+                }
+            }
+        }
+
+        interference.resize(function.n_values);
+    }
+
+    // Two candidates interfere, if one of them is live where the other one is defined. Phis
+    // define their results at the start of the block and use their operands at the end of
+    // the predecessors.
+    void compute_interference()
+    {
+        if (n_candidates == 0)
+        {
+            return;
+        }
+
+        const auto n_blocks = function.blocks.size();
+
+        std::vector<std::vector<bool>> live_in(n_blocks, std::vector<bool>(n_candidates));
+        std::vector<std::vector<bool>> live_out(n_blocks, std::vector<bool>(n_candidates));
+
+        auto index = [this](ir_value_id value) { return candidate_index[value]; };
+
+        auto compute_live_out = [&](ir_block_id id) {
+            std::vector<bool> live(n_candidates);
+
+            for (auto successor : function.blocks[id].successors)
+            {
+                const auto& target = function.blocks[successor];
+
+                for (std::size_t i = 0; i < n_candidates; ++i)
+                {
+                    live[i] = live[i] || live_in[successor][i];
+                }
+
+                for (std::size_t p = 0; p < target.predecessors.size(); ++p)
+                {
+                    if (target.predecessors[p] != id)
+                    {
+                        continue;
+                    }
+                    for (std::size_t i = 0; i < target.count_phis(); ++i)
+                    {
+                        live[index(target.instructions[i].operands[p])] = true;
+                    }
+                }
+            }
+
+            return live;
+        };
+
+        // Walks the block backwards, calling on_definition with the values live after
+        // every definition, and returns the values live at its start (without phis)
+        auto walk = [&](ir_block_id id, std::vector<bool> live, auto&& on_definition) {
+            const auto& instructions = function.blocks[id].instructions;
+
+            for (auto i = instructions.size(); i-- > 0;)
+            {
+                const auto& instruction = instructions[i];
+
+                // Phi results are defined at the start of the block, their operands are
+                // used by the predecessors
+                if (instruction.op == ir_opcode::PHI)
+                {
+                    if (index(instruction.result) != NO_VALUE)
+                    {
+                        live[index(instruction.result)] = false;
+                    }
+                    continue;
+                }
+                if (instruction.result != NO_VALUE && index(instruction.result) != NO_VALUE)
+                {
+                    on_definition(instruction.result, live);
+                    live[index(instruction.result)] = false;
+                }
+                for (auto operand : instruction.operands)
+                {
+                    if (index(operand) != NO_VALUE)
+                    {
+                        live[index(operand)] = true;
+                    }
+                }
+            }
+
+            return live;
+        };
+
+        auto ignore = [](ir_value_id, const std::vector<bool>&) {};
+
+        for (bool changed = true; changed;)
+        {
+            changed = false;
+
+            for (auto id = static_cast<ir_block_id>(n_blocks); id-- > 0;)
+            {
+                live_out[id] = compute_live_out(id);
+                auto live    = walk(id, live_out[id], ignore);
+
+                if (live != live_in[id])
+                {
+                    live_in[id] = std::move(live);
+                    changed     = true;
+                }
+            }
+        }
+
+        std::vector<ir_value_id> values_by_index(n_candidates);
+
+        for (ir_value_id value = 0; value < function.n_values; ++value)
+        {
+            if (index(value) != NO_VALUE)
+            {
+                values_by_index[index(value)] = value;
+            }
+        }
+
+        auto add_interference = [&](ir_value_id value, const std::vector<bool>& live) {
+            for (std::size_t i = 0; i < n_candidates; ++i)
+            {
+                if (live[i] && values_by_index[i] != value)
+                {
+                    interference[value].push_back(values_by_index[i]);
+                    interference[values_by_index[i]].push_back(value);
+                }
+            }
+        };
+
+        for (ir_block_id id = 0; id < n_blocks; ++id)
+        {
+            auto live = walk(id, live_out[id], add_interference);
+
+            // Phi results are defined together at the start of the block
+            const auto& block = function.blocks[id];
+
+            for (std::size_t i = 0; i < block.count_phis(); ++i)
+            {
+                live[index(block.instructions[i].result)] = true;
+            }
+            for (std::size_t i = 0; i < block.count_phis(); ++i)
+            {
+                add_interference(block.instructions[i].result, live);
+            }
+        }
+    }
+
+    bool interfere(ir_value_id a, ir_value_id b) const
+    {
+        const auto& smaller = members[a].size() < members[b].size() ? members[a] : members[b];
+        auto        other   = members[a].size() < members[b].size() ? b : a;
+
+        return std::ranges::any_of(smaller, [&](ir_value_id member) {
+            return std::ranges::any_of(interference[member], [&](ir_value_id neighbor) {
+                return classes[neighbor] == other;
+            });
+        });
+    }
+
+    bool contains_parameter(ir_value_id a) const
+    {
+        return std::ranges::any_of(members[a], [this](ir_value_id v) { return is_parameter[v]; });
+    }
+
+    void try_merge(ir_value_id a, ir_value_id b)
+    {
+        a = classes[a];
+        b = classes[b];
+
+        // Parameters arrive in fixed registers, so two of them can not share one
+        if (a == b || interfere(a, b) || (contains_parameter(a) && contains_parameter(b)))
+        {
+            return;
+        }
+
+        if (members[a].size() < members[b].size())
+        {
+            std::swap(a, b);
+        }
+
+        for (auto member : members[b])
+        {
+            classes[member] = a;
+        }
+        members[a].insert(members[a].end(), members[b].begin(), members[b].end());
+        members[b].clear();
+    }
+};
+
+//****************************************************************************//
+//                                  Emission                                  //
+//****************************************************************************//
+class function_emitter
+{
+ public:
+    // Methods
+    function_emitter(const ir_function&                         function_,
+                     std::vector<value_t>&                      constants_,
+                     std::unordered_map<value_t, std::int32_t>& constant_indices_,
+                     bool                                       emit_tail_calls_)
+        : function(function_),
+          constants(constants_),
+          constant_indices(constant_indices_),
+          emit_tail_calls(emit_tail_calls_),
+          definitions(function_.n_values, nullptr),
+          registers(function_.n_values, NO_REGISTER)
+    {
+        lowered.name         = function.name;
+        lowered.n_parameters = function.n_parameters;
+    }
+
+    lowered_function emit()
+    {
+        assign_registers();
+        collect_copies();
+        forward_empty_blocks();
+
+        // One label per block, comparisons add their own
+        lowered.labels.resize(function.blocks.size());
+
+        for (ir_block_id id = 0; id < function.blocks.size(); ++id)
+        {
+            if (forwarded[id] == id)
+            {
+                lowered.labels[id] = lowered.code.size();
+                emit_block(id);
+            }
+        }
+
+        for (ir_block_id id = 0; id < function.blocks.size(); ++id)
+        {
+            lowered.labels[id] = lowered.labels[forwarded[id]];
+        }
+
+        return std::move(lowered);
+    }
+
+ private:
+    struct copy
+    {
+        std::int32_t destination;
+        ir_value_id  source;
+    };
+
+    // Variables
+    const ir_function&                         function;
+    std::vector<value_t>&                      constants;
+    std::unordered_map<value_t, std::int32_t>& constant_indices;
+    bool                                       emit_tail_calls;
+    lowered_function                           lowered;
+    std::vector<const ir_instruction*>         definitions;
+    std::vector<std::int32_t>                  registers;
+    // Copies executed at the end of each block for the phis of its successor
+    std::vector<std::vector<copy>>             copies;
+    // Blocks consisting of a single jump are replaced by their target
+    std::vector<ir_block_id>                   forwarded;
+    // Line of the IR instruction being emitted, the copies of phis take the terminator's
+    std::uint32_t                              line{};
+
+    // Methods
+    std::int32_t new_register()
+    {
+        return static_cast<std::int32_t>(lowered.n_virtual_registers++);
+    }
+
+    std::size_t new_label()
+    {
+        lowered.labels.push_back(0);
+
+        return lowered.labels.size() - 1;
+    }
+
+    void emit(opcode op, std::int32_t a = 0, std::int32_t b = 0, std::int32_t c = 0)
+    {
+        lowered.code.push_back({op, a, b, c});
+        lowered.lines.push_back(line);
+    }
+
+    std::int32_t get_constant(value_t value)
+    {
+        auto [it, inserted] =
+            constant_indices.try_emplace(value, static_cast<std::int32_t>(constants.size()));
+
+        if (inserted)
+        {
+            constants.push_back(value);
+        }
+
+        return it->second;
+    }
+
+    std::int32_t reg(ir_value_id value) const
+    {
+        return registers[value];
+    }
+
+    const ir_instruction* get_constant_definition(ir_value_id value) const
+    {
+        const auto* definition = definitions[value];
+
+        return definition != nullptr && definition->op == ir_opcode::CONSTANT ? definition
+                                                                              : nullptr;
+    }
+
+    // Parameters arrive in the first registers, every other class gets a fresh one
+    void assign_registers()
+    {
+        value_coalescer coalescer(function);
+        coalescer.coalesce();
+
+        lowered.n_virtual_registers = function.n_parameters;
+
+        std::vector<std::int32_t> class_registers(function.n_values, NO_REGISTER);
+
+        for (const auto& block : function.blocks)
+        {
+            for (const auto& instruction : block.instructions)
+            {
+                if (instruction.op == ir_opcode::PARAMETER)
+                {
+                    class_registers[coalescer.get_class(instruction.result)] =
+                        static_cast<std::int32_t>(instruction.immediate);
+                }
+                if (instruction.result != NO_VALUE)
+                {
+                    definitions[instruction.result] = &instruction;
+                }
+            }
+        }
+
+        for (ir_value_id value = 0; value < function.n_values; ++value)
+        {
+            if (definitions[value] == nullptr)
+            {
+                continue;
+            }
+
+            auto& class_register = class_registers[coalescer.get_class(value)];
+
+            if (class_register == NO_REGISTER)
+            {
+                class_register = new_register();
+            }
+            registers[value] = class_register;
+        }
+    }
+
+    void collect_copies()
+    {
+        copies.resize(function.blocks.size());
+
+        for (const auto& block : function.blocks)
+        {
+            for (std::size_t p = 0; p < block.predecessors.size(); ++p)
+            {
+                for (std::size_t i = 0; i < block.count_phis(); ++i)
+                {
+                    const auto& phi    = block.instructions[i];
+                    auto        source = phi.operands[p];
+
+                    if (reg(phi.result) != reg(source))
+                    {
+                        copies[block.predecessors[p]].push_back({reg(phi.result), source});
+                    }
+                }
+            }
+        }
+    }
+
+    void forward_empty_blocks()
+    {
+        forwarded.resize(function.blocks.size());
+
+        auto is_empty = [this](ir_block_id id) {
+            const auto& block = function.blocks[id];
+
+            return id != 0 && block.instructions.size() == 1
+                   && block.terminator().op == ir_opcode::JUMP && copies[id].empty();
+        };
+
+        for (ir_block_id id = 0; id < function.blocks.size(); ++id)
+        {
+            // Follows chains of empty blocks, an empty infinite loop keeps its last block
+            auto target = id;
+
+            for (std::size_t steps = 0; is_empty(target) && steps < function.blocks.size();
+                 ++steps)
+            {
+                target = function.blocks[target].successors[0];
+            }
+            forwarded[id] = is_empty(target) ? id : target;
+        }
+    }
+
+    // The next block, which is actually emitted
+    ir_block_id get_fallthrough(ir_block_id id) const
+    {
+        for (++id; id < function.blocks.size(); ++id)
+        {
+            if (forwarded[id] == id)
+            {
+                return id;
+            }
+        }
+
+        return NO_BLOCK;
+    }
+
+    void emit_block(ir_block_id id)
+    {
+        const auto& block     = function.blocks[id];
+        const auto  tail_call = emit_tail_calls ? find_tail_call(block) : std::nullopt;
+
+        for (std::size_t i = 0; i < block.instructions.size(); ++i)
+        {
+            const auto& instruction = block.instructions[i];
+            line                    = instruction.line;
+
+            if (tail_call == i)
+            {
+                // The callee returns straight to our caller, which makes the RET unreachable
+                emit_call(instruction, opcode::TAILCALL);
+                break;
+            }
+            if (is_terminator(instruction.op))
+            {
+                emit_copies(copies[id]);
+                emit_terminator(id, instruction);
+            }
+            else
+            {
+                emit_instruction(instruction);
+            }
+        }
+    }
+
+    void emit_instruction(const ir_instruction& instruction)
+    {
+        switch (instruction.op)
+        {
+            case ir_opcode::PHI:
+                // Handled by the copies in the predecessors
+                break;
+            case ir_opcode::CONSTANT:
+                emit(opcode::SETLIT, reg(instruction.result), get_constant(instruction.immediate));
+                break;
+            case ir_opcode::PARAMETER:
+                if (reg(instruction.result) != instruction.immediate)
+                {
+                    emit(opcode::SET,
+                         reg(instruction.result),
+                         static_cast<std::int32_t>(instruction.immediate));
+                }
+                break;
+            case ir_opcode::COPY:
+                if (reg(instruction.result) != reg(instruction.operands[0]))
+                {
+                    emit(opcode::SET, reg(instruction.result), reg(instruction.operands[0]));
+                }
+                break;
+            case ir_opcode::NOT:
+                emit(opcode::NOT, reg(instruction.result), reg(instruction.operands[0]));
+                break;
+            case ir_opcode::COMPARE:
+                emit_compare(instruction);
+                break;
+            case ir_opcode::CALL:
+                emit_call(instruction);
+                break;
+            case ir_opcode::BUILTIN:
+                // Builtins take their single argument or return their value in operand a
+                emit(static_cast<opcode>(instruction.immediate),
+                     reg(instruction.result != NO_VALUE ? instruction.result
+                                                        : instruction.operands[0]));
+                break;
+            default:
+                emit(to_opcode(instruction.op),
+                     reg(instruction.result),
+                     reg(instruction.operands[0]),
+                     reg(instruction.operands[1]));
+                break;
+        }
+    }
+
+    void emit_compare(const ir_instruction& instruction)
+    {
+        auto lhs = reg(instruction.operands[0]);
+        auto rhs = reg(instruction.operands[1]);
+
+        // A fresh register, if the result shares one with an operand read by the jump
+        auto result = reg(instruction.result);
+        auto target = result == lhs || result == rhs ? new_register() : result;
+        auto done   = new_label();
+
+        emit(opcode::SETLIT, target, get_constant(1));
+        emit(to_conditional_jump(instruction.condition()),
+             static_cast<std::int32_t>(done),
+             lhs,
+             rhs);
+        emit(opcode::SETLIT, target, get_constant(0));
+        lowered.labels[done] = lowered.code.size();
+
+        if (target != result)
+        {
+            emit(opcode::SET, result, target);
+        }
+    }
+
+    void emit_call(const ir_instruction& instruction, opcode op = opcode::CALL)
+    {
+        for (std::size_t i = 0; i < instruction.operands.size(); ++i)
+        {
+            auto argument = instruction.operands[i];
+            auto slot     = OUTGOING_SLOT_BASE + static_cast<std::int32_t>(i);
+
+            if (const auto* constant = get_constant_definition(argument))
+            {
+                emit(opcode::SETLIT, slot, get_constant(constant->immediate));
+            }
+            else
+            {
+                emit(opcode::SET, slot, reg(argument));
+            }
+        }
+        lowered.n_outgoing_slots = std::max(lowered.n_outgoing_slots, instruction.operands.size());
+
+        emit(op,
+             op == opcode::CALL ? reg(instruction.result) : 0,
+             static_cast<std::int32_t>(instruction.immediate),
+             OUTGOING_SLOT_BASE);
+    }
+
+    // The copies happen in parallel: every source is read before any destination is written
+    void emit_copies(std::vector<copy> pending)
+    {
+        // Constants do not read registers and are loaded last
+        std::vector<copy> constant_loads;
+
+        std::erase_if(pending, [&](const copy& c) {
+            if (get_constant_definition(c.source) == nullptr)
+            {
+                return false;
+            }
+            constant_loads.push_back(c);
+
+            return true;
+        });
+
+        std::vector<std::pair<std::int32_t, std::int32_t>> moves;
+
+        for (const auto& c : pending)
+        {
+            moves.emplace_back(c.destination, reg(c.source));
+        }
+
+        while (!moves.empty())
+        {
+            auto ready = std::ranges::find_if(moves, [&moves](const auto& move) {
+                return std::ranges::none_of(
+                    moves, [&move](const auto& other) { return other.second == move.first; });
+            });
+
+            if (ready == moves.end())
+            {
+                // Only cycles are left, one destination is saved to break them
+                auto saved     = moves.front().first;
+                auto temporary = new_register();
+
+                emit(opcode::SET, temporary, saved);
+                for (auto& move : moves)
+                {
+                    if (move.second == saved)
+                    {
+                        move.second = temporary;
+                    }
+                }
+                continue;
+            }
+
+            emit(opcode::SET, ready->first, ready->second);
+            moves.erase(ready);
+        }
+
+        for (const auto& c : constant_loads)
+        {
+            emit(opcode::SETLIT,
+                 c.destination,
+                 get_constant(get_constant_definition(c.source)->immediate));
+        }
+    }
+
+    void emit_jump(opcode op, ir_block_id target, std::int32_t b = 0, std::int32_t c = 0)
+    {
+        emit(op, static_cast<std::int32_t>(forwarded[target]), b, c);
+    }
+
+    void emit_terminator(ir_block_id id, const ir_instruction& instruction)
+    {
+        const auto& successors  = function.blocks[id].successors;
+        auto        fallthrough = get_fallthrough(id);
+
+        switch (instruction.op)
+        {
+            case ir_opcode::JUMP:
+                if (forwarded[successors[0]] != fallthrough)
+                {
+                    emit_jump(opcode::JUMP, successors[0]);
+                }
+                break;
+            case ir_opcode::BRANCH:
+            {
+                auto jump = to_conditional_jump(instruction.condition());
+                auto lhs  = reg(instruction.operands[0]);
+                auto rhs  = reg(instruction.operands[1]);
+
+                if (forwarded[successors[0]] == fallthrough)
+                {
+                    emit_jump(negate_conditional_jump(jump), successors[1], lhs, rhs);
+                }
+                else
+                {
+                    emit_jump(jump, successors[0], lhs, rhs);
+
+                    if (forwarded[successors[1]] != fallthrough)
+                    {
+                        emit_jump(opcode::JUMP, successors[1]);
+                    }
+                }
+                break;
+            }
+            case ir_opcode::SWITCH:
+            {
+                std::vector<std::size_t> table;
+
+                for (auto target : instruction.targets)
+                {
+                    table.push_back(forwarded[successors[target]]);
+                }
+
+                emit(opcode::JUMPTABLE,
+                     reg(instruction.operands[0]),
+                     static_cast<std::int32_t>(lowered.jump_tables.size()),
+                     static_cast<std::int32_t>(table.size()));
+                lowered.jump_tables.push_back(std::move(table));
+
+                // Indices out of range fall through to successor 0
+                if (forwarded[successors[0]] != fallthrough)
+                {
+                    emit_jump(opcode::JUMP, successors[0]);
+                }
+                break;
+            }
+            case ir_opcode::RET:
+                emit(opcode::RET, reg(instruction.operands[0]));
+                break;
+            default:
+                throw std::runtime_error("Invalid terminator");
+        }
+    }
+};
+}    // namespace
+
+lowered_function lower_ir_function(ir_function                                function,
+                                   std::vector<value_t>&                      constants,
+                                   std::unordered_map<value_t, std::int32_t>& constant_indices,
+                                   bool                                       emit_tail_calls)
+{
+    split_critical_edges(function);
+
+    return function_emitter(function, constants, constant_indices, emit_tail_calls).emit();
+}
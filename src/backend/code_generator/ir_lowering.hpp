@@ -0,0 +1,39 @@
+// Copyright © 2021-2022 Jonas Muehlmann
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "backend/ir/ir.hpp"
+#include "backend/value.hpp"
+#include "lowered_function.hpp"
+
+// Translates a function out of SSA form into code on virtual registers. Values connected by
+// phis and copies share a register where their live ranges do not interfere, the remaining
+// phis become parallel copies at the end of the predecessors. Critical edges into blocks
+// with phis are split first, so the copies only execute on the edge they belong to.
+// Constants are added to the program's constant pool. With emit_tail_calls, calls whose
+// result is returned right away become a TAILCALL reusing the frame.
+lowered_function lower_ir_function(ir_function                                function,
+                                   std::vector<value_t>&                      constants,
+                                   std::unordered_map<value_t, std::int32_t>& constant_indices,
+                                   bool                                       emit_tail_calls);
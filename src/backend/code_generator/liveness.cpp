@@ -0,0 +1,207 @@
+// Copyright © 2021-2022 Jonas Muehlmann
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include "liveness.hpp"
+
+#include <algorithm>
+#include <utility>
+
+std::vector<basic_block> split_basic_blocks(const lowered_function& function)
+{
+    const auto&       code = function.code;
+    std::vector<bool> is_leader(code.size() + 1, false);
+
+    is_leader[0] = true;
+
+    for (auto label : function.labels)
+    {
+        is_leader[label] = true;
+    }
+
+    for (std::size_t i = 0; i < code.size(); ++i)
+    {
+        if (is_jump(code[i].op) || is_terminator(code[i].op) || code[i].op == opcode::JUMPTABLE)
+        {
+            is_leader[i + 1] = true;
+        }
+    }
+
+    std::vector<basic_block> blocks;
+    std::vector<std::size_t> block_of_instruction(code.size() + 1, 0);
+
+    for (std::size_t i = 0; i < code.size(); ++i)
+    {
+        if (is_leader[i])
+        {
+            blocks.push_back({i, i, {}});
+        }
+        blocks.back().end       = i + 1;
+        block_of_instruction[i] = blocks.size() - 1;
+    }
+    block_of_instruction[code.size()] = blocks.size();
+
+    for (std::size_t b = 0; b < blocks.size(); ++b)
+    {
+        const auto& last = code[blocks[b].end - 1];
+
+        if (is_jump(last.op))
+        {
+            auto target = block_of_instruction[function.labels[static_cast<std::size_t>(last.a)]];
+
+            if (target < blocks.size())
+            {
+                blocks[b].successors.push_back(target);
+            }
+        }
+        if (last.op == opcode::JUMPTABLE)
+        {
+            for (auto label : function.jump_tables[static_cast<std::size_t>(last.b)])
+            {
+                auto target = block_of_instruction[function.labels[label]];
+
+                auto& successors = blocks[b].successors;
+
+                if (target < blocks.size()
+                    && std::ranges::find(successors, target) == successors.end())
+                {
+                    successors.push_back(target);
+                }
+            }
+        }
+        if (!is_terminator(last.op) && b + 1 < blocks.size())
+        {
+            blocks[b].successors.push_back(b + 1);
+        }
+    }
+
+    return blocks;
+}
+
+std::optional<std::int32_t> get_defined_virtual_register(const instruction& i)
+{
+    auto reg = get_defined_register(i);
+
+    if (reg.has_value() && is_virtual_register(*reg))
+    {
+        return reg;
+    }
+
+    return std::nullopt;
+}
+
+liveness compute_liveness(const lowered_function& function)
+{
+    const auto& code        = function.code;
+    const auto  n_registers = function.n_virtual_registers;
+
+    liveness result;
+    result.blocks = split_basic_blocks(function);
+
+    const auto& blocks = result.blocks;
+
+    std::vector<std::vector<bool>> uses(blocks.size(), std::vector<bool>(n_registers, false));
+    std::vector<std::vector<bool>> defs(blocks.size(), std::vector<bool>(n_registers, false));
+
+    result.live_in.assign(blocks.size(), std::vector<bool>(n_registers, false));
+    result.live_out.assign(blocks.size(), std::vector<bool>(n_registers, false));
+
+    for (std::size_t b = 0; b < blocks.size(); ++b)
+    {
+        for (auto i = blocks[b].begin; i < blocks[b].end; ++i)
+        {
+            for_each_used_virtual_register(code[i], [&](std::int32_t reg) {
+                auto r = static_cast<std::size_t>(reg);
+                if (!defs[b][r])
+                {
+                    uses[b][r] = true;
+                }
+            });
+
+            if (auto reg = get_defined_virtual_register(code[i]))
+            {
+                defs[b][static_cast<std::size_t>(*reg)] = true;
+            }
+        }
+    }
+
+    // Until a fixed point is reached
+    bool changed = true;
+    while (changed)
+    {
+        changed = false;
+
+        for (auto b = blocks.size(); b-- > 0;)
+        {
+            std::vector<bool> new_out(n_registers, false);
+
+            for (auto successor : blocks[b].successors)
+            {
+                for (std::size_t r = 0; r < n_registers; ++r)
+                {
+                    new_out[r] = new_out[r] || result.live_in[successor][r];
+                }
+            }
+
+            std::vector<bool> new_in(n_registers, false);
+
+            for (std::size_t r = 0; r < n_registers; ++r)
+            {
+                new_in[r] = uses[b][r] || (new_out[r] && !defs[b][r]);
+            }
+
+            if (new_out != result.live_out[b] || new_in != result.live_in[b])
+            {
+                result.live_out[b] = std::move(new_out);
+                result.live_in[b]  = std::move(new_in);
+                changed            = true;
+            }
+        }
+    }
+
+    return result;
+}
+
+std::vector<std::vector<bool>> compute_live_after(const lowered_function& function)
+{
+    const auto& code   = function.code;
+    auto        result = compute_liveness(function);
+
+    std::vector<std::vector<bool>> live_after(code.size());
+
+    for (std::size_t b = 0; b < result.blocks.size(); ++b)
+    {
+        auto live = result.live_out[b];
+
+        for (auto i = result.blocks[b].end; i-- > result.blocks[b].begin;)
+        {
+            live_after[i] = live;
+
+            if (auto reg = get_defined_virtual_register(code[i]))
+            {
+                live[static_cast<std::size_t>(*reg)] = false;
+            }
+
+            for_each_used_virtual_register(code[i], [&live](std::int32_t reg) {
+                live[static_cast<std::size_t>(reg)] = true;
+            });
+        }
+    }
+
+    return live_after;
+}
@@ -0,0 +1,67 @@
+// Copyright © 2021-2022 Jonas Muehlmann
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include "lowered_function.hpp"
+
+struct basic_block
+{
+    std::size_t              begin;
+    // Exclusive
+    std::size_t              end;
+    std::vector<std::size_t> successors;
+};
+
+// Only virtual registers are tracked, the outgoing argument area is never considered dead
+struct liveness
+{
+    std::vector<basic_block>       blocks;
+    // Block -> virtual registers live at the begin/end of the block
+    std::vector<std::vector<bool>> live_in;
+    std::vector<std::vector<bool>> live_out;
+};
+
+std::vector<basic_block> split_basic_blocks(const lowered_function& function);
+
+// Backwards data flow analysis over the function's basic blocks
+liveness compute_liveness(const lowered_function& function);
+
+// Instruction -> virtual registers live after it
+std::vector<std::vector<bool>> compute_live_after(const lowered_function& function);
+
+std::optional<std::int32_t> get_defined_virtual_register(const instruction& i);
+
+template <typename TFunction>
+void for_each_used_virtual_register(const instruction& i, TFunction&& function)
+{
+    for (auto reg : get_used_registers(i))
+    {
+        if (is_virtual_register(reg))
+        {
+            function(reg);
+        }
+    }
+}
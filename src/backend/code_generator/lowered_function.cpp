@@ -0,0 +1,54 @@
+// Copyright © 2021-2022 Jonas Muehlmann
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include "lowered_function.hpp"
+
+void erase_instructions(lowered_function& function, const std::vector<bool>& erased)
+{
+    std::vector<instruction>   code;
+    std::vector<std::uint32_t> lines;
+    std::vector<std::size_t>   new_position(function.code.size() + 1, 0);
+
+    code.reserve(function.code.size());
+    lines.reserve(function.lines.size());
+
+    for (std::size_t i = 0; i < function.code.size(); ++i)
+    {
+        new_position[i] = code.size();
+
+        if (!erased[i])
+        {
+            code.push_back(function.code[i]);
+
+            if (!function.lines.empty())
+            {
+                lines.push_back(function.lines[i]);
+            }
+        }
+    }
+    new_position[function.code.size()] = code.size();
+
+    for (auto& label : function.labels)
+    {
+        label = new_position[label];
+    }
+
+    function.code  = std::move(code);
+    function.lines = std::move(lines);
+}
@@ -0,0 +1,60 @@
+// Copyright © 2021-2022 Jonas Muehlmann
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "backend/instruction.hpp"
+
+// Registers at or above this index refer to the outgoing argument area, where arguments are
+// placed before a CALL. They are not subject to register allocation and are appended to the
+// frame after all allocated registers.
+inline constexpr std::int32_t OUTGOING_SLOT_BASE = 1 << 30;
+
+inline bool is_virtual_register(std::int32_t reg)
+{
+    return reg >= 0 && reg < OUTGOING_SLOT_BASE;
+}
+
+// A function after lowering from the AST, but before register allocation and linking.
+// Registers are virtual and unbounded, jump targets (operand a) are indices into labels.
+struct lowered_function
+{
+    std::string                           name;
+    std::size_t                           n_parameters{};
+    std::vector<instruction>              code;
+    // Label -> index of the instruction following it
+    std::vector<std::size_t>              labels;
+    std::size_t                           n_virtual_registers{};
+    std::size_t                           n_outgoing_slots{};
+    // Frame size after register allocation
+    std::size_t                           n_registers{};
+    // Labels of the entries of every JUMPTABLE, which refers to its table by operand b
+    std::vector<std::vector<std::size_t>> jump_tables{};
+    // Source line of every instruction, or empty if there are none
+    std::vector<std::uint32_t>            lines{};
+};
+
+// Removes all instructions marked in erased, labels move to the next remaining instruction
+void erase_instructions(lowered_function& function, const std::vector<bool>& erased);
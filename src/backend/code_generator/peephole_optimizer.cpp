@@ -0,0 +1,481 @@
+// Copyright © 2021-2022 Jonas Muehlmann
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include "peephole_optimizer.hpp"
+
+#include <cstdint>
+#include <optional>
+
+#include "backend/instruction.hpp"
+#include "backend/opcode.hpp"
+#include "liveness.hpp"
+
+namespace
+{
+//****************************************************************************//
+//                                  Helpers                                   //
+//****************************************************************************//
+// Upper bound for the number of rounds, every round only ever shrinks the code
+constexpr std::size_t MAX_ROUNDS = 16;
+
+std::size_t to_index(std::int32_t reg)
+{
+    return static_cast<std::size_t>(reg);
+}
+
+// Facts about the function, which are recomputed after every rule
+struct window_context
+{
+    lowered_function&              function;
+    const std::vector<value_t>&    constants;
+    std::vector<std::vector<bool>> live_after;
+    // Number of jumps targeting each position
+    std::vector<std::size_t>       n_jumps_to;
+    std::vector<bool>              is_label_target;
+    // Literal held by each register, which is only defined once by a SETLIT
+    std::vector<std::optional<value_t>> literal;
+    std::vector<bool>                   erased;
+
+    window_context(lowered_function& function_, const std::vector<value_t>& constants_) :
+        function{function_},
+        constants{constants_},
+        live_after{compute_live_after(function_)},
+        n_jumps_to(function_.code.size() + 1, 0),
+        is_label_target(function_.code.size() + 1, false),
+        literal(function_.n_virtual_registers),
+        erased(function_.code.size(), false)
+    {
+        for (auto label : function.labels)
+        {
+            is_label_target[label] = true;
+        }
+
+        std::vector<std::size_t> n_definitions(function.n_virtual_registers, 0);
+
+        for (const auto& i : function.code)
+        {
+            if (is_jump(i.op))
+            {
+                ++n_jumps_to[target_of(i)];
+            }
+
+            if (auto reg = get_defined_virtual_register(i))
+            {
+                ++n_definitions[to_index(*reg)];
+
+                if (i.op == opcode::SETLIT)
+                {
+                    literal[to_index(*reg)] = constants[to_index(i.b)];
+                }
+            }
+        }
+
+        // Parameters are defined by the caller
+        for (std::size_t r = 0; r < literal.size(); ++r)
+        {
+            if (n_definitions[r] != 1 || r < function.n_parameters)
+            {
+                literal[r].reset();
+            }
+        }
+    }
+
+    [[nodiscard]] std::size_t target_of(const instruction& jump) const
+    {
+        return function.labels[to_index(jump.a)];
+    }
+
+    [[nodiscard]] bool is_dead_after(std::size_t index, std::int32_t reg) const
+    {
+        return is_virtual_register(reg) && !live_after[index][to_index(reg)];
+    }
+
+    [[nodiscard]] bool holds_literal(std::int32_t reg, value_t value) const
+    {
+        return is_virtual_register(reg) && literal[to_index(reg)] == value;
+    }
+
+    [[nodiscard]] bool is_literal(const instruction& i, value_t value) const
+    {
+        return i.op == opcode::SETLIT && constants[to_index(i.b)] == value;
+    }
+
+    // Whether the instruction at index may be rewritten together with its predecessor
+    [[nodiscard]] bool continues_window(std::size_t index) const
+    {
+        return index < function.code.size() && !is_label_target[index] && !erased[index];
+    }
+
+    void erase(std::size_t index)
+    {
+        erased[index] = true;
+    }
+
+    void commit()
+    {
+        erase_instructions(function, erased);
+    }
+};
+
+// Tests of a register against zero, returns whether the jump is taken for a non-zero value
+std::optional<bool> get_zero_test(const window_context& context, const instruction& i)
+{
+    const bool is_equality = i.op == opcode::JUMPEQ || i.op == opcode::JUMPEQI;
+
+    if (i.op == opcode::JUMPEQI || i.op == opcode::JUMPNEQI)
+    {
+        return i.c == 0 ? std::optional(!is_equality) : std::nullopt;
+    }
+    if (i.op == opcode::JUMPEQ || i.op == opcode::JUMPNEQ)
+    {
+        return context.holds_literal(i.c, 0) ? std::optional(!is_equality) : std::nullopt;
+    }
+
+    return std::nullopt;
+}
+
+bool is_negatable(opcode op)
+{
+    return is_conditional_jump(op) && op != opcode::INCJUMPLESS && op != opcode::INCJUMPLESSI;
+}
+
+// Division and modulo by a register trap on zero, so they can not just be removed
+bool has_side_effects(const instruction& i)
+{
+    switch (i.op)
+    {
+        case opcode::CALL:
+        case opcode::PRINT:
+        case opcode::READ:
+        case opcode::RET:
+        case opcode::TAILCALL:
+        case opcode::JUMPTABLE:
+        case opcode::DIV:
+        case opcode::MOD:
+            return true;
+        case opcode::DIVI:
+        case opcode::MODI:
+            return i.c == 0;
+        default:
+            return is_jump(i.op);
+    }
+}
+
+//****************************************************************************//
+//                                   Rules                                    //
+//****************************************************************************//
+std::size_t remove_redundant_sets(window_context& context)
+{
+    auto&       code   = context.function.code;
+    std::size_t n_hits = 0;
+
+    for (std::size_t i = 0; i < code.size(); ++i)
+    {
+        if (context.erased[i])
+        {
+            continue;
+        }
+
+        auto& current = code[i];
+
+        // SET r, r
+        if (current.op == opcode::SET && current.a == current.b)
+        {
+            context.erase(i);
+            ++n_hits;
+            continue;
+        }
+
+        if (!context.continues_window(i + 1) || code[i + 1].op != opcode::SET)
+        {
+            continue;
+        }
+
+        const auto& copy = code[i + 1];
+
+        // SET a, b; SET b, a
+        if (current.op == opcode::SET && copy.a == current.b && copy.b == current.a)
+        {
+            context.erase(i + 1);
+            ++n_hits;
+            continue;
+        }
+
+        // OP t, ...; SET v, t with t dead afterwards computes straight into v
+        if (get_operand_layout(current.op).a == operand_kind::DESTINATION
+            && current.a == copy.b && copy.a != copy.b && context.is_dead_after(i + 1, copy.b))
+        {
+            current.a = copy.a;
+            context.erase(i + 1);
+            ++n_hits;
+        }
+    }
+
+    return n_hits;
+}
+
+std::size_t thread_jumps(window_context& context)
+{
+    auto&       code   = context.function.code;
+    auto&       labels = context.function.labels;
+    std::size_t n_hits = 0;
+
+    for (std::size_t i = 0; i < code.size(); ++i)
+    {
+        auto& jump = code[i];
+
+        if (!is_jump(jump.op))
+        {
+            continue;
+        }
+
+        // Follow chains of unconditional jumps, the step limit guards against cycles
+        auto label = jump.a;
+        for (std::size_t steps = 0; steps < code.size(); ++steps)
+        {
+            auto target = labels[to_index(label)];
+
+            if (target >= code.size() || code[target].op != opcode::JUMP || code[target].a == label)
+            {
+                break;
+            }
+            label = code[target].a;
+        }
+
+        if (label != jump.a)
+        {
+            jump.a = label;
+            ++n_hits;
+        }
+
+        // Jumps to the next instruction, the conditional ones have no side effects either
+        if (context.target_of(jump) == i + 1 && jump.op != opcode::INCJUMPLESS
+            && jump.op != opcode::INCJUMPLESSI)
+        {
+            context.erase(i);
+            ++n_hits;
+        }
+    }
+
+    return n_hits;
+}
+
+std::size_t fuse_compares(window_context& context)
+{
+    auto&       code   = context.function.code;
+    std::size_t n_hits = 0;
+
+    for (std::size_t i = 0; i + 1 < code.size(); ++i)
+    {
+        if (context.erased[i] || !context.continues_window(i + 1))
+        {
+            continue;
+        }
+
+        auto&       current = code[i];
+        const auto& next    = code[i + 1];
+
+        // JUMPcc skip; JUMP target; skip: -> JUMP!cc target
+        if (is_negatable(current.op) && next.op == opcode::JUMP
+            && context.target_of(current) == i + 2)
+        {
+            current = {negate_conditional_jump(current.op), next.a, current.b, current.c};
+            context.erase(i + 1);
+            ++n_hits;
+            continue;
+        }
+
+        // NOT t, x; JUMPEQ/JUMPNEQ target, t, 0 -> inverted test of x
+        if (current.op == opcode::NOT && is_conditional_jump(next.op) && next.b == current.a
+            && context.is_dead_after(i + 1, current.a))
+        {
+            if (get_zero_test(context, next).has_value())
+            {
+                current = {negate_conditional_jump(next.op), next.a, current.b, next.c};
+                context.erase(i + 1);
+                ++n_hits;
+                continue;
+            }
+        }
+
+        // SETLIT t, 1; JUMPcc done, x, y; SETLIT t, 0; done: JUMPNEQ target, t, 0
+        // -> JUMPcc target, x, y
+        if (i + 3 < code.size() && context.is_literal(current, 1) && is_negatable(next.op)
+            && next.b != current.a && next.c != current.a && context.continues_window(i + 2)
+            && context.is_literal(code[i + 2], 0) && code[i + 2].a == current.a
+            && context.target_of(next) == i + 3 && context.n_jumps_to[i + 3] == 1
+            && !context.erased[i + 3] && code[i + 3].b == current.a
+            && context.is_dead_after(i + 3, current.a))
+        {
+            if (auto jump_if_true = get_zero_test(context, code[i + 3]))
+            {
+                current = {*jump_if_true ? next.op : negate_conditional_jump(next.op),
+                           code[i + 3].a,
+                           next.b,
+                           next.c};
+                context.erase(i + 1);
+                context.erase(i + 2);
+                context.erase(i + 3);
+                ++n_hits;
+            }
+        }
+    }
+
+    return n_hits;
+}
+
+std::size_t remove_dead_stores(window_context& context)
+{
+    auto&       code   = context.function.code;
+    std::size_t n_hits = 0;
+
+    for (std::size_t i = 0; i < code.size(); ++i)
+    {
+        auto reg = get_defined_virtual_register(code[i]);
+
+        if (!context.erased[i] && reg.has_value() && !has_side_effects(code[i])
+            && context.is_dead_after(i, *reg))
+        {
+            context.erase(i);
+            ++n_hits;
+        }
+    }
+
+    return n_hits;
+}
+
+std::size_t simplify_inc_dec(window_context& context)
+{
+    auto&       code   = context.function.code;
+    std::size_t n_hits = 0;
+
+    for (std::size_t i = 0; i < code.size(); ++i)
+    {
+        if (context.erased[i])
+        {
+            continue;
+        }
+
+        auto& current = code[i];
+
+        // ADDI r, r, +-1 -> INC/DEC r, ADDI a, b, 0 -> SET a, b
+        if (current.op == opcode::ADDI)
+        {
+            if (current.a == current.b && (current.c == 1 || current.c == -1))
+            {
+                current = {current.c == 1 ? opcode::INC : opcode::DEC, current.a, 0, 0};
+                ++n_hits;
+            }
+            else if (current.c == 0)
+            {
+                current = {opcode::SET, current.a, current.b, 0};
+                ++n_hits;
+            }
+            continue;
+        }
+
+        if (!context.continues_window(i + 1))
+        {
+            continue;
+        }
+
+        const auto& next = code[i + 1];
+
+        // INC r; DEC r and DEC r; INC r
+        if ((current.op == opcode::INC && next.op == opcode::DEC)
+            || (current.op == opcode::DEC && next.op == opcode::INC))
+        {
+            if (current.a == next.a)
+            {
+                context.erase(i);
+                context.erase(i + 1);
+                ++n_hits;
+                ++i;
+            }
+            continue;
+        }
+
+        // SETLIT t, +-1; ADD/SUB r, r, t -> INC/DEC r
+        if (current.op != opcode::SETLIT || (next.op != opcode::ADD && next.op != opcode::SUB)
+            || !context.is_dead_after(i + 1, current.a))
+        {
+            continue;
+        }
+
+        const auto literal = context.constants[to_index(current.b)];
+        const bool is_add  = next.op == opcode::ADD;
+        const auto reg     = next.b == current.a && is_add ? next.c : next.b;
+
+        if ((literal != 1 && literal != -1) || next.a != reg || reg == current.a
+            || (next.c != current.a && !(is_add && next.b == current.a)))
+        {
+            continue;
+        }
+
+        current = {(literal == 1) == is_add ? opcode::INC : opcode::DEC, reg, 0, 0};
+        context.erase(i + 1);
+        ++n_hits;
+        ++i;
+    }
+
+    return n_hits;
+}
+}    // namespace
+
+//****************************************************************************//
+//                                Entry point                                 //
+//****************************************************************************//
+peephole_statistics optimize_peephole(lowered_function&           function,
+                                      const std::vector<value_t>& constants)
+{
+    using rule_function_t = std::size_t (*)(window_context&);
+
+    constexpr std::array<std::pair<peephole_rule, rule_function_t>, 5> RULES{
+        {{peephole_rule::JUMP_THREADING, thread_jumps},
+         {peephole_rule::FUSED_COMPARE, fuse_compares},
+         {peephole_rule::INC_DEC, simplify_inc_dec},
+         {peephole_rule::REDUNDANT_SET, remove_redundant_sets},
+         {peephole_rule::DEAD_STORE, remove_dead_stores}}};
+
+    peephole_statistics statistics;
+
+    for (std::size_t round = 0; round < MAX_ROUNDS; ++round)
+    {
+        std::size_t n_hits = 0;
+
+        for (auto [rule, apply] : RULES)
+        {
+            // Liveness and labels change with every rule, so each one gets a fresh context
+            window_context context(function, constants);
+            auto           n_rule_hits = apply(context);
+
+            context.commit();
+
+            statistics[rule] += n_rule_hits;
+            n_hits += n_rule_hits;
+        }
+
+        if (n_hits == 0)
+        {
+            break;
+        }
+    }
+
+    return statistics;
+}
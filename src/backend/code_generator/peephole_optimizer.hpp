@@ -0,0 +1,126 @@
+// Copyright © 2021-2022 Jonas Muehlmann
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <string_view>
+#include <vector>
+
+#include "backend/value.hpp"
+#include "enum_range.hpp"
+#include "lowered_function.hpp"
+#include <nlohmann/json.hpp>
+
+using json = nlohmann::ordered_json;
+
+enum class peephole_rule
+{
+    // SET r, r and copies, which can be folded into the instruction computing the value
+    REDUNDANT_SET,
+    // Jumps to jumps and jumps to the next instruction
+    JUMP_THREADING,
+    // Conditional jumps over a JUMP and materialized booleans, which are only tested
+    FUSED_COMPARE,
+    // Side effect free instructions defining a dead register
+    DEAD_STORE,
+    // Additions of +-1 and INC/DEC pairs
+    INC_DEC
+};
+
+const int NUM_PEEPHOLE_RULES = []() {
+    EnumRange<peephole_rule, peephole_rule::INC_DEC> range;
+
+    return range.size();
+}();
+
+const auto ALL_PEEPHOLE_RULES = enum_to_array<peephole_rule, peephole_rule::INC_DEC>();
+
+const auto LUT_PEEPHOLE_RULE_TO_STRING = []() {
+    using namespace std::literals::string_view_literals;
+
+    constexpr auto arr = []() {
+        std::array<std::string_view, EnumRange<peephole_rule, peephole_rule::INC_DEC>().size()>
+            arr{};
+        arr.fill(""sv);
+
+        arr[static_cast<size_t>(peephole_rule::REDUNDANT_SET)]  = "REDUNDANT_SET"sv;
+        arr[static_cast<size_t>(peephole_rule::JUMP_THREADING)] = "JUMP_THREADING"sv;
+        arr[static_cast<size_t>(peephole_rule::FUSED_COMPARE)]  = "FUSED_COMPARE"sv;
+        arr[static_cast<size_t>(peephole_rule::DEAD_STORE)]     = "DEAD_STORE"sv;
+        arr[static_cast<size_t>(peephole_rule::INC_DEC)]        = "INC_DEC"sv;
+
+        return arr;
+    }();
+
+    static_assert(
+        std::ranges::count_if(arr, [](std::string_view str) { return str == ""sv; })
+            == 0,
+        "peephole_rule missing string representation");
+
+    return arr;
+}();
+
+inline void to_json(json& j, const peephole_rule& rule)
+{
+    j = LUT_PEEPHOLE_RULE_TO_STRING[static_cast<size_t>(rule)];
+}
+
+// Number of times each rule rewrote the code
+struct peephole_statistics
+{
+    std::array<std::size_t, EnumRange<peephole_rule, peephole_rule::INC_DEC>().size()> hits{};
+
+    std::size_t& operator[](peephole_rule rule)
+    {
+        return hits[static_cast<std::size_t>(rule)];
+    }
+
+    std::size_t operator[](peephole_rule rule) const
+    {
+        return hits[static_cast<std::size_t>(rule)];
+    }
+
+    peephole_statistics& operator+=(const peephole_statistics& other)
+    {
+        for (std::size_t i = 0; i < hits.size(); ++i)
+        {
+            hits[i] += other.hits[i];
+        }
+
+        return *this;
+    }
+};
+
+inline void to_json(json& j, const peephole_statistics& statistics)
+{
+    j = json::object();
+
+    for (auto rule : ALL_PEEPHOLE_RULES)
+    {
+        j[LUT_PEEPHOLE_RULE_TO_STRING[static_cast<size_t>(rule)]] = statistics[rule];
+    }
+}
+
+// Rewrites short windows of instructions of a function, which has not been register
+// allocated yet, until no rule applies anymore.
+peephole_statistics optimize_peephole(lowered_function&           function,
+                                      const std::vector<value_t>& constants);
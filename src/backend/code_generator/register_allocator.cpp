@@ -0,0 +1,461 @@
+// Copyright © 2021-2022 Jonas Muehlmann
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include "register_allocator.hpp"
+
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <tuple>
+
+#include "backend/opcode.hpp"
+#include "liveness.hpp"
+
+//****************************************************************************//
+//                               Live intervals                               //
+//****************************************************************************//
+// Every instruction i occupies two positions: operands are read at 2i and the result is
+// written at 2i + 1. This way a register whose last use is at i can be reused for the
+// result of i, but not for a value which has to be live before i.
+namespace
+{
+std::size_t use_position(std::size_t index)
+{
+    return 2 * index;
+}
+
+std::size_t def_position(std::size_t index)
+{
+    return 2 * index + 1;
+}
+}    // namespace
+
+std::vector<live_interval> compute_live_intervals(const lowered_function& function)
+{
+    const auto& code        = function.code;
+    const auto  n_registers = function.n_virtual_registers;
+
+    if (code.empty())
+    {
+        return {};
+    }
+
+    auto        result   = compute_liveness(function);
+    const auto& blocks   = result.blocks;
+    const auto& live_in  = result.live_in;
+    const auto& live_out = result.live_out;
+
+    constexpr auto           UNSET = std::numeric_limits<std::size_t>::max();
+    std::vector<std::size_t> start(n_registers, UNSET);
+    std::vector<std::size_t> end(n_registers, 0);
+
+    auto extend = [&](std::size_t reg, std::size_t position) {
+        start[reg] = start[reg] == UNSET ? position : std::min(start[reg], position);
+        end[reg]   = std::max(end[reg], position);
+    };
+
+    // Parameters are defined by the caller before the first instruction
+    for (std::size_t r = 0; r < std::min(function.n_parameters, n_registers); ++r)
+    {
+        extend(r, 0);
+    }
+
+    for (std::size_t b = 0; b < blocks.size(); ++b)
+    {
+        for (std::size_t r = 0; r < n_registers; ++r)
+        {
+            if (live_in[b][r])
+            {
+                extend(r, use_position(blocks[b].begin));
+            }
+            if (live_out[b][r])
+            {
+                extend(r, def_position(blocks[b].end - 1));
+            }
+        }
+
+        for (auto i = blocks[b].begin; i < blocks[b].end; ++i)
+        {
+            for_each_used_virtual_register(code[i], [&](std::int32_t reg) {
+                extend(static_cast<std::size_t>(reg), use_position(i));
+            });
+
+            if (auto reg = get_defined_virtual_register(code[i]))
+            {
+                extend(static_cast<std::size_t>(*reg), def_position(i));
+            }
+        }
+    }
+
+    std::vector<live_interval> intervals;
+
+    for (std::size_t r = 0; r < n_registers; ++r)
+    {
+        if (start[r] != UNSET)
+        {
+            intervals.push_back({static_cast<std::int32_t>(r), start[r], end[r]});
+        }
+    }
+
+    return intervals;
+}
+
+//****************************************************************************//
+//                                Linear scan                                 //
+//****************************************************************************//
+namespace
+{
+std::optional<register_allocation> linear_scan(const lowered_function&    function,
+                                               std::vector<live_interval> intervals,
+                                               std::size_t                n_available,
+                                               bool                       allow_spilling)
+{
+    const auto n_registers = function.n_virtual_registers;
+
+    // Copy source for every register defined by a SET, used as allocation hint
+    std::vector<std::int32_t> copy_source(n_registers, NO_REGISTER);
+
+    for (const auto& i : function.code)
+    {
+        if (i.op == opcode::SET && is_virtual_register(i.a) && is_virtual_register(i.b))
+        {
+            copy_source[static_cast<std::size_t>(i.a)] = i.b;
+        }
+    }
+
+    auto is_parameter = [&function](const live_interval& interval) {
+        return static_cast<std::size_t>(interval.virtual_register) < function.n_parameters;
+    };
+
+    // Parameters first, they arrive in fixed registers
+    std::ranges::sort(intervals, [&](const live_interval& lhs, const live_interval& rhs) {
+        return std::tuple(lhs.start, !is_parameter(lhs), lhs.virtual_register)
+               < std::tuple(rhs.start, !is_parameter(rhs), rhs.virtual_register);
+    });
+
+    register_allocation allocation;
+    allocation.physical_register.assign(n_registers, NO_REGISTER);
+    allocation.spill_slot.assign(n_registers, NO_REGISTER);
+
+    std::vector<bool>          is_free(n_available, true);
+    std::vector<live_interval> active;
+
+    auto spill = [&](std::int32_t reg) {
+        allocation.physical_register[static_cast<std::size_t>(reg)] = NO_REGISTER;
+        allocation.spill_slot[static_cast<std::size_t>(reg)] =
+            static_cast<std::int32_t>(allocation.n_spill_slots++);
+    };
+
+    for (const auto& current : intervals)
+    {
+        // Expire intervals which ended before the current one starts
+        std::erase_if(active, [&](const live_interval& interval) {
+            if (interval.end < current.start)
+            {
+                is_free[static_cast<std::size_t>(
+                    allocation.physical_register[static_cast<std::size_t>(
+                        interval.virtual_register)])] = true;
+                return true;
+            }
+            return false;
+        });
+
+        const auto   current_register = static_cast<std::size_t>(current.virtual_register);
+        std::int32_t chosen           = NO_REGISTER;
+
+        if (is_parameter(current))
+        {
+            if (current_register >= n_available)
+            {
+                throw std::runtime_error("Function " + function.name
+                                         + " has more parameters than available registers");
+            }
+            chosen = current.virtual_register;
+        }
+        else if (auto source = copy_source[current_register];
+                 source != NO_REGISTER
+                 && allocation.physical_register[static_cast<std::size_t>(source)] != NO_REGISTER
+                 && is_free[static_cast<std::size_t>(
+                     allocation.physical_register[static_cast<std::size_t>(source)])])
+        {
+            chosen = allocation.physical_register[static_cast<std::size_t>(source)];
+        }
+        else if (auto free = std::ranges::find(is_free, true); free != is_free.end())
+        {
+            chosen = static_cast<std::int32_t>(std::distance(is_free.begin(), free));
+        }
+
+        if (chosen != NO_REGISTER)
+        {
+            is_free[static_cast<std::size_t>(chosen)]     = false;
+            allocation.physical_register[current_register] = chosen;
+            active.push_back(current);
+            continue;
+        }
+
+        if (!allow_spilling)
+        {
+            return std::nullopt;
+        }
+
+        // Spill whichever of the active intervals and the current one lives the longest
+        auto longest = std::ranges::max_element(active, {}, &live_interval::end);
+
+        if (longest != active.end() && longest->end > current.end)
+        {
+            allocation.physical_register[current_register] =
+                allocation.physical_register[static_cast<std::size_t>(longest->virtual_register)];
+            spill(longest->virtual_register);
+
+            *longest = current;
+        }
+        else
+        {
+            spill(current.virtual_register);
+        }
+    }
+
+    // Parameters arrive in the first registers, even if they are spilled right away
+    allocation.n_physical_registers = function.n_parameters;
+
+    for (auto reg : allocation.physical_register)
+    {
+        allocation.n_physical_registers =
+            std::max(allocation.n_physical_registers, static_cast<std::size_t>(reg + 1));
+    }
+
+    return allocation;
+}
+}    // namespace
+
+register_allocation allocate_registers(const lowered_function& function,
+                                       std::size_t             register_budget)
+{
+    // Two registers are needed to reload the operands of spilled registers
+    constexpr std::size_t N_SCRATCH_REGISTERS = 2;
+
+    if (register_budget <= N_SCRATCH_REGISTERS)
+    {
+        throw std::invalid_argument("Register budget too small");
+    }
+
+    auto intervals = compute_live_intervals(function);
+
+    if (auto allocation = linear_scan(function, intervals, register_budget, false))
+    {
+        return *allocation;
+    }
+
+    auto allocation =
+        *linear_scan(function, intervals, register_budget - N_SCRATCH_REGISTERS, true);
+
+    allocation.scratch_register = static_cast<std::int32_t>(allocation.n_physical_registers);
+    allocation.n_physical_registers += N_SCRATCH_REGISTERS;
+
+    return allocation;
+}
+
+//****************************************************************************//
+//                                  Rewrite                                   //
+//****************************************************************************//
+void apply_register_allocation(lowered_function& function, const register_allocation& allocation)
+{
+    const auto spill_base    = allocation.n_physical_registers;
+    const auto outgoing_base = spill_base + allocation.n_spill_slots;
+
+    auto to_frame_index = [](std::size_t index) {
+        return static_cast<std::int32_t>(index);
+    };
+
+    auto spill_register = [&](std::int32_t reg) {
+        return to_frame_index(
+            spill_base
+            + static_cast<std::size_t>(allocation.spill_slot[static_cast<std::size_t>(reg)]));
+    };
+
+    auto is_spilled = [&](std::int32_t reg) {
+        return is_virtual_register(reg)
+               && allocation.spill_slot[static_cast<std::size_t>(reg)] != NO_REGISTER;
+    };
+
+    auto map_register = [&](std::int32_t reg) -> std::int32_t {
+        if (reg >= OUTGOING_SLOT_BASE)
+        {
+            return to_frame_index(outgoing_base + static_cast<std::size_t>(reg - OUTGOING_SLOT_BASE));
+        }
+        return allocation.physical_register[static_cast<std::size_t>(reg)];
+    };
+
+    std::vector<instruction>   code;
+    std::vector<std::uint32_t> lines;
+    std::vector<std::size_t>   new_position(function.code.size() + 1, 0);
+
+    code.reserve(function.code.size());
+
+    // Reloads and stores belong to the line of the instruction they were added for
+    auto add_lines = [&](std::size_t index) {
+        if (!function.lines.empty())
+        {
+            lines.resize(code.size(), function.lines[index]);
+        }
+    };
+
+    auto rewrite_instruction = [&](const instruction& original) {
+        auto rewritten = original;
+
+        std::int32_t                next_scratch = allocation.scratch_register;
+        std::array<std::int32_t, 2> reloaded{NO_REGISTER, NO_REGISTER};
+
+        auto map_use = [&](std::int32_t& operand) {
+            if (!is_spilled(operand))
+            {
+                operand = map_register(operand);
+                return;
+            }
+
+            // Both operands may name the same spilled register
+            if (reloaded[0] == operand)
+            {
+                operand = allocation.scratch_register;
+                return;
+            }
+
+            reloaded[static_cast<std::size_t>(next_scratch - allocation.scratch_register)] = operand;
+            code.push_back({opcode::SET, next_scratch, spill_register(operand), 0});
+            operand = next_scratch++;
+        };
+
+        struct operand_reference
+        {
+            operand_kind  kind;
+            std::int32_t  original;
+            std::int32_t* rewritten;
+        };
+
+        const auto                             layout = get_operand_layout(original.op);
+        const std::array<operand_reference, 3> operands{
+            {{layout.a, original.a, &rewritten.a},
+             {layout.b, original.b, &rewritten.b},
+             {layout.c, original.c, &rewritten.c}}};
+
+        // Operands
+        for (const auto& operand : operands)
+        {
+            if (operand.kind == operand_kind::SOURCE
+                || operand.kind == operand_kind::SOURCE_DESTINATION)
+            {
+                map_use(*operand.rewritten);
+            }
+            else if (operand.kind == operand_kind::ARGUMENTS)
+            {
+                *operand.rewritten = map_register(operand.original);
+            }
+        }
+
+        // Result, a spilled register, which is also read, already lives in a scratch register
+        std::int32_t store_to   = NO_REGISTER;
+        std::int32_t store_from = NO_REGISTER;
+
+        for (const auto& operand : operands)
+        {
+            if (operand.kind == operand_kind::DESTINATION)
+            {
+                if (is_spilled(operand.original))
+                {
+                    *operand.rewritten = allocation.scratch_register;
+                    store_to           = spill_register(operand.original);
+                    store_from         = allocation.scratch_register;
+                }
+                else
+                {
+                    *operand.rewritten = map_register(operand.original);
+                }
+            }
+            else if (operand.kind == operand_kind::SOURCE_DESTINATION
+                     && is_spilled(operand.original))
+            {
+                store_to   = spill_register(operand.original);
+                store_from = *operand.rewritten;
+            }
+        }
+
+        if (rewritten.op == opcode::SET && rewritten.a == rewritten.b)
+        {
+            return;
+        }
+
+        code.push_back(rewritten);
+
+        if (store_to != NO_REGISTER)
+        {
+            code.push_back({opcode::SET, store_to, store_from, 0});
+        }
+    };
+
+    // Spilled parameters arrive in registers and are moved to their slots on entry
+    for (std::size_t p = 0; p < function.n_parameters; ++p)
+    {
+        if (p < function.n_virtual_registers && is_spilled(static_cast<std::int32_t>(p)))
+        {
+            code.push_back({opcode::SET,
+                            spill_register(static_cast<std::int32_t>(p)),
+                            static_cast<std::int32_t>(p),
+                            0});
+        }
+    }
+    add_lines(0);
+
+    for (std::size_t index = 0; index < function.code.size(); ++index)
+    {
+        new_position[index] = code.size();
+
+        // A fused increment can not store its spilled register before jumping, so it is
+        // split up again
+        std::vector<instruction> expanded{function.code[index]};
+
+        if (const auto& fused = function.code[index];
+            (fused.op == opcode::INCJUMPLESS || fused.op == opcode::INCJUMPLESSI)
+            && is_spilled(fused.b))
+        {
+            expanded = {{opcode::INC, fused.b, 0, 0},
+                        {fused.op == opcode::INCJUMPLESS ? opcode::JUMPLESS : opcode::JUMPLESSI,
+                         fused.a,
+                         fused.b,
+                         fused.c}};
+        }
+
+        for (const auto& original : expanded)
+        {
+            rewrite_instruction(original);
+        }
+        add_lines(index);
+    }
+    new_position[function.code.size()] = code.size();
+
+    for (auto& label : function.labels)
+    {
+        label = new_position[label];
+    }
+
+    function.code        = std::move(code);
+    function.lines       = std::move(lines);
+    function.n_registers = std::max<std::size_t>(outgoing_base + function.n_outgoing_slots, 1);
+}
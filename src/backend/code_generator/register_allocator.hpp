@@ -0,0 +1,65 @@
+// Copyright © 2021-2022 Jonas Muehlmann
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "lowered_function.hpp"
+
+// Registers available to a single function before values are spilled
+inline constexpr std::size_t DEFAULT_REGISTER_BUDGET = 64;
+
+struct live_interval
+{
+    std::int32_t virtual_register;
+    // First and last position, at which the register is live. Instruction i reads its
+    // operands at position 2i and writes its result at position 2i + 1.
+    std::size_t  start;
+    std::size_t  end;
+};
+
+struct register_allocation
+{
+    // Virtual register -> physical register, NO_REGISTER for spilled registers
+    std::vector<std::int32_t> physical_register;
+    // Virtual register -> spill slot, NO_REGISTER for registers living in a register
+    std::vector<std::int32_t> spill_slot;
+    std::size_t               n_physical_registers{};
+    std::size_t               n_spill_slots{};
+    // Registers reserved for reloading spilled operands, NO_REGISTER if nothing was spilled
+    std::int32_t              scratch_register{NO_REGISTER};
+};
+
+// Intervals are computed from a liveness analysis over the basic blocks of the function, so
+// values live across loop back edges cover the whole loop. Registers which are never
+// referenced have no interval.
+std::vector<live_interval> compute_live_intervals(const lowered_function& function);
+
+// Linear scan (Poletto & Sarkar). Copies (SET) whose source dies at the copy are coalesced
+// by preferring the source's register for the destination.
+register_allocation allocate_registers(const lowered_function& function,
+                                       std::size_t             register_budget = DEFAULT_REGISTER_BUDGET);
+
+// Rewrites the function to physical registers, inserting reloads and stores for spilled
+// registers and dropping copies which became no-ops, and sets the function's frame size.
+void apply_register_allocation(lowered_function& function, const register_allocation& allocation);
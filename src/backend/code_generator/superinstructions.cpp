@@ -0,0 +1,230 @@
+// Copyright © 2021-2022 Jonas Muehlmann
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include "superinstructions.hpp"
+
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <utility>
+
+#include "backend/instruction.hpp"
+#include "backend/opcode.hpp"
+
+namespace
+{
+std::optional<opcode> to_immediate_opcode(opcode op)
+{
+    switch (op)
+    {
+        // Subtraction is turned into an addition of the negated immediate
+        case opcode::ADD:
+        case opcode::SUB:
+            return opcode::ADDI;
+        case opcode::MUL:
+            return opcode::MULI;
+        case opcode::DIV:
+            return opcode::DIVI;
+        case opcode::MOD:
+            return opcode::MODI;
+        case opcode::AND:
+            return opcode::ANDI;
+        case opcode::LSHIFT:
+            return opcode::LSHIFTI;
+        case opcode::RSHIFT:
+            return opcode::RSHIFTI;
+        case opcode::JUMPEQ:
+            return opcode::JUMPEQI;
+        case opcode::JUMPNEQ:
+            return opcode::JUMPNEQI;
+        case opcode::JUMPLESS:
+            return opcode::JUMPLESSI;
+        case opcode::JUMPGREATER:
+            return opcode::JUMPGREATERI;
+        case opcode::JUMPLEQ:
+            return opcode::JUMPLEQI;
+        case opcode::JUMPGEQ:
+            return opcode::JUMPGEQI;
+        default:
+            return std::nullopt;
+    }
+}
+
+bool is_commutative(opcode op)
+{
+    return op == opcode::ADD || op == opcode::MUL || op == opcode::AND;
+}
+
+std::optional<std::int32_t> to_immediate(value_t value)
+{
+    if (value < std::numeric_limits<std::int32_t>::min()
+        || value > std::numeric_limits<std::int32_t>::max())
+    {
+        return std::nullopt;
+    }
+
+    return static_cast<std::int32_t>(value);
+}
+
+// Rewrites operations reading a register, which only ever holds a literal, to their
+// immediate variants
+std::size_t fold_immediates(lowered_function& function, const std::vector<value_t>& constants)
+{
+    const auto n_registers = function.n_virtual_registers;
+
+    std::vector<std::size_t>            n_definitions(n_registers, 0);
+    std::vector<std::size_t>            n_uses(n_registers, 0);
+    std::vector<std::optional<value_t>> literal(n_registers);
+
+    for (const auto& i : function.code)
+    {
+        if (auto reg = get_defined_register(i); reg.has_value() && is_virtual_register(*reg))
+        {
+            const auto r = static_cast<std::size_t>(*reg);
+
+            ++n_definitions[r];
+            if (i.op == opcode::SETLIT)
+            {
+                literal[r] = constants[static_cast<std::size_t>(i.b)];
+            }
+        }
+
+        for (auto reg : get_used_registers(i))
+        {
+            if (is_virtual_register(reg))
+            {
+                ++n_uses[static_cast<std::size_t>(reg)];
+            }
+        }
+    }
+
+    auto get_immediate = [&](std::int32_t reg) -> std::optional<std::int32_t> {
+        const auto r = static_cast<std::size_t>(reg);
+
+        // Parameters are defined by the caller
+        if (!is_virtual_register(reg) || r < function.n_parameters || n_definitions[r] != 1
+            || !literal[r].has_value())
+        {
+            return std::nullopt;
+        }
+
+        return to_immediate(*literal[r]);
+    };
+
+    std::size_t n_formed = 0;
+
+    for (auto& i : function.code)
+    {
+        if (!to_immediate_opcode(i.op).has_value())
+        {
+            continue;
+        }
+
+        if (!get_immediate(i.c).has_value() && get_immediate(i.b).has_value())
+        {
+            if (is_conditional_jump(i.op))
+            {
+                i.op = mirror_conditional_jump(i.op);
+                std::swap(i.b, i.c);
+            }
+            else if (is_commutative(i.op))
+            {
+                std::swap(i.b, i.c);
+            }
+        }
+
+        auto immediate = get_immediate(i.c);
+
+        if (!immediate.has_value()
+            || (i.op == opcode::SUB && *immediate == std::numeric_limits<std::int32_t>::min()))
+        {
+            continue;
+        }
+
+        --n_uses[static_cast<std::size_t>(i.c)];
+
+        i = {*to_immediate_opcode(i.op), i.a, i.b, i.op == opcode::SUB ? -*immediate : *immediate};
+        ++n_formed;
+    }
+
+    // Literals, which are not read anymore
+    std::vector<bool> erased(function.code.size(), false);
+
+    for (std::size_t i = 0; i < function.code.size(); ++i)
+    {
+        const auto& instruction = function.code[i];
+
+        erased[i] = instruction.op == opcode::SETLIT && is_virtual_register(instruction.a)
+                    && n_uses[static_cast<std::size_t>(instruction.a)] == 0;
+    }
+    erase_instructions(function, erased);
+
+    return n_formed;
+}
+
+// Fuses the increment of a counting loop with the following loop test
+std::size_t fuse_increment_and_test(lowered_function& function)
+{
+    auto& code = function.code;
+
+    std::vector<bool> is_label_target(code.size() + 1, false);
+    std::vector<bool> erased(code.size(), false);
+
+    for (auto label : function.labels)
+    {
+        is_label_target[label] = true;
+    }
+
+    std::size_t n_formed = 0;
+
+    for (std::size_t i = 0; i + 1 < code.size(); ++i)
+    {
+        const auto& increment = code[i];
+        const auto& test      = code[i + 1];
+
+        if (increment.op != opcode::INC
+            || (test.op != opcode::JUMPLESS && test.op != opcode::JUMPLESSI)
+            || test.b != increment.a || (test.op == opcode::JUMPLESS && test.c == increment.a))
+        {
+            continue;
+        }
+
+        // Jumps to the test, e.g. the one entering an inverted loop, still need it
+        erased[i + 1] = !is_label_target[i + 1];
+
+        code[i] = {test.op == opcode::JUMPLESS ? opcode::INCJUMPLESS : opcode::INCJUMPLESSI,
+                   test.a,
+                   increment.a,
+                   test.c};
+        ++n_formed;
+        ++i;
+    }
+    erase_instructions(function, erased);
+
+    return n_formed;
+}
+}    // namespace
+
+std::size_t form_superinstructions(lowered_function&           function,
+                                   const std::vector<value_t>& constants)
+{
+    auto n_formed = fold_immediates(function, constants);
+
+    return n_formed + fuse_increment_and_test(function);
+}
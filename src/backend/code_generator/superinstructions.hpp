@@ -0,0 +1,38 @@
+// Copyright © 2021-2022 Jonas Muehlmann
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "backend/value.hpp"
+#include "lowered_function.hpp"
+
+// Replaces frequent instruction sequences with superinstructions, which do the same work in
+// a single dispatch. The sequences are the most frequent opcode pairs and triples of the
+// representative programs in benchmarks/representative_programs.hpp, as reported by the
+// interpreter built with MVPL_DISPATCH_STATISTICS:
+//   - SETLIT followed by arithmetic or a conditional jump reading the literal becomes the
+//     immediate variant of the operation (ADDI, MULI, ..., JUMPLESSI, ...)
+//   - INC followed by the loop test becomes INCJUMPLESS(I)
+// Has to run before register allocation. Returns the number of formed superinstructions.
+std::size_t form_superinstructions(lowered_function&           function,
+                                   const std::vector<value_t>& constants);
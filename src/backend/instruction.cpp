@@ -18,3 +18,184 @@
 // TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
 // OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "instruction.hpp"
+
+#include <stdexcept>
+#include <utility>
+
+operand_layout get_operand_layout(opcode op)
+{
+    using enum operand_kind;
+
+    switch (op)
+    {
+        case opcode::ADD:
+        case opcode::SUB:
+        case opcode::MUL:
+        case opcode::DIV:
+        case opcode::MOD:
+        case opcode::AND:
+        case opcode::OR:
+        case opcode::LSHIFT:
+        case opcode::RSHIFT:
+        case opcode::XOR:
+            return {DESTINATION, SOURCE, SOURCE};
+        case opcode::INC:
+        case opcode::DEC:
+            return {SOURCE_DESTINATION, UNUSED, UNUSED};
+        case opcode::NOT:
+        case opcode::SET:
+            return {DESTINATION, SOURCE, UNUSED};
+        case opcode::JUMPEQ:
+        case opcode::JUMPNEQ:
+        case opcode::JUMPLESS:
+        case opcode::JUMPGREATER:
+        case opcode::JUMPLEQ:
+        case opcode::JUMPGEQ:
+            return {TARGET, SOURCE, SOURCE};
+        case opcode::SETLIT:
+            return {DESTINATION, CONSTANT, UNUSED};
+        case opcode::READ:
+            return {DESTINATION, UNUSED, UNUSED};
+        case opcode::JUMP:
+            return {TARGET, UNUSED, UNUSED};
+        case opcode::PRINT:
+        case opcode::RET:
+            return {SOURCE, UNUSED, UNUSED};
+        case opcode::CALL:
+            // The arguments are not subject to register allocation
+            return {DESTINATION, FUNCTION, ARGUMENTS};
+        case opcode::TAILCALL:
+            return {UNUSED, FUNCTION, ARGUMENTS};
+        case opcode::ADDI:
+        case opcode::MULI:
+        case opcode::DIVI:
+        case opcode::MODI:
+        case opcode::ANDI:
+        case opcode::LSHIFTI:
+        case opcode::RSHIFTI:
+            return {DESTINATION, SOURCE, IMMEDIATE};
+        case opcode::JUMPEQI:
+        case opcode::JUMPNEQI:
+        case opcode::JUMPLESSI:
+        case opcode::JUMPGREATERI:
+        case opcode::JUMPLEQI:
+        case opcode::JUMPGEQI:
+            return {TARGET, SOURCE, IMMEDIATE};
+        case opcode::INCJUMPLESS:
+            return {TARGET, SOURCE_DESTINATION, SOURCE};
+        case opcode::INCJUMPLESSI:
+            return {TARGET, SOURCE_DESTINATION, IMMEDIATE};
+        case opcode::DIVPOW2I:
+        case opcode::MODPOW2I:
+            return {DESTINATION, SOURCE, IMMEDIATE};
+        case opcode::DIVMAGIC:
+        case opcode::MODMAGIC:
+            return {DESTINATION, SOURCE, CONSTANT};
+        case opcode::JUMPTABLE:
+            return {SOURCE, TABLE, IMMEDIATE};
+        default:
+            break;
+    }
+
+    throw std::invalid_argument("Invalid opcode");
+}
+
+bool is_jump(opcode op)
+{
+    return get_operand_layout(op).a == operand_kind::TARGET;
+}
+
+bool is_conditional_jump(opcode op)
+{
+    return is_jump(op) && op != opcode::JUMP;
+}
+
+bool is_terminator(opcode op)
+{
+    return op == opcode::JUMP || op == opcode::RET || op == opcode::TAILCALL;
+}
+
+std::optional<std::int32_t> get_defined_register(const instruction& i)
+{
+    auto layout = get_operand_layout(i.op);
+
+    for (auto [kind, operand] : {std::pair{layout.a, i.a}, {layout.b, i.b}, {layout.c, i.c}})
+    {
+        if (kind == operand_kind::DESTINATION || kind == operand_kind::SOURCE_DESTINATION)
+        {
+            return operand;
+        }
+    }
+
+    return std::nullopt;
+}
+
+used_registers_t get_used_registers(const instruction& i)
+{
+    auto             layout = get_operand_layout(i.op);
+    used_registers_t used{NO_REGISTER, NO_REGISTER};
+    std::size_t      n_used = 0;
+
+    for (auto [kind, operand] : {std::pair{layout.a, i.a}, {layout.b, i.b}, {layout.c, i.c}})
+    {
+        if (kind == operand_kind::SOURCE || kind == operand_kind::SOURCE_DESTINATION)
+        {
+            used[n_used++] = operand;
+        }
+    }
+
+    return used;
+}
+
+opcode negate_conditional_jump(opcode op)
+{
+    switch (op)
+    {
+        case opcode::JUMPEQ:
+            return opcode::JUMPNEQ;
+        case opcode::JUMPNEQ:
+            return opcode::JUMPEQ;
+        case opcode::JUMPLESS:
+            return opcode::JUMPGEQ;
+        case opcode::JUMPGREATER:
+            return opcode::JUMPLEQ;
+        case opcode::JUMPLEQ:
+            return opcode::JUMPGREATER;
+        case opcode::JUMPGEQ:
+            return opcode::JUMPLESS;
+        case opcode::JUMPEQI:
+            return opcode::JUMPNEQI;
+        case opcode::JUMPNEQI:
+            return opcode::JUMPEQI;
+        case opcode::JUMPLESSI:
+            return opcode::JUMPGEQI;
+        case opcode::JUMPGREATERI:
+            return opcode::JUMPLEQI;
+        case opcode::JUMPLEQI:
+            return opcode::JUMPGREATERI;
+        case opcode::JUMPGEQI:
+            return opcode::JUMPLESSI;
+        default:
+            throw std::invalid_argument("Opcode is not a negatable conditional jump");
+    }
+}
+
+opcode mirror_conditional_jump(opcode op)
+{
+    switch (op)
+    {
+        case opcode::JUMPEQ:
+        case opcode::JUMPNEQ:
+            return op;
+        case opcode::JUMPLESS:
+            return opcode::JUMPGREATER;
+        case opcode::JUMPGREATER:
+            return opcode::JUMPLESS;
+        case opcode::JUMPLEQ:
+            return opcode::JUMPGEQ;
+        case opcode::JUMPGEQ:
+            return opcode::JUMPLEQ;
+        default:
+            throw std::invalid_argument("Opcode is not a mirrorable conditional jump");
+    }
+}
@@ -19,3 +19,76 @@
 // OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 #pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+
+#include "common/macros.hpp"
+#include "opcode.hpp"
+#include <nlohmann/json.hpp>
+
+using json = nlohmann::ordered_json;
+
+// Fixed width three address instruction, the meaning of the operands depends on the opcode
+// (see opcode.hpp). Unused operands are 0.
+struct instruction
+{
+    opcode       op;
+    std::int32_t a;
+    std::int32_t b;
+    std::int32_t c;
+
+    bool operator==(const instruction&) const = default;
+};
+
+NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE_UNORDERED(instruction, op, a, b, c);
+
+// Register operands read by an instruction, unused slots hold NO_REGISTER
+inline constexpr std::int32_t NO_REGISTER = -1;
+
+using used_registers_t = std::array<std::int32_t, 2>;
+
+// What an operand of an instruction refers to
+enum class operand_kind
+{
+    UNUSED,
+    // Registers
+    SOURCE,
+    DESTINATION,
+    SOURCE_DESTINATION,
+    // First register of the outgoing argument area (CALL, TAILCALL)
+    ARGUMENTS,
+    // Non registers
+    TARGET,
+    IMMEDIATE,
+    CONSTANT,
+    FUNCTION,
+    // First entry of a jump table in the constant pool, before linking the index into the
+    // function's jump tables
+    TABLE
+};
+
+struct operand_layout
+{
+    operand_kind a;
+    operand_kind b;
+    operand_kind c;
+};
+
+operand_layout get_operand_layout(opcode op);
+
+bool is_jump(opcode op);
+bool is_conditional_jump(opcode op);
+// True for instructions, after which execution never continues with the next instruction
+bool is_terminator(opcode op);
+
+std::optional<std::int32_t> get_defined_register(const instruction& i);
+used_registers_t            get_used_registers(const instruction& i);
+
+// Swaps the comparison of a conditional jump for its negation (e.g. JUMPLESS -> JUMPGEQ)
+opcode negate_conditional_jump(opcode op);
+// Swaps the comparison of a conditional jump for the one with swapped operands
+// (e.g. JUMPLESS -> JUMPGREATER)
+opcode mirror_conditional_jump(opcode op);
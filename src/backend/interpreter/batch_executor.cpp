@@ -0,0 +1,211 @@
+// Copyright © 2021-2022 Jonas Muehlmann
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include "batch_executor.hpp"
+
+#include <algorithm>
+#include <exception>
+#include <utility>
+
+batch_executor::batch_executor(const batch_options& options_) :
+    options{options_},
+    workers{},
+    batch{0},
+    is_stopping{false},
+    jobs{},
+    results{},
+    n_remaining{0},
+    n_stolen{0}
+{
+    const auto n_threads = options.n_threads != 0
+                               ? options.n_threads
+                               : std::max<std::size_t>(std::thread::hardware_concurrency(), 1);
+
+    for (std::size_t i = 0; i < n_threads; ++i)
+    {
+        workers.push_back(std::make_unique<worker>());
+    }
+
+    // Started once all workers exist, as they steal from each other
+    for (std::size_t i = 0; i < n_threads; ++i)
+    {
+        workers[i]->thread = std::thread(&batch_executor::serve, this, i);
+    }
+}
+
+batch_executor::~batch_executor()
+{
+    {
+        std::scoped_lock lock(mutex);
+        is_stopping = true;
+    }
+
+    batch_started.notify_all();
+
+    for (auto& pooled : workers)
+    {
+        pooled->thread.join();
+    }
+}
+
+std::vector<batch_result> batch_executor::run(std::span<const batch_job> jobs_)
+{
+    if (jobs_.empty())
+    {
+        return {};
+    }
+
+    jobs = jobs_;
+    results.assign(jobs.size(), {});
+    n_remaining = jobs.size();
+
+    // Consecutive jobs stay on one thread, they often run the same program
+    for (std::size_t i = 0; i < workers.size(); ++i)
+    {
+        std::scoped_lock lock(workers[i]->mutex);
+
+        for (auto job = i * jobs.size() / workers.size();
+             job < (i + 1) * jobs.size() / workers.size();
+             ++job)
+        {
+            workers[i]->queue.push_back(job);
+        }
+    }
+
+    std::unique_lock lock(mutex);
+
+    ++batch;
+    batch_started.notify_all();
+    batch_finished.wait(lock, [this] { return n_remaining == 0; });
+
+    jobs = {};
+
+    return std::exchange(results, {});
+}
+
+std::size_t batch_executor::get_n_threads() const
+{
+    return workers.size();
+}
+
+std::uint64_t batch_executor::get_n_stolen() const
+{
+    return n_stolen;
+}
+
+void batch_executor::serve(std::size_t index)
+{
+    auto& self = *workers[index];
+
+    for (std::uint64_t served = 0;;)
+    {
+        {
+            std::unique_lock lock(mutex);
+            batch_started.wait(lock, [&] { return is_stopping || batch != served; });
+
+            if (is_stopping)
+            {
+                return;
+            }
+
+            served = batch;
+        }
+
+        // No jobs are added during a batch, so once all queues are empty the thread is done
+        while (auto job = take_job(index))
+        {
+            results[*job] = run_job(self, jobs[*job]);
+
+            if (--n_remaining == 0)
+            {
+                std::scoped_lock lock(mutex);
+                batch_finished.notify_all();
+            }
+        }
+    }
+}
+
+std::optional<std::size_t> batch_executor::take_job(std::size_t index)
+{
+    {
+        auto&            self = *workers[index];
+        std::scoped_lock lock(self.mutex);
+
+        if (!self.queue.empty())
+        {
+            const auto job = self.queue.back();
+            self.queue.pop_back();
+
+            return job;
+        }
+    }
+
+    for (std::size_t i = 1; i < workers.size(); ++i)
+    {
+        auto&            victim = *workers[(index + i) % workers.size()];
+        std::scoped_lock lock(victim.mutex);
+
+        if (!victim.queue.empty())
+        {
+            const auto job = victim.queue.front();
+            victim.queue.pop_front();
+            ++n_stolen;
+
+            return job;
+        }
+    }
+
+    return std::nullopt;
+}
+
+batch_result batch_executor::run_job(worker& self, const batch_job& job)
+{
+    batch_result result{true, 0, {}, {}};
+    auto&        context = self.machines[job.program];
+
+    try
+    {
+        if (!context)
+        {
+            auto created     = std::make_unique<machine_context>();
+            created->machine = std::make_unique<register_machine>(
+                *job.program, created->output, options.jit, options.stack_limit);
+            context = std::move(created);
+        }
+
+        context->output.str({});
+        context->input.str(job.input);
+        context->input.clear();
+        context->machine->set_input(context->input);
+
+        result.value = context->machine->run();
+    }
+    catch (const std::exception& exception)
+    {
+        result.succeeded = false;
+        result.error     = exception.what();
+    }
+
+    if (context)
+    {
+        result.output = context->output.str();
+    }
+
+    return result;
+}
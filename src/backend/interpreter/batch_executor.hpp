@@ -0,0 +1,132 @@
+// Copyright © 2021-2022 Jonas Muehlmann
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "backend/bytecode_program.hpp"
+#include "backend/value.hpp"
+#include "jit_compiler.hpp"
+#include "register_machine.hpp"
+
+struct batch_options
+{
+    // 0 uses one thread per core
+    std::size_t n_threads{0};
+    std::size_t stack_limit{register_machine::DEFAULT_STACK_LIMIT};
+    jit_options jit{default_jit_options()};
+};
+
+// A run of a program, which has to outlive the batch, with the text read() takes its values
+// from
+struct batch_job
+{
+    const bytecode_program* program;
+    std::string             input;
+};
+
+struct batch_result
+{
+    // False if the run threw, error holds the message then
+    bool        succeeded;
+    value_t     value;
+    std::string output;
+    std::string error;
+};
+
+// Runs batches of independent jobs on a pool of threads within this process, unlike the
+// worker_pool's processes. Every thread keeps a register machine per program it ran, so
+// following jobs of the same program reuse its stacks, decoded code and machine code, and
+// the threads only share the queues.
+//
+// The jobs of a batch are split evenly between the threads' queues. A thread takes its own
+// jobs from the back and, once its queue is empty, steals from the front of the others',
+// so that threads with short jobs take over the jobs of those with long ones.
+class batch_executor
+{
+ public:
+    // Methods
+    explicit batch_executor(const batch_options& options_ = {});
+    ~batch_executor();
+
+    batch_executor(const batch_executor&)            = delete;
+    batch_executor& operator=(const batch_executor&) = delete;
+
+    // Blocks until every job ran, the results are in the order of the jobs. Batches have to
+    // be run one after the other.
+    std::vector<batch_result> run(std::span<const batch_job> jobs);
+
+    [[nodiscard]] std::size_t get_n_threads() const;
+    // Jobs taken from another thread's queue, over all batches
+    [[nodiscard]] std::uint64_t get_n_stolen() const;
+
+ private:
+    // A machine reused for the jobs of one program
+    struct machine_context
+    {
+        std::ostringstream                output;
+        std::istringstream                input;
+        std::unique_ptr<register_machine> machine;
+    };
+
+    using machine_map =
+        std::unordered_map<const bytecode_program*, std::unique_ptr<machine_context>>;
+
+    struct worker
+    {
+        std::mutex              mutex;
+        // Indices into the current batch
+        std::deque<std::size_t> queue;
+        machine_map             machines;
+        std::thread             thread;
+    };
+
+    // Variables
+    batch_options                        options;
+    std::vector<std::unique_ptr<worker>> workers;
+    // Guards the batch and is_stopping
+    std::mutex                           mutex;
+    std::condition_variable              batch_started;
+    std::condition_variable              batch_finished;
+    std::uint64_t                        batch;
+    bool                                 is_stopping;
+    std::span<const batch_job>           jobs;
+    std::vector<batch_result>            results;
+    std::atomic<std::size_t>             n_remaining;
+    std::atomic<std::uint64_t>           n_stolen;
+
+    // Methods
+    void                       serve(std::size_t index);
+    std::optional<std::size_t> take_job(std::size_t index);
+    batch_result               run_job(worker& self, const batch_job& job);
+};
@@ -0,0 +1,367 @@
+// Copyright © 2021-2022 Jonas Muehlmann
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include "buffered_io.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <stdexcept>
+#include <utility>
+
+#ifdef MVPL_FILE_DESCRIPTORS
+#    include <cerrno>
+
+#    include <poll.h>
+#    include <unistd.h>
+#endif
+
+namespace
+{
+bool is_space(char character)
+{
+    return character == ' ' || character == '\n' || character == '\t' || character == '\r'
+           || character == '\v' || character == '\f';
+}
+
+// The text of a value, without surrounding whitespace
+value_t parse_value(const char* first, const char* last)
+{
+    const bool is_negative = first != last && *first == '-';
+
+    if (first != last && (*first == '-' || *first == '+'))
+    {
+        ++first;
+    }
+
+    if (first == last)
+    {
+        throw std::runtime_error("Invalid input");
+    }
+
+    // The smallest value's magnitude is one larger than the largest value's
+    const auto    limit = static_cast<std::uint64_t>(std::numeric_limits<value_t>::max())
+                       + (is_negative ? 1 : 0);
+    std::uint64_t magnitude = 0;
+
+    for (; first != last; ++first)
+    {
+        if (*first < '0' || *first > '9')
+        {
+            throw std::runtime_error("Invalid input");
+        }
+
+        const auto digit = static_cast<std::uint64_t>(*first - '0');
+
+        if (magnitude > (limit - digit) / 10)
+        {
+            throw std::runtime_error("Input out of range");
+        }
+
+        magnitude = magnitude * 10 + digit;
+    }
+
+    return static_cast<value_t>(is_negative ? 0 - magnitude : magnitude);
+}
+
+#ifdef MVPL_FILE_DESCRIPTORS
+// Waits until a non-blocking file descriptor is ready, returns false on errors
+bool wait_until_ready(int file, short events)
+{
+    pollfd ready{file, events, 0};
+
+    while (poll(&ready, 1, -1) < 0)
+    {
+        if (errno != EINTR)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool would_block()
+{
+    return errno == EAGAIN || errno == EWOULDBLOCK;
+}
+#endif
+}    // namespace
+
+//****************************************************************************//
+//                                   Output                                   //
+//****************************************************************************//
+output_buffer::output_buffer(std::ostream& stream_, std::size_t capacity) :
+    stream{&stream_},
+    file{-1},
+    buffer(std::max(capacity, MAX_VALUE_LENGTH)),
+    size{0}
+{
+#ifdef MVPL_FILE_DESCRIPTORS
+    if (stream_.rdbuf() == std::cout.rdbuf())
+    {
+        file = STDOUT_FILENO;
+    }
+#endif
+}
+
+#ifdef MVPL_FILE_DESCRIPTORS
+output_buffer::output_buffer(int file_, std::size_t capacity) :
+    stream{nullptr},
+    file{file_},
+    buffer(std::max(capacity, MAX_VALUE_LENGTH)),
+    size{0}
+{}
+#endif
+
+output_buffer::output_buffer(output_buffer&& other) noexcept :
+    stream{other.stream},
+    file{other.file},
+    buffer{std::move(other.buffer)},
+    size{std::exchange(other.size, 0)}
+{}
+
+output_buffer& output_buffer::operator=(output_buffer&& other)
+{
+    if (this != &other)
+    {
+        flush();
+
+        stream = other.stream;
+        file   = other.file;
+        buffer = std::move(other.buffer);
+        size   = std::exchange(other.size, 0);
+    }
+
+    return *this;
+}
+
+output_buffer::~output_buffer()
+{
+    try
+    {
+        flush();
+    }
+    catch (const std::runtime_error&)
+    {
+    }
+}
+
+void output_buffer::flush()
+{
+    if (size == 0)
+    {
+        return;
+    }
+
+    const auto pending = std::exchange(size, 0);
+
+#ifdef MVPL_FILE_DESCRIPTORS
+    if (file != -1)
+    {
+        // Whatever was written to the stream comes first
+        if (stream != nullptr)
+        {
+            stream->flush();
+        }
+
+        for (std::size_t written = 0; written < pending;)
+        {
+            const auto n_written = ::write(file, buffer.data() + written, pending - written);
+
+            if (n_written < 0 && would_block() && wait_until_ready(file, POLLOUT))
+            {
+                continue;
+            }
+            if (n_written < 0 && errno != EINTR)
+            {
+                throw std::runtime_error("Could not write the output");
+            }
+            if (n_written > 0)
+            {
+                written += static_cast<std::size_t>(n_written);
+            }
+        }
+
+        return;
+    }
+#endif
+
+    if (!stream->write(buffer.data(), static_cast<std::streamsize>(pending)))
+    {
+        throw std::runtime_error("Could not write the output");
+    }
+}
+
+//****************************************************************************//
+//                                   Input                                    //
+//****************************************************************************//
+input_buffer::input_buffer(std::istream& stream_, std::size_t capacity_) :
+    stream{&stream_},
+    file{-1},
+    buffer{},
+    capacity{std::max<std::size_t>(capacity_, 1)},
+    begin{0},
+    end{0},
+    is_exhausted{false}
+{
+#ifdef MVPL_FILE_DESCRIPTORS
+    if (stream_.rdbuf() == std::cin.rdbuf())
+    {
+        file = STDIN_FILENO;
+    }
+#endif
+}
+
+#ifdef MVPL_FILE_DESCRIPTORS
+input_buffer::input_buffer(int file_, std::size_t capacity_) :
+    stream{nullptr},
+    file{file_},
+    buffer{},
+    capacity{std::max<std::size_t>(capacity_, 1)},
+    begin{0},
+    end{0},
+    is_exhausted{false}
+{}
+#endif
+
+value_t input_buffer::read(output_buffer& pending_output)
+{
+    for (;;)
+    {
+        if (const auto value = try_read(pending_output))
+        {
+            return *value;
+        }
+
+        wait();
+    }
+}
+
+std::optional<value_t> input_buffer::try_read(output_buffer& pending_output)
+{
+    for (;;)
+    {
+        const char* data  = buffer.data();
+        const char* last  = data + end;
+        const char* first = std::find_if_not(data + begin, last, is_space);
+        begin             = static_cast<std::size_t>(first - data);
+
+        // Whitespace or the end of the input completes a value
+        const char* value_end = std::find_if(first, last, is_space);
+
+        if (value_end != last || (is_exhausted && first != last))
+        {
+            begin = static_cast<std::size_t>(value_end - data);
+
+            return parse_value(first, value_end);
+        }
+
+        if (is_exhausted)
+        {
+            return 0;
+        }
+
+        if (!refill(pending_output) && !is_exhausted)
+        {
+            return std::nullopt;
+        }
+    }
+}
+
+void input_buffer::wait()
+{
+#ifdef MVPL_FILE_DESCRIPTORS
+    if (file != -1 && !wait_until_ready(file, POLLIN))
+    {
+        throw std::runtime_error("Could not wait for input");
+    }
+#endif
+}
+
+bool input_buffer::refill(output_buffer& pending_output)
+{
+    if (is_exhausted)
+    {
+        return false;
+    }
+
+    pending_output.flush();
+
+    // The beginning of an incomplete value moves to the front, the buffer only grows if the
+    // value fills it
+    std::copy(buffer.begin() + static_cast<std::ptrdiff_t>(begin),
+              buffer.begin() + static_cast<std::ptrdiff_t>(end),
+              buffer.begin());
+    end   = end - begin;
+    begin = 0;
+
+    if (end == buffer.size())
+    {
+        if (buffer.size() >= MAX_INPUT_LENGTH)
+        {
+            throw std::runtime_error("Invalid input");
+        }
+
+        buffer.resize(buffer.empty() ? capacity : std::min(2 * buffer.size(), MAX_INPUT_LENGTH));
+    }
+
+    char* const       free_space = buffer.data() + end;
+    const std::size_t free_size  = buffer.size() - end;
+    std::size_t       n_read     = 0;
+
+#ifdef MVPL_FILE_DESCRIPTORS
+    if (file != -1)
+    {
+        auto result = ::read(file, free_space, free_size);
+
+        while (result < 0 && errno == EINTR)
+        {
+            result = ::read(file, free_space, free_size);
+        }
+
+        if (result < 0 && would_block())
+        {
+            return false;
+        }
+        if (result < 0)
+        {
+            throw std::runtime_error("Could not read the input");
+        }
+
+        n_read = static_cast<std::size_t>(result);
+    }
+    else
+#endif
+    {
+        // Only takes what the stream has buffered, so that interactive streams do not block
+        // until the whole buffer is filled
+        const auto available = stream->rdbuf()->in_avail();
+        const auto requested =
+            available > 0 ? std::min(static_cast<std::size_t>(available), free_size) : 1;
+
+        n_read = static_cast<std::size_t>(
+            stream->rdbuf()->sgetn(free_space, static_cast<std::streamsize>(requested)));
+    }
+
+    end          = end + n_read;
+    is_exhausted = n_read == 0;
+
+    return n_read > 0;
+}
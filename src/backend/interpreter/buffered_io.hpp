@@ -0,0 +1,136 @@
+// Copyright © 2021-2022 Jonas Muehlmann
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#pragma once
+
+#include <charconv>
+#include <cstddef>
+#include <istream>
+#include <limits>
+#include <optional>
+#include <ostream>
+#include <vector>
+
+#include "backend/value.hpp"
+
+// Reading and writing file descriptors needs POSIX, elsewhere the buffers only use streams
+#ifdef __unix__
+#    define MVPL_FILE_DESCRIPTORS
+#endif
+
+inline constexpr std::size_t DEFAULT_IO_BUFFER_SIZE = 64 * 1024;
+
+// Output of the WRITE trap (print). Values are formatted into a large buffer, which is only
+// written once it is full or flushed, so printing does not make a call to the stream or a
+// system call per value. The buffer of std::cout is bypassed: output to it is written to
+// the standard output's file descriptor after flushing the stream.
+class output_buffer
+{
+ public:
+    // Sign, digits and the newline
+    static constexpr std::size_t MAX_VALUE_LENGTH = std::numeric_limits<value_t>::digits10 + 3;
+
+    // Methods
+    explicit output_buffer(std::ostream& stream_, std::size_t capacity = DEFAULT_IO_BUFFER_SIZE);
+#ifdef MVPL_FILE_DESCRIPTORS
+    explicit output_buffer(int file_, std::size_t capacity = DEFAULT_IO_BUFFER_SIZE);
+#endif
+    // Flushes, errors are ignored
+    ~output_buffer();
+
+    output_buffer(const output_buffer&)            = delete;
+    output_buffer& operator=(const output_buffer&) = delete;
+    output_buffer(output_buffer&& other) noexcept;
+    // Flushes what is pending before taking over the other buffer
+    output_buffer& operator=(output_buffer&& other);
+
+    // Writes the value and a newline
+    void write(value_t value)
+    {
+        if (buffer.size() - size < MAX_VALUE_LENGTH)
+        {
+            flush();
+        }
+
+        auto* end = std::to_chars(buffer.data() + size, buffer.data() + buffer.size(), value).ptr;
+        *end++    = '\n';
+        size      = static_cast<std::size_t>(end - buffer.data());
+    }
+
+    // Throws std::runtime_error if the output can not be written, the buffer is empty
+    // afterwards either way. Non-blocking file descriptors are waited for until writable.
+    void flush();
+
+ private:
+    // Variables
+    std::ostream*     stream;
+    // Used instead of the stream unless -1
+    int               file;
+    std::vector<char> buffer;
+    std::size_t       size;
+};
+
+// Input of the READ trap (read). The input is read in large blocks, integers are parsed out of
+// the buffer. Like output_buffer, std::cin is bypassed for the standard input's file
+// descriptor, any input already buffered by the stream is not seen.
+//
+// A value is only parsed once it is complete, i.e. followed by whitespace or the end of the
+// input. Until then its beginning stays in the buffer, so that reading a non-blocking file
+// descriptor can stop at any point and continue once more input arrived.
+class input_buffer
+{
+ public:
+    // Longest value including leading zeros, the buffer grows to hold it if it is smaller
+    static constexpr std::size_t MAX_INPUT_LENGTH = 4096;
+
+    // Methods
+    // The buffer is only allocated once the program reads
+    explicit input_buffer(std::istream& stream_, std::size_t capacity_ = DEFAULT_IO_BUFFER_SIZE);
+#ifdef MVPL_FILE_DESCRIPTORS
+    explicit input_buffer(int file_, std::size_t capacity_ = DEFAULT_IO_BUFFER_SIZE);
+#endif
+
+    // Skips whitespace and parses a decimal integer with an optional sign, which has to end
+    // at whitespace or the end of the input. Returns 0 once the input is exhausted. The
+    // pending output is flushed before waiting for more input, so that prompts are shown.
+    // Throws std::runtime_error if the input is no integer, out of range or can not be read.
+    value_t read(output_buffer& pending_output);
+    // Like read, but returns std::nullopt instead of waiting if a non-blocking file descriptor
+    // has no complete value yet
+    std::optional<value_t> try_read(output_buffer& pending_output);
+    // Blocks until the file descriptor is readable, returns at once for streams
+    void wait();
+
+ private:
+    // Variables
+    std::istream*     stream;
+    // Used instead of the stream unless -1
+    int               file;
+    std::vector<char> buffer;
+    std::size_t       capacity;
+    // Unread part of the buffer
+    std::size_t       begin;
+    std::size_t       end;
+    bool              is_exhausted;
+
+    // Methods
+    // Appends to the unread part, returns false at the end of the input or if reading would
+    // block
+    bool refill(output_buffer& pending_output);
+};
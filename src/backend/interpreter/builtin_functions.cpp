@@ -18,3 +18,40 @@
 // TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
 // OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "builtin_functions.hpp"
+
+#include <algorithm>
+#include <array>
+
+using namespace std::literals::string_view_literals;
+
+namespace
+{
+const std::array BUILTIN_FUNCTIONS{
+    builtin_function{"print"sv, opcode::PRINT, 1, false},
+    builtin_function{"read"sv, opcode::READ, 0, true},
+};
+}    // namespace
+
+std::optional<builtin_function> find_builtin_function(std::string_view name)
+{
+    const auto* builtin = std::ranges::find(BUILTIN_FUNCTIONS, name, &builtin_function::name);
+
+    if (builtin == BUILTIN_FUNCTIONS.end())
+    {
+        return std::nullopt;
+    }
+
+    return *builtin;
+}
+
+std::optional<builtin_function> find_builtin_function(opcode op)
+{
+    const auto* builtin = std::ranges::find(BUILTIN_FUNCTIONS, op, &builtin_function::op);
+
+    if (builtin == BUILTIN_FUNCTIONS.end())
+    {
+        return std::nullopt;
+    }
+
+    return *builtin;
+}
@@ -19,3 +19,23 @@
 // OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 #pragma once
+
+#include <cstddef>
+#include <optional>
+#include <string_view>
+
+#include "backend/opcode.hpp"
+
+// Functions provided by the interpreter itself, calls to them are lowered to a single
+// instruction instead of a CALL.
+struct builtin_function
+{
+    std::string_view name;
+    opcode           op;
+    std::size_t      n_parameters;
+    // Procedures do not produce a value and can not be evaluated
+    bool             returns_value;
+};
+
+std::optional<builtin_function> find_builtin_function(std::string_view name);
+std::optional<builtin_function> find_builtin_function(opcode op);
@@ -0,0 +1,162 @@
+// Copyright © 2021-2022 Jonas Muehlmann
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include "dispatch_statistics.hpp"
+
+#include <algorithm>
+#include <iomanip>
+#include <string>
+#include <utility>
+
+namespace
+{
+std::size_t to_index(opcode op)
+{
+    return static_cast<std::size_t>(op);
+}
+
+std::size_t to_index(opcode first, opcode second)
+{
+    return to_index(first) * ALL_OPCODES.size() + to_index(second);
+}
+
+std::size_t to_index(opcode first, opcode second, opcode third)
+{
+    return to_index(first, second) * ALL_OPCODES.size() + to_index(third);
+}
+
+// Prints the n_top largest counts, name_of maps an index of counts to its opcode sequence
+template <typename TFunction>
+void print_top(std::ostream&                     output,
+               const std::vector<std::uint64_t>& counts,
+               std::uint64_t                     n_dispatches,
+               std::size_t                       n_top,
+               TFunction&&                       name_of)
+{
+    std::vector<std::pair<std::uint64_t, std::size_t>> sorted;
+
+    for (std::size_t i = 0; i < counts.size(); ++i)
+    {
+        if (counts[i] > 0)
+        {
+            sorted.emplace_back(counts[i], i);
+        }
+    }
+
+    std::ranges::sort(sorted, std::greater{});
+    sorted.resize(std::min(sorted.size(), n_top));
+
+    for (const auto& [count, index] : sorted)
+    {
+        output << "    " << std::left << std::setw(40) << name_of(index) << std::right
+               << std::setw(14) << count << std::setw(9) << std::fixed << std::setprecision(2)
+               << 100.0 * static_cast<double>(count) / static_cast<double>(n_dispatches)
+               << "%\n";
+    }
+}
+
+std::string to_string(std::size_t index, std::size_t length)
+{
+    std::string name;
+
+    for (std::size_t i = 0; i < length; ++i)
+    {
+        auto op = index % ALL_OPCODES.size();
+        index /= ALL_OPCODES.size();
+
+        name = std::string(LUT_OPCODE_TO_STRING[op]) + (name.empty() ? "" : " ") + name;
+    }
+
+    return name;
+}
+}    // namespace
+
+dispatch_statistics::dispatch_statistics() :
+    n_dispatches{0},
+    opcode_counts(ALL_OPCODES.size(), 0),
+    pair_counts(ALL_OPCODES.size() * ALL_OPCODES.size(), 0),
+    triple_counts(ALL_OPCODES.size() * ALL_OPCODES.size() * ALL_OPCODES.size(), 0),
+    previous_index{NO_INDEX},
+    second_previous_index{NO_INDEX},
+    previous_op{},
+    second_previous_op{}
+{}
+
+void dispatch_statistics::record(std::span<const instruction> code, std::size_t index)
+{
+    const auto op = code[index].op;
+
+    ++n_dispatches;
+    ++opcode_counts[to_index(op)];
+
+    if (previous_index != NO_INDEX && index == previous_index + 1)
+    {
+        ++pair_counts[to_index(previous_op, op)];
+
+        if (second_previous_index != NO_INDEX && previous_index == second_previous_index + 1)
+        {
+            ++triple_counts[to_index(second_previous_op, previous_op, op)];
+        }
+    }
+
+    second_previous_index = previous_index;
+    second_previous_op    = previous_op;
+    previous_index        = index;
+    previous_op           = op;
+}
+
+std::uint64_t dispatch_statistics::get_n_dispatches() const
+{
+    return n_dispatches;
+}
+
+std::uint64_t dispatch_statistics::get_count(opcode op) const
+{
+    return opcode_counts[to_index(op)];
+}
+
+std::uint64_t dispatch_statistics::get_count(opcode first, opcode second) const
+{
+    return pair_counts[to_index(first, second)];
+}
+
+std::uint64_t dispatch_statistics::get_count(opcode first, opcode second, opcode third) const
+{
+    return triple_counts[to_index(first, second, third)];
+}
+
+void dispatch_statistics::print_report(std::ostream& output, std::size_t n_top) const
+{
+    output << "Dispatches: " << n_dispatches << '\n';
+
+    output << "Opcodes:\n";
+    print_top(output, opcode_counts, n_dispatches, n_top, [](std::size_t index) {
+        return to_string(index, 1);
+    });
+
+    output << "Pairs:\n";
+    print_top(output, pair_counts, n_dispatches, n_top, [](std::size_t index) {
+        return to_string(index, 2);
+    });
+
+    output << "Triples:\n";
+    print_top(output, triple_counts, n_dispatches, n_top, [](std::size_t index) {
+        return to_string(index, 3);
+    });
+}
@@ -0,0 +1,67 @@
+// Copyright © 2021-2022 Jonas Muehlmann
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <ostream>
+#include <span>
+#include <vector>
+
+#include "backend/instruction.hpp"
+#include "backend/opcode.hpp"
+
+// Dynamic opcode histogram collected by the instrumented interpreter (built with
+// MVPL_DISPATCH_STATISTICS). Pairs and triples only count instructions, which directly
+// follow each other in the code, because only those can be fused into a superinstruction.
+class dispatch_statistics
+{
+ public:
+    // Methods
+    dispatch_statistics();
+
+    // Records the dispatch of code[index]
+    void record(std::span<const instruction> code, std::size_t index);
+
+    [[nodiscard]] std::uint64_t get_n_dispatches() const;
+    [[nodiscard]] std::uint64_t get_count(opcode op) const;
+    [[nodiscard]] std::uint64_t get_count(opcode first, opcode second) const;
+    [[nodiscard]] std::uint64_t get_count(opcode first, opcode second, opcode third) const;
+
+    // Prints the n_top most frequent opcodes, pairs and triples
+    void print_report(std::ostream& output, std::size_t n_top = 10) const;
+
+ private:
+    static constexpr std::size_t NO_INDEX = std::numeric_limits<std::size_t>::max();
+
+    // Variables
+    std::uint64_t              n_dispatches;
+    std::vector<std::uint64_t> opcode_counts;
+    std::vector<std::uint64_t> pair_counts;
+    std::vector<std::uint64_t> triple_counts;
+
+    // Indices and opcodes of the last two dispatched instructions
+    std::size_t previous_index;
+    std::size_t second_previous_index;
+    opcode      previous_op;
+    opcode      second_previous_op;
+};
@@ -0,0 +1,108 @@
+// Copyright © 2021-2022 Jonas Muehlmann
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include "executable_memory.hpp"
+
+// Only POSIX systems provide mmap and mprotect, elsewhere the JIT is disabled
+#ifdef __unix__
+
+#    include <algorithm>
+#    include <stdexcept>
+#    include <utility>
+
+#    include <sys/mman.h>
+#    include <unistd.h>
+
+executable_memory::executable_memory(std::size_t size) :
+    memory{nullptr}, mapped_size{0}, executable{false}
+{
+    const auto page_size = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+
+    mapped_size = (std::max<std::size_t>(size, 1) + page_size - 1) / page_size * page_size;
+
+    void* mapping =
+        mmap(nullptr, mapped_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    if (mapping == MAP_FAILED)
+    {
+        throw std::runtime_error("Could not map memory for machine code");
+    }
+
+    memory = static_cast<std::uint8_t*>(mapping);
+}
+
+executable_memory::~executable_memory()
+{
+    if (memory != nullptr)
+    {
+        munmap(memory, mapped_size);
+    }
+}
+
+executable_memory::executable_memory(executable_memory&& other) noexcept :
+    memory{std::exchange(other.memory, nullptr)},
+    mapped_size{std::exchange(other.mapped_size, 0)},
+    executable{std::exchange(other.executable, false)}
+{}
+
+executable_memory& executable_memory::operator=(executable_memory&& other) noexcept
+{
+    std::swap(memory, other.memory);
+    std::swap(mapped_size, other.mapped_size);
+    std::swap(executable, other.executable);
+
+    return *this;
+}
+
+std::uint8_t* executable_memory::data() const
+{
+    return memory;
+}
+
+std::size_t executable_memory::size() const
+{
+    return mapped_size;
+}
+
+bool executable_memory::is_executable() const
+{
+    return executable;
+}
+
+void executable_memory::make_writable()
+{
+    protect(PROT_READ | PROT_WRITE);
+    executable = false;
+}
+
+void executable_memory::make_executable()
+{
+    protect(PROT_READ | PROT_EXEC);
+    executable = true;
+}
+
+void executable_memory::protect(int protection)
+{
+    if (mprotect(memory, mapped_size, protection) != 0)
+    {
+        throw std::runtime_error("Could not change the protection of machine code");
+    }
+}
+
+#endif
@@ -0,0 +1,56 @@
+// Copyright © 2021-2022 Jonas Muehlmann
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Page aligned memory for generated machine code. It is never writable and executable at the
+// same time (W^X): code is copied in while the memory is writable and the memory is then
+// made executable, patching it again requires making it writable first.
+class executable_memory
+{
+ public:
+    // Methods
+    // Maps at least size bytes of writable memory, throws std::runtime_error on failure
+    explicit executable_memory(std::size_t size);
+    ~executable_memory();
+
+    executable_memory(const executable_memory&)            = delete;
+    executable_memory& operator=(const executable_memory&) = delete;
+    executable_memory(executable_memory&& other) noexcept;
+    executable_memory& operator=(executable_memory&& other) noexcept;
+
+    [[nodiscard]] std::uint8_t* data() const;
+    [[nodiscard]] std::size_t   size() const;
+    [[nodiscard]] bool          is_executable() const;
+
+    void make_writable();
+    void make_executable();
+
+ private:
+    // Variables
+    std::uint8_t* memory;
+    std::size_t   mapped_size;
+    bool          executable;
+
+    // Methods
+    void protect(int protection);
+};
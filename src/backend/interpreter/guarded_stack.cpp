@@ -0,0 +1,266 @@
+// Copyright © 2021-2022 Jonas Muehlmann
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include "guarded_stack.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+#ifdef MVPL_GUARD_PAGES
+#    include <memory>
+#    include <mutex>
+
+#    include <sys/mman.h>
+#    include <unistd.h>
+#endif
+
+namespace
+{
+// Accessible from the start, the accessible part at least doubles whenever the stack grows
+constexpr std::size_t INITIAL_SIZE = 64 * 1024;
+
+std::size_t round_up(std::size_t size, std::size_t alignment)
+{
+    return (size + alignment - 1) / alignment * alignment;
+}
+}    // namespace
+
+//****************************************************************************//
+//                               Guarded stack                                //
+//****************************************************************************//
+#ifdef MVPL_GUARD_PAGES
+guarded_stack::guarded_stack(std::size_t limit_, std::size_t guard_size_) :
+    memory{nullptr}, reserved_size{0}, accessible_size{0}, usable_size{0}
+{
+    const auto page_size = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+
+    usable_size   = round_up(std::max<std::size_t>(limit_, 1), page_size);
+    reserved_size = usable_size + round_up(std::max<std::size_t>(guard_size_, 1), page_size);
+
+    // Reserving address space needs no memory, until pages are made accessible
+    void* mapping = mmap(nullptr,
+                         reserved_size,
+                         PROT_NONE,
+                         MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE,
+                         -1,
+                         0);
+
+    if (mapping == MAP_FAILED)
+    {
+        throw std::runtime_error("Could not reserve memory for the stack");
+    }
+
+    memory = static_cast<std::byte*>(mapping);
+
+    if (handle_fault(memory + std::min(INITIAL_SIZE, usable_size) - 1) != fault::GROWN)
+    {
+        munmap(memory, reserved_size);
+
+        throw std::runtime_error("Could not commit memory for the stack");
+    }
+}
+
+guarded_stack::~guarded_stack()
+{
+    munmap(memory, reserved_size);
+}
+
+guarded_stack::fault guarded_stack::handle_fault(const void* address) noexcept
+{
+    const auto* byte = static_cast<const std::byte*>(address);
+
+    if (byte < memory + accessible_size || byte >= memory + reserved_size)
+    {
+        return fault::FOREIGN;
+    }
+
+    const auto offset = static_cast<std::size_t>(byte - memory);
+
+    if (offset >= usable_size)
+    {
+        return fault::EXHAUSTED;
+    }
+
+    const auto new_size =
+        std::min(usable_size, std::max(round_up(offset + 1, INITIAL_SIZE), 2 * accessible_size));
+
+    // Out of memory ends the program like an overflow
+    if (mprotect(memory + accessible_size, new_size - accessible_size, PROT_READ | PROT_WRITE)
+        != 0)
+    {
+        return fault::EXHAUSTED;
+    }
+
+    accessible_size = new_size;
+
+    return fault::GROWN;
+}
+#else
+guarded_stack::guarded_stack(std::size_t limit_, [[maybe_unused]] std::size_t guard_size_) :
+    memory{new std::byte[limit_]},
+    reserved_size{limit_},
+    accessible_size{limit_},
+    usable_size{limit_}
+{}
+
+guarded_stack::~guarded_stack()
+{
+    delete[] memory;
+}
+
+guarded_stack::fault guarded_stack::handle_fault([[maybe_unused]] const void* address) noexcept
+{
+    return fault::FOREIGN;
+}
+#endif
+
+void* guarded_stack::data() const
+{
+    return memory;
+}
+
+std::size_t guarded_stack::limit() const
+{
+    return usable_size;
+}
+
+std::size_t guarded_stack::committed() const
+{
+    return accessible_size;
+}
+
+//****************************************************************************//
+//                            Stack fault handler                             //
+//****************************************************************************//
+#ifdef MVPL_GUARD_PAGES
+namespace
+{
+constexpr std::size_t SIGNAL_STACK_SIZE = 64 * 1024;
+
+thread_local stack_fault_handler* active_handler = nullptr;
+
+struct sigaction previous_action;
+std::once_flag   install_flag;
+
+// Overflowing the native stack faults as well, the handler can not run on it then. Threads,
+// which did not set up an alternate signal stack themselves, get this one.
+struct signal_stack
+{
+    std::unique_ptr<std::byte[]> memory;
+
+    ~signal_stack()
+    {
+        if (memory != nullptr)
+        {
+            stack_t disabled{};
+            disabled.ss_flags = SS_DISABLE;
+
+            sigaltstack(&disabled, nullptr);
+        }
+    }
+};
+
+thread_local signal_stack thread_signal_stack;
+}    // namespace
+
+stack_fault_handler::stack_fault_handler(std::initializer_list<guarded_stack*> stacks_) :
+    stacks{stacks_}, overflow_target{}, previous{active_handler}
+{
+    std::call_once(install_flag, [] {
+        struct sigaction action = {};
+        action.sa_sigaction     = handle_segmentation_fault;
+        action.sa_flags         = SA_SIGINFO | SA_ONSTACK;
+        sigemptyset(&action.sa_mask);
+
+        if (sigaction(SIGSEGV, &action, &previous_action) != 0)
+        {
+            throw std::runtime_error("Could not install the stack overflow handler");
+        }
+    });
+
+    stack_t current{};
+    sigaltstack(nullptr, &current);
+
+    if ((current.ss_flags & SS_DISABLE) != 0)
+    {
+        thread_signal_stack.memory = std::make_unique<std::byte[]>(SIGNAL_STACK_SIZE);
+
+        stack_t stack{};
+        stack.ss_sp   = thread_signal_stack.memory.get();
+        stack.ss_size = SIGNAL_STACK_SIZE;
+
+        if (sigaltstack(&stack, nullptr) != 0)
+        {
+            throw std::runtime_error("Could not install the alternate signal stack");
+        }
+    }
+
+    active_handler = this;
+}
+
+stack_fault_handler::~stack_fault_handler()
+{
+    active_handler = previous;
+}
+
+sigjmp_buf& stack_fault_handler::get_overflow_target()
+{
+    return overflow_target;
+}
+
+void stack_fault_handler::handle_segmentation_fault(int        signal_number,
+                                                    siginfo_t* info,
+                                                    void*      context)
+{
+    if (active_handler != nullptr)
+    {
+        for (auto* stack : active_handler->stacks)
+        {
+            switch (stack->handle_fault(info->si_addr))
+            {
+                case guarded_stack::fault::GROWN:
+                    return;
+                case guarded_stack::fault::EXHAUSTED:
+                    siglongjmp(active_handler->overflow_target, 1);
+                case guarded_stack::fault::FOREIGN:
+                    break;
+            }
+        }
+    }
+
+    // Not an access to one of the stacks, whoever handled faults before takes over
+    if ((previous_action.sa_flags & SA_SIGINFO) != 0)
+    {
+        previous_action.sa_sigaction(signal_number, info, context);
+    }
+    else if (previous_action.sa_handler != SIG_DFL && previous_action.sa_handler != SIG_IGN)
+    {
+        previous_action.sa_handler(signal_number);
+    }
+    else
+    {
+        // Returning repeats the faulting access, which now terminates the program
+        struct sigaction default_action = {};
+        default_action.sa_handler       = SIG_DFL;
+        sigemptyset(&default_action.sa_mask);
+
+        sigaction(SIGSEGV, &default_action, nullptr);
+    }
+}
+#endif
@@ -0,0 +1,104 @@
+// Copyright © 2021-2022 Jonas Muehlmann
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#pragma once
+
+#include <cstddef>
+#include <initializer_list>
+#include <vector>
+
+// Stacks of the interpreter detect overflows through guard pages instead of comparing the
+// stack pointer against the limit on every push. Only POSIX systems provide the necessary
+// mmap, mprotect and signal handling, elsewhere the stack is allocated at its full size
+// and pushes are checked.
+#ifdef __unix__
+#    define MVPL_GUARD_PAGES
+#    include <setjmp.h>
+#    include <signal.h>
+#endif
+
+// Address space for limit bytes is reserved up front, followed by at least guard_size bytes
+// of inaccessible guard pages. Only the first pages are accessible at first: touching the
+// ones behind them makes them accessible, so memory is committed as the stack grows, until
+// touching the guard pages signals an overflow (see stack_fault_handler).
+class guarded_stack
+{
+ public:
+    enum class fault
+    {
+        // The address is not part of the stack
+        FOREIGN,
+        // Pages up to the address were made accessible, the access can be repeated
+        GROWN,
+        // The address lies in the guard pages or no more memory could be committed
+        EXHAUSTED,
+    };
+
+    // Methods
+    // Throws std::runtime_error if the address space can not be reserved
+    guarded_stack(std::size_t limit_, std::size_t guard_size_);
+    ~guarded_stack();
+
+    guarded_stack(const guarded_stack&)            = delete;
+    guarded_stack& operator=(const guarded_stack&) = delete;
+
+    [[nodiscard]] void*       data() const;
+    [[nodiscard]] std::size_t limit() const;
+    // Number of accessible bytes from the start
+    [[nodiscard]] std::size_t committed() const;
+
+    // Called from the signal handler, so it only makes system calls
+    fault handle_fault(const void* address) noexcept;
+
+ private:
+    // Variables
+    std::byte*  memory;
+    std::size_t reserved_size;
+    std::size_t accessible_size;
+    std::size_t usable_size;
+};
+
+#ifdef MVPL_GUARD_PAGES
+// While it exists, segmentation faults of the current thread in the given stacks are
+// handled on an alternate signal stack: faults before a stack's limit grow it, faults in
+// its guard pages jump to get_overflow_target, which has to be set with sigsetjmp by the
+// function creating the handler. Other faults crash the program as if there was no handler.
+class stack_fault_handler
+{
+ public:
+    // Methods
+    explicit stack_fault_handler(std::initializer_list<guarded_stack*> stacks_);
+    ~stack_fault_handler();
+
+    stack_fault_handler(const stack_fault_handler&)            = delete;
+    stack_fault_handler& operator=(const stack_fault_handler&) = delete;
+
+    [[nodiscard]] sigjmp_buf& get_overflow_target();
+
+ private:
+    // Variables
+    std::vector<guarded_stack*> stacks;
+    sigjmp_buf                  overflow_target;
+    // Handlers of nested machines on the same thread
+    stack_fault_handler*        previous;
+
+    // Methods
+    static void handle_segmentation_fault(int signal, siginfo_t* info, void* context);
+};
+#endif
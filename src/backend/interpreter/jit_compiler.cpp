@@ -0,0 +1,1047 @@
+// Copyright © 2021-2022 Jonas Muehlmann
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include "jit_compiler.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+
+#include "backend/instruction.hpp"
+#include "backend/opcode.hpp"
+
+jit_options default_jit_options()
+{
+    return {.enabled = std::getenv("MVPL_NO_JIT") == nullptr};
+}
+
+#ifdef MVPL_JIT
+
+namespace
+{
+//****************************************************************************//
+//                                  Assembler                                 //
+//****************************************************************************//
+// The templates only need the first eight registers, so no REX.R/REX.B bits are needed.
+// rdi holds the register window for the whole function.
+enum class gpr : std::uint8_t
+{
+    RAX = 0,
+    RCX = 1,
+    RDX = 2,
+    RSI = 6,
+    RDI = 7
+};
+
+// Low nibble of Jcc (0x0F 0x80 + cc) and SETcc (0x0F 0x90 + cc)
+enum class condition_code : std::uint8_t
+{
+    ABOVE_EQUAL   = 0x3,
+    EQUAL         = 0x4,
+    NOT_EQUAL     = 0x5,
+    LESS          = 0xC,
+    GREATER_EQUAL = 0xD,
+    LESS_EQUAL    = 0xE,
+    GREATER       = 0xF
+};
+
+// The /digit of the immediate forms, the register forms are 8 * op + 1 (r/m, r) and
+// 8 * op + 3 (r, r/m)
+enum class alu_op : std::uint8_t
+{
+    ADD = 0,
+    OR  = 1,
+    AND = 4,
+    SUB = 5,
+    XOR = 6,
+    CMP = 7
+};
+
+// The /digit of the shift group (0xC1, 0xD3)
+enum class shift_op : std::uint8_t
+{
+    SHL = 4,
+    SHR = 5,
+    SAR = 7
+};
+
+constexpr std::uint8_t REX_W = 0x48;
+
+class assembler
+{
+ public:
+    using label = std::size_t;
+
+    label new_label()
+    {
+        labels.push_back(UNBOUND);
+
+        return labels.size() - 1;
+    }
+
+    void bind(label target)
+    {
+        labels[target] = bytes.size();
+    }
+
+    //*************************    Moves    **************************//
+    // reg = registers[slot]
+    void load(gpr reg, std::int32_t slot)
+    {
+        emit(REX_W, 0x8B);
+        emit_slot(reg, slot);
+    }
+
+    // registers[slot] = reg
+    void store(std::int32_t slot, gpr reg)
+    {
+        emit(REX_W, 0x89);
+        emit_slot(reg, slot);
+    }
+
+    void move(gpr destination, gpr source)
+    {
+        emit(REX_W, 0x89, modrm(source, destination));
+    }
+
+    void move_immediate(gpr reg, value_t value)
+    {
+        if (auto small = to_int32(value))
+        {
+            // Sign extended
+            emit(REX_W, 0xC7, modrm(0, reg));
+            emit_int32(*small);
+        }
+        else
+        {
+            emit(REX_W, static_cast<std::uint8_t>(0xB8 + static_cast<std::uint8_t>(reg)));
+            emit_int64(value);
+        }
+    }
+
+    // Zeroes the whole register, without a dependency on its old value
+    void clear(gpr reg)
+    {
+        emit(0x31, modrm(reg, reg));
+    }
+
+    //***********************    Arithmetic    ***********************//
+    // destination = destination <op> source
+    void alu(alu_op op, gpr destination, gpr source)
+    {
+        emit(REX_W, static_cast<std::uint8_t>(8 * static_cast<std::uint8_t>(op) + 1));
+        emit(modrm(source, destination));
+    }
+
+    // reg = reg <op> registers[slot]
+    void alu_slot(alu_op op, gpr reg, std::int32_t slot)
+    {
+        emit(REX_W, static_cast<std::uint8_t>(8 * static_cast<std::uint8_t>(op) + 3));
+        emit_slot(reg, slot);
+    }
+
+    // reg = reg <op> sign extended immediate
+    void alu_immediate(alu_op op, gpr reg, std::int32_t immediate)
+    {
+        if (immediate >= INT8_MIN && immediate <= INT8_MAX)
+        {
+            emit(REX_W, 0x83, modrm(static_cast<std::uint8_t>(op), reg));
+            emit(static_cast<std::uint8_t>(immediate));
+        }
+        else
+        {
+            emit(REX_W, 0x81, modrm(static_cast<std::uint8_t>(op), reg));
+            emit_int32(immediate);
+        }
+    }
+
+    // registers[slot] = registers[slot] <op> sign extended 8 bit immediate
+    void alu_slot_immediate(alu_op op, std::int32_t slot, std::int8_t immediate)
+    {
+        emit(REX_W, 0x83);
+        emit_slot(static_cast<std::uint8_t>(op), slot);
+        emit(static_cast<std::uint8_t>(immediate));
+    }
+
+    void test(gpr lhs, gpr rhs)
+    {
+        emit(REX_W, 0x85, modrm(rhs, lhs));
+    }
+
+    void negate(gpr reg)
+    {
+        emit(REX_W, 0xF7, modrm(3, reg));
+    }
+
+    // destination = destination * source, truncated to 64 bits
+    void multiply(gpr destination, gpr source)
+    {
+        emit(REX_W, 0x0F, 0xAF);
+        emit(modrm(destination, source));
+    }
+
+    void multiply_immediate(gpr destination, gpr source, std::int32_t immediate)
+    {
+        emit(REX_W, 0x69, modrm(destination, source));
+        emit_int32(immediate);
+    }
+
+    // rdx:rax = rax * source
+    void multiply_wide(gpr source)
+    {
+        emit(REX_W, 0xF7, modrm(5, source));
+    }
+
+    // rax = rdx:rax / divisor, rdx = rdx:rax % divisor
+    void divide(gpr divisor)
+    {
+        // cqo sign extends rax into rdx
+        emit(REX_W, 0x99);
+        emit(REX_W, 0xF7, modrm(7, divisor));
+    }
+
+    // Shifts by cl, the hardware takes the amount modulo 64 like shift_left/shift_right
+    void shift(shift_op op, gpr reg)
+    {
+        emit(REX_W, 0xD3, modrm(static_cast<std::uint8_t>(op), reg));
+    }
+
+    void shift_immediate(shift_op op, gpr reg, std::uint8_t amount)
+    {
+        emit(REX_W, 0xC1, modrm(static_cast<std::uint8_t>(op), reg));
+        emit(static_cast<std::uint8_t>(amount & 63));
+    }
+
+    // Sets the low byte of reg (rax to rdx only) to the condition, the rest is unchanged
+    void set_if(condition_code condition, gpr reg)
+    {
+        emit(0x0F, static_cast<std::uint8_t>(0x90 + static_cast<std::uint8_t>(condition)));
+        emit(modrm(0, reg));
+    }
+
+    //**********************    Control flow    **********************//
+    void jump(label target)
+    {
+        emit(0xE9);
+        emit_fixup(target, fixup_kind::RELATIVE);
+    }
+
+    void jump_if(condition_code condition, label target)
+    {
+        emit(0x0F, static_cast<std::uint8_t>(0x80 + static_cast<std::uint8_t>(condition)));
+        emit_fixup(target, fixup_kind::RELATIVE);
+    }
+
+    // Jumps to the address at table + 8 * index, clobbers rcx
+    void jump_indirect(label table, gpr index)
+    {
+        // lea rcx, [rip + table]
+        emit(REX_W, 0x8D, 0x0D);
+        emit_fixup(table, fixup_kind::RELATIVE);
+        // jmp [rcx + 8 * index]
+        emit(0xFF, 0x24);
+        emit(static_cast<std::uint8_t>(0xC0 | (static_cast<std::uint8_t>(index) << 3)
+                                       | static_cast<std::uint8_t>(gpr::RCX)));
+    }
+
+    // Jumps to the address in target
+    void jump_to(gpr target)
+    {
+        emit(0xFF, modrm(4, target));
+    }
+
+    void ret()
+    {
+        emit(0xC3);
+    }
+
+    //**************************    Data    **************************//
+    // Pads with int3 up to a multiple of alignment
+    void align(std::size_t alignment)
+    {
+        while (bytes.size() % alignment != 0)
+        {
+            emit(0xCC);
+        }
+    }
+
+    // Absolute address of the label, for jump tables
+    void emit_address(label target)
+    {
+        emit_fixup(target, fixup_kind::ABSOLUTE);
+    }
+
+    //*************************    Output    *************************//
+    [[nodiscard]] std::size_t size() const
+    {
+        return bytes.size();
+    }
+
+    [[nodiscard]] std::size_t offset_of(label target) const
+    {
+        return labels[target];
+    }
+
+    // Resolves the labels for code placed at base
+    void link_into(std::uint8_t* base)
+    {
+        for (const auto& fixup : fixups)
+        {
+            const auto target = static_cast<std::int64_t>(labels[fixup.target]);
+            auto*      field  = bytes.data() + fixup.offset;
+
+            if (fixup.kind == fixup_kind::RELATIVE)
+            {
+                // Relative to the end of the 32 bit field, which ends all of our instructions
+                const auto displacement = static_cast<std::int32_t>(
+                    target - static_cast<std::int64_t>(fixup.offset + 4));
+
+                std::memcpy(field, &displacement, sizeof(displacement));
+            }
+            else
+            {
+                const auto address = reinterpret_cast<std::uint64_t>(base)
+                                     + static_cast<std::uint64_t>(target);
+
+                std::memcpy(field, &address, sizeof(address));
+            }
+        }
+
+        std::ranges::copy(bytes, base);
+    }
+
+ private:
+    enum class fixup_kind
+    {
+        RELATIVE,
+        ABSOLUTE
+    };
+
+    struct fixup
+    {
+        std::size_t offset;
+        label       target;
+        fixup_kind  kind;
+    };
+
+    static constexpr std::size_t UNBOUND = std::numeric_limits<std::size_t>::max();
+
+    std::vector<std::uint8_t> bytes;
+    std::vector<std::size_t>  labels;
+    std::vector<fixup>        fixups;
+
+    static std::uint8_t modrm(std::uint8_t reg, gpr rm)
+    {
+        return static_cast<std::uint8_t>(0xC0 | (reg << 3) | static_cast<std::uint8_t>(rm));
+    }
+
+    static std::uint8_t modrm(gpr reg, gpr rm)
+    {
+        return modrm(static_cast<std::uint8_t>(reg), rm);
+    }
+
+    static std::optional<std::int32_t> to_int32(value_t value)
+    {
+        if (value < INT32_MIN || value > INT32_MAX)
+        {
+            return std::nullopt;
+        }
+
+        return static_cast<std::int32_t>(value);
+    }
+
+    template<typename... T>
+    void emit(T... values)
+    {
+        (bytes.push_back(static_cast<std::uint8_t>(values)), ...);
+    }
+
+    void emit_int32(std::int32_t value)
+    {
+        const auto old_size = bytes.size();
+
+        bytes.resize(old_size + sizeof(value));
+        std::memcpy(bytes.data() + old_size, &value, sizeof(value));
+    }
+
+    void emit_int64(std::int64_t value)
+    {
+        const auto old_size = bytes.size();
+
+        bytes.resize(old_size + sizeof(value));
+        std::memcpy(bytes.data() + old_size, &value, sizeof(value));
+    }
+
+    // ModRM and displacement of [rdi + 8 * slot]
+    void emit_slot(std::uint8_t reg, std::int32_t slot)
+    {
+        emit(0x80 | (reg << 3) | static_cast<std::uint8_t>(gpr::RDI));
+        emit_int32(slot * static_cast<std::int32_t>(sizeof(value_t)));
+    }
+
+    void emit_slot(gpr reg, std::int32_t slot)
+    {
+        emit_slot(static_cast<std::uint8_t>(reg), slot);
+    }
+
+    void emit_fixup(label target, fixup_kind kind)
+    {
+        fixups.push_back({bytes.size(), target, kind});
+
+        if (kind == fixup_kind::RELATIVE)
+        {
+            emit_int32(0);
+        }
+        else
+        {
+            emit_int64(0);
+        }
+    }
+};
+
+//****************************************************************************//
+//                                  Templates                                 //
+//****************************************************************************//
+// Register windows are addressed with 32 bit displacements
+constexpr std::int32_t MAX_JIT_REGISTERS = INT32_MAX / static_cast<std::int32_t>(sizeof(value_t));
+
+struct function_extent
+{
+    std::size_t begin;
+    std::size_t end;
+};
+
+// Functions are laid out one after another, so a function ends where the next one starts
+function_extent get_extent(const bytecode_view& program, std::size_t function)
+{
+    const auto begin = program.functions[function].entry;
+    auto       end   = program.code.size();
+
+    for (const auto& other : program.functions)
+    {
+        if (other.entry > begin)
+        {
+            end = std::min(end, other.entry);
+        }
+    }
+
+    return {begin, end};
+}
+
+bool is_in(std::int64_t value, std::size_t begin, std::size_t end)
+{
+    return value >= 0 && static_cast<std::size_t>(value) >= begin
+           && static_cast<std::size_t>(value) < end;
+}
+
+// Checks, that every operand stays inside of the register window, the function and the
+// constant pool, so that the templates need no bounds checks
+bool has_valid_operands(const bytecode_view&   program,
+                        const function_extent& extent,
+                        std::size_t            n_registers)
+{
+    const auto n_constants = program.constants.size();
+
+    for (std::size_t index = extent.begin; index < extent.end; ++index)
+    {
+        const auto& i      = program.code[index];
+        const auto  layout = get_operand_layout(i.op);
+
+        for (auto [kind, operand] : {std::pair{layout.a, i.a}, {layout.b, i.b}, {layout.c, i.c}})
+        {
+            bool is_valid = true;
+
+            switch (kind)
+            {
+                case operand_kind::SOURCE:
+                case operand_kind::DESTINATION:
+                case operand_kind::SOURCE_DESTINATION:
+                    is_valid = is_in(operand, 0, n_registers);
+                    break;
+                case operand_kind::TARGET:
+                    is_valid = is_in(operand, extent.begin, extent.end);
+                    break;
+                case operand_kind::CONSTANT:
+                    // DIVMAGIC and MODMAGIC read two more constants
+                    is_valid = i.op == opcode::SETLIT
+                                   ? is_in(operand, 0, n_constants)
+                                   : n_constants > 2 && is_in(operand, 0, n_constants - 2);
+                    break;
+                case operand_kind::TABLE:
+                    is_valid = i.c >= 0 && is_in(operand, 0, n_constants)
+                               && n_constants - static_cast<std::size_t>(operand)
+                                      >= static_cast<std::size_t>(i.c)
+                               && std::ranges::all_of(
+                                   program.constants.begin() + operand,
+                                   program.constants.begin() + operand + i.c,
+                                   [&extent](value_t target) {
+                                       return is_in(target, extent.begin, extent.end);
+                                   });
+                    break;
+                case operand_kind::UNUSED:
+                case operand_kind::IMMEDIATE:
+                case operand_kind::ARGUMENTS:
+                case operand_kind::FUNCTION:
+                    break;
+                default:
+                    break;
+            }
+
+            if (!is_valid)
+            {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+condition_code to_condition_code(opcode op)
+{
+    switch (op)
+    {
+        case opcode::JUMPEQ:
+        case opcode::JUMPEQI:
+            return condition_code::EQUAL;
+        case opcode::JUMPNEQ:
+        case opcode::JUMPNEQI:
+            return condition_code::NOT_EQUAL;
+        case opcode::JUMPLESS:
+        case opcode::JUMPLESSI:
+            return condition_code::LESS;
+        case opcode::JUMPGREATER:
+        case opcode::JUMPGREATERI:
+            return condition_code::GREATER;
+        case opcode::JUMPLEQ:
+        case opcode::JUMPLEQI:
+            return condition_code::LESS_EQUAL;
+        case opcode::JUMPGEQ:
+        case opcode::JUMPGEQI:
+            return condition_code::GREATER_EQUAL;
+        default:
+            break;
+    }
+
+    throw std::invalid_argument("Not a conditional jump");
+}
+
+class function_translator
+{
+ public:
+    function_translator(const bytecode_view& program_, const function_extent& extent_) :
+        program{program_}, extent{extent_}, as{}, instruction_labels{}, exits{}, tables{}
+    {
+        // One more for falling off the end of the function
+        for (std::size_t index = extent.begin; index <= extent.end; ++index)
+        {
+            instruction_labels.push_back(as.new_label());
+        }
+    }
+
+    assembler& translate()
+    {
+        // The second argument is the entry
+        as.jump_to(gpr::RSI);
+
+        for (std::size_t index = extent.begin; index < extent.end; ++index)
+        {
+            as.bind(label_of(index));
+            translate(index, program.code[index]);
+        }
+
+        as.bind(label_of(extent.end));
+        emit_exit(extent.end);
+
+        // Cold code behind the function
+        for (auto [label, index] : exits)
+        {
+            as.bind(label);
+            emit_exit(index);
+        }
+
+        as.align(sizeof(std::uint64_t));
+
+        for (auto [label, first, size] : tables)
+        {
+            as.bind(label);
+
+            for (std::size_t entry = 0; entry < size; ++entry)
+            {
+                const auto target = static_cast<std::size_t>(program.constants[first + entry]);
+
+                as.emit_address(label_of(target));
+            }
+        }
+
+        return as;
+    }
+
+    // Offset of the machine code of the instruction at index
+    [[nodiscard]] std::size_t offset_of(std::size_t index) const
+    {
+        return as.offset_of(label_of(index));
+    }
+
+ private:
+    struct side_exit
+    {
+        assembler::label label;
+        std::size_t      index;
+    };
+
+    struct jump_table
+    {
+        assembler::label label;
+        std::size_t      first;
+        std::size_t      size;
+    };
+
+    const bytecode_view&          program;
+    function_extent               extent;
+    assembler                     as;
+    std::vector<assembler::label> instruction_labels;
+    std::vector<side_exit>        exits;
+    std::vector<jump_table>       tables;
+
+    assembler::label label_of(std::size_t index) const
+    {
+        return instruction_labels[index - extent.begin];
+    }
+
+    assembler::label label_of(std::int32_t index) const
+    {
+        return label_of(static_cast<std::size_t>(index));
+    }
+
+    assembler::label exit_label(std::size_t index)
+    {
+        auto label = as.new_label();
+
+        exits.push_back({label, index});
+
+        return label;
+    }
+
+    // Returns the exit's index in rdx, see jit_result
+    void emit_exit(std::size_t index)
+    {
+        as.move_immediate(gpr::RDX, static_cast<value_t>(index));
+        as.ret();
+    }
+
+    void emit_binary(const instruction& i, alu_op op)
+    {
+        as.load(gpr::RAX, i.b);
+        as.alu_slot(op, gpr::RAX, i.c);
+        as.store(i.a, gpr::RAX);
+    }
+
+    void emit_shift(const instruction& i, shift_op op)
+    {
+        as.load(gpr::RAX, i.b);
+        as.load(gpr::RCX, i.c);
+        as.shift(op, gpr::RAX);
+        as.store(i.a, gpr::RAX);
+    }
+
+    // The divisor is in rcx, the dividend in rax
+    void emit_division(const instruction& i, std::size_t index, bool is_modulo)
+    {
+        auto done      = as.new_label();
+        auto not_minus = as.new_label();
+
+        as.test(gpr::RCX, gpr::RCX);
+        as.jump_if(condition_code::EQUAL, exit_label(index));
+        // idiv faults for INT64_MIN / -1, the interpreter wraps instead
+        as.alu_immediate(alu_op::CMP, gpr::RCX, -1);
+        as.jump_if(condition_code::NOT_EQUAL, not_minus);
+
+        if (is_modulo)
+        {
+            as.clear(gpr::RAX);
+        }
+        else
+        {
+            as.negate(gpr::RAX);
+        }
+        as.jump(done);
+
+        as.bind(not_minus);
+        as.divide(gpr::RCX);
+
+        if (is_modulo)
+        {
+            as.move(gpr::RAX, gpr::RDX);
+        }
+
+        as.bind(done);
+        as.store(i.a, gpr::RAX);
+    }
+
+    // lhs + bias, where bias is 2^shift - 1 for negative lhs and 0 otherwise, in rax and
+    // the bias in rcx (see divide_by_power_of_two)
+    void emit_power_of_two_bias(const instruction& i)
+    {
+        as.load(gpr::RAX, i.b);
+        as.move(gpr::RCX, gpr::RAX);
+        as.shift_immediate(shift_op::SAR, gpr::RCX, 63);
+        as.shift_immediate(shift_op::SHR, gpr::RCX, static_cast<std::uint8_t>(64 - i.c));
+        as.alu(alu_op::ADD, gpr::RAX, gpr::RCX);
+    }
+
+    // Quotient in rdx, the dividend in rcx (see divide_by_magic)
+    void emit_magic_division(const instruction& i)
+    {
+        const value_t* magic      = program.constants.data() + i.c;
+        const value_t  multiplier = magic[0];
+        const value_t  divisor    = magic[2];
+
+        as.load(gpr::RCX, i.b);
+        as.move_immediate(gpr::RAX, multiplier);
+        as.multiply_wide(gpr::RCX);
+
+        if (divisor > 0 && multiplier < 0)
+        {
+            as.alu(alu_op::ADD, gpr::RDX, gpr::RCX);
+        }
+        else if (divisor < 0 && multiplier > 0)
+        {
+            as.alu(alu_op::SUB, gpr::RDX, gpr::RCX);
+        }
+        as.shift_immediate(shift_op::SAR, gpr::RDX, static_cast<std::uint8_t>(magic[1]));
+        as.move(gpr::RAX, gpr::RDX);
+        as.shift_immediate(shift_op::SHR, gpr::RAX, 63);
+        as.alu(alu_op::ADD, gpr::RDX, gpr::RAX);
+    }
+
+    void translate(std::size_t index, const instruction& i)
+    {
+        switch (i.op)
+        {
+            //*********************    Arithmetic    *********************//
+            case opcode::ADD:
+                emit_binary(i, alu_op::ADD);
+                break;
+            case opcode::SUB:
+                emit_binary(i, alu_op::SUB);
+                break;
+            case opcode::MUL:
+                as.load(gpr::RAX, i.b);
+                as.load(gpr::RCX, i.c);
+                as.multiply(gpr::RAX, gpr::RCX);
+                as.store(i.a, gpr::RAX);
+                break;
+            case opcode::DIV:
+            case opcode::MOD:
+                as.load(gpr::RAX, i.b);
+                as.load(gpr::RCX, i.c);
+                emit_division(i, index, i.op == opcode::MOD);
+                break;
+            case opcode::INC:
+                as.alu_slot_immediate(alu_op::ADD, i.a, 1);
+                break;
+            case opcode::DEC:
+                as.alu_slot_immediate(alu_op::SUB, i.a, 1);
+                break;
+
+            //***********************    Binary    ***********************//
+            case opcode::AND:
+                emit_binary(i, alu_op::AND);
+                break;
+            case opcode::OR:
+                emit_binary(i, alu_op::OR);
+                break;
+            case opcode::XOR:
+                emit_binary(i, alu_op::XOR);
+                break;
+            case opcode::LSHIFT:
+                emit_shift(i, shift_op::SHL);
+                break;
+            case opcode::RSHIFT:
+                emit_shift(i, shift_op::SAR);
+                break;
+            case opcode::NOT:
+                as.load(gpr::RAX, i.b);
+                as.clear(gpr::RCX);
+                as.test(gpr::RAX, gpr::RAX);
+                as.set_if(condition_code::EQUAL, gpr::RCX);
+                as.store(i.a, gpr::RCX);
+                break;
+
+            //*********************    Comparison    *********************//
+            case opcode::JUMPEQ:
+            case opcode::JUMPNEQ:
+            case opcode::JUMPLESS:
+            case opcode::JUMPGREATER:
+            case opcode::JUMPLEQ:
+            case opcode::JUMPGEQ:
+                as.load(gpr::RAX, i.b);
+                as.alu_slot(alu_op::CMP, gpr::RAX, i.c);
+                as.jump_if(to_condition_code(i.op), label_of(i.a));
+                break;
+
+            //************************    Misc    ************************//
+            case opcode::SET:
+                as.load(gpr::RAX, i.b);
+                as.store(i.a, gpr::RAX);
+                break;
+            case opcode::SETLIT:
+                as.move_immediate(gpr::RAX, program.constants[static_cast<std::size_t>(i.b)]);
+                as.store(i.a, gpr::RAX);
+                break;
+            case opcode::JUMP:
+                as.jump(label_of(i.a));
+                break;
+            case opcode::RET:
+                as.load(gpr::RAX, i.a);
+                as.move_immediate(gpr::RDX, NO_EXIT);
+                as.ret();
+                break;
+
+            //*****************    Superinstructions    ******************//
+            case opcode::ADDI:
+                as.load(gpr::RAX, i.b);
+                as.alu_immediate(alu_op::ADD, gpr::RAX, i.c);
+                as.store(i.a, gpr::RAX);
+                break;
+            case opcode::MULI:
+                as.load(gpr::RCX, i.b);
+                as.multiply_immediate(gpr::RAX, gpr::RCX, i.c);
+                as.store(i.a, gpr::RAX);
+                break;
+            case opcode::DIVI:
+            case opcode::MODI:
+                as.load(gpr::RAX, i.b);
+                as.move_immediate(gpr::RCX, i.c);
+                emit_division(i, index, i.op == opcode::MODI);
+                break;
+            case opcode::ANDI:
+                as.load(gpr::RAX, i.b);
+                as.alu_immediate(alu_op::AND, gpr::RAX, i.c);
+                as.store(i.a, gpr::RAX);
+                break;
+            case opcode::LSHIFTI:
+            case opcode::RSHIFTI:
+                as.load(gpr::RAX, i.b);
+                as.shift_immediate(i.op == opcode::LSHIFTI ? shift_op::SHL : shift_op::SAR,
+                                   gpr::RAX,
+                                   static_cast<std::uint8_t>(i.c));
+                as.store(i.a, gpr::RAX);
+                break;
+            case opcode::JUMPEQI:
+            case opcode::JUMPNEQI:
+            case opcode::JUMPLESSI:
+            case opcode::JUMPGREATERI:
+            case opcode::JUMPLEQI:
+            case opcode::JUMPGEQI:
+                as.load(gpr::RAX, i.b);
+                as.alu_immediate(alu_op::CMP, gpr::RAX, i.c);
+                as.jump_if(to_condition_code(i.op), label_of(i.a));
+                break;
+            case opcode::INCJUMPLESS:
+            case opcode::INCJUMPLESSI:
+                as.load(gpr::RAX, i.b);
+                as.alu_immediate(alu_op::ADD, gpr::RAX, 1);
+                as.store(i.b, gpr::RAX);
+
+                if (i.op == opcode::INCJUMPLESS)
+                {
+                    as.alu_slot(alu_op::CMP, gpr::RAX, i.c);
+                }
+                else
+                {
+                    as.alu_immediate(alu_op::CMP, gpr::RAX, i.c);
+                }
+                as.jump_if(condition_code::LESS, label_of(i.a));
+                break;
+
+            //******************    Constant division    *******************//
+            case opcode::DIVPOW2I:
+            case opcode::MODPOW2I:
+                if (i.c <= 0 || i.c >= 63)
+                {
+                    // Not generated by the code generator, the interpreter decides
+                    as.jump(exit_label(index));
+                }
+                else if (i.op == opcode::DIVPOW2I)
+                {
+                    emit_power_of_two_bias(i);
+                    as.shift_immediate(shift_op::SAR, gpr::RAX, static_cast<std::uint8_t>(i.c));
+                    as.store(i.a, gpr::RAX);
+                }
+                else
+                {
+                    emit_power_of_two_bias(i);
+                    as.move_immediate(gpr::RDX, (value_t{1} << i.c) - 1);
+                    as.alu(alu_op::AND, gpr::RAX, gpr::RDX);
+                    as.alu(alu_op::SUB, gpr::RAX, gpr::RCX);
+                    as.store(i.a, gpr::RAX);
+                }
+                break;
+            case opcode::DIVMAGIC:
+                emit_magic_division(i);
+                as.store(i.a, gpr::RDX);
+                break;
+            case opcode::MODMAGIC:
+                emit_magic_division(i);
+                as.move_immediate(gpr::RAX, program.constants[static_cast<std::size_t>(i.c) + 2]);
+                as.multiply(gpr::RDX, gpr::RAX);
+                as.alu(alu_op::SUB, gpr::RCX, gpr::RDX);
+                as.store(i.a, gpr::RCX);
+                break;
+
+            //**********************    Switches    **********************//
+            case opcode::JUMPTABLE:
+            {
+                auto table = as.new_label();
+
+                // Negative indices become too large as well
+                as.load(gpr::RAX, i.a);
+                as.alu_immediate(alu_op::CMP, gpr::RAX, i.c);
+                as.jump_if(condition_code::ABOVE_EQUAL, label_of(index + 1));
+                as.jump_indirect(table, gpr::RAX);
+
+                tables.push_back({table,
+                                  static_cast<std::size_t>(i.b),
+                                  static_cast<std::size_t>(i.c)});
+                break;
+            }
+
+            // PRINT, no template
+            default:
+                as.jump(exit_label(index));
+                break;
+        }
+    }
+};
+}    // namespace
+
+#endif
+
+//****************************************************************************//
+//                                JIT compiler                                //
+//****************************************************************************//
+namespace
+{
+constexpr std::size_t NO_FUNCTION = std::numeric_limits<std::size_t>::max();
+}    // namespace
+
+jit_compiler::jit_compiler(const bytecode_view& program_, const jit_options& options) :
+    program{program_},
+    threshold{std::max<std::size_t>(options.threshold, 1)},
+    // The interpreter counts down to 0 and starts again
+    loop_threshold{options.enabled ? std::max<std::size_t>(options.loop_threshold, 1)
+                                   : std::numeric_limits<std::size_t>::max()},
+    functions(program_.functions.size(), {0, !options.enabled, nullptr, nullptr, 0}),
+    owners(program_.code.size(), NO_FUNCTION),
+    native_offsets(program_.code.size(), 0),
+    code{}
+{
+#ifdef MVPL_JIT
+    for (std::size_t function = 0; function < program.functions.size(); ++function)
+    {
+        const auto extent = get_extent(program, function);
+
+        for (std::size_t index = extent.begin; index < extent.end; ++index)
+        {
+            owners[index] = function;
+        }
+    }
+#endif
+}
+
+jit_entry jit_compiler::enter_loop(std::size_t index)
+{
+    const auto function = owners[index];
+
+    if (function == NO_FUNCTION)
+    {
+        return {nullptr, nullptr};
+    }
+
+    auto& state = functions[function];
+
+    if (state.native == nullptr && (state.is_attempted || !compile(function)))
+    {
+        return {nullptr, nullptr};
+    }
+
+    return {state.native, code[state.code_index].data() + native_offsets[index]};
+}
+
+std::size_t jit_compiler::get_loop_threshold() const
+{
+    return loop_threshold;
+}
+
+bool jit_compiler::is_compiled(std::size_t function) const
+{
+    return functions[function].native != nullptr;
+}
+
+bool jit_compiler::compile([[maybe_unused]] std::size_t function)
+{
+    auto& state = functions[function];
+
+    state.is_attempted = true;
+
+#ifdef MVPL_JIT
+    const auto extent      = get_extent(program, function);
+    const auto n_registers = std::max<std::size_t>(program.functions[function].n_registers, 1);
+
+    const auto first = program.code.begin() + static_cast<std::ptrdiff_t>(extent.begin);
+    const auto last  = program.code.begin() + static_cast<std::ptrdiff_t>(extent.end);
+
+    if (std::any_of(first,
+                    last,
+                    [](const instruction& i) {
+                        return i.op == opcode::CALL || i.op == opcode::TAILCALL;
+                    })
+        || n_registers > static_cast<std::size_t>(MAX_JIT_REGISTERS)
+        || !has_valid_operands(program, extent, n_registers))
+    {
+        return false;
+    }
+
+    function_translator translator(program, extent);
+    auto&               as = translator.translate();
+
+    auto& memory = code.emplace_back(as.size());
+    as.link_into(memory.data());
+    memory.make_executable();
+
+    for (std::size_t index = extent.begin; index < extent.end; ++index)
+    {
+        native_offsets[index] = static_cast<std::uint32_t>(translator.offset_of(index));
+    }
+
+    state.code_index = code.size() - 1;
+    state.native     = reinterpret_cast<jit_function>(memory.data());
+    state.entry      = memory.data() + native_offsets[extent.begin];
+
+    return true;
+#else
+    return false;
+#endif
+}
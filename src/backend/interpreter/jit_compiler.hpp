@@ -0,0 +1,138 @@
+// Copyright © 2021-2022 Jonas Muehlmann
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "backend/bytecode_program.hpp"
+#include "backend/value.hpp"
+#include "executable_memory.hpp"
+
+// Hot functions are translated to x86-64 machine code. Defining MVPL_NO_JIT (or configuring
+// with -DMVPL_NO_JIT=ON) leaves it out of the build, the MVPL_NO_JIT environment variable
+// disables it at runtime.
+#if defined(__x86_64__) && defined(__unix__) && !defined(MVPL_NO_JIT)
+#    define MVPL_JIT
+#endif
+
+// Machine code works on the register window of an interpreter frame. It either returns from
+// the function or leaves through a side exit, after which the interpreter continues with the
+// instruction at the exit's index in the same frame: at instructions without a template
+// (e.g. PRINT) and where the instruction traps (e.g. division by zero), so that the
+// interpreter reports the error.
+inline constexpr std::int64_t NO_EXIT = -1;
+
+// Returned in rax and rdx by the System V ABI
+struct jit_result
+{
+    value_t      value;
+    std::int64_t exit;
+};
+
+// Starts executing at entry, the machine code of any instruction of the function, so that
+// loops can switch to machine code in the middle of the function
+using jit_function = jit_result (*)(value_t* registers, const void* entry);
+
+struct jit_entry
+{
+    jit_function function;
+    const void*  address;
+
+    explicit operator bool() const
+    {
+        return function != nullptr;
+    }
+};
+
+inline constexpr std::size_t JIT_THRESHOLD      = 100;
+inline constexpr std::size_t JIT_LOOP_THRESHOLD = 10'000;
+
+struct jit_options
+{
+    bool enabled{true};
+    // Number of interpreted entries into a function, after which it is compiled
+    std::size_t threshold{JIT_THRESHOLD};
+    // Number of taken backward jumps in the interpreter, after which the function containing
+    // the loop is compiled and continues as machine code
+    std::size_t loop_threshold{JIT_LOOP_THRESHOLD};
+};
+
+// Enabled unless the MVPL_NO_JIT environment variable is set
+jit_options default_jit_options();
+
+// Translates every instruction to a fixed template of machine code with the instruction's
+// operands patched in. Registers stay in the register window, so the interpreter's state is
+// up to date at every instruction boundary and neither side exits nor entries in the middle
+// of a function need any translation. Functions containing calls have no template and are
+// always interpreted, because the machine code has no frames of its own.
+class jit_compiler
+{
+ public:
+    // Methods
+    jit_compiler(const bytecode_view& program, const jit_options& options);
+
+    // Counts an entry into the function and returns its machine code, as soon as the
+    // function is hot and could be compiled
+    jit_entry enter(std::size_t function)
+    {
+        auto& state = functions[function];
+
+        if (state.native == nullptr
+            && (state.is_attempted || ++state.entries < threshold || !compile(function)))
+        {
+            return {nullptr, nullptr};
+        }
+
+        return {state.native, state.entry};
+    }
+
+    // Compiles the function containing the instruction at index, if that was not attempted
+    // yet, and returns the machine code continuing there
+    jit_entry enter_loop(std::size_t index);
+
+    [[nodiscard]] std::size_t get_loop_threshold() const;
+    [[nodiscard]] bool        is_compiled(std::size_t function) const;
+
+ private:
+    struct function_state
+    {
+        std::size_t  entries;
+        bool         is_attempted;
+        jit_function native;
+        const void*  entry;
+        // Into jit_compiler::code
+        std::size_t  code_index;
+    };
+
+    // Variables
+    bytecode_view                  program;
+    std::size_t                    threshold;
+    std::size_t                    loop_threshold;
+    std::vector<function_state>    functions;
+    // Function of each instruction and the offset of its machine code, once compiled
+    std::vector<std::size_t>       owners;
+    std::vector<std::uint32_t>     native_offsets;
+    std::vector<executable_memory> code;
+
+    // Methods
+    bool compile(std::size_t function);
+};
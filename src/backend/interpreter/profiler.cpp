@@ -0,0 +1,292 @@
+// Copyright © 2021-2022 Jonas Muehlmann
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include "profiler.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <numeric>
+#include <string>
+#include <utility>
+
+#if defined(__x86_64__) || defined(__i386__)
+#    include <x86intrin.h>
+#endif
+
+std::uint64_t read_cycle_counter()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                          std::chrono::steady_clock::now().time_since_epoch())
+                                          .count());
+#endif
+}
+
+profiler::profiler(const bytecode_program& program_) :
+    function_layouts{get_function_layouts(program_)},
+    program{program_.code,
+            program_.constants,
+            function_layouts,
+            program_.main_function,
+            program_.lines},
+    names{get_function_names(program_)},
+    owners{},
+    instruction_counts(program_.code.size(), 0),
+    functions(program_.functions.size(), {0, 0, 0, 0}),
+    call_tree{{0, 0, 0}},
+    children{},
+    stack{},
+    last_transfer{0}
+{
+    index_functions();
+}
+
+profiler::profiler(const bytecode_view& program_, std::vector<std::string> names_) :
+    function_layouts{},
+    program{program_},
+    names{std::move(names_)},
+    owners{},
+    instruction_counts(program_.code.size(), 0),
+    functions(program_.functions.size(), {0, 0, 0, 0}),
+    call_tree{{0, 0, 0}},
+    children{},
+    stack{},
+    last_transfer{0}
+{
+    index_functions();
+}
+
+void profiler::start(std::size_t function)
+{
+    stack.clear();
+
+    for (auto& profile : functions)
+    {
+        profile.depth = 0;
+    }
+
+    last_transfer = read_cycle_counter();
+    enter(function);
+}
+
+void profiler::write_folded_stacks(std::ostream& output) const
+{
+    for (std::size_t node = 1; node < call_tree.size(); ++node)
+    {
+        if (call_tree[node].self_cycles == 0)
+        {
+            continue;
+        }
+
+        std::vector<std::size_t> path;
+
+        for (auto caller = node; caller != 0; caller = call_tree[caller].parent)
+        {
+            path.push_back(call_tree[caller].function);
+        }
+
+        for (auto function = path.rbegin(); function != path.rend(); ++function)
+        {
+            output << (function == path.rbegin() ? "" : ";") << names[*function];
+        }
+        output << ' ' << call_tree[node].self_cycles << '\n';
+    }
+}
+
+json profiler::get_summary() const
+{
+    std::vector<std::uint64_t> opcode_counts(ALL_OPCODES.size(), 0);
+    std::vector<std::uint64_t> function_counts(functions.size(), 0);
+    // (line, function) -> count, inlining puts the same line into several functions
+    std::map<std::pair<std::uint32_t, std::size_t>, std::uint64_t> line_counts;
+
+    for (std::size_t i = 0; i < instruction_counts.size(); ++i)
+    {
+        if (instruction_counts[i] == 0)
+        {
+            continue;
+        }
+
+        opcode_counts[static_cast<std::size_t>(program.code[i].op)] += instruction_counts[i];
+        function_counts[owners[i]] += instruction_counts[i];
+
+        if (i < program.lines.size() && program.lines[i] != 0)
+        {
+            line_counts[{program.lines[i], owners[i]}] += instruction_counts[i];
+        }
+    }
+
+    json summary = json::object();
+
+    summary["instructions"] = std::accumulate(instruction_counts.begin(),
+                                              instruction_counts.end(),
+                                              std::uint64_t{0});
+    summary["cycles"] = std::accumulate(
+        functions.begin(),
+        functions.end(),
+        std::uint64_t{0},
+        [](std::uint64_t cycles, const function_profile& profile) {
+            return cycles + profile.self_cycles;
+        });
+
+    // Opcodes
+    std::vector<std::size_t> order(ALL_OPCODES.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::ranges::stable_sort(order, std::greater{}, [&](std::size_t op) {
+        return opcode_counts[op];
+    });
+
+    summary["opcodes"] = json::object();
+
+    for (auto op : order)
+    {
+        if (opcode_counts[op] > 0)
+        {
+            summary["opcodes"][std::string(LUT_OPCODE_TO_STRING[op])] = opcode_counts[op];
+        }
+    }
+
+    // Functions
+    order.resize(functions.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::ranges::stable_sort(order, std::greater{}, [this](std::size_t function) {
+        return functions[function].self_cycles;
+    });
+
+    summary["functions"] = json::array();
+
+    for (auto function : order)
+    {
+        const auto& profile = functions[function];
+
+        if (profile.calls > 0)
+        {
+            summary["functions"].push_back({{"name", names[function]},
+                                            {"calls", profile.calls},
+                                            {"instructions", function_counts[function]},
+                                            {"self_cycles", profile.self_cycles},
+                                            {"total_cycles", profile.total_cycles}});
+        }
+    }
+
+    // Lines
+    std::vector<std::pair<std::pair<std::uint32_t, std::size_t>, std::uint64_t>> lines(
+        line_counts.begin(), line_counts.end());
+    std::ranges::stable_sort(lines, std::greater{}, [](const auto& line) { return line.second; });
+
+    summary["lines"] = json::array();
+
+    for (const auto& [line, count] : lines)
+    {
+        summary["lines"].push_back(
+            {{"line", line.first}, {"function", names[line.second]}, {"instructions", count}});
+    }
+
+    return summary;
+}
+
+void profiler::index_functions()
+{
+    names.resize(program.functions.size());
+
+    for (std::size_t i = 0; i < names.size(); ++i)
+    {
+        if (names[i].empty())
+        {
+            names[i] = "function_" + std::to_string(i);
+        }
+    }
+
+    owners = get_instruction_owners(program);
+}
+
+void profiler::record_transfer(const instruction& i)
+{
+    switch (i.op)
+    {
+        case opcode::CALL:
+            enter(static_cast<std::size_t>(i.b));
+            break;
+
+        case opcode::RET:
+            leave();
+            break;
+
+        // The callee replaces the caller on the stack
+        case opcode::TAILCALL:
+            leave();
+            enter(static_cast<std::size_t>(i.b));
+            break;
+
+        default:
+            break;
+    }
+}
+
+void profiler::charge(std::uint64_t now)
+{
+    if (!stack.empty())
+    {
+        functions[stack.back().function].self_cycles += now - last_transfer;
+        call_tree[stack.back().node].self_cycles += now - last_transfer;
+    }
+
+    last_transfer = now;
+}
+
+void profiler::enter(std::size_t function)
+{
+    const auto now    = read_cycle_counter();
+    const auto parent = stack.empty() ? 0 : stack.back().node;
+
+    charge(now);
+
+    auto [child, is_new] = children.try_emplace({parent, function}, call_tree.size());
+
+    if (is_new)
+    {
+        call_tree.push_back({function, parent, 0});
+    }
+
+    ++functions[function].calls;
+    ++functions[function].depth;
+    stack.push_back({child->second, function, now});
+}
+
+void profiler::leave()
+{
+    if (stack.empty())
+    {
+        return;
+    }
+
+    const auto now  = read_cycle_counter();
+    const auto call = stack.back();
+
+    charge(now);
+    stack.pop_back();
+
+    // Recursive calls are already part of the outermost one's total
+    if (--functions[call.function].depth == 0)
+    {
+        functions[call.function].total_cycles += now - call.entered;
+    }
+}
@@ -0,0 +1,131 @@
+// Copyright © 2021-2022 Jonas Muehlmann
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "backend/bytecode_program.hpp"
+#include "backend/opcode.hpp"
+#include <nlohmann/json.hpp>
+
+using json = nlohmann::ordered_json;
+
+// Reads the processor's time stamp counter, elsewhere a steady clock in nanoseconds
+std::uint64_t read_cycle_counter();
+
+// Collects what a register machine executes while the profiler is attached to it (see
+// register_machine::attach_profiler): how often every instruction ran, which gives the counts
+// per opcode, function and source line, and at calls and returns the cycles spent in every
+// function and call stack. Everything accumulates over all runs.
+//
+// Cycles are split between functions only at calls and returns, so that counting an
+// instruction stays a single increment. Time spent in the profiler itself at calls is
+// charged to the callee.
+class profiler
+{
+ public:
+    // Methods
+    // The program has to outlive the profiler
+    explicit profiler(const bytecode_program& program_);
+    // Names are indexed like the program's functions, functions without one are called by
+    // their index, e.g. those of an image without debug information
+    profiler(const bytecode_view& program_, std::vector<std::string> names_);
+
+    // Called by the register machine before the first instruction of a run. The calls a
+    // previous run left open, because it threw, are dropped without their total cycles.
+    void start(std::size_t function);
+
+    // Called by the register machine before executing code[index]
+    void record(std::size_t index)
+    {
+        ++instruction_counts[index];
+
+        const auto op = program.code[index].op;
+
+        if (op == opcode::CALL || op == opcode::RET || op == opcode::TAILCALL)
+        {
+            record_transfer(program.code[index]);
+        }
+    }
+
+    // One line per call stack, e.g. "main;fib;fib 1234": the functions from the outermost on
+    // and the cycles spent in the innermost one, the input of flame graph tools
+    void write_folded_stacks(std::ostream& output) const;
+
+    // Counts per opcode, function and source line, ordered by decreasing count or cycles
+    [[nodiscard]] json get_summary() const;
+
+ private:
+    struct function_profile
+    {
+        std::uint64_t calls;
+        // Spent in the function itself, without its callees
+        std::uint64_t self_cycles;
+        // From the outermost call to its return, with callees
+        std::uint64_t total_cycles;
+        // Number of calls on the stack
+        std::size_t   depth;
+    };
+
+    // Call stacks form a tree, its first node is the root without a function
+    struct call_tree_node
+    {
+        std::size_t   function;
+        std::size_t   parent;
+        std::uint64_t self_cycles;
+    };
+
+    struct active_call
+    {
+        std::size_t   node;
+        std::size_t   function;
+        std::uint64_t entered;
+    };
+
+    // Variables
+    // Only used when constructed from a bytecode_program, which has no function layouts
+    std::vector<function_layout>                               function_layouts;
+    bytecode_view                                              program;
+    std::vector<std::string>                                   names;
+    // Function of each instruction
+    std::vector<std::size_t>                                   owners;
+    std::vector<std::uint64_t>                                 instruction_counts;
+    std::vector<function_profile>                              functions;
+    std::vector<call_tree_node>                                call_tree;
+    // (parent, function) -> call tree node
+    std::map<std::pair<std::size_t, std::size_t>, std::size_t> children;
+    std::vector<active_call>                                   stack;
+    // Cycle counter at the last call or return
+    std::uint64_t                                              last_transfer;
+
+    // Methods
+    // Names the functions without one and finds the function of every instruction
+    void index_functions();
+    void record_transfer(const instruction& i);
+    void charge(std::uint64_t now);
+    void enter(std::size_t function);
+    void leave();
+};
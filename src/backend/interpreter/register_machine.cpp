@@ -18,3 +18,793 @@
 // TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
 // OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "register_machine.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
+
+#include "backend/opcode.hpp"
+
+namespace
+{
+std::size_t get_window_size(const bytecode_view& program)
+{
+    std::size_t window_size = 1;
+
+    for (const auto& function : program.functions)
+    {
+        window_size = std::max(window_size, function.n_registers);
+    }
+
+    return window_size;
+}
+}    // namespace
+
+// A callee's window starts within its caller's and is cleared front to back, so an
+// overflowing call touches the guard pages, which span a window, before anything behind.
+register_machine::register_machine(const bytecode_program& program_,
+                                   std::ostream&           output_,
+                                   const jit_options&      jit_,
+                                   std::size_t             stack_limit) :
+    function_layouts{get_function_layouts(program_)},
+    program{program_.code,
+            program_.constants,
+            function_layouts,
+            program_.main_function,
+            program_.lines},
+    output{output_},
+    input{std::cin},
+    decoded_code{},
+    window_size{get_window_size(program)},
+    value_stack{stack_limit, window_size * sizeof(value_t)},
+    frame_stack{stack_limit, sizeof(call_frame)},
+    jit{program, jit_},
+    attached_profiler{nullptr},
+    position{&unobserved_position},
+    unobserved_position{NOT_EXECUTING},
+    suspended{},
+    result{0}
+{}
+
+register_machine::register_machine(const bytecode_view& program_,
+                                   std::ostream&        output_,
+                                   const jit_options&   jit_,
+                                   std::size_t          stack_limit) :
+    function_layouts{},
+    program{program_},
+    output{output_},
+    input{std::cin},
+    decoded_code{},
+    window_size{get_window_size(program)},
+    value_stack{stack_limit, window_size * sizeof(value_t)},
+    frame_stack{stack_limit, sizeof(call_frame)},
+    jit{program, jit_},
+    attached_profiler{nullptr},
+    position{&unobserved_position},
+    unobserved_position{NOT_EXECUTING},
+    suspended{},
+    result{0}
+{}
+
+value_t register_machine::run()
+{
+    // A non-blocking input is waited for here instead
+    while (resume(std::numeric_limits<std::size_t>::max()) != run_status::FINISHED)
+    {
+        input.wait();
+    }
+
+    return result;
+}
+
+register_machine::run_status register_machine::resume(std::size_t budget)
+{
+    if (program.main_function >= program.functions.size())
+    {
+        throw std::invalid_argument("Program has no main function");
+    }
+
+    // However the run ends, the machine no longer executes any instruction
+    struct position_reset
+    {
+        published_position* position;
+
+        ~position_reset()
+        {
+            position->store(NOT_EXECUTING, std::memory_order_relaxed);
+        }
+    } reset{position};
+
+#ifdef MVPL_GUARD_PAGES
+    // Execution leaves no state behind, which would need cleaning up after the jump
+    stack_fault_handler fault_handler({&value_stack, &frame_stack});
+
+    if (sigsetjmp(fault_handler.get_overflow_target(), 1) != 0)
+    {
+        output.flush();
+
+        throw std::runtime_error("Stack overflow");
+    }
+#endif
+
+    // Larger budgets are as good as unlimited
+    const auto limited_budget = static_cast<std::ptrdiff_t>(
+        std::min<std::size_t>(budget, std::numeric_limits<std::ptrdiff_t>::max()));
+
+    // What the program printed before a trap is written as well
+    try
+    {
+        const auto status = execute(false, limited_budget);
+
+        if (status == run_status::FINISHED)
+        {
+            output.flush();
+        }
+
+        return status;
+    }
+    catch (const std::runtime_error&)
+    {
+        output.flush();
+
+        throw;
+    }
+}
+
+value_t register_machine::get_result() const
+{
+    return result;
+}
+
+void register_machine::prepare()
+{
+    execute(true, 0);
+}
+
+void register_machine::set_input(std::istream& input_)
+{
+    input = input_buffer(input_);
+}
+
+#ifdef MVPL_FILE_DESCRIPTORS
+void register_machine::set_input(int file, std::size_t buffer_size)
+{
+    input = input_buffer(file, buffer_size);
+}
+
+void register_machine::set_output(int file, std::size_t buffer_size)
+{
+    output = output_buffer(file, buffer_size);
+}
+#endif
+
+bool register_machine::is_jit_compiled(std::size_t function) const
+{
+    return jit.is_compiled(function);
+}
+
+void register_machine::attach_profiler(profiler* profiler_)
+{
+    jit               = jit_compiler(program, {.enabled = false});
+    attached_profiler = profiler_;
+
+    // Decoded again with the handlers matching the profiler
+    decoded_code.clear();
+}
+
+void register_machine::publish_position(published_position* position_)
+{
+    position = position_ != nullptr ? position_ : &unobserved_position;
+
+    decoded_code.clear();
+}
+
+#ifdef MVPL_DISPATCH_STATISTICS
+const dispatch_statistics& register_machine::get_dispatch_statistics() const
+{
+    return statistics;
+}
+#endif
+
+void register_machine::decode([[maybe_unused]] const void* const* handlers)
+{
+    decoded_code.clear();
+    decoded_code.reserve(program.code.size());
+
+    if (std::ranges::any_of(program.code, [](const instruction& i) {
+            return static_cast<std::size_t>(i.op) >= ALL_OPCODES.size();
+        }))
+    {
+        throw std::invalid_argument("Program contains invalid opcode");
+    }
+
+    if (std::ranges::any_of(program.functions, [](const function_layout& function) {
+            return function.n_parameters > function.n_registers;
+        }))
+    {
+        throw std::invalid_argument("Program contains function with too few registers");
+    }
+
+    if (std::ranges::any_of(program.functions, [this](const function_layout& function) {
+            return function.entry >= program.code.size();
+        }))
+    {
+        throw std::invalid_argument("Program contains function with invalid entry");
+    }
+
+    // The arguments have to lie within the caller's window, which bounds the stack's size
+    if (std::ranges::any_of(program.code, [this](const instruction& i) {
+            if (i.op != opcode::CALL && i.op != opcode::TAILCALL)
+            {
+                return false;
+            }
+
+            return i.b < 0 || static_cast<std::size_t>(i.b) >= program.functions.size()
+                   || i.c < 0
+                   || static_cast<std::size_t>(i.c)
+                              + program.functions[static_cast<std::size_t>(i.b)].n_parameters
+                          > window_size;
+        }))
+    {
+        throw std::invalid_argument("Program contains invalid call");
+    }
+
+#ifdef MVPL_THREADED_DISPATCH
+    std::ranges::transform(
+        program.code, std::back_inserter(decoded_code), [handlers](const instruction& i) {
+            return threaded_instruction{
+                handlers[static_cast<std::size_t>(i.op)], i.a, i.b, i.c};
+        });
+#else
+    std::ranges::copy(program.code, std::back_inserter(decoded_code));
+#endif
+}
+
+//****************************************************************************//
+//                                  Dispatch                                  //
+//****************************************************************************//
+// Every handler is written once against the macros below and expands either to a label
+// (threaded dispatch) or to a case of the fallback switch.
+#ifdef MVPL_DISPATCH_STATISTICS
+#    define VM_RECORD() statistics.record(program.code, static_cast<std::size_t>(ip - code))
+#else
+#    define VM_RECORD() (void)0
+#endif
+
+// Threaded code reaches a handler's profiling or publishing entry only when decoded for
+// them, the switch has to check for the profiler and always publishes. Profiled code
+// publishes as well, to the unobserved position unless a position is published.
+#define VM_PROFILE() attached_profiler->record(static_cast<std::size_t>(ip - code))
+#define VM_PUBLISH() \
+    published->store(static_cast<std::size_t>(ip - code), std::memory_order_relaxed)
+
+#ifdef MVPL_THREADED_DISPATCH
+#    define VM_DISPATCH() \
+        VM_RECORD();      \
+        goto* ip->handler
+#    define VM_SWITCH() VM_DISPATCH();
+#    define VM_CASE(op) \
+        profile_##op:   \
+        VM_PROFILE();   \
+        publish_##op:   \
+        VM_PUBLISH();   \
+        handle_##op:
+#    define VM_DEFAULT()
+#    define VM_NEXT() \
+        ++ip;         \
+        VM_DISPATCH()
+#else
+#    define VM_DISPATCH() continue
+#    define VM_SWITCH()                   \
+        VM_RECORD();                      \
+        if (attached_profiler != nullptr) \
+        {                                 \
+            VM_PROFILE();                 \
+        }                                 \
+        VM_PUBLISH();                     \
+        switch (ip->op)
+#    define VM_CASE(op)   case opcode::op:
+#    define VM_DEFAULT()  default:
+#    define VM_NEXT() \
+        ++ip;         \
+        continue
+#endif
+
+// Taken backward jumps and calls charge the budget. Once it is used up, the run is suspended
+// before the destination is executed.
+#define VM_CHARGE(cost, destination)                                                         \
+    if ((budget -= (cost)) <= 0)                                                             \
+    {                                                                                        \
+        suspended = suspension{regs, frame, static_cast<std::size_t>((destination) - code)}; \
+        return run_status::PREEMPTED;                                                        \
+    }
+
+#ifdef MVPL_JIT
+// Continues in machine code, until the function returns or leaves through a side exit
+#    define VM_RUN_NATIVE(native)                                                 \
+        {                                                                         \
+            const auto native_result = (native).function(regs, (native).address); \
+                                                                                  \
+            if (native_result.exit != NO_EXIT)                                    \
+            {                                                                     \
+                ip = code + native_result.exit;                                   \
+                VM_DISPATCH();                                                    \
+            }                                                                     \
+            return_value = native_result.value;                                   \
+            goto return_from_function;                                            \
+        }
+
+// Taken backward jumps close loops. Once enough of them ran, the function containing the
+// loop is compiled and continues as machine code at the jump's target.
+#    define VM_JUMP(target)                                                            \
+        {                                                                              \
+            const decoded_instruction* destination = code + (target);                  \
+            const auto                 index       = destination - code;               \
+                                                                                       \
+            if (destination <= ip)                                                     \
+            {                                                                          \
+                VM_CHARGE(ip - destination + 1, destination)                           \
+                                                                                       \
+                if (--loop_countdown == 0)                                             \
+                {                                                                      \
+                    loop_countdown = jit.get_loop_threshold();                         \
+                                                                                       \
+                    if (auto native = jit.enter_loop(static_cast<std::size_t>(index))) \
+                    {                                                                  \
+                        VM_RUN_NATIVE(native)                                          \
+                    }                                                                  \
+                }                                                                      \
+            }                                                                          \
+            ip = destination;                                                          \
+            VM_DISPATCH();                                                             \
+        }
+#else
+#    define VM_JUMP(target)                                           \
+        {                                                             \
+            const decoded_instruction* destination = code + (target); \
+                                                                      \
+            if (destination <= ip)                                    \
+            {                                                         \
+                VM_CHARGE(ip - destination + 1, destination)          \
+            }                                                         \
+            ip = destination;                                         \
+            VM_DISPATCH();                                            \
+        }
+#endif
+
+#define VM_BINARY_OP(op, expression)         \
+    VM_CASE(op)                              \
+    {                                        \
+        const value_t lhs = regs[ip->b];     \
+        const value_t rhs = regs[ip->c];     \
+        regs[ip->a]       = (expression);    \
+        VM_NEXT();                           \
+    }
+
+#define VM_IMMEDIATE_OP(op, expression)                  \
+    VM_CASE(op)                                          \
+    {                                                    \
+        const value_t lhs = regs[ip->b];                 \
+        const value_t rhs = static_cast<value_t>(ip->c); \
+        regs[ip->a]       = (expression);                \
+        VM_NEXT();                                       \
+    }
+
+#define VM_CONDITIONAL_JUMP_IMMEDIATE(op, comparison)           \
+    VM_CASE(op)                                                 \
+    {                                                           \
+        if (regs[ip->b] comparison static_cast<value_t>(ip->c)) \
+        {                                                       \
+            VM_JUMP(ip->a);                                     \
+        }                                                       \
+        VM_NEXT();                                              \
+    }
+
+#define VM_CONDITIONAL_JUMP(op, comparison)     \
+    VM_CASE(op)                                 \
+    {                                           \
+        if (regs[ip->b] comparison regs[ip->c]) \
+        {                                       \
+            VM_JUMP(ip->a);                     \
+        }                                       \
+        VM_NEXT();                              \
+    }
+
+register_machine::run_status register_machine::execute(bool only_decode, std::ptrdiff_t budget)
+{
+#ifdef MVPL_THREADED_DISPATCH
+#    pragma GCC diagnostic push
+#    pragma GCC diagnostic ignored "-Wpedantic"
+    // Order has to match the opcode enum
+    static const void* const handlers[] = {
+        &&handle_ADD,          &&handle_SUB,          &&handle_MUL,          &&handle_DIV,
+        &&handle_MOD,          &&handle_INC,          &&handle_DEC,          &&handle_AND,
+        &&handle_OR,           &&handle_NOT,          &&handle_LSHIFT,       &&handle_RSHIFT,
+        &&handle_XOR,          &&handle_JUMPEQ,       &&handle_JUMPNEQ,      &&handle_JUMPLESS,
+        &&handle_JUMPGREATER,  &&handle_JUMPLEQ,      &&handle_JUMPGEQ,      &&handle_SET,
+        &&handle_SETLIT,       &&handle_JUMP,         &&handle_PRINT,        &&handle_READ,
+        &&handle_CALL,         &&handle_RET,          &&handle_TAILCALL,     &&handle_ADDI,
+        &&handle_MULI,         &&handle_DIVI,         &&handle_MODI,         &&handle_ANDI,
+        &&handle_LSHIFTI,      &&handle_RSHIFTI,      &&handle_JUMPEQI,      &&handle_JUMPNEQI,
+        &&handle_JUMPLESSI,    &&handle_JUMPGREATERI, &&handle_JUMPLEQI,     &&handle_JUMPGEQI,
+        &&handle_INCJUMPLESS,  &&handle_INCJUMPLESSI, &&handle_DIVPOW2I,     &&handle_MODPOW2I,
+        &&handle_DIVMAGIC,     &&handle_MODMAGIC,     &&handle_JUMPTABLE};
+    static const void* const profiled_handlers[] = {
+        &&profile_ADD,          &&profile_SUB,          &&profile_MUL,
+        &&profile_DIV,          &&profile_MOD,          &&profile_INC,
+        &&profile_DEC,          &&profile_AND,          &&profile_OR,
+        &&profile_NOT,          &&profile_LSHIFT,       &&profile_RSHIFT,
+        &&profile_XOR,          &&profile_JUMPEQ,       &&profile_JUMPNEQ,
+        &&profile_JUMPLESS,     &&profile_JUMPGREATER,  &&profile_JUMPLEQ,
+        &&profile_JUMPGEQ,      &&profile_SET,          &&profile_SETLIT,
+        &&profile_JUMP,         &&profile_PRINT,        &&profile_READ,
+        &&profile_CALL,         &&profile_RET,          &&profile_TAILCALL,
+        &&profile_ADDI,         &&profile_MULI,         &&profile_DIVI,
+        &&profile_MODI,         &&profile_ANDI,         &&profile_LSHIFTI,
+        &&profile_RSHIFTI,      &&profile_JUMPEQI,      &&profile_JUMPNEQI,
+        &&profile_JUMPLESSI,    &&profile_JUMPGREATERI, &&profile_JUMPLEQI,
+        &&profile_JUMPGEQI,     &&profile_INCJUMPLESS,  &&profile_INCJUMPLESSI,
+        &&profile_DIVPOW2I,     &&profile_MODPOW2I,     &&profile_DIVMAGIC,
+        &&profile_MODMAGIC,     &&profile_JUMPTABLE};
+    static const void* const published_handlers[] = {
+        &&publish_ADD,          &&publish_SUB,          &&publish_MUL,
+        &&publish_DIV,          &&publish_MOD,          &&publish_INC,
+        &&publish_DEC,          &&publish_AND,          &&publish_OR,
+        &&publish_NOT,          &&publish_LSHIFT,       &&publish_RSHIFT,
+        &&publish_XOR,          &&publish_JUMPEQ,       &&publish_JUMPNEQ,
+        &&publish_JUMPLESS,     &&publish_JUMPGREATER,  &&publish_JUMPLEQ,
+        &&publish_JUMPGEQ,      &&publish_SET,          &&publish_SETLIT,
+        &&publish_JUMP,         &&publish_PRINT,        &&publish_READ,
+        &&publish_CALL,         &&publish_RET,          &&publish_TAILCALL,
+        &&publish_ADDI,         &&publish_MULI,         &&publish_DIVI,
+        &&publish_MODI,         &&publish_ANDI,         &&publish_LSHIFTI,
+        &&publish_RSHIFTI,      &&publish_JUMPEQI,      &&publish_JUMPNEQI,
+        &&publish_JUMPLESSI,    &&publish_JUMPGREATERI, &&publish_JUMPLEQI,
+        &&publish_JUMPGEQI,     &&publish_INCJUMPLESS,  &&publish_INCJUMPLESSI,
+        &&publish_DIVPOW2I,     &&publish_MODPOW2I,     &&publish_DIVMAGIC,
+        &&publish_MODMAGIC,     &&publish_JUMPTABLE};
+    static_assert(std::size(handlers) == EnumRange<opcode, LAST_OPCODE>().size(),
+                  "opcode missing handler");
+    static_assert(std::size(profiled_handlers) == std::size(handlers),
+                  "opcode missing profiling handler");
+    static_assert(std::size(published_handlers) == std::size(handlers),
+                  "opcode missing publishing handler");
+
+    if (decoded_code.size() != program.code.size())
+    {
+        if (attached_profiler != nullptr)
+        {
+            decode(profiled_handlers);
+        }
+        else if (position != &unobserved_position)
+        {
+            decode(published_handlers);
+        }
+        else
+        {
+            decode(handlers);
+        }
+    }
+#else
+    if (decoded_code.size() != program.code.size())
+    {
+        decode(nullptr);
+    }
+#endif
+
+    if (only_decode)
+    {
+        return run_status::FINISHED;
+    }
+
+    // The hot state lives in locals, so that the compiler can keep it in machine registers
+    // and only has to write it back on calls and returns.
+    const decoded_instruction* const code      = decoded_code.data();
+    const value_t* const             constants = program.constants.data();
+    const auto&                      main      = program.functions[program.main_function];
+    published_position* const        published = position;
+
+    value_t*                   regs   = static_cast<value_t*>(value_stack.data());
+    call_frame* const          frames = static_cast<call_frame*>(frame_stack.data());
+    call_frame*                frame  = frames;
+    const decoded_instruction* ip     = code + main.entry;
+
+#ifndef MVPL_GUARD_PAGES
+    // Without guard pages calls check that the callee's window and frame fit
+    const std::size_t       n_values    = value_stack.limit() / sizeof(value_t);
+    const value_t* const    last_window = regs + n_values - window_size;
+    const call_frame* const last_frame  = frames + frame_stack.limit() / sizeof(call_frame) - 1;
+#endif
+
+    // Set by RET and machine code returning from a function
+    value_t return_value = 0;
+
+#ifdef MVPL_JIT
+    std::size_t loop_countdown = jit.get_loop_threshold();
+#endif
+
+    if (suspended)
+    {
+        regs  = suspended->registers;
+        frame = suspended->frame;
+        ip    = code + suspended->instruction;
+
+        suspended.reset();
+    }
+    else
+    {
+        std::fill_n(regs, main.n_registers, 0);
+        *frame = {regs, nullptr, 0};
+
+        if (attached_profiler != nullptr)
+        {
+            attached_profiler->start(program.main_function);
+        }
+
+#ifdef MVPL_JIT
+        if (auto native = jit.enter(program.main_function))
+        {
+            const auto native_result = native.function(regs, native.address);
+
+            if (native_result.exit == NO_EXIT)
+            {
+                result = native_result.value;
+
+                return run_status::FINISHED;
+            }
+
+            ip = code + native_result.exit;
+        }
+#endif
+    }
+
+    for (;;)
+    {
+        VM_SWITCH()
+        {
+            //*********************    Arithmetic    *********************//
+            VM_BINARY_OP(ADD, wrapping_add(lhs, rhs))
+            VM_BINARY_OP(SUB, wrapping_sub(lhs, rhs))
+            VM_BINARY_OP(MUL, wrapping_mul(lhs, rhs))
+            VM_BINARY_OP(DIV, checked_div(lhs, rhs))
+            VM_BINARY_OP(MOD, checked_mod(lhs, rhs))
+
+            VM_CASE(INC)
+            {
+                regs[ip->a] = wrapping_add(regs[ip->a], 1);
+                VM_NEXT();
+            }
+            VM_CASE(DEC)
+            {
+                regs[ip->a] = wrapping_sub(regs[ip->a], 1);
+                VM_NEXT();
+            }
+
+            //***********************    Binary    ***********************//
+            VM_BINARY_OP(AND, lhs & rhs)
+            VM_BINARY_OP(OR, lhs | rhs)
+            VM_BINARY_OP(XOR, lhs ^ rhs)
+            VM_BINARY_OP(LSHIFT, shift_left(lhs, rhs))
+            VM_BINARY_OP(RSHIFT, shift_right(lhs, rhs))
+
+            VM_CASE(NOT)
+            {
+                regs[ip->a] = static_cast<value_t>(regs[ip->b] == 0);
+                VM_NEXT();
+            }
+
+            //*********************    Comparison    *********************//
+            VM_CONDITIONAL_JUMP(JUMPEQ, ==)
+            VM_CONDITIONAL_JUMP(JUMPNEQ, !=)
+            VM_CONDITIONAL_JUMP(JUMPLESS, <)
+            VM_CONDITIONAL_JUMP(JUMPGREATER, >)
+            VM_CONDITIONAL_JUMP(JUMPLEQ, <=)
+            VM_CONDITIONAL_JUMP(JUMPGEQ, >=)
+
+            //************************    Misc    ************************//
+            VM_CASE(SET)
+            {
+                regs[ip->a] = regs[ip->b];
+                VM_NEXT();
+            }
+            VM_CASE(SETLIT)
+            {
+                regs[ip->a] = constants[ip->b];
+                VM_NEXT();
+            }
+            VM_CASE(JUMP)
+            {
+                VM_JUMP(ip->a);
+            }
+            VM_CASE(PRINT)
+            {
+                output.write(regs[ip->a]);
+                VM_NEXT();
+            }
+            VM_CASE(READ)
+            {
+                const auto value = input.try_read(output);
+
+                // Reads again once resumed
+                if (!value)
+                {
+                    suspended = suspension{regs, frame, static_cast<std::size_t>(ip - code)};
+
+                    return run_status::WAITING_FOR_INPUT;
+                }
+
+                regs[ip->a] = *value;
+                VM_NEXT();
+            }
+            VM_CASE(CALL)
+            {
+                const auto& callee = program.functions[static_cast<std::size_t>(ip->b)];
+
+                // The callee's window overlaps the caller's from the first argument on
+                regs += ip->c;
+#ifndef MVPL_GUARD_PAGES
+                if (regs > last_window || frame == last_frame)
+                {
+                    throw std::runtime_error("Stack overflow");
+                }
+#endif
+                std::fill(regs + callee.n_parameters, regs + callee.n_registers, 0);
+                *++frame = {regs, ip + 1, ip->a};
+
+#ifdef MVPL_JIT
+                if (auto native = jit.enter(static_cast<std::size_t>(ip->b)))
+                {
+                    // Side exits continue in the callee's frame
+                    VM_RUN_NATIVE(native)
+                }
+#endif
+
+                VM_CHARGE(1, code + callee.entry)
+
+                ip = code + callee.entry;
+                VM_DISPATCH();
+            }
+            VM_CASE(RET)
+            {
+                return_value = regs[ip->a];
+#ifdef MVPL_JIT
+            return_from_function:
+#endif
+                if (frame == frames)
+                {
+                    result = return_value;
+
+                    return run_status::FINISHED;
+                }
+
+                const auto return_address  = frame->return_address;
+                const auto return_register = frame->return_register;
+
+                --frame;
+                regs                  = frame->registers;
+                regs[return_register] = return_value;
+                ip                    = return_address;
+                VM_DISPATCH();
+            }
+
+            VM_CASE(TAILCALL)
+            {
+                // The arguments start behind the caller's registers, so copying them to the
+                // front of the frame never overwrites one, which is still to be copied
+                const auto& callee = program.functions[static_cast<std::size_t>(ip->b)];
+
+                std::copy_n(regs + ip->c, callee.n_parameters, regs);
+                std::fill(regs + callee.n_parameters, regs + callee.n_registers, 0);
+
+                VM_CHARGE(1, code + callee.entry)
+
+                ip = code + callee.entry;
+                VM_DISPATCH();
+            }
+
+            //*****************    Superinstructions    ******************//
+            VM_IMMEDIATE_OP(ADDI, wrapping_add(lhs, rhs))
+            VM_IMMEDIATE_OP(MULI, wrapping_mul(lhs, rhs))
+            VM_IMMEDIATE_OP(DIVI, checked_div(lhs, rhs))
+            VM_IMMEDIATE_OP(MODI, checked_mod(lhs, rhs))
+            VM_IMMEDIATE_OP(ANDI, lhs & rhs)
+            VM_IMMEDIATE_OP(LSHIFTI, shift_left(lhs, rhs))
+            VM_IMMEDIATE_OP(RSHIFTI, shift_right(lhs, rhs))
+
+            VM_CONDITIONAL_JUMP_IMMEDIATE(JUMPEQI, ==)
+            VM_CONDITIONAL_JUMP_IMMEDIATE(JUMPNEQI, !=)
+            VM_CONDITIONAL_JUMP_IMMEDIATE(JUMPLESSI, <)
+            VM_CONDITIONAL_JUMP_IMMEDIATE(JUMPGREATERI, >)
+            VM_CONDITIONAL_JUMP_IMMEDIATE(JUMPLEQI, <=)
+            VM_CONDITIONAL_JUMP_IMMEDIATE(JUMPGEQI, >=)
+
+            VM_CASE(INCJUMPLESS)
+            {
+                const value_t counter = wrapping_add(regs[ip->b], 1);
+                regs[ip->b]           = counter;
+
+                if (counter < regs[ip->c])
+                {
+                    VM_JUMP(ip->a);
+                }
+                VM_NEXT();
+            }
+            VM_CASE(INCJUMPLESSI)
+            {
+                const value_t counter = wrapping_add(regs[ip->b], 1);
+                regs[ip->b]           = counter;
+
+                if (counter < static_cast<value_t>(ip->c))
+                {
+                    VM_JUMP(ip->a);
+                }
+                VM_NEXT();
+            }
+
+            //******************    Constant division    *******************//
+            VM_IMMEDIATE_OP(DIVPOW2I, divide_by_power_of_two(lhs, rhs))
+            VM_IMMEDIATE_OP(MODPOW2I, modulo_by_power_of_two(lhs, rhs))
+
+            VM_CASE(DIVMAGIC)
+            {
+                const value_t* magic = constants + ip->c;
+                regs[ip->a]          = divide_by_magic(regs[ip->b], magic[0], magic[1], magic[2]);
+                VM_NEXT();
+            }
+            VM_CASE(MODMAGIC)
+            {
+                const value_t* magic    = constants + ip->c;
+                const value_t  lhs      = regs[ip->b];
+                const value_t  quotient = divide_by_magic(lhs, magic[0], magic[1], magic[2]);
+                regs[ip->a]             = wrapping_sub(lhs, wrapping_mul(quotient, magic[2]));
+                VM_NEXT();
+            }
+
+            //**********************    Switches    **********************//
+            VM_CASE(JUMPTABLE)
+            {
+                // Negative indices become too large as well
+                const auto index = static_cast<std::uint64_t>(regs[ip->a]);
+
+                if (index < static_cast<std::uint64_t>(ip->c))
+                {
+                    const decoded_instruction* destination =
+                        code + constants[ip->b + static_cast<std::ptrdiff_t>(index)];
+
+                    if (destination <= ip)
+                    {
+                        VM_CHARGE(ip - destination + 1, destination)
+                    }
+
+                    ip = destination;
+                    VM_DISPATCH();
+                }
+                VM_NEXT();
+            }
+
+            VM_DEFAULT()
+            {
+                throw std::runtime_error("Invalid opcode");
+            }
+        }
+    }
+#ifdef MVPL_THREADED_DISPATCH
+#    pragma GCC diagnostic pop
+#endif
+}
+
+#undef VM_CONDITIONAL_JUMP_IMMEDIATE
+#undef VM_JUMP
+#undef VM_CHARGE
+#undef VM_RUN_NATIVE
+#undef VM_CONDITIONAL_JUMP
+#undef VM_IMMEDIATE_OP
+#undef VM_BINARY_OP
+#undef VM_NEXT
+#undef VM_DEFAULT
+#undef VM_CASE
+#undef VM_SWITCH
+#undef VM_DISPATCH
+#undef VM_RECORD
@@ -20,3 +20,166 @@
 //
 
 #pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <optional>
+#include <ostream>
+#include <vector>
+
+#include "backend/bytecode_program.hpp"
+#include "backend/value.hpp"
+#include "buffered_io.hpp"
+#include "dispatch_statistics.hpp"
+#include "guarded_stack.hpp"
+#include "jit_compiler.hpp"
+#include "profiler.hpp"
+#include "sampling_profiler.hpp"
+
+// GCC and clang support taking the address of labels, which lets every handler jump
+// straight to the next one instead of going through a single, badly predicted switch.
+#if (defined(__GNUC__) || defined(__clang__)) && !defined(MVPL_SWITCH_DISPATCH)
+#    define MVPL_THREADED_DISPATCH
+#endif
+
+class register_machine
+{
+ public:
+    // Bytes each of the value and the frame stack may grow to
+    static constexpr std::size_t DEFAULT_STACK_LIMIT = 64 * 1024 * 1024;
+
+    // Where resume stopped
+    enum class run_status
+    {
+        FINISHED,
+        // At a read from a non-blocking input, which has no complete value yet
+        WAITING_FOR_INPUT,
+        // The budget was used up
+        PREEMPTED,
+    };
+
+    // Methods
+    explicit register_machine(const bytecode_program& program,
+                              std::ostream&           output      = std::cout,
+                              const jit_options&      jit         = default_jit_options(),
+                              std::size_t             stack_limit = DEFAULT_STACK_LIMIT);
+    // Executes the sections in place, e.g. those of a bytecode_image
+    explicit register_machine(const bytecode_view& program,
+                              std::ostream&        output      = std::cout,
+                              const jit_options&   jit         = default_jit_options(),
+                              std::size_t          stack_limit = DEFAULT_STACK_LIMIT);
+
+    // Executes the program's main function and returns its return value. Throws
+    // std::runtime_error("Stack overflow") once a stack reaches its limit. The output is
+    // buffered and written at the end of the run, or when the buffer is full or the program
+    // waits for input.
+    value_t run();
+
+    // Starts a run or continues the suspended one, until it finishes, waits for input or used
+    // up the budget of instructions. Instead of every instruction, taken backward jumps charge
+    // the length of the loop they close and calls charge one, so neither loops nor recursion
+    // run far past the budget. Machine code of the JIT is not preempted. A suspended run
+    // keeps its registers and frames in the machine and continues where it stopped, output
+    // is only flushed once it finished. Throws like run, which ends the run.
+    run_status resume(std::size_t budget);
+    // Return value of the last finished run
+    [[nodiscard]] value_t get_result() const;
+
+    // Where read takes its values from, std::cin unless set
+    void set_input(std::istream& input_);
+#ifdef MVPL_FILE_DESCRIPTORS
+    // Reads the file descriptor, which stays open. Once a non-blocking one has no complete
+    // value to read, resume returns WAITING_FOR_INPUT, run waits for it.
+    void set_input(int file, std::size_t buffer_size = DEFAULT_IO_BUFFER_SIZE);
+    // Prints to the file descriptor instead of the constructor's stream, it stays open
+    void set_output(int file, std::size_t buffer_size = DEFAULT_IO_BUFFER_SIZE);
+#endif
+
+    // Decodes the program ahead of the first run, so that processes forked afterwards share
+    // the decoded code with this one
+    void prepare();
+
+    // True once the function runs as machine code
+    [[nodiscard]] bool is_jit_compiled(std::size_t function) const;
+
+    // Following runs report every instruction to the profiler, nullptr detaches it again.
+    // Profiled code is decoded to a second set of handlers, which call the profiler before
+    // continuing in the regular ones, so that the machine runs unchanged without one. The
+    // JIT is disabled for good, functions have to be interpreted to be profiled.
+    void attach_profiler(profiler* profiler_);
+
+    // Following runs store the index of every instruction in position before executing it
+    // and NOT_EXECUTING after the run, for a sampling_profiler. Like the profiler's, this
+    // code is decoded to its own handlers. nullptr stops publishing.
+    void publish_position(published_position* position_);
+
+#ifdef MVPL_DISPATCH_STATISTICS
+    // Accumulated over all runs
+    [[nodiscard]] const dispatch_statistics& get_dispatch_statistics() const;
+#endif
+
+ private:
+    // Instructions are translated once before the first run, so that dispatching only needs
+    // a single indirect jump to the address stored in the instruction itself.
+    struct threaded_instruction
+    {
+        const void*  handler;
+        std::int32_t a;
+        std::int32_t b;
+        std::int32_t c;
+    };
+
+#ifdef MVPL_THREADED_DISPATCH
+    using decoded_instruction = threaded_instruction;
+#else
+    using decoded_instruction = instruction;
+#endif
+
+    // The register windows of all frames lie on one contiguous value stack, which is
+    // allocated with the machine. A callee's window starts at the caller's first argument
+    // register, so the arguments already are the callee's parameters and calls neither
+    // allocate nor copy. As windows overlap, the frames are kept on a second stack. Both
+    // end in guard pages, so calls do not compare against the limit (see guarded_stack).
+    struct call_frame
+    {
+        value_t*                   registers;
+        const decoded_instruction* return_address;
+        std::int32_t               return_register;
+    };
+
+    // Where a suspended run continues. The instruction is an index, as the code may be
+    // decoded again in between.
+    struct suspension
+    {
+        value_t*    registers;
+        call_frame* frame;
+        std::size_t instruction;
+    };
+
+    // Variables
+    // Only used when constructed from a bytecode_program, which has no function layouts
+    std::vector<function_layout>     function_layouts;
+    bytecode_view                    program;
+    output_buffer                    output;
+    input_buffer                     input;
+    std::vector<decoded_instruction> decoded_code;
+    // Largest register window of any function, see decode
+    std::size_t                      window_size;
+    guarded_stack                    value_stack;
+    guarded_stack                    frame_stack;
+    jit_compiler                     jit;
+    profiler*                        attached_profiler;
+    // Points to unobserved_position, unless a position is published
+    published_position*              position;
+    published_position               unobserved_position;
+    std::optional<suspension>        suspended;
+    value_t                          result;
+#ifdef MVPL_DISPATCH_STATISTICS
+    dispatch_statistics statistics;
+#endif
+
+    // Methods
+    void       decode(const void* const* handlers);
+    run_status execute(bool only_decode, std::ptrdiff_t budget);
+};
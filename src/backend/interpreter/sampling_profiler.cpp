@@ -0,0 +1,286 @@
+// Copyright © 2021-2022 Jonas Muehlmann
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include "sampling_profiler.hpp"
+
+#ifdef MVPL_SAMPLING_PROFILER
+#    include <algorithm>
+#    include <map>
+#    include <mutex>
+#    include <numeric>
+#    include <stdexcept>
+#    include <utility>
+
+#    include <sys/time.h>
+#    include <unistd.h>
+
+namespace
+{
+// The handler is process wide, it finds the sampling profiler here
+std::atomic<sampling_profiler*> active_profiler = nullptr;
+
+std::once_flag install_flag;
+}    // namespace
+
+sampling_profiler::sampling_profiler(const bytecode_program& program_) :
+    function_layouts{get_function_layouts(program_)},
+    program{program_.code,
+            program_.constants,
+            function_layouts,
+            program_.main_function,
+            program_.lines},
+    names{get_function_names(program_)},
+    owners{},
+    position{NOT_EXECUTING},
+    samples(program_.code.size()),
+    idle_samples{0},
+    interval{DEFAULT_SAMPLING_INTERVAL},
+    is_sampling{false}
+{
+    index_functions();
+}
+
+sampling_profiler::sampling_profiler(const bytecode_view&     program_,
+                                     std::vector<std::string> names_) :
+    function_layouts{},
+    program{program_},
+    names{std::move(names_)},
+    owners{},
+    position{NOT_EXECUTING},
+    samples(program_.code.size()),
+    idle_samples{0},
+    interval{DEFAULT_SAMPLING_INTERVAL},
+    is_sampling{false}
+{
+    index_functions();
+}
+
+sampling_profiler::~sampling_profiler()
+{
+    stop();
+}
+
+void sampling_profiler::start(std::chrono::microseconds interval_)
+{
+    if (is_sampling)
+    {
+        return;
+    }
+
+    sampling_profiler* none = nullptr;
+
+    if (!active_profiler.compare_exchange_strong(none, this))
+    {
+        throw std::runtime_error("Another sampling profiler is running");
+    }
+
+    // Stays installed, a signal still pending after stopping must not terminate the process
+    std::call_once(install_flag, [] {
+        struct sigaction action = {};
+        action.sa_handler       = handle_signal;
+        action.sa_flags         = SA_RESTART;
+        sigemptyset(&action.sa_mask);
+
+        if (sigaction(SIGPROF, &action, nullptr) != 0)
+        {
+            throw std::runtime_error("Could not install the sampling handler");
+        }
+    });
+
+    interval = std::max(interval_, std::chrono::microseconds{1});
+
+    const auto seconds      = std::chrono::duration_cast<std::chrono::seconds>(interval);
+    const auto microseconds = interval - seconds;
+
+#    ifdef __linux__
+    // Counts the CPU time of this thread only and interrupts it rather than any other,
+    // glibc does not name the field of the thread id
+    sigevent event       = {};
+    event.sigev_notify   = SIGEV_THREAD_ID;
+    event.sigev_signo    = SIGPROF;
+    event._sigev_un._tid = gettid();
+
+    itimerspec period          = {};
+    period.it_interval.tv_sec  = seconds.count();
+    period.it_interval.tv_nsec = microseconds.count() * 1000;
+    period.it_value            = period.it_interval;
+
+    if (timer_create(CLOCK_THREAD_CPUTIME_ID, &event, &timer) != 0)
+    {
+        active_profiler = nullptr;
+
+        throw std::runtime_error("Could not create the sampling timer");
+    }
+
+    if (timer_settime(timer, 0, &period, nullptr) != 0)
+    {
+        timer_delete(timer);
+        active_profiler = nullptr;
+
+        throw std::runtime_error("Could not start the sampling timer");
+    }
+#    else
+    itimerval period           = {};
+    period.it_interval.tv_sec  = static_cast<time_t>(seconds.count());
+    period.it_interval.tv_usec = static_cast<suseconds_t>(microseconds.count());
+    period.it_value            = period.it_interval;
+
+    if (setitimer(ITIMER_PROF, &period, nullptr) != 0)
+    {
+        active_profiler = nullptr;
+
+        throw std::runtime_error("Could not start the sampling timer");
+    }
+#    endif
+
+    is_sampling = true;
+}
+
+void sampling_profiler::stop()
+{
+    if (!is_sampling)
+    {
+        return;
+    }
+
+#    ifdef __linux__
+    timer_delete(timer);
+#    else
+    itimerval disarmed = {};
+    setitimer(ITIMER_PROF, &disarmed, nullptr);
+#    endif
+
+    active_profiler = nullptr;
+    is_sampling     = false;
+}
+
+published_position& sampling_profiler::get_position()
+{
+    return position;
+}
+
+std::uint64_t sampling_profiler::get_n_samples() const
+{
+    return std::accumulate(samples.begin(),
+                           samples.end(),
+                           idle_samples.load(),
+                           [](std::uint64_t n, const std::atomic<std::uint64_t>& count) {
+                               return n + count.load();
+                           });
+}
+
+json sampling_profiler::get_summary() const
+{
+    std::vector<std::uint64_t> function_samples(program.functions.size(), 0);
+    // (line, function) -> samples, inlining puts the same line into several functions
+    std::map<std::pair<std::uint32_t, std::size_t>, std::uint64_t> line_samples;
+
+    for (std::size_t i = 0; i < samples.size(); ++i)
+    {
+        const auto count = samples[i].load();
+
+        if (count == 0)
+        {
+            continue;
+        }
+
+        function_samples[owners[i]] += count;
+
+        if (i < program.lines.size() && program.lines[i] != 0)
+        {
+            line_samples[{program.lines[i], owners[i]}] += count;
+        }
+    }
+
+    json summary = json::object();
+
+    summary["interval_us"] = interval.count();
+    summary["samples"]     = get_n_samples();
+    summary["idle"]        = idle_samples.load();
+
+    // Functions
+    std::vector<std::size_t> order(function_samples.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::ranges::stable_sort(order, std::greater{}, [&](std::size_t function) {
+        return function_samples[function];
+    });
+
+    summary["functions"] = json::array();
+
+    for (auto function : order)
+    {
+        if (function_samples[function] > 0)
+        {
+            summary["functions"].push_back(
+                {{"name", names[function]}, {"samples", function_samples[function]}});
+        }
+    }
+
+    // Lines
+    std::vector<std::pair<std::pair<std::uint32_t, std::size_t>, std::uint64_t>> lines(
+        line_samples.begin(), line_samples.end());
+    std::ranges::stable_sort(lines, std::greater{}, [](const auto& line) { return line.second; });
+
+    summary["lines"] = json::array();
+
+    for (const auto& [line, count] : lines)
+    {
+        summary["lines"].push_back(
+            {{"line", line.first}, {"function", names[line.second]}, {"samples", count}});
+    }
+
+    return summary;
+}
+
+void sampling_profiler::index_functions()
+{
+    names.resize(program.functions.size());
+
+    for (std::size_t i = 0; i < names.size(); ++i)
+    {
+        if (names[i].empty())
+        {
+            names[i] = "function_" + std::to_string(i);
+        }
+    }
+
+    owners = get_instruction_owners(program);
+}
+
+void sampling_profiler::handle_signal([[maybe_unused]] int signal)
+{
+    auto* profiler = active_profiler.load();
+
+    if (profiler == nullptr)
+    {
+        return;
+    }
+
+    const auto index = profiler->position.load(std::memory_order_relaxed);
+
+    if (index < profiler->samples.size())
+    {
+        profiler->samples[index].fetch_add(1, std::memory_order_relaxed);
+    }
+    else
+    {
+        profiler->idle_samples.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+#endif
@@ -0,0 +1,114 @@
+// Copyright © 2021-2022 Jonas Muehlmann
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "backend/bytecode_program.hpp"
+#include <nlohmann/json.hpp>
+
+using json = nlohmann::ordered_json;
+
+// Index of the instruction a register machine is executing, which it publishes for a signal
+// handler (see register_machine::publish_position). Lock free atomics are async signal safe.
+using published_position = std::atomic<std::size_t>;
+
+static_assert(published_position::is_always_lock_free);
+
+// Published while the machine does not run
+inline constexpr std::size_t NOT_EXECUTING = std::numeric_limits<std::size_t>::max();
+
+// Timers and signals need POSIX, elsewhere there is no sampling profiler
+#ifdef __unix__
+#    define MVPL_SAMPLING_PROFILER
+#    include <signal.h>
+#    include <time.h>
+#endif
+
+#ifdef MVPL_SAMPLING_PROFILER
+inline constexpr std::chrono::microseconds DEFAULT_SAMPLING_INTERVAL{1000};
+
+// A statistical profiler: while sampling, a timer interrupts the thread with SIGPROF every
+// interval of CPU time and the signal handler counts the instruction published in the
+// position, functions and source lines are only looked up afterwards. Publishing is a
+// single store per instruction, unlike the exact counts of the profiler, so it can stay
+// on for long running programs.
+//
+// Machine code of the JIT does not publish, its samples count for the instruction it was
+// entered at, the function's entry or a loop's jump target.
+class sampling_profiler
+{
+ public:
+    // Methods
+    // The program has to outlive the profiler
+    explicit sampling_profiler(const bytecode_program& program_);
+    // Names are indexed like the program's functions, functions without one are called by
+    // their index
+    sampling_profiler(const bytecode_view& program_, std::vector<std::string> names_);
+    ~sampling_profiler();
+
+    sampling_profiler(const sampling_profiler&)            = delete;
+    sampling_profiler& operator=(const sampling_profiler&) = delete;
+
+    // Samples the calling thread, on systems without per thread CPU timers the process.
+    // Kernels usually check CPU timers once per tick, shorter intervals are rounded up.
+    // Only one profiler samples at a time, throws std::runtime_error if another one does or
+    // the timer can not be created.
+    void start(std::chrono::microseconds interval_ = DEFAULT_SAMPLING_INTERVAL);
+    void stop();
+
+    // Where the register machine publishes the instruction it executes
+    [[nodiscard]] published_position& get_position();
+
+    [[nodiscard]] std::uint64_t get_n_samples() const;
+    // Samples per function and source line, ordered by decreasing count. Samples taken while
+    // no instruction was published, e.g. between runs, are idle.
+    [[nodiscard]] json get_summary() const;
+
+ private:
+    // Variables
+    // Only used when constructed from a bytecode_program, which has no function layouts
+    std::vector<function_layout>            function_layouts;
+    bytecode_view                           program;
+    std::vector<std::string>                names;
+    // Function of each instruction
+    std::vector<std::size_t>                owners;
+    published_position                      position;
+    // Per instruction, counted by the signal handler
+    std::vector<std::atomic<std::uint64_t>> samples;
+    std::atomic<std::uint64_t>              idle_samples;
+    std::chrono::microseconds               interval;
+    bool                                    is_sampling;
+#    ifdef __linux__
+    timer_t                                 timer;
+#    endif
+
+    // Methods
+    // Names the functions without one and finds the function of every instruction
+    void        index_functions();
+    static void handle_signal(int signal);
+};
+#endif
@@ -0,0 +1,193 @@
+// Copyright © 2021-2022 Jonas Muehlmann
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include "script_scheduler.hpp"
+
+#ifdef MVPL_SCRIPT_SCHEDULER
+#    include <cerrno>
+#    include <exception>
+#    include <iostream>
+#    include <stdexcept>
+#    include <utility>
+
+#    include <fcntl.h>
+#    include <unistd.h>
+
+namespace
+{
+// Most events are taken per call, further ones are left for the next round
+constexpr std::size_t MAX_EVENTS = 1024;
+}    // namespace
+
+script_scheduler::script_scheduler(const script_scheduler_options& options_) :
+    options{options_},
+    epoll{epoll_create1(EPOLL_CLOEXEC)},
+    scripts{},
+    ready{},
+    events{},
+    n_running{0}
+{
+    if (epoll < 0)
+    {
+        throw std::runtime_error("Could not create the epoll instance");
+    }
+
+    events.resize(MAX_EVENTS);
+}
+
+script_scheduler::~script_scheduler()
+{
+    close(epoll);
+}
+
+std::size_t script_scheduler::add(const bytecode_program& program, int input_file, int output_file)
+{
+    return add_machine(
+        std::make_unique<register_machine>(program, std::cout, options.jit, options.stack_limit),
+        input_file,
+        output_file);
+}
+
+std::size_t script_scheduler::add(const bytecode_view& program, int input_file, int output_file)
+{
+    return add_machine(
+        std::make_unique<register_machine>(program, std::cout, options.jit, options.stack_limit),
+        input_file,
+        output_file);
+}
+
+void script_scheduler::run()
+{
+    while (n_running > 0)
+    {
+        // Only blocks while every script waits for input
+        const int n_events = epoll_wait(
+            epoll, events.data(), static_cast<int>(events.size()), ready.empty() ? -1 : 0);
+
+        if (n_events < 0 && errno != EINTR)
+        {
+            throw std::runtime_error("Could not wait for input");
+        }
+
+        for (int i = 0; i < n_events; ++i)
+        {
+            ready.push_back(events[static_cast<std::size_t>(i)].data.u64);
+        }
+
+        // Scripts becoming ready during the round take their turn in the next one
+        for (auto n_ready = ready.size(); n_ready > 0; --n_ready)
+        {
+            const auto index = ready.front();
+            ready.pop_front();
+
+            take_turn(index);
+        }
+    }
+}
+
+std::size_t script_scheduler::get_n_scripts() const
+{
+    return scripts.size();
+}
+
+const script_result& script_scheduler::get_result(std::size_t index) const
+{
+    return scripts.at(index).result;
+}
+
+std::size_t script_scheduler::add_machine(std::unique_ptr<register_machine> machine,
+                                          int                               input_file,
+                                          int                               output_file)
+{
+    const int flags = fcntl(input_file, F_GETFL);
+
+    if (flags < 0 || fcntl(input_file, F_SETFL, flags | O_NONBLOCK) < 0)
+    {
+        throw std::runtime_error("Could not make the input non-blocking");
+    }
+
+    machine->set_input(input_file, options.input_buffer_size);
+    machine->set_output(output_file, options.output_buffer_size);
+
+    scripts.push_back({std::move(machine), input_file, false, {false, 0, {}}});
+    ready.push_back(scripts.size() - 1);
+    ++n_running;
+
+    return scripts.size() - 1;
+}
+
+void script_scheduler::take_turn(std::size_t index)
+{
+    try
+    {
+        switch (scripts[index].machine->resume(options.time_slice))
+        {
+            case register_machine::run_status::FINISHED:
+                finish(index, {true, scripts[index].machine->get_result(), {}});
+                break;
+            case register_machine::run_status::WAITING_FOR_INPUT:
+                watch(index);
+                break;
+            case register_machine::run_status::PREEMPTED:
+                ready.push_back(index);
+                break;
+        }
+    }
+    catch (const std::exception& exception)
+    {
+        finish(index, {false, 0, exception.what()});
+    }
+}
+
+void script_scheduler::watch(std::size_t index)
+{
+    auto& waiting = scripts[index];
+
+    // One shot, so that a script is only made ready once per wait
+    epoll_event event{};
+    event.events   = EPOLLIN | EPOLLONESHOT;
+    event.data.u64 = index;
+
+    if (epoll_ctl(epoll,
+                  waiting.is_watched ? EPOLL_CTL_MOD : EPOLL_CTL_ADD,
+                  waiting.input_file,
+                  &event)
+        != 0)
+    {
+        throw std::runtime_error("Could not watch the input");
+    }
+
+    waiting.is_watched = true;
+}
+
+void script_scheduler::finish(std::size_t index, script_result result)
+{
+    auto& finished = scripts[index];
+
+    if (finished.is_watched)
+    {
+        epoll_ctl(epoll, EPOLL_CTL_DEL, finished.input_file, nullptr);
+    }
+
+    finished.machine.reset();
+    finished.is_watched = false;
+    finished.result     = std::move(result);
+    --n_running;
+}
+#endif
@@ -0,0 +1,122 @@
+// Copyright © 2021-2022 Jonas Muehlmann
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#pragma once
+
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "backend/bytecode_program.hpp"
+#include "backend/value.hpp"
+#include "buffered_io.hpp"
+#include "jit_compiler.hpp"
+#include "register_machine.hpp"
+
+// Waiting for many file descriptors at once needs Linux' epoll, elsewhere there is no scheduler
+#ifdef __linux__
+#    define MVPL_SCRIPT_SCHEDULER
+#    include <sys/epoll.h>
+#endif
+
+#ifdef MVPL_SCRIPT_SCHEDULER
+struct script_scheduler_options
+{
+    // Instructions a script runs before the next one's turn, see register_machine::resume
+    std::size_t time_slice{100'000};
+    // Scripts are expected to be small, so their stacks and buffers are as well
+    std::size_t stack_limit{256 * 1024};
+    std::size_t input_buffer_size{1024};
+    std::size_t output_buffer_size{1024};
+    // Machine code runs without being preempted, so it is only enabled on request
+    jit_options jit{.enabled = false};
+};
+
+struct script_result
+{
+    // False if the run threw, error holds the message then
+    bool        succeeded;
+    value_t     value;
+    std::string error;
+};
+
+// Runs many scripts on the calling thread, each in its own register machine. A script, which
+// reads from its input while no complete value arrived, is suspended instead of blocking the
+// thread, its input is watched with epoll and the script resumed once it is readable. Scripts
+// ready to run take turns of a time slice each, so a long running script delays the others
+// by at most a slice per turn.
+//
+// An idle script costs its machine: the decoded code, the touched pages of its stacks and its
+// buffers. Each machine's stacks take four memory mappings, of which Linux allows 65530 per
+// process by default (vm.max_map_count), so more than about 16000 scripts need the limit
+// raised. Output is written when flushed, while it can not be written the others wait.
+class script_scheduler
+{
+ public:
+    // Methods
+    // Throws std::runtime_error if the epoll instance can not be created
+    explicit script_scheduler(const script_scheduler_options& options_ = {});
+    ~script_scheduler();
+
+    script_scheduler(const script_scheduler&)            = delete;
+    script_scheduler& operator=(const script_scheduler&) = delete;
+
+    // The script reads values from input_file, which is made non-blocking and may not be
+    // shared with another script, and prints to output_file. Both may be the same socket and
+    // stay open. The program has to outlive the scheduler. Returns the script's index.
+    std::size_t add(const bytecode_program& program, int input_file, int output_file);
+    std::size_t add(const bytecode_view& program, int input_file, int output_file);
+
+    // Blocks until every script added finished
+    void run();
+
+    [[nodiscard]] std::size_t get_n_scripts() const;
+    // Valid once the script finished
+    [[nodiscard]] const script_result& get_result(std::size_t index) const;
+
+ private:
+    struct script
+    {
+        // Released once the script finished
+        std::unique_ptr<register_machine> machine;
+        int                               input_file;
+        bool                              is_watched;
+        script_result                     result;
+    };
+
+    // Variables
+    script_scheduler_options options;
+    int                      epoll;
+    std::vector<script>      scripts;
+    // Scripts in the order they take their next turn
+    std::deque<std::size_t>  ready;
+    std::vector<epoll_event> events;
+    std::size_t              n_running;
+
+    // Methods
+    std::size_t add_machine(std::unique_ptr<register_machine> machine,
+                            int                               input_file,
+                            int                               output_file);
+    void        take_turn(std::size_t index);
+    void        watch(std::size_t index);
+    void        finish(std::size_t index, script_result result);
+};
+#endif
@@ -0,0 +1,369 @@
+// Copyright © 2021-2022 Jonas Muehlmann
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include "worker_pool.hpp"
+
+#ifdef MVPL_WORKER_POOL
+#    include <algorithm>
+#    include <cerrno>
+#    include <cstdlib>
+#    include <fstream>
+#    include <iostream>
+#    include <stdexcept>
+#    include <string>
+#    include <vector>
+
+#    include <poll.h>
+#    include <sys/uio.h>
+#    include <sys/wait.h>
+#    include <unistd.h>
+
+namespace
+{
+// Written at once, so that a record is never split between workers
+struct job_record
+{
+    std::uint64_t job;
+};
+
+struct result_header
+{
+    std::uint64_t job;
+    value_t       value;
+    std::uint64_t output_size;
+    std::uint64_t error_size;
+    std::uint8_t  succeeded;
+};
+
+static_assert(sizeof(job_record) <= PIPE_BUF);
+
+iovec make_piece(const void* data, std::size_t size)
+{
+    return {const_cast<void*>(data), size};
+}
+
+// Writes the pieces one after the other, with a single system call unless the pipe fills up
+void write_all(int file, std::vector<iovec> pieces)
+{
+    auto*       piece = pieces.data();
+    auto* const end   = piece + pieces.size();
+
+    while (piece != end)
+    {
+        const auto written = writev(file, piece, static_cast<int>(end - piece));
+
+        if (written < 0)
+        {
+            if (errno != EINTR)
+            {
+                throw std::runtime_error("Could not write to a worker pipe");
+            }
+
+            continue;
+        }
+
+        // Skips the pieces written completely and the written part of the next one
+        auto remaining = static_cast<std::size_t>(written);
+
+        for (; piece != end && remaining >= piece->iov_len; ++piece)
+        {
+            remaining -= piece->iov_len;
+        }
+
+        if (piece != end)
+        {
+            piece->iov_base = static_cast<char*>(piece->iov_base) + remaining;
+            piece->iov_len -= remaining;
+        }
+    }
+}
+
+// Returns false if the other end was closed before anything was read
+bool read_all(int file, void* data, std::size_t size)
+{
+    auto* bytes = static_cast<char*>(data);
+
+    for (std::size_t done = 0; done < size;)
+    {
+        const auto n_read = read(file, bytes + done, size - done);
+
+        if (n_read == 0 && done == 0)
+        {
+            return false;
+        }
+        if ((n_read < 0 && errno != EINTR) || n_read == 0)
+        {
+            throw std::runtime_error("Could not read from a worker pipe");
+        }
+        if (n_read > 0)
+        {
+            done += static_cast<std::size_t>(n_read);
+        }
+    }
+
+    return true;
+}
+
+// Sums the fields of /proc/<pid>/smaps_rollup, which are given in KiB
+worker_memory read_memory(pid_t pid)
+{
+    worker_memory memory{pid, 0, 0, 0, 0};
+    std::ifstream rollup("/proc/" + std::to_string(pid) + "/smaps_rollup");
+
+    for (std::string line; std::getline(rollup, line);)
+    {
+        std::istringstream fields(line);
+        std::string        field;
+        std::uint64_t      kibibytes = 0;
+
+        if (!(fields >> field >> kibibytes))
+        {
+            continue;
+        }
+
+        const auto bytes = kibibytes * 1024;
+
+        if (field == "Private_Clean:" || field == "Private_Dirty:")
+        {
+            memory.private_bytes += bytes;
+        }
+        else if (field == "Shared_Clean:" || field == "Shared_Dirty:")
+        {
+            memory.shared_bytes += bytes;
+        }
+        else if (field == "Pss:")
+        {
+            memory.proportional_bytes = bytes;
+        }
+    }
+
+    return memory;
+}
+}    // namespace
+
+worker_pool::worker_pool(const bytecode_image& image, const worker_pool_options& options) :
+    workers{}, queue{-1}
+{
+    int queue_pipe[2];
+
+    if (pipe(queue_pipe) != 0)
+    {
+        throw std::runtime_error("Could not create the job queue");
+    }
+
+    queue = queue_pipe[1];
+
+    // Everything the workers only read is set up once and shared after forking
+    std::ostringstream output;
+    register_machine   vm(image.get_program(), output, options.jit, options.stack_limit);
+
+    try
+    {
+        vm.prepare();
+
+        // Buffered output would otherwise be written by every worker as well
+        std::cout.flush();
+        std::cerr.flush();
+
+        for (std::size_t i = 0; i < std::max<std::size_t>(options.n_workers, 1); ++i)
+        {
+            int result_pipe[2];
+
+            if (pipe(result_pipe) != 0)
+            {
+                throw std::runtime_error("Could not create a result pipe");
+            }
+
+            const pid_t pid = fork();
+
+            if (pid < 0)
+            {
+                close(result_pipe[0]);
+                close(result_pipe[1]);
+
+                throw std::runtime_error("Could not fork a worker");
+            }
+
+            if (pid == 0)
+            {
+                // The worker keeps only its own ends of the pipes
+                close(queue);
+                close(result_pipe[0]);
+
+                for (const auto& other : workers)
+                {
+                    close(other.results);
+                }
+
+                serve(vm, output, queue_pipe[0], result_pipe[1]);
+            }
+
+            close(result_pipe[1]);
+            workers.push_back({pid, result_pipe[0], 0});
+        }
+    }
+    catch (...)
+    {
+        close(queue_pipe[0]);
+        shut_down();
+
+        throw;
+    }
+
+    close(queue_pipe[0]);
+}
+
+worker_pool::~worker_pool()
+{
+    shut_down();
+}
+
+void worker_pool::submit(std::uint64_t job)
+{
+    const job_record record{job};
+
+    write_all(queue, {make_piece(&record, sizeof(record))});
+}
+
+job_result worker_pool::wait_result()
+{
+    std::vector<pollfd> files;
+
+    for (const auto& worker : workers)
+    {
+        files.push_back({worker.results, POLLIN, 0});
+    }
+
+    while (poll(files.data(), files.size(), -1) < 0)
+    {
+        if (errno != EINTR)
+        {
+            throw std::runtime_error("Could not wait for the workers");
+        }
+    }
+
+    const auto ready = std::ranges::find_if(
+        files, [](const pollfd& file) { return (file.revents & (POLLIN | POLLHUP)) != 0; });
+    const auto index = static_cast<std::size_t>(ready - files.begin());
+
+    result_header header{};
+
+    if (ready == files.end() || !read_all(ready->fd, &header, sizeof(header)))
+    {
+        throw std::runtime_error("Worker " + std::to_string(index) + " died");
+    }
+
+    job_result result{header.job, index, header.succeeded != 0, header.value, {}, {}};
+
+    result.output.resize(header.output_size);
+    result.error.resize(header.error_size);
+
+    if (!read_all(ready->fd, result.output.data(), result.output.size())
+        || !read_all(ready->fd, result.error.data(), result.error.size()))
+    {
+        throw std::runtime_error("Worker " + std::to_string(index) + " died");
+    }
+
+    ++workers[index].jobs;
+
+    return result;
+}
+
+std::size_t worker_pool::get_n_workers() const
+{
+    return workers.size();
+}
+
+std::vector<worker_memory> worker_pool::get_memory() const
+{
+    std::vector<worker_memory> memory;
+
+    for (const auto& worker : workers)
+    {
+        memory.push_back(read_memory(worker.pid));
+        memory.back().jobs = worker.jobs;
+    }
+
+    return memory;
+}
+
+void worker_pool::serve(register_machine&   vm,
+                        std::ostringstream& output,
+                        int                 job_queue,
+                        int                 result_pipe)
+{
+    // Leaves with _exit, so that nothing of the supervisor is destructed or flushed twice
+    try
+    {
+        for (job_record record{}; read_all(job_queue, &record, sizeof(record));)
+        {
+            result_header header{record.job, 0, 0, 0, 1};
+            std::string   error;
+
+            output.str({});
+
+            try
+            {
+                header.value = vm.run();
+            }
+            catch (const std::exception& exception)
+            {
+                header.succeeded = 0;
+                error            = exception.what();
+            }
+
+            const auto text    = output.str();
+            header.output_size = text.size();
+            header.error_size  = error.size();
+
+            write_all(result_pipe,
+                      {make_piece(&header, sizeof(header)),
+                       make_piece(text.data(), text.size()),
+                       make_piece(error.data(), error.size())});
+        }
+    }
+    catch (...)
+    {
+        _exit(EXIT_FAILURE);
+    }
+
+    _exit(EXIT_SUCCESS);
+}
+
+void worker_pool::shut_down()
+{
+    // Workers exit once the queue is empty and closed
+    if (queue != -1)
+    {
+        close(queue);
+        queue = -1;
+    }
+
+    for (auto& worker : workers)
+    {
+        close(worker.results);
+
+        while (waitpid(worker.pid, nullptr, 0) < 0 && errno == EINTR)
+        {
+        }
+    }
+
+    workers.clear();
+}
+#endif
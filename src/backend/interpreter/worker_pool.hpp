@@ -0,0 +1,120 @@
+// Copyright © 2021-2022 Jonas Muehlmann
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "backend/bytecode_image.hpp"
+#include "backend/value.hpp"
+#include "jit_compiler.hpp"
+#include "register_machine.hpp"
+
+// Forking needs POSIX, elsewhere there is no worker pool
+#ifdef __unix__
+#    define MVPL_WORKER_POOL
+#    include <sys/types.h>
+#endif
+
+#ifdef MVPL_WORKER_POOL
+struct worker_pool_options
+{
+    std::size_t n_workers{1};
+    std::size_t stack_limit{register_machine::DEFAULT_STACK_LIMIT};
+    jit_options jit{default_jit_options()};
+};
+
+struct job_result
+{
+    std::uint64_t job;
+    std::size_t   worker;
+    // False if the run threw, error holds the message then
+    bool          succeeded;
+    value_t       value;
+    std::string   output;
+    std::string   error;
+};
+
+// Resident memory of a worker in bytes, as accounted by the kernel (Linux' smaps_rollup).
+// Shared memory is mapped by other processes as well, i.e. the image and pages not written
+// since the fork. Everything is 0 where the kernel does not provide the numbers.
+struct worker_memory
+{
+    pid_t         pid;
+    std::size_t   jobs;
+    std::uint64_t private_bytes;
+    std::uint64_t shared_bytes;
+    // Proportional set size: private memory plus a share of the shared memory
+    std::uint64_t proportional_bytes;
+};
+
+// A supervisor forking worker processes, which run the program of an image whenever a job
+// is submitted. The image stays a shared, file backed mapping and the register machine is
+// set up and decoded before forking, so that a worker's own memory consists of what it
+// writes while running: its stacks, the output and the JIT's machine code.
+//
+// Jobs are queued through a pipe all workers read from, whichever is idle takes the next
+// one. Each worker sends its results back through its own pipe. Submitting blocks while
+// the queue is full, which happens with thousands of jobs outstanding, so callers should
+// collect results in between.
+class worker_pool
+{
+ public:
+    // Methods
+    // Throws std::runtime_error if the processes or pipes can not be created
+    worker_pool(const bytecode_image& image, const worker_pool_options& options);
+    // Waits for the workers to finish the queued jobs and exit, results are discarded
+    ~worker_pool();
+
+    worker_pool(const worker_pool&)            = delete;
+    worker_pool& operator=(const worker_pool&) = delete;
+
+    void submit(std::uint64_t job);
+    // Blocks until any worker finished a job, throws std::runtime_error if a worker died
+    job_result wait_result();
+
+    [[nodiscard]] std::size_t                get_n_workers() const;
+    [[nodiscard]] std::vector<worker_memory> get_memory() const;
+
+ private:
+    struct worker_process
+    {
+        pid_t       pid;
+        // Read end of the worker's result pipe
+        int         results;
+        std::size_t jobs;
+    };
+
+    // Variables
+    std::vector<worker_process> workers;
+    // Write end of the job queue
+    int                         queue;
+
+    // Methods
+    [[noreturn]] static void serve(register_machine&   vm,
+                                   std::ostringstream& output,
+                                   int                 job_queue,
+                                   int                 result_pipe);
+    void                     shut_down();
+};
+#endif
@@ -0,0 +1,157 @@
+// Copyright © 2021-2022 Jonas Muehlmann
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include "cleanup_passes.hpp"
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "dominator_tree.hpp"
+
+std::size_t remove_unreachable_blocks(ir_function& function)
+{
+    std::vector<bool> removed(function.blocks.size(), true);
+
+    for (auto block : compute_reverse_postorder(function))
+    {
+        removed[block] = false;
+    }
+
+    auto n_removed = static_cast<std::size_t>(std::ranges::count(removed, true));
+
+    if (n_removed != 0)
+    {
+        remove_blocks(function, removed);
+    }
+
+    return n_removed;
+}
+
+std::size_t remove_trivial_phis(ir_function& function)
+{
+    std::size_t n_removed = 0;
+
+    for (bool changed = true; changed;)
+    {
+        changed = false;
+
+        std::vector<ir_value_id> replacements(function.n_values, NO_VALUE);
+
+        for (auto& block : function.blocks)
+        {
+            std::erase_if(block.instructions, [&](const ir_instruction& instruction) {
+                if (instruction.op != ir_opcode::PHI)
+                {
+                    return false;
+                }
+
+                auto same = NO_VALUE;
+
+                for (auto operand : instruction.operands)
+                {
+                    if (operand == instruction.result || operand == same)
+                    {
+                        continue;
+                    }
+                    if (same != NO_VALUE)
+                    {
+                        return false;
+                    }
+                    same = operand;
+                }
+
+                // A phi only using itself is never executed with a defined value
+                if (same == NO_VALUE)
+                {
+                    return false;
+                }
+
+                replacements[instruction.result] = same;
+                ++n_removed;
+                changed = true;
+
+                return true;
+            });
+        }
+
+        if (changed)
+        {
+            replace_values(function, std::move(replacements));
+        }
+    }
+
+    return n_removed;
+}
+
+std::size_t eliminate_dead_values(ir_function& function)
+{
+    std::vector<const ir_instruction*> definitions(function.n_values, nullptr);
+    std::vector<bool>                  live(function.n_values);
+    std::vector<ir_value_id>           worklist;
+
+    auto mark = [&](const ir_instruction& instruction) {
+        for (auto operand : instruction.operands)
+        {
+            if (!live[operand])
+            {
+                live[operand] = true;
+                worklist.push_back(operand);
+            }
+        }
+    };
+
+    for (const auto& block : function.blocks)
+    {
+        for (const auto& instruction : block.instructions)
+        {
+            if (instruction.result != NO_VALUE)
+            {
+                definitions[instruction.result] = &instruction;
+            }
+            if (has_side_effects(instruction.op))
+            {
+                mark(instruction);
+            }
+        }
+    }
+
+    while (!worklist.empty())
+    {
+        auto value = worklist.back();
+        worklist.pop_back();
+
+        if (definitions[value] != nullptr)
+        {
+            mark(*definitions[value]);
+        }
+    }
+
+    std::size_t n_removed = 0;
+
+    for (auto& block : function.blocks)
+    {
+        n_removed += std::erase_if(block.instructions, [&live](const ir_instruction& instruction) {
+            return !has_side_effects(instruction.op) && instruction.result != NO_VALUE
+                   && !live[instruction.result];
+        });
+    }
+
+    return n_removed;
+}
@@ -0,0 +1,38 @@
+// Copyright © 2021-2022 Jonas Muehlmann
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#pragma once
+
+#include <cstddef>
+
+#include "ir.hpp"
+
+// Function passes, which keep the IR in shape for the other passes and the lowering. Each
+// returns the number of changes it made.
+
+// Removes blocks, which can not be reached from the entry block
+std::size_t remove_unreachable_blocks(ir_function& function);
+
+// Replaces phis whose operands are all the same value (ignoring the phi itself) by that
+// value, until none are left
+std::size_t remove_trivial_phis(ir_function& function);
+
+// Removes instructions without side effects, whose results are never used, including cycles
+// of phis only using each other
+std::size_t eliminate_dead_values(ir_function& function);
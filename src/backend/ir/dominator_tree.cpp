@@ -0,0 +1,181 @@
+// Copyright © 2021-2022 Jonas Muehlmann
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include "dominator_tree.hpp"
+
+#include <utility>
+
+std::vector<ir_block_id> compute_reverse_postorder(const ir_function& function)
+{
+    std::vector<ir_block_id> postorder;
+    std::vector<bool>        visited(function.blocks.size());
+
+    // Iterative depth first search, the second member is the next successor to visit
+    std::vector<std::pair<ir_block_id, std::size_t>> stack{{0, 0}};
+    visited[0] = true;
+
+    while (!stack.empty())
+    {
+        auto& [block, next] = stack.back();
+        const auto& successors = function.blocks[block].successors;
+
+        if (next < successors.size())
+        {
+            auto successor = successors[next++];
+
+            if (!visited[successor])
+            {
+                visited[successor] = true;
+                stack.emplace_back(successor, 0);
+            }
+            continue;
+        }
+
+        postorder.push_back(block);
+        stack.pop_back();
+    }
+
+    return {postorder.rbegin(), postorder.rend()};
+}
+
+dominator_tree::dominator_tree(const ir_function& function)
+    : immediate_dominators(function.blocks.size(), NO_BLOCK),
+      children(function.blocks.size()),
+      reverse_postorder(compute_reverse_postorder(function)),
+      enter(function.blocks.size()),
+      leave(function.blocks.size())
+{
+    std::vector<std::size_t> order(function.blocks.size(), 0);
+
+    for (std::size_t i = 0; i < reverse_postorder.size(); ++i)
+    {
+        order[reverse_postorder[i]] = i;
+    }
+
+    auto intersect = [&](ir_block_id a, ir_block_id b) {
+        while (a != b)
+        {
+            while (order[a] > order[b])
+            {
+                a = immediate_dominators[a];
+            }
+            while (order[b] > order[a])
+            {
+                b = immediate_dominators[b];
+            }
+        }
+
+        return a;
+    };
+
+    // The entry block temporarily dominates itself, which terminates intersect
+    immediate_dominators[0] = 0;
+
+    for (bool changed = true; changed;)
+    {
+        changed = false;
+
+        for (auto block : reverse_postorder)
+        {
+            if (block == 0)
+            {
+                continue;
+            }
+
+            auto dominator = NO_BLOCK;
+
+            for (auto predecessor : function.blocks[block].predecessors)
+            {
+                if (immediate_dominators[predecessor] == NO_BLOCK)
+                {
+                    continue;
+                }
+                dominator =
+                    dominator == NO_BLOCK ? predecessor : intersect(predecessor, dominator);
+            }
+
+            if (dominator != immediate_dominators[block])
+            {
+                immediate_dominators[block] = dominator;
+                changed                     = true;
+            }
+        }
+    }
+
+    immediate_dominators[0] = NO_BLOCK;
+
+    for (auto block : reverse_postorder)
+    {
+        if (block != 0)
+        {
+            children[immediate_dominators[block]].push_back(block);
+        }
+    }
+
+    // Number the tree in preorder
+    std::size_t                                      counter = 0;
+    std::vector<std::pair<ir_block_id, std::size_t>> stack{{0, 0}};
+    enter[0] = counter++;
+
+    while (!stack.empty())
+    {
+        auto& [block, next] = stack.back();
+
+        if (next < children[block].size())
+        {
+            auto child   = children[block][next++];
+            enter[child] = counter++;
+            stack.emplace_back(child, 0);
+            continue;
+        }
+
+        leave[block] = counter;
+        stack.pop_back();
+    }
+}
+
+ir_block_id dominator_tree::get_immediate_dominator(ir_block_id block) const
+{
+    return immediate_dominators[block];
+}
+
+const std::vector<ir_block_id>& dominator_tree::get_children(ir_block_id block) const
+{
+    return children[block];
+}
+
+const std::vector<ir_block_id>& dominator_tree::get_reverse_postorder() const
+{
+    return reverse_postorder;
+}
+
+bool dominator_tree::is_reachable(ir_block_id block) const
+{
+    return block == 0 || immediate_dominators[block] != NO_BLOCK;
+}
+
+bool dominator_tree::dominates(ir_block_id a, ir_block_id b) const
+{
+    if (!is_reachable(a) || !is_reachable(b))
+    {
+        return false;
+    }
+
+    return enter[a] <= enter[b] && leave[b] <= leave[a];
+}
@@ -0,0 +1,61 @@
+// Copyright © 2021-2022 Jonas Muehlmann
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "ir.hpp"
+
+// Blocks reachable from the entry block in reverse postorder, so every block comes before
+// its successors, except along back edges.
+std::vector<ir_block_id> compute_reverse_postorder(const ir_function& function);
+
+// Immediate dominators of all reachable blocks, computed with the iterative algorithm by
+// Cooper, Harvey and Kennedy. Block a dominates block b if every path from the entry block
+// to b passes through a.
+class dominator_tree
+{
+ public:
+    // Methods
+    explicit dominator_tree(const ir_function& function);
+
+    // NO_BLOCK for the entry block and unreachable blocks
+    [[nodiscard]] ir_block_id get_immediate_dominator(ir_block_id block) const;
+
+    [[nodiscard]] const std::vector<ir_block_id>& get_children(ir_block_id block) const;
+
+    [[nodiscard]] const std::vector<ir_block_id>& get_reverse_postorder() const;
+
+    [[nodiscard]] bool is_reachable(ir_block_id block) const;
+
+    // Every block dominates itself
+    [[nodiscard]] bool dominates(ir_block_id a, ir_block_id b) const;
+
+ private:
+    // Variables
+    std::vector<ir_block_id>              immediate_dominators;
+    std::vector<std::vector<ir_block_id>> children;
+    std::vector<ir_block_id>              reverse_postorder;
+    // Preorder interval of every block in the tree, a dominates b if b's interval is nested
+    // in a's
+    std::vector<std::size_t>              enter;
+    std::vector<std::size_t>              leave;
+};
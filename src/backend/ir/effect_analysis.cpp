@@ -0,0 +1,144 @@
+// Copyright © 2021-2022 Jonas Muehlmann
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include "effect_analysis.hpp"
+
+#include <cstddef>
+
+#include "dominator_tree.hpp"
+#include "loop_info.hpp"
+
+std::vector<function_effects> analyze_effects(const ir_program& program)
+{
+    const auto n_functions = program.functions.size();
+
+    std::vector<function_effects> effects(n_functions);
+
+    // Procedures are only ever called for their side effects
+    for (std::size_t i = 0; i < n_functions; ++i)
+    {
+        effects[i].pure = program.functions[i].returns_value;
+    }
+
+    // Functions are pure, until they turn out to print or to call an impure function
+    for (bool changed = true; changed;)
+    {
+        changed = false;
+
+        for (std::size_t i = 0; i < n_functions; ++i)
+        {
+            if (!effects[i].pure)
+            {
+                continue;
+            }
+
+            for (const auto& block : program.functions[i].blocks)
+            {
+                for (const auto& instruction : block.instructions)
+                {
+                    if (instruction.op == ir_opcode::BUILTIN
+                        || (instruction.op == ir_opcode::CALL
+                            && !effects[static_cast<std::size_t>(instruction.immediate)].pure))
+                    {
+                        effects[i].pure = false;
+                        changed         = true;
+                    }
+                }
+            }
+        }
+    }
+
+    // Functions only become total once all their callees are, so recursive functions never do
+    for (bool changed = true; changed;)
+    {
+        changed = false;
+
+        for (std::size_t i = 0; i < n_functions; ++i)
+        {
+            const auto& function = program.functions[i];
+
+            if (!effects[i].pure || effects[i].total)
+            {
+                continue;
+            }
+
+            dominator_tree dominators(function);
+
+            if (!loop_info(function, dominators).get_loops().empty())
+            {
+                continue;
+            }
+
+            const auto constants = collect_constants(function);
+            bool       total     = true;
+
+            for (const auto& block : function.blocks)
+            {
+                for (const auto& instruction : block.instructions)
+                {
+                    if (can_trap(instruction, constants)
+                        || (instruction.op == ir_opcode::CALL
+                            && !effects[static_cast<std::size_t>(instruction.immediate)].total))
+                    {
+                        total = false;
+                    }
+                }
+            }
+
+            if (total)
+            {
+                effects[i].total = true;
+                changed          = true;
+            }
+        }
+    }
+
+    return effects;
+}
+
+std::vector<std::optional<value_t>> collect_constants(const ir_function& function)
+{
+    std::vector<std::optional<value_t>> constants(function.n_values);
+
+    for (const auto& block : function.blocks)
+    {
+        for (const auto& instruction : block.instructions)
+        {
+            if (instruction.op == ir_opcode::CONSTANT)
+            {
+                constants[instruction.result] = instruction.immediate;
+            }
+        }
+    }
+
+    return constants;
+}
+
+bool can_trap(const ir_instruction&                        instruction,
+              const std::vector<std::optional<value_t>>& constants)
+{
+    if (instruction.op != ir_opcode::DIV && instruction.op != ir_opcode::MOD)
+    {
+        return false;
+    }
+
+    const auto& divisor = constants[instruction.operands[1]];
+
+    return !divisor.has_value() || *divisor == 0;
+}
@@ -0,0 +1,47 @@
+// Copyright © 2021-2022 Jonas Muehlmann
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#pragma once
+
+#include <optional>
+#include <vector>
+
+#include "backend/value.hpp"
+#include "ir.hpp"
+
+// What calling a function can do besides computing its return value
+struct function_effects
+{
+    // A function, which neither prints nor calls a procedure or an impure function. Pure
+    // functions may still trap or not terminate.
+    bool pure{};
+    // Pure, without loops, recursion or instructions, which can trap, so a call can be
+    // executed speculatively
+    bool total{};
+};
+
+// Effects of every function of the program, indexed like program.functions
+std::vector<function_effects> analyze_effects(const ir_program& program);
+
+// Value of every value defined by a CONSTANT instruction
+std::vector<std::optional<value_t>> collect_constants(const ir_function& function);
+
+// Division and modulo trap, unless their divisor is a nonzero constant
+bool can_trap(const ir_instruction&                        instruction,
+              const std::vector<std::optional<value_t>>& constants);
@@ -0,0 +1,369 @@
+// Copyright © 2021-2022 Jonas Muehlmann
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include "inliner.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <utility>
+#include <vector>
+
+#include "cleanup_passes.hpp"
+#include "dominator_tree.hpp"
+#include "loop_info.hpp"
+
+namespace
+{
+struct call_site
+{
+    ir_block_id block;
+    std::size_t index;
+    std::size_t callee;
+    std::size_t loop_depth;
+};
+
+std::size_t count_instructions(const ir_function& function)
+{
+    std::size_t size = 0;
+
+    for (const auto& block : function.blocks)
+    {
+        size += static_cast<std::size_t>(
+            std::ranges::count_if(block.instructions, [](const ir_instruction& instruction) {
+                return instruction.op != ir_opcode::PARAMETER;
+            }));
+    }
+
+    return size;
+}
+
+// Strongly connected components of the call graph with Tarjan's algorithm, which finds them
+// callees first
+std::vector<std::vector<std::size_t>> find_call_graph_components(const ir_program& program)
+{
+    const auto n_functions = program.functions.size();
+
+    std::vector<std::vector<std::size_t>> callees(n_functions);
+
+    for (std::size_t caller = 0; caller < n_functions; ++caller)
+    {
+        for (const auto& block : program.functions[caller].blocks)
+        {
+            for (const auto& instruction : block.instructions)
+            {
+                if (instruction.op == ir_opcode::CALL)
+                {
+                    callees[caller].push_back(static_cast<std::size_t>(instruction.immediate));
+                }
+            }
+        }
+    }
+
+    std::vector<std::vector<std::size_t>> components;
+    std::vector<std::size_t>              index(n_functions, 0);
+    std::vector<std::size_t>              low_link(n_functions, 0);
+    std::vector<bool>                     on_stack(n_functions);
+    std::vector<std::size_t>              stack;
+    std::size_t                           counter = 1;
+
+    std::function<void(std::size_t)> visit = [&](std::size_t function) {
+        index[function] = low_link[function] = counter++;
+        stack.push_back(function);
+        on_stack[function] = true;
+
+        for (auto callee : callees[function])
+        {
+            if (index[callee] == 0)
+            {
+                visit(callee);
+                low_link[function] = std::min(low_link[function], low_link[callee]);
+            }
+            else if (on_stack[callee])
+            {
+                low_link[function] = std::min(low_link[function], index[callee]);
+            }
+        }
+
+        if (low_link[function] == index[function])
+        {
+            auto&       component = components.emplace_back();
+            std::size_t member    = 0;
+
+            do
+            {
+                member = stack.back();
+                stack.pop_back();
+                on_stack[member] = false;
+                component.push_back(member);
+            } while (member != function);
+        }
+    };
+
+    for (std::size_t function = 0; function < n_functions; ++function)
+    {
+        if (index[function] == 0)
+        {
+            visit(function);
+        }
+    }
+
+    return components;
+}
+
+// Inlines the call at caller.blocks[site.block].instructions[site.index]. Returns the blocks,
+// which follow site.block in the layout: the callee's blocks and the continuation.
+std::vector<ir_block_id> inline_call(ir_function&       caller,
+                                     const call_site&   site,
+                                     const ir_function& callee)
+{
+    auto& blocks = caller.blocks;
+    auto  call   = blocks[site.block].instructions[site.index];
+
+    // The code after the call moves to a new block together with the outgoing edges
+    auto  continuation = caller.new_block();
+    auto& source       = blocks[site.block].instructions;
+
+    blocks[continuation].instructions.assign(
+        std::make_move_iterator(source.begin() + static_cast<std::ptrdiff_t>(site.index) + 1),
+        std::make_move_iterator(source.end()));
+    source.erase(source.begin() + static_cast<std::ptrdiff_t>(site.index), source.end());
+
+    blocks[continuation].successors = std::exchange(blocks[site.block].successors, {});
+
+    for (auto successor : blocks[continuation].successors)
+    {
+        std::ranges::replace(blocks[successor].predecessors, site.block, continuation);
+    }
+
+    // Callee values are renamed by an offset, except for parameters, which become the
+    // arguments
+    const auto block_offset = static_cast<ir_block_id>(blocks.size());
+    const auto value_offset = static_cast<ir_value_id>(caller.n_values);
+
+    std::vector<ir_value_id> renamed(callee.n_values);
+
+    for (ir_value_id value = 0; value < callee.n_values; ++value)
+    {
+        renamed[value] = value_offset + value;
+    }
+    for (const auto& instruction : callee.blocks[0].instructions)
+    {
+        if (instruction.op == ir_opcode::PARAMETER)
+        {
+            auto parameter = static_cast<std::size_t>(instruction.immediate);
+
+            renamed[instruction.result] = call.operands[parameter];
+        }
+    }
+    caller.n_values += callee.n_values;
+
+    std::vector<ir_block_id> layout;
+    std::vector<ir_value_id> return_values;
+
+    for (ir_block_id id = 0; id < callee.blocks.size(); ++id)
+    {
+        auto  copy  = caller.new_block();
+        auto& block = blocks[copy];
+
+        layout.push_back(copy);
+
+        for (auto predecessor : callee.blocks[id].predecessors)
+        {
+            block.predecessors.push_back(block_offset + predecessor);
+        }
+        for (auto successor : callee.blocks[id].successors)
+        {
+            block.successors.push_back(block_offset + successor);
+        }
+
+        for (auto instruction : callee.blocks[id].instructions)
+        {
+            if (instruction.op == ir_opcode::PARAMETER)
+            {
+                continue;
+            }
+
+            for (auto& operand : instruction.operands)
+            {
+                operand = renamed[operand];
+            }
+            if (instruction.result != NO_VALUE)
+            {
+                instruction.result = renamed[instruction.result];
+            }
+
+            // Returns continue after the call
+            if (instruction.op == ir_opcode::RET)
+            {
+                return_values.push_back(instruction.operands[0]);
+                instruction = {ir_opcode::JUMP, NO_VALUE, {}, 0};
+                block.successors.push_back(continuation);
+                blocks[continuation].predecessors.push_back(copy);
+            }
+
+            block.instructions.push_back(std::move(instruction));
+        }
+    }
+
+    blocks[site.block].instructions.push_back({ir_opcode::JUMP, NO_VALUE, {}, 0});
+    add_edge(caller, site.block, block_offset);
+
+    // The result of the call is defined by a phi over the returned values
+    auto& instructions = blocks[continuation].instructions;
+
+    instructions.insert(instructions.begin(),
+                        {ir_opcode::PHI, call.result, std::move(return_values), 0});
+
+    layout.push_back(continuation);
+
+    return layout;
+}
+
+// Picks the call sites to inline, most frequent and smallest callees first
+std::vector<call_site> select_call_sites(const ir_program&               program,
+                                         std::size_t                     caller_index,
+                                         const std::vector<std::size_t>& component_of,
+                                         const inliner_options&          options)
+{
+    const auto&    caller = program.functions[caller_index];
+    dominator_tree dominators(caller);
+    loop_info      loops(caller, dominators);
+
+    std::vector<call_site>   candidates;
+    std::vector<std::size_t> sizes(program.functions.size(), 0);
+
+    for (ir_block_id block = 0; block < caller.blocks.size(); ++block)
+    {
+        const auto& instructions = caller.blocks[block].instructions;
+
+        for (std::size_t i = 0; i < instructions.size(); ++i)
+        {
+            if (instructions[i].op != ir_opcode::CALL)
+            {
+                continue;
+            }
+
+            auto callee = static_cast<std::size_t>(instructions[i].immediate);
+
+            if (component_of[callee] != component_of[caller_index])
+            {
+                candidates.push_back({block, i, callee, loops.get_depth(block)});
+                sizes[callee] = count_instructions(program.functions[callee]);
+            }
+        }
+    }
+
+    std::ranges::stable_sort(candidates, [&sizes](const call_site& a, const call_site& b) {
+        return a.loop_depth != b.loop_depth ? a.loop_depth > b.loop_depth
+                                            : sizes[a.callee] < sizes[b.callee];
+    });
+
+    auto caller_size = count_instructions(caller);
+    auto budget      = std::max(options.min_growth, caller_size * options.max_growth_percent / 100);
+
+    std::vector<call_site> selected;
+
+    for (const auto& site : candidates)
+    {
+        auto size  = sizes[site.callee];
+        auto limit = site.loop_depth > 0 ? options.max_hot_callee_size : options.max_callee_size;
+
+        if (size <= limit && size <= budget)
+        {
+            budget -= size;
+            selected.push_back(site);
+        }
+    }
+
+    return selected;
+}
+
+std::size_t inline_into(ir_program&                     program,
+                        std::size_t                     caller_index,
+                        const std::vector<std::size_t>& component_of,
+                        const inliner_options&          options)
+{
+    auto  sites  = select_call_sites(program, caller_index, component_of, options);
+    auto& caller = program.functions[caller_index];
+
+    if (sites.empty())
+    {
+        return 0;
+    }
+
+    // Inlining splits blocks and appends new ones, so the sites of a block are inlined back
+    // to front to keep the earlier positions valid
+    std::ranges::sort(sites, [](const call_site& a, const call_site& b) {
+        return a.block != b.block ? a.block < b.block : a.index > b.index;
+    });
+
+    const auto n_blocks = caller.blocks.size();
+
+    std::vector<std::vector<ir_block_id>> inserted_after(n_blocks);
+
+    for (const auto& site : sites)
+    {
+        auto  layout = inline_call(caller, site, program.functions[site.callee]);
+        auto& after  = inserted_after[site.block];
+
+        after.insert(after.begin(), layout.begin(), layout.end());
+    }
+
+    std::vector<ir_block_id> order;
+
+    for (ir_block_id block = 0; block < n_blocks; ++block)
+    {
+        order.push_back(block);
+        order.insert(order.end(), inserted_after[block].begin(), inserted_after[block].end());
+    }
+
+    reorder_blocks(caller, order);
+    remove_unreachable_blocks(caller);
+    remove_trivial_phis(caller);
+
+    return sites.size();
+}
+}    // namespace
+
+std::size_t inline_calls(ir_program& program, const inliner_options& options)
+{
+    auto components = find_call_graph_components(program);
+
+    std::vector<std::size_t> component_of(program.functions.size());
+
+    for (std::size_t i = 0; i < components.size(); ++i)
+    {
+        for (auto function : components[i])
+        {
+            component_of[function] = i;
+        }
+    }
+
+    std::size_t n_inlined = 0;
+
+    for (const auto& component : components)
+    {
+        for (auto function : component)
+        {
+            n_inlined += inline_into(program, function, component_of, options);
+        }
+    }
+
+    return n_inlined;
+}
@@ -0,0 +1,44 @@
+// Copyright © 2021-2022 Jonas Muehlmann
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#pragma once
+
+#include <cstddef>
+
+#include "ir.hpp"
+
+struct inliner_options
+{
+    // Callees with up to this many instructions are inlined everywhere
+    std::size_t max_callee_size{16};
+    // Larger limit for call sites inside loops, which execute more often
+    std::size_t max_hot_callee_size{64};
+    // Every function may grow by this percentage of its size or by min_growth instructions,
+    // whichever is larger
+    std::size_t max_growth_percent{100};
+    std::size_t min_growth{64};
+};
+
+// Replaces calls by a copy of the callee's body: parameters become the arguments, every
+// other value of the callee is renamed and returns jump to the code after the call, where a
+// phi collects the return value. Call sites are considered by estimated frequency (loop
+// nesting depth) and callee size, until the caller's growth budget is used up.
+// Functions are processed callees first, so inlined bodies are already optimized. Calls
+// within a cycle of the call graph are never inlined. Returns the number of inlined calls.
+std::size_t inline_calls(ir_program& program, const inliner_options& options = {});
@@ -0,0 +1,365 @@
+// Copyright © 2021-2022 Jonas Muehlmann
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include "ir.hpp"
+
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+
+#include "backend/interpreter/builtin_functions.hpp"
+#include "backend/opcode.hpp"
+
+//****************************************************************************//
+//                                  Opcodes                                   //
+//****************************************************************************//
+bool is_terminator(ir_opcode op)
+{
+    return op == ir_opcode::JUMP || op == ir_opcode::BRANCH || op == ir_opcode::SWITCH
+           || op == ir_opcode::RET;
+}
+
+bool has_result(ir_opcode op, value_t immediate)
+{
+    if (op == ir_opcode::BUILTIN)
+    {
+        auto builtin = find_builtin_function(static_cast<opcode>(immediate));
+
+        return builtin && builtin->returns_value;
+    }
+
+    return !is_terminator(op);
+}
+
+bool has_side_effects(ir_opcode op)
+{
+    switch (op)
+    {
+        case ir_opcode::DIV:
+        case ir_opcode::MOD:
+        case ir_opcode::CALL:
+        case ir_opcode::BUILTIN:
+        case ir_opcode::JUMP:
+        case ir_opcode::BRANCH:
+        case ir_opcode::SWITCH:
+        case ir_opcode::RET:
+            return true;
+        default:
+            return false;
+    }
+}
+
+ir_condition negate_condition(ir_condition condition)
+{
+    switch (condition)
+    {
+        case ir_condition::EQUAL:
+            return ir_condition::NEQUAL;
+        case ir_condition::NEQUAL:
+            return ir_condition::EQUAL;
+        case ir_condition::LESS:
+            return ir_condition::GREATEREQ;
+        case ir_condition::LESSEQ:
+            return ir_condition::GREATER;
+        case ir_condition::GREATER:
+            return ir_condition::LESSEQ;
+        case ir_condition::GREATEREQ:
+            return ir_condition::LESS;
+        default:
+            throw std::runtime_error("Invalid condition");
+    }
+}
+
+ir_condition mirror_condition(ir_condition condition)
+{
+    switch (condition)
+    {
+        case ir_condition::EQUAL:
+        case ir_condition::NEQUAL:
+            return condition;
+        case ir_condition::LESS:
+            return ir_condition::GREATER;
+        case ir_condition::LESSEQ:
+            return ir_condition::GREATEREQ;
+        case ir_condition::GREATER:
+            return ir_condition::LESS;
+        case ir_condition::GREATEREQ:
+            return ir_condition::LESSEQ;
+        default:
+            throw std::runtime_error("Invalid condition");
+    }
+}
+
+bool evaluate_condition(ir_condition condition, value_t lhs, value_t rhs)
+{
+    switch (condition)
+    {
+        case ir_condition::EQUAL:
+            return lhs == rhs;
+        case ir_condition::NEQUAL:
+            return lhs != rhs;
+        case ir_condition::LESS:
+            return lhs < rhs;
+        case ir_condition::LESSEQ:
+            return lhs <= rhs;
+        case ir_condition::GREATER:
+            return lhs > rhs;
+        case ir_condition::GREATEREQ:
+            return lhs >= rhs;
+        default:
+            throw std::runtime_error("Invalid condition");
+    }
+}
+
+//****************************************************************************//
+//                                 Structure                                  //
+//****************************************************************************//
+std::size_t ir_block::count_phis() const
+{
+    return static_cast<std::size_t>(std::ranges::find_if(instructions,
+                                                         [](const ir_instruction& i) {
+                                                             return i.op != ir_opcode::PHI;
+                                                         })
+                                    - instructions.begin());
+}
+
+//****************************************************************************//
+//                                  Editing                                   //
+//****************************************************************************//
+void add_edge(ir_function& function, ir_block_id from, ir_block_id to)
+{
+    function.blocks[from].successors.push_back(to);
+    function.blocks[to].predecessors.push_back(from);
+}
+
+void remove_edge(ir_function& function, ir_block_id from, ir_block_id to)
+{
+    auto& successors = function.blocks[from].successors;
+    auto& target     = function.blocks[to];
+
+    successors.erase(std::ranges::find(successors, to));
+
+    auto index = std::ranges::find(target.predecessors, from) - target.predecessors.begin();
+    target.predecessors.erase(target.predecessors.begin() + index);
+
+    for (auto& instruction : target.instructions)
+    {
+        if (instruction.op == ir_opcode::PHI)
+        {
+            instruction.operands.erase(instruction.operands.begin() + index);
+        }
+    }
+}
+
+ir_block_id split_edge(ir_function& function, ir_block_id from, ir_block_id to)
+{
+    auto middle = function.new_block();
+
+    *std::ranges::find(function.blocks[from].successors, to)   = middle;
+    *std::ranges::find(function.blocks[to].predecessors, from) = middle;
+
+    function.blocks[middle].predecessors = {from};
+    function.blocks[middle].successors   = {to};
+    function.blocks[middle].instructions.push_back({ir_opcode::JUMP, NO_VALUE, {}, 0});
+
+    return middle;
+}
+
+void remove_blocks(ir_function& function, const std::vector<bool>& removed)
+{
+    std::vector<ir_block_id> order;
+
+    for (ir_block_id block = 0; block < function.blocks.size(); ++block)
+    {
+        if (!removed[block])
+        {
+            order.push_back(block);
+        }
+    }
+
+    reorder_blocks(function, order);
+}
+
+void reorder_blocks(ir_function& function, const std::vector<ir_block_id>& order)
+{
+    std::vector<ir_block_id> renumbered(function.blocks.size(), NO_BLOCK);
+
+    for (ir_block_id i = 0; i < order.size(); ++i)
+    {
+        renumbered[order[i]] = i;
+    }
+
+    std::vector<ir_block> blocks;
+    blocks.reserve(order.size());
+
+    for (auto old : order)
+    {
+        auto block = std::move(function.blocks[old]);
+
+        // Edges from removed blocks disappear together with their phi operands
+        for (auto i = block.predecessors.size(); i-- > 0;)
+        {
+            if (renumbered[block.predecessors[i]] != NO_BLOCK)
+            {
+                block.predecessors[i] = renumbered[block.predecessors[i]];
+                continue;
+            }
+
+            block.predecessors.erase(block.predecessors.begin() + static_cast<std::ptrdiff_t>(i));
+
+            for (auto& instruction : block.instructions)
+            {
+                if (instruction.op == ir_opcode::PHI)
+                {
+                    instruction.operands.erase(instruction.operands.begin()
+                                               + static_cast<std::ptrdiff_t>(i));
+                }
+            }
+        }
+
+        for (auto& successor : block.successors)
+        {
+            if (renumbered[successor] == NO_BLOCK)
+            {
+                throw std::runtime_error("Removed block " + std::to_string(successor)
+                                         + " is still a successor");
+            }
+            successor = renumbered[successor];
+        }
+
+        blocks.push_back(std::move(block));
+    }
+
+    function.blocks = std::move(blocks);
+}
+
+void replace_values(ir_function& function, std::vector<ir_value_id> replacements)
+{
+    replacements.resize(function.n_values, NO_VALUE);
+
+    auto resolve = [&replacements](ir_value_id value) {
+        while (value != NO_VALUE && replacements[value] != NO_VALUE)
+        {
+            value = replacements[value];
+        }
+
+        return value;
+    };
+
+    for (auto& block : function.blocks)
+    {
+        for (auto& instruction : block.instructions)
+        {
+            for (auto& operand : instruction.operands)
+            {
+                operand = resolve(operand);
+            }
+        }
+    }
+}
+
+//****************************************************************************//
+//                                  Printing                                  //
+//****************************************************************************//
+namespace
+{
+void print_list(std::ostream& stream, const std::vector<ir_value_id>& values, char prefix)
+{
+    for (std::size_t i = 0; i < values.size(); ++i)
+    {
+        stream << (i == 0 ? " " : ", ") << prefix << values[i];
+    }
+}
+}    // namespace
+
+void print_function(std::ostream& stream, const ir_function& function)
+{
+    stream << function.name << "(" << function.n_parameters << "):\n";
+
+    for (ir_block_id id = 0; id < function.blocks.size(); ++id)
+    {
+        const auto& block = function.blocks[id];
+
+        stream << "b" << id << ":";
+        if (!block.predecessors.empty())
+        {
+            stream << " ; preds";
+            print_list(stream, block.predecessors, 'b');
+        }
+        stream << "\n";
+
+        for (const auto& instruction : block.instructions)
+        {
+            stream << "    ";
+            if (instruction.result != NO_VALUE)
+            {
+                stream << "v" << instruction.result << " = ";
+            }
+            stream << LUT_IR_OPCODE_TO_STRING[static_cast<std::size_t>(instruction.op)];
+
+            switch (instruction.op)
+            {
+                case ir_opcode::CONSTANT:
+                case ir_opcode::PARAMETER:
+                case ir_opcode::CALL:
+                    stream << " #" << instruction.immediate;
+                    break;
+                case ir_opcode::BUILTIN:
+                    stream << " " << LUT_OPCODE_TO_STRING[static_cast<std::size_t>(
+                        instruction.immediate)];
+                    break;
+                case ir_opcode::COMPARE:
+                case ir_opcode::BRANCH:
+                    stream << " "
+                           << LUT_IR_CONDITION_TO_STRING[static_cast<std::size_t>(
+                                  instruction.immediate)];
+                    break;
+                default:
+                    break;
+            }
+            print_list(stream, instruction.operands, 'v');
+
+            if (instruction.op == ir_opcode::SWITCH)
+            {
+                stream << " [";
+                for (std::size_t i = 0; i < instruction.targets.size(); ++i)
+                {
+                    stream << (i == 0 ? "" : ", ") << instruction.targets[i];
+                }
+                stream << "]";
+            }
+
+            if (is_terminator(instruction.op) && !block.successors.empty())
+            {
+                stream << " ->";
+                print_list(stream, block.successors, 'b');
+            }
+            stream << "\n";
+        }
+    }
+}
+
+std::string to_string(const ir_function& function)
+{
+    std::ostringstream stream;
+    print_function(stream, function);
+
+    return stream.str();
+}
@@ -0,0 +1,302 @@
+// Copyright © 2021-2022 Jonas Muehlmann
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "backend/value.hpp"
+#include "enum_range.hpp"
+#include <nlohmann/json.hpp>
+
+using json = nlohmann::ordered_json;
+
+// The intermediate representation sits between the AST and the register bytecode. Every
+// function is a control flow graph of basic blocks in SSA form: each value is defined by
+// exactly one instruction and joins of control flow select values with phi instructions.
+using ir_value_id = std::uint32_t;
+using ir_block_id = std::uint32_t;
+
+inline constexpr ir_value_id NO_VALUE = std::numeric_limits<ir_value_id>::max();
+inline constexpr ir_block_id NO_BLOCK = std::numeric_limits<ir_block_id>::max();
+
+//****************************************************************************//
+//                                  Opcodes                                   //
+//****************************************************************************//
+// result is the value defined by the instruction, op0, op1, ... are its operands
+enum class ir_opcode
+{
+    // result = immediate
+    CONSTANT,
+    // result = parameter number immediate, only allowed in the entry block
+    PARAMETER,
+    // result = op0
+    COPY,
+    // result = the operand belonging to the predecessor control came from
+    PHI,
+    // result = op0 <op> op1, with the same semantics as the bytecode
+    ADD,
+    SUB,
+    MUL,
+    DIV,
+    MOD,
+    AND,
+    OR,
+    XOR,
+    LSHIFT,
+    RSHIFT,
+    // result = !op0
+    NOT,
+    // result = op0 <immediate> op1 ? 1 : 0, immediate is an ir_condition
+    COMPARE,
+    // result = function number immediate (op0, op1, ...)
+    CALL,
+    // Builtin function, immediate is its opcode, no result
+    BUILTIN,
+    // Terminators
+    // Continue with successor 0
+    JUMP,
+    // Continue with successor 0 if op0 <immediate> op1, else with successor 1
+    BRANCH,
+    // Continue with successor targets[op0] if 0 <= op0 < targets.size(), else with
+    // successor 0
+    SWITCH,
+    // return op0
+    RET
+};
+
+const int NUM_IR_OPCODES = []() {
+    EnumRange<ir_opcode, ir_opcode::RET> range;
+
+    return range.size();
+}();
+
+const auto ALL_IR_OPCODES = enum_to_array<ir_opcode, ir_opcode::RET>();
+
+const auto LUT_IR_OPCODE_TO_STRING = []() {
+    using namespace std::literals::string_view_literals;
+
+    constexpr auto arr = []() {
+        std::array<std::string_view, EnumRange<ir_opcode, ir_opcode::RET>().size()> arr{};
+        arr.fill(""sv);
+
+        arr[static_cast<size_t>(ir_opcode::CONSTANT)]  = "CONSTANT"sv;
+        arr[static_cast<size_t>(ir_opcode::PARAMETER)] = "PARAMETER"sv;
+        arr[static_cast<size_t>(ir_opcode::COPY)]      = "COPY"sv;
+        arr[static_cast<size_t>(ir_opcode::PHI)]       = "PHI"sv;
+        arr[static_cast<size_t>(ir_opcode::ADD)]       = "ADD"sv;
+        arr[static_cast<size_t>(ir_opcode::SUB)]       = "SUB"sv;
+        arr[static_cast<size_t>(ir_opcode::MUL)]       = "MUL"sv;
+        arr[static_cast<size_t>(ir_opcode::DIV)]       = "DIV"sv;
+        arr[static_cast<size_t>(ir_opcode::MOD)]       = "MOD"sv;
+        arr[static_cast<size_t>(ir_opcode::AND)]       = "AND"sv;
+        arr[static_cast<size_t>(ir_opcode::OR)]        = "OR"sv;
+        arr[static_cast<size_t>(ir_opcode::XOR)]       = "XOR"sv;
+        arr[static_cast<size_t>(ir_opcode::LSHIFT)]    = "LSHIFT"sv;
+        arr[static_cast<size_t>(ir_opcode::RSHIFT)]    = "RSHIFT"sv;
+        arr[static_cast<size_t>(ir_opcode::NOT)]       = "NOT"sv;
+        arr[static_cast<size_t>(ir_opcode::COMPARE)]   = "COMPARE"sv;
+        arr[static_cast<size_t>(ir_opcode::CALL)]      = "CALL"sv;
+        arr[static_cast<size_t>(ir_opcode::BUILTIN)]   = "BUILTIN"sv;
+        arr[static_cast<size_t>(ir_opcode::JUMP)]      = "JUMP"sv;
+        arr[static_cast<size_t>(ir_opcode::BRANCH)]    = "BRANCH"sv;
+        arr[static_cast<size_t>(ir_opcode::SWITCH)]    = "SWITCH"sv;
+        arr[static_cast<size_t>(ir_opcode::RET)]       = "RET"sv;
+
+        return arr;
+    }();
+
+    static_assert(
+        std::ranges::count_if(arr, [](std::string_view str) { return str == ""sv; })
+            == 0,
+        "ir_opcode missing string representation");
+
+    return arr;
+}();
+
+inline void to_json(json& j, const ir_opcode& op)
+{
+    j = LUT_IR_OPCODE_TO_STRING[static_cast<size_t>(op)];
+}
+
+enum class ir_condition
+{
+    EQUAL,
+    NEQUAL,
+    LESS,
+    LESSEQ,
+    GREATER,
+    GREATEREQ
+};
+
+const auto LUT_IR_CONDITION_TO_STRING = []() {
+    using namespace std::literals::string_view_literals;
+
+    constexpr auto arr = []() {
+        std::array<std::string_view, EnumRange<ir_condition, ir_condition::GREATEREQ>().size()>
+            arr{};
+        arr.fill(""sv);
+
+        arr[static_cast<size_t>(ir_condition::EQUAL)]     = "EQUAL"sv;
+        arr[static_cast<size_t>(ir_condition::NEQUAL)]    = "NEQUAL"sv;
+        arr[static_cast<size_t>(ir_condition::LESS)]      = "LESS"sv;
+        arr[static_cast<size_t>(ir_condition::LESSEQ)]    = "LESSEQ"sv;
+        arr[static_cast<size_t>(ir_condition::GREATER)]   = "GREATER"sv;
+        arr[static_cast<size_t>(ir_condition::GREATEREQ)] = "GREATEREQ"sv;
+
+        return arr;
+    }();
+
+    static_assert(
+        std::ranges::count_if(arr, [](std::string_view str) { return str == ""sv; })
+            == 0,
+        "ir_condition missing string representation");
+
+    return arr;
+}();
+
+inline void to_json(json& j, const ir_condition& condition)
+{
+    j = LUT_IR_CONDITION_TO_STRING[static_cast<size_t>(condition)];
+}
+
+bool is_terminator(ir_opcode op);
+
+// Terminators and builtins without a value (e.g. print) have no result. The immediate of a
+// BUILTIN is the builtin's opcode.
+bool has_result(ir_opcode op, value_t immediate);
+
+// Instructions which can not be removed, even if their result is unused. Division traps on
+// a zero divisor.
+bool has_side_effects(ir_opcode op);
+
+// !(a <condition> b) == a <negated> b
+ir_condition negate_condition(ir_condition condition);
+
+// a <condition> b == b <mirrored> a
+ir_condition mirror_condition(ir_condition condition);
+
+bool evaluate_condition(ir_condition condition, value_t lhs, value_t rhs);
+
+//****************************************************************************//
+//                                 Structure                                  //
+//****************************************************************************//
+struct ir_instruction
+{
+    ir_opcode                  op;
+    ir_value_id                result{NO_VALUE};
+    std::vector<ir_value_id>   operands;
+    // Meaning depends on op, see ir_opcode
+    value_t                    immediate{};
+    // Successor numbers of a SWITCH, indexed by op0
+    std::vector<std::uint32_t> targets{};
+    // Source line of the statement the instruction was built from counted from 1, 0 if unknown
+    std::uint32_t              line{};
+
+    ir_condition condition() const
+    {
+        return static_cast<ir_condition>(immediate);
+    }
+};
+
+// Phi instructions come first and the last instruction is the only terminator. Operands of
+// phi instructions are ordered like the predecessors.
+struct ir_block
+{
+    std::vector<ir_instruction> instructions;
+    std::vector<ir_block_id>    predecessors;
+    std::vector<ir_block_id>    successors;
+
+    ir_instruction& terminator()
+    {
+        return instructions.back();
+    }
+
+    const ir_instruction& terminator() const
+    {
+        return instructions.back();
+    }
+
+    std::size_t count_phis() const;
+};
+
+// Block 0 is the entry block, the order of the blocks is the order in which they are laid out
+// in the bytecode.
+struct ir_function
+{
+    std::string           name;
+    std::size_t           n_parameters{};
+    bool                  returns_value{};
+    std::vector<ir_block> blocks;
+    std::size_t           n_values{};
+
+    ir_value_id new_value()
+    {
+        return static_cast<ir_value_id>(n_values++);
+    }
+
+    ir_block_id new_block()
+    {
+        blocks.emplace_back();
+
+        return static_cast<ir_block_id>(blocks.size() - 1);
+    }
+};
+
+struct ir_program
+{
+    std::vector<ir_function> functions;
+    std::size_t              main_function{};
+};
+
+//****************************************************************************//
+//                                  Editing                                   //
+//****************************************************************************//
+void add_edge(ir_function& function, ir_block_id from, ir_block_id to);
+
+// Removes the edge from -> to and the phi operands belonging to it
+void remove_edge(ir_function& function, ir_block_id from, ir_block_id to);
+
+// Routes the edge from -> to through a new, empty block, which is returned
+ir_block_id split_edge(ir_function& function, ir_block_id from, ir_block_id to);
+
+// Removes all blocks marked in removed together with their edges and renumbers the others
+void remove_blocks(ir_function& function, const std::vector<bool>& removed);
+
+// Renumbers the blocks, order[i] becomes block i. Blocks missing from order are removed.
+void reorder_blocks(ir_function& function, const std::vector<ir_block_id>& order);
+
+// Replaces every use of value v by replacements[v], unless it is NO_VALUE. Chains of
+// replacements are followed.
+void replace_values(ir_function& function, std::vector<ir_value_id> replacements);
+
+//****************************************************************************//
+//                                  Printing                                  //
+//****************************************************************************//
+// Human readable listing, e.g. "v3 = ADD v1, v2"
+void print_function(std::ostream& stream, const ir_function& function);
+
+std::string to_string(const ir_function& function);
@@ -0,0 +1,1197 @@
+// Copyright © 2021-2022 Jonas Muehlmann
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include "ir_builder.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "backend/interpreter/builtin_functions.hpp"
+#include "cleanup_passes.hpp"
+#include "frontend/lexer/token_type.hpp"
+
+namespace
+{
+//****************************************************************************//
+//                                  Helpers                                   //
+//****************************************************************************//
+struct function_signature
+{
+    std::size_t index;
+    std::size_t n_parameters;
+    bool        returns_value;
+};
+
+using function_table_t = std::unordered_map<std::string_view, function_signature>;
+
+std::optional<ir_opcode> to_arithmetic_opcode(token_type token)
+{
+    switch (token)
+    {
+        case token_type::PLUS:
+            return ir_opcode::ADD;
+        case token_type::MINUS:
+            return ir_opcode::SUB;
+        case token_type::MULTIPLICATION:
+            return ir_opcode::MUL;
+        case token_type::DIVISION:
+            return ir_opcode::DIV;
+        case token_type::MODULO:
+            return ir_opcode::MOD;
+        case token_type::BINARY_AND:
+            return ir_opcode::AND;
+        case token_type::BINARY_OR:
+            return ir_opcode::OR;
+        case token_type::LSHIFT:
+            return ir_opcode::LSHIFT;
+        case token_type::RSHIFT:
+            return ir_opcode::RSHIFT;
+        case token_type::XOR:
+            return ir_opcode::XOR;
+        default:
+            return std::nullopt;
+    }
+}
+
+std::optional<ir_condition> to_condition(token_type token)
+{
+    switch (token)
+    {
+        case token_type::LESS:
+            return ir_condition::LESS;
+        case token_type::LESSEQ:
+            return ir_condition::LESSEQ;
+        case token_type::GREATER:
+            return ir_condition::GREATER;
+        case token_type::GREATEREQ:
+            return ir_condition::GREATEREQ;
+        case token_type::EQUAL:
+            return ir_condition::EQUAL;
+        case token_type::NEQUAL:
+            return ir_condition::NEQUAL;
+        default:
+            return std::nullopt;
+    }
+}
+
+token_type get_operator(const std::shared_ptr<ast_node_t>& operator_)
+{
+    return std::get<leaf_node>(*operator_).token;
+}
+
+value_t parse_literal(std::string_view literal)
+{
+    value_t value{};
+    auto [end, error] = std::from_chars(literal.data(), literal.data() + literal.size(), value);
+
+    if (error != std::errc{} || end != literal.data() + literal.size())
+    {
+        throw std::runtime_error("Invalid integer literal " + std::string(literal));
+    }
+
+    return value;
+}
+
+bool is_literal(std::string_view argument)
+{
+    // Literals computed by the constant folder might be negative
+    if (argument.starts_with('-'))
+    {
+        argument.remove_prefix(1);
+    }
+
+    return !argument.empty()
+           && std::ranges::all_of(argument, [](char c) { return c >= '0' && c <= '9'; });
+}
+
+// Value of literal nodes
+std::optional<value_t> get_literal(const ast_node_t& node)
+{
+    const auto* leaf = std::get_if<leaf_node>(&node);
+
+    if (leaf == nullptr || leaf->token != token_type::LITERAL)
+    {
+        return std::nullopt;
+    }
+
+    return parse_literal(leaf->value);
+}
+
+bool is_missing(const std::shared_ptr<ast_node_t>& node)
+{
+    return node == nullptr || std::holds_alternative<missing_optional_node>(*node);
+}
+
+// Line the node starts on counted from 1, the lexer counts from 0. 0 for nodes without a
+// location.
+std::uint32_t get_line(const ast_node_t& node)
+{
+    return std::visit(
+        [](const auto& alternative) -> std::uint32_t {
+            if constexpr (requires { alternative.source_location_; })
+            {
+                return static_cast<std::uint32_t>(alternative.source_location_.line_start + 1);
+            }
+            else
+            {
+                return 0;
+            }
+        },
+        node);
+}
+
+//****************************************************************************//
+//                              Function builder                              //
+//****************************************************************************//
+// Every declaration introduces a new variable, even if it shadows another one
+using variable_id = std::size_t;
+
+struct switch_case
+{
+    value_t     value;
+    ir_block_id body;
+};
+
+// State needed while translating a single function
+class function_builder
+{
+ public:
+    // Methods
+    function_builder(ir_function&                function_,
+                     const function_table_t&     functions_,
+                     const ir_builder_options&   options_,
+                     std::vector<switch_report>* switches_)
+        : function(function_), functions(functions_), options(options_), switches(switches_)
+    {
+        scopes.emplace_back();
+        start_block(create_block());
+        seal_block(current);
+    }
+
+    void build(const signature_node& signature, const block_node& body);
+
+ private:
+    // Variables
+    ir_function&                function;
+    const function_table_t&     functions;
+    const ir_builder_options&   options;
+    std::vector<switch_report>* switches;
+    ir_block_id                 current{NO_BLOCK};
+    // Source line of the statement being lowered, see ir_instruction::line
+    std::uint32_t               current_line{};
+    // Order in which blocks were started, becomes the order of the blocks
+    std::vector<ir_block_id> layout;
+
+    std::vector<std::unordered_map<std::string_view, variable_id>> scopes;
+    variable_id                                                    n_variables{};
+
+    // Value of every variable at the end of a block, as far as it is known
+    std::vector<std::unordered_map<variable_id, ir_value_id>> definitions;
+    std::vector<bool>                                         sealed;
+    // Phis of unsealed blocks, which get their operands when the block is sealed
+    std::vector<std::vector<std::pair<variable_id, ir_value_id>>> incomplete_phis;
+
+    // Methods
+    //**************************    Blocks    **************************//
+    ir_block_id create_block()
+    {
+        definitions.emplace_back();
+        sealed.push_back(false);
+        incomplete_phis.emplace_back();
+
+        return function.new_block();
+    }
+
+    void start_block(ir_block_id block)
+    {
+        current = block;
+        layout.push_back(block);
+    }
+
+    // Continues in a new block, which has no predecessors, after a return
+    void start_unreachable_block()
+    {
+        start_block(create_block());
+        seal_block(current);
+    }
+
+    ir_value_id emit(ir_opcode op, std::vector<ir_value_id> operands = {}, value_t immediate = 0)
+    {
+        auto result = has_result(op, immediate) ? function.new_value() : NO_VALUE;
+
+        function.blocks[current].instructions.push_back(
+            {op, result, std::move(operands), immediate, {}, current_line});
+
+        return result;
+    }
+
+    ir_value_id emit_constant(value_t value)
+    {
+        return emit(ir_opcode::CONSTANT, {}, value);
+    }
+
+    void jump_to(ir_block_id target)
+    {
+        emit(ir_opcode::JUMP);
+        add_edge(function, current, target);
+    }
+
+    void branch(ir_condition condition,
+                ir_value_id  lhs,
+                ir_value_id  rhs,
+                ir_block_id  if_true,
+                ir_block_id  if_false)
+    {
+        emit(ir_opcode::BRANCH, {lhs, rhs}, static_cast<value_t>(condition));
+        add_edge(function, current, if_true);
+        add_edge(function, current, if_false);
+    }
+
+    // Continues with table[index] if 0 <= index < table.size(), else with otherwise
+    void switch_to(ir_value_id index, const std::vector<ir_block_id>& table, ir_block_id otherwise)
+    {
+        std::vector<ir_block_id>   successors{otherwise};
+        std::vector<std::uint32_t> targets;
+
+        for (auto block : table)
+        {
+            auto successor = std::ranges::find(successors, block);
+
+            if (successor == successors.end())
+            {
+                successors.push_back(block);
+                successor = successors.end() - 1;
+            }
+            targets.push_back(static_cast<std::uint32_t>(successor - successors.begin()));
+        }
+
+        emit(ir_opcode::SWITCH, {index});
+        function.blocks[current].terminator().targets = std::move(targets);
+
+        for (auto successor : successors)
+        {
+            add_edge(function, current, successor);
+        }
+    }
+
+    //**************************    Variables    **************************//
+    variable_id declare_variable(std::string_view identifier)
+    {
+        scopes.back()[identifier] = n_variables;
+
+        return n_variables++;
+    }
+
+    variable_id lookup_variable(std::string_view identifier) const
+    {
+        for (auto scope = scopes.rbegin(); scope != scopes.rend(); ++scope)
+        {
+            if (auto it = scope->find(identifier); it != scope->end())
+            {
+                return it->second;
+            }
+        }
+
+        throw std::runtime_error("Use of undeclared variable " + std::string(identifier));
+    }
+
+    void write_variable(variable_id variable, ir_value_id value)
+    {
+        definitions[current][variable] = value;
+    }
+
+    ir_value_id read_variable(variable_id variable)
+    {
+        return read_variable(variable, current);
+    }
+
+    ir_value_id read_variable(variable_id variable, ir_block_id block)
+    {
+        if (auto it = definitions[block].find(variable); it != definitions[block].end())
+        {
+            return it->second;
+        }
+
+        ir_value_id value = NO_VALUE;
+        const auto& predecessors = function.blocks[block].predecessors;
+
+        if (!sealed[block])
+        {
+            value = insert_phi(block);
+            incomplete_phis[block].emplace_back(variable, value);
+        }
+        else if (predecessors.size() == 1)
+        {
+            value = read_variable(variable, predecessors[0]);
+        }
+        else if (predecessors.empty())
+        {
+            // Only happens in unreachable code
+            value = function.new_value();
+            auto& instructions = function.blocks[block].instructions;
+            auto  n_phis       = static_cast<std::ptrdiff_t>(function.blocks[block].count_phis());
+
+            instructions.insert(instructions.begin() + n_phis, {ir_opcode::CONSTANT, value, {}, 0});
+        }
+        else
+        {
+            // Defined before reading the operands, which breaks cycles through loops
+            value                        = insert_phi(block);
+            definitions[block][variable] = value;
+            add_phi_operands(variable, block, value);
+        }
+
+        definitions[block][variable] = value;
+
+        return value;
+    }
+
+    ir_value_id insert_phi(ir_block_id block)
+    {
+        auto  value        = function.new_value();
+        auto& instructions = function.blocks[block].instructions;
+
+        instructions.insert(instructions.begin(), {ir_opcode::PHI, value, {}, 0});
+
+        return value;
+    }
+
+    void add_phi_operands(variable_id variable, ir_block_id block, ir_value_id phi)
+    {
+        std::vector<ir_value_id> operands;
+
+        // Reading might insert phis into this block, so the phi is looked up afterwards
+        for (std::size_t i = 0; i < function.blocks[block].predecessors.size(); ++i)
+        {
+            operands.push_back(read_variable(variable, function.blocks[block].predecessors[i]));
+        }
+
+        for (auto& instruction : function.blocks[block].instructions)
+        {
+            if (instruction.result == phi)
+            {
+                instruction.operands = std::move(operands);
+                break;
+            }
+        }
+    }
+
+    void seal_block(ir_block_id block)
+    {
+        for (auto [variable, phi] : std::exchange(incomplete_phis[block], {}))
+        {
+            add_phi_operands(variable, block, phi);
+        }
+        sealed[block] = true;
+    }
+
+    //**************************    Expressions    **************************//
+    ir_value_id lower_expression(const ast_node_t& node);
+    ir_value_id lower_call(const call_node& node, bool needs_value);
+    void lower_condition(const ast_node_t& node, ir_block_id if_true, ir_block_id if_false);
+    void lower_logical_condition(const binary_op_node& node,
+                                 ir_block_id           if_true,
+                                 ir_block_id           if_false);
+    ir_value_id lower_logical_operator(const binary_op_node& node);
+
+    //**************************    Statements    **************************//
+    void lower_statement(const std::shared_ptr<ast_node_t>& node);
+    void lower_block(const block_node& node);
+    void lower_if_chain(const std::vector<std::shared_ptr<ast_node_t>>& statements,
+                        std::size_t&                                    i);
+    void lower_loop(const std::shared_ptr<ast_node_t>& condition,
+                    const std::shared_ptr<ast_node_t>& body,
+                    const std::shared_ptr<ast_node_t>& update);
+    void lower_switch(const switch_node& node);
+    void lower_jump_table(ir_value_id                     value,
+                          const std::vector<switch_case>& cases,
+                          const switch_plan&              plan,
+                          ir_block_id                     otherwise);
+    void lower_binary_search(ir_value_id                  value,
+                             std::span<const switch_case> cases,
+                             ir_block_id                  otherwise);
+    void lower_hash(ir_value_id                     value,
+                    const std::vector<switch_case>& cases,
+                    const switch_plan&              plan,
+                    ir_block_id                     otherwise);
+
+    friend struct expression_visitor;
+    friend struct statement_visitor;
+};
+
+//****************************************************************************//
+//                                Expressions                                 //
+//****************************************************************************//
+struct expression_visitor
+{
+    function_builder& builder;
+
+    ir_value_id operator()(const leaf_node& node)
+    {
+        if (node.token == token_type::LITERAL)
+        {
+            return builder.emit_constant(parse_literal(node.value));
+        }
+        if (node.token == token_type::IDENTIFIER)
+        {
+            return builder.read_variable(builder.lookup_variable(node.value));
+        }
+
+        throw std::runtime_error("Unexpected token in expression");
+    }
+
+    ir_value_id operator()(const binary_op_node& node)
+    {
+        auto token = get_operator(node.operator_);
+
+        if (auto op = to_arithmetic_opcode(token))
+        {
+            auto lhs = builder.lower_expression(*node.lhs);
+            auto rhs = builder.lower_expression(*node.rhs);
+
+            return builder.emit(*op, {lhs, rhs});
+        }
+
+        if (token == token_type::LOGICAL_AND || token == token_type::LOGICAL_OR)
+        {
+            return builder.lower_logical_operator(node);
+        }
+
+        if (auto condition = to_condition(token))
+        {
+            auto lhs = builder.lower_expression(*node.lhs);
+            auto rhs = builder.lower_expression(*node.rhs);
+
+            return builder.emit(ir_opcode::COMPARE, {lhs, rhs}, static_cast<value_t>(*condition));
+        }
+
+        throw std::runtime_error("Unexpected binary operator");
+    }
+
+    ir_value_id operator()(const unary_op_node& node)
+    {
+        auto token = get_operator(node.operator_);
+
+        if (token == token_type::NOT)
+        {
+            return builder.emit(ir_opcode::NOT, {builder.lower_expression(*node.operand)});
+        }
+
+        // Increment and decrement assign the new value to their operand
+        const auto& operand = std::get<leaf_node>(*node.operand);
+
+        if (operand.token != token_type::IDENTIFIER)
+        {
+            throw std::runtime_error("Operand of increment/decrement must be a variable");
+        }
+
+        auto variable = builder.lookup_variable(operand.value);
+        auto op       = token == token_type::INCREMENT ? ir_opcode::ADD : ir_opcode::SUB;
+        auto one      = builder.emit_constant(1);
+        auto result   = builder.emit(op, {builder.read_variable(variable), one});
+
+        builder.write_variable(variable, result);
+
+        return result;
+    }
+
+    ir_value_id operator()(const call_node& node)
+    {
+        return builder.lower_call(node, true);
+    }
+
+    ir_value_id operator()([[maybe_unused]] const auto& node)
+    {
+        throw std::runtime_error("Unexpected node in expression");
+    }
+};
+
+ir_value_id function_builder::lower_expression(const ast_node_t& node)
+{
+    return std::visit(expression_visitor{*this}, node);
+}
+
+// Returns the result or NO_VALUE for builtins without a value
+ir_value_id function_builder::lower_call(const call_node& node, bool needs_value)
+{
+    const auto& arguments = std::get<parameter_pass_node>(*node.parameter_pass).parameter_list;
+
+    auto check_arity = [&](std::size_t n_parameters) {
+        if (arguments.size() != n_parameters)
+        {
+            throw std::runtime_error("Wrong number of arguments passed to "
+                                     + std::string(node.identifier));
+        }
+    };
+
+    auto check_value = [&](bool returns_value) {
+        if (needs_value && !returns_value)
+        {
+            throw std::runtime_error("Procedure " + std::string(node.identifier)
+                                     + " does not return a value");
+        }
+    };
+
+    auto lower_arguments = [&]() {
+        std::vector<ir_value_id> values;
+
+        for (auto argument : arguments)
+        {
+            values.push_back(is_literal(argument) ? emit_constant(parse_literal(argument))
+                                                  : read_variable(lookup_variable(argument)));
+        }
+
+        return values;
+    };
+
+    if (auto it = functions.find(node.identifier); it != functions.end())
+    {
+        const auto& callee = it->second;
+
+        check_arity(callee.n_parameters);
+        check_value(callee.returns_value);
+
+        return emit(ir_opcode::CALL, lower_arguments(), static_cast<value_t>(callee.index));
+    }
+
+    if (auto builtin = find_builtin_function(node.identifier))
+    {
+        check_arity(builtin->n_parameters);
+        check_value(builtin->returns_value);
+
+        return emit(ir_opcode::BUILTIN, lower_arguments(), static_cast<value_t>(builtin->op));
+    }
+
+    throw std::runtime_error("Call to undefined function " + std::string(node.identifier));
+}
+
+// Ends the current block with a branch to if_true or if_false depending on the truthiness of
+// the condition. Logical operators only evaluate their right operand, if the left one does
+// not decide the result, and never materialize their value.
+void function_builder::lower_condition(const ast_node_t& node,
+                                       ir_block_id       if_true,
+                                       ir_block_id       if_false)
+{
+    if (const auto* binary_op = std::get_if<binary_op_node>(&node))
+    {
+        auto token = get_operator(binary_op->operator_);
+
+        if (auto condition = to_condition(token))
+        {
+            auto lhs = lower_expression(*binary_op->lhs);
+            auto rhs = lower_expression(*binary_op->rhs);
+
+            branch(*condition, lhs, rhs, if_true, if_false);
+
+            return;
+        }
+
+        if (token == token_type::LOGICAL_AND || token == token_type::LOGICAL_OR)
+        {
+            lower_logical_condition(*binary_op, if_true, if_false);
+
+            return;
+        }
+    }
+
+    if (const auto* unary_op = std::get_if<unary_op_node>(&node))
+    {
+        if (get_operator(unary_op->operator_) == token_type::NOT)
+        {
+            lower_condition(*unary_op->operand, if_false, if_true);
+
+            return;
+        }
+    }
+
+    auto value = lower_expression(node);
+
+    branch(ir_condition::NEQUAL, value, emit_constant(0), if_true, if_false);
+}
+
+void function_builder::lower_logical_condition(const binary_op_node& node,
+                                               ir_block_id           if_true,
+                                               ir_block_id           if_false)
+{
+    auto rhs = create_block();
+
+    if (get_operator(node.operator_) == token_type::LOGICAL_AND)
+    {
+        lower_condition(*node.lhs, rhs, if_false);
+    }
+    else
+    {
+        lower_condition(*node.lhs, if_true, rhs);
+    }
+
+    seal_block(rhs);
+    start_block(rhs);
+    lower_condition(*node.rhs, if_true, if_false);
+}
+
+// Outside of conditions, the short circuiting branches join again to select 0 or 1
+ir_value_id function_builder::lower_logical_operator(const binary_op_node& node)
+{
+    // Not reachable by name, only used to place the phi
+    auto result   = n_variables++;
+    auto if_true  = create_block();
+    auto if_false = create_block();
+    auto join     = create_block();
+
+    lower_logical_condition(node, if_true, if_false);
+
+    for (auto [block, value] : {std::pair{if_true, 1}, {if_false, 0}})
+    {
+        seal_block(block);
+        start_block(block);
+        write_variable(result, emit_constant(value));
+        jump_to(join);
+    }
+
+    seal_block(join);
+    start_block(join);
+
+    return read_variable(result);
+}
+
+//****************************************************************************//
+//                                 Statements                                 //
+//****************************************************************************//
+struct statement_visitor
+{
+    function_builder& builder;
+
+    void operator()(const block_node& node)
+    {
+        builder.lower_block(node);
+    }
+
+    void operator()(const var_decl_node& node)
+    {
+        auto value = builder.emit_constant(0);
+
+        builder.write_variable(builder.declare_variable(node.identifier), value);
+    }
+
+    void operator()(const var_init_node& node)
+    {
+        // Lowered before declaring, the initializer might refer to a shadowed variable
+        auto value = builder.lower_expression(*node.value);
+
+        builder.write_variable(builder.declare_variable(node.identifier), value);
+    }
+
+    void operator()(const var_assignment_node& node)
+    {
+        auto variable = builder.lookup_variable(node.identifier);
+
+        builder.write_variable(variable, builder.lower_expression(*node.value));
+    }
+
+    void operator()(const call_node& node)
+    {
+        builder.lower_call(node, false);
+    }
+
+    void operator()(const binary_op_node& node)
+    {
+        expression_visitor{builder}(node);
+    }
+
+    void operator()(const unary_op_node& node)
+    {
+        expression_visitor{builder}(node);
+    }
+
+    void operator()(const leaf_node& node)
+    {
+        expression_visitor{builder}(node);
+    }
+
+    void operator()(const return_stmt_node& node)
+    {
+        auto value = node.value != nullptr ? builder.lower_expression(*node.value)
+                                           : builder.emit_constant(0);
+
+        builder.emit(ir_opcode::RET, {value});
+        builder.start_unreachable_block();
+    }
+
+    void operator()(const while_loop_node& node)
+    {
+        builder.lower_loop(node.condition, node.body, nullptr);
+    }
+
+    void operator()(const for_loop_node& node)
+    {
+        builder.scopes.emplace_back();
+
+        builder.lower_statement(node.init_stmt);
+        builder.lower_loop(node.test_expression, node.body, node.update_expression);
+
+        builder.scopes.pop_back();
+    }
+
+    void operator()(const switch_node& node)
+    {
+        builder.lower_switch(node);
+    }
+
+    void operator()([[maybe_unused]] const missing_optional_node& node) {}
+
+    void operator()([[maybe_unused]] const auto& node)
+    {
+        throw std::runtime_error("Unexpected node in statement");
+    }
+};
+
+void function_builder::lower_statement(const std::shared_ptr<ast_node_t>& node)
+{
+    if (node != nullptr)
+    {
+        // Statements nested in the node set their own line and restore this one afterwards
+        const auto enclosing_line = std::exchange(current_line, get_line(*node));
+
+        std::visit(statement_visitor{*this}, *node);
+        current_line = enclosing_line;
+    }
+}
+
+void function_builder::lower_block(const block_node& node)
+{
+    scopes.emplace_back();
+
+    const auto& statements = node.statements;
+
+    for (std::size_t i = 0; i < statements.size(); ++i)
+    {
+        if (std::holds_alternative<if_stmt_node>(*statements[i]))
+        {
+            lower_if_chain(statements, i);
+        }
+        else
+        {
+            lower_statement(statements[i]);
+        }
+    }
+
+    scopes.pop_back();
+}
+
+// else if and else statements follow their if statement in the same block, i is left at the
+// last statement of the chain
+void function_builder::lower_if_chain(const std::vector<std::shared_ptr<ast_node_t>>& statements,
+                                      std::size_t&                                    i)
+{
+    auto end = create_block();
+
+    for (bool first = true;; first = false, ++i)
+    {
+        const auto& statement = *statements[i];
+        const auto* if_stmt   = std::get_if<if_stmt_node>(&statement);
+        const auto* else_if   = std::get_if<else_if_stmt_node>(&statement);
+
+        current_line = get_line(statement);
+
+        const auto& condition = first ? if_stmt->condition : else_if->condition;
+        const auto& body      = first ? if_stmt->body : else_if->body;
+
+        bool continues = i + 1 < statements.size()
+                         && (std::holds_alternative<else_if_stmt_node>(*statements[i + 1])
+                             || std::holds_alternative<else_stmt_node>(*statements[i + 1]));
+
+        // Without another branch, a false condition continues right after the chain
+        auto then = create_block();
+        auto next = continues ? create_block() : end;
+
+        lower_condition(*condition, then, next);
+        seal_block(then);
+        start_block(then);
+        lower_statement(body);
+        jump_to(end);
+
+        if (!continues)
+        {
+            break;
+        }
+
+        seal_block(next);
+        start_block(next);
+
+        if (const auto* else_stmt = std::get_if<else_stmt_node>(statements[i + 1].get()))
+        {
+            lower_statement(else_stmt->body);
+            jump_to(end);
+            ++i;
+            break;
+        }
+    }
+
+    seal_block(end);
+    start_block(end);
+}
+
+// Inverted loop, so every iteration only executes a single jump: the condition is lowered
+// first, since the body reads the variables through it, but is laid out after the body
+void function_builder::lower_loop(const std::shared_ptr<ast_node_t>& condition,
+                                  const std::shared_ptr<ast_node_t>& body,
+                                  const std::shared_ptr<ast_node_t>& update)
+{
+    auto test = create_block();
+    auto head = create_block();
+    auto exit = create_block();
+
+    jump_to(test);
+
+    auto test_begin = layout.size();
+    start_block(test);
+
+    if (!is_missing(condition))
+    {
+        lower_condition(*condition, head, exit);
+    }
+    else
+    {
+        jump_to(head);
+    }
+
+    auto body_begin = layout.size();
+    seal_block(head);
+    start_block(head);
+    lower_statement(body);
+    lower_statement(update);
+    jump_to(test);
+    seal_block(test);
+
+    std::rotate(layout.begin() + static_cast<std::ptrdiff_t>(test_begin),
+                layout.begin() + static_cast<std::ptrdiff_t>(body_begin),
+                layout.end());
+
+    seal_block(exit);
+    start_block(exit);
+}
+
+void function_builder::lower_switch(const switch_node& node)
+{
+    const auto& cases = std::get<block_node>(*node.body).statements;
+    auto        value = lower_expression(*node.expression);
+    auto        end   = create_block();
+
+    std::vector<std::optional<value_t>> case_values;
+    std::vector<ir_block_id>            bodies;
+
+    for (const auto& case_ : cases)
+    {
+        case_values.push_back(get_literal(*std::get<case_node>(*case_).value));
+        bodies.push_back(create_block());
+    }
+
+    auto plan = options.select_switch_strategies
+                    ? plan_switch(case_values)
+                    : switch_plan{.reason = "switch strategies are disabled"};
+
+    if (switches != nullptr)
+    {
+        switches->push_back({function.name, cases.size(), plan.strategy, plan.reason});
+    }
+
+    if (plan.strategy == switch_strategy::COMPARISONS)
+    {
+        // The case values are compared in order
+        for (std::size_t i = 0; i < cases.size(); ++i)
+        {
+            auto case_value = lower_expression(*std::get<case_node>(*cases[i]).value);
+            auto next       = create_block();
+
+            branch(ir_condition::EQUAL, value, case_value, bodies[i], next);
+            seal_block(next);
+            start_block(next);
+        }
+        jump_to(end);
+    }
+    else
+    {
+        // Sorted by value, a duplicate value belongs to its first case
+        std::vector<switch_case> targets;
+
+        for (std::size_t i = 0; i < cases.size(); ++i)
+        {
+            targets.push_back({*case_values[i], bodies[i]});
+        }
+        std::ranges::stable_sort(targets, {}, &switch_case::value);
+        targets.erase(std::ranges::unique(targets, {}, &switch_case::value).begin(),
+                      targets.end());
+
+        switch (plan.strategy)
+        {
+            case switch_strategy::JUMP_TABLE:
+                lower_jump_table(value, targets, plan, end);
+                break;
+            case switch_strategy::BINARY_SEARCH:
+                lower_binary_search(value, targets, end);
+                break;
+            case switch_strategy::HASH:
+                lower_hash(value, targets, plan, end);
+                break;
+            default:
+                throw std::runtime_error("Invalid switch strategy");
+        }
+    }
+
+    for (std::size_t i = 0; i < cases.size(); ++i)
+    {
+        seal_block(bodies[i]);
+        start_block(bodies[i]);
+        lower_statement(std::get<case_node>(*cases[i]).body);
+        jump_to(end);
+    }
+
+    seal_block(end);
+    start_block(end);
+}
+
+void function_builder::lower_jump_table(ir_value_id                     value,
+                                        const std::vector<switch_case>& cases,
+                                        const switch_plan&              plan,
+                                        ir_block_id                     otherwise)
+{
+    auto slot_of = [&plan](value_t case_value) {
+        return static_cast<std::size_t>(static_cast<std::uint64_t>(case_value)
+                                        - static_cast<std::uint64_t>(plan.offset));
+    };
+
+    std::vector<ir_block_id> table(slot_of(cases.back().value) + 1, otherwise);
+
+    for (const auto& case_ : cases)
+    {
+        table[slot_of(case_.value)] = case_.body;
+    }
+
+    auto index = plan.offset == 0
+                     ? value
+                     : emit(ir_opcode::SUB, {value, emit_constant(plan.offset)});
+
+    switch_to(index, table, otherwise);
+}
+
+void function_builder::lower_binary_search(ir_value_id                  value,
+                                           std::span<const switch_case> cases,
+                                           ir_block_id                  otherwise)
+{
+    if (cases.size() < MIN_SWITCH_TABLE_CASES)
+    {
+        for (std::size_t i = 0; i < cases.size(); ++i)
+        {
+            auto next = i + 1 < cases.size() ? create_block() : otherwise;
+
+            branch(ir_condition::EQUAL, value, emit_constant(cases[i].value), cases[i].body, next);
+
+            if (next != otherwise)
+            {
+                seal_block(next);
+                start_block(next);
+            }
+        }
+
+        return;
+    }
+
+    auto middle = cases.size() / 2;
+    auto lower  = create_block();
+    auto upper  = create_block();
+
+    branch(ir_condition::LESS, value, emit_constant(cases[middle].value), lower, upper);
+    seal_block(lower);
+    seal_block(upper);
+
+    start_block(lower);
+    lower_binary_search(value, cases.first(middle), otherwise);
+    start_block(upper);
+    lower_binary_search(value, cases.subspan(middle), otherwise);
+}
+
+void function_builder::lower_hash(ir_value_id                     value,
+                                  const std::vector<switch_case>& cases,
+                                  const switch_plan&              plan,
+                                  ir_block_id                     otherwise)
+{
+    auto hash = value;
+
+    if (plan.multiplier != 1)
+    {
+        hash = emit(ir_opcode::MUL, {hash, emit_constant(plan.multiplier)});
+    }
+    if (plan.shift != 0)
+    {
+        hash = emit(ir_opcode::RSHIFT, {hash, emit_constant(plan.shift)});
+    }
+    hash = emit(ir_opcode::AND,
+                {hash, emit_constant(static_cast<value_t>(plan.table_size) - 1)});
+
+    // The cases in a slot are still compared, the hash only narrows them down
+    std::vector<std::vector<switch_case>> slots(plan.table_size);
+    std::vector<ir_block_id>              table(plan.table_size, otherwise);
+
+    for (const auto& case_ : cases)
+    {
+        slots[hash_switch_value(plan, case_.value)].push_back(case_);
+    }
+    for (std::size_t slot = 0; slot < slots.size(); ++slot)
+    {
+        if (!slots[slot].empty())
+        {
+            table[slot] = create_block();
+        }
+    }
+
+    switch_to(hash, table, otherwise);
+
+    for (std::size_t slot = 0; slot < slots.size(); ++slot)
+    {
+        if (!slots[slot].empty())
+        {
+            seal_block(table[slot]);
+            start_block(table[slot]);
+            lower_binary_search(value, slots[slot], otherwise);
+        }
+    }
+}
+
+void function_builder::build(const signature_node& signature, const block_node& body)
+{
+    const auto& parameters = std::get<parameter_def_node>(*signature.parameter_list).parameter_list;
+
+    current_line = static_cast<std::uint32_t>(signature.source_location_.line_start + 1);
+
+    for (std::size_t i = 0; i < parameters.size(); ++i)
+    {
+        auto value = emit(ir_opcode::PARAMETER, {}, static_cast<value_t>(i));
+
+        write_variable(declare_variable(parameters[i]), value);
+    }
+
+    lower_block(body);
+
+    // Falling off the end returns 0, at the closing brace
+    current_line = static_cast<std::uint32_t>(body.source_location_.line_end + 1);
+    emit(ir_opcode::RET, {emit_constant(0)});
+
+    reorder_blocks(function, layout);
+    remove_unreachable_blocks(function);
+    remove_trivial_phis(function);
+}
+
+//****************************************************************************//
+//                                 Functions                                  //
+//****************************************************************************//
+// Returns signature and body of function and procedure definitions
+std::optional<std::pair<const signature_node*, const block_node*>>
+get_definition(const ast_node_t& node)
+{
+    auto split = [](const auto& definition) {
+        return std::pair{&std::get<signature_node>(*definition.signature),
+                         &std::get<block_node>(*definition.body)};
+    };
+
+    if (const auto* function = std::get_if<func_def_node>(&node))
+    {
+        return split(*function);
+    }
+    if (const auto* procedure = std::get_if<procedure_def_node>(&node))
+    {
+        return split(*procedure);
+    }
+
+    return std::nullopt;
+}
+
+std::size_t count_parameters(const signature_node& signature)
+{
+    return std::get<parameter_def_node>(*signature.parameter_list).parameter_list.size();
+}
+}    // namespace
+
+//****************************************************************************//
+//                                Entry point                                 //
+//****************************************************************************//
+ir_program build_ir(const ast_node_t&           ast,
+                    const ir_builder_options&   options,
+                    std::vector<switch_report>* switches)
+{
+    const auto& globals = std::get<program_node>(ast).globals;
+
+    function_table_t functions;
+
+    for (const auto& global : globals)
+    {
+        auto definition = get_definition(*global);
+
+        if (!definition.has_value())
+        {
+            throw std::runtime_error("Global variables are not supported by the code generator");
+        }
+
+        auto [signature, body] = *definition;
+        auto [it, inserted]    = functions.try_emplace(
+            signature->identifier,
+            function_signature{functions.size(),
+                               count_parameters(*signature),
+                               std::holds_alternative<func_def_node>(*global)});
+
+        if (!inserted)
+        {
+            throw std::runtime_error("Redefinition of function "
+                                     + std::string(signature->identifier));
+        }
+    }
+
+    auto main_function = functions.find("main");
+
+    if (main_function == functions.end())
+    {
+        throw std::runtime_error("Program does not define a main function");
+    }
+
+    ir_program program;
+    program.main_function = main_function->second.index;
+
+    for (const auto& global : globals)
+    {
+        auto [signature, body] = *get_definition(*global);
+        auto& function         = program.functions.emplace_back();
+
+        function.name          = std::string(signature->identifier);
+        function.n_parameters  = count_parameters(*signature);
+        function.returns_value = std::holds_alternative<func_def_node>(*global);
+
+        function_builder(function, functions, options, switches).build(*signature, *body);
+    }
+
+    return program;
+}
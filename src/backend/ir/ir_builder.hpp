@@ -0,0 +1,44 @@
+// Copyright © 2021-2022 Jonas Muehlmann
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#pragma once
+
+#include <vector>
+
+#include "frontend/parser/ast_node.hpp"
+#include "ir.hpp"
+#include "switch_strategy.hpp"
+
+struct ir_builder_options
+{
+    // Switches with literal cases may use a jump table, a binary search or a hash instead of
+    // comparing the cases in order, see plan_switch
+    bool select_switch_strategies{true};
+};
+
+// Translates the program to SSA form. Variables are renamed on the fly with the algorithm by
+// Braun et al. ("Simple and Efficient Construction of Static Single Assignment Form"): a
+// block is sealed once all its predecessors are known and reading a variable, which is not
+// defined locally, looks it up in the predecessors, inserting phis where paths join.
+// Blocks are laid out like the bytecode is expected to be, e.g. loops are inverted so that
+// the condition follows the body. If switches is given, the strategy chosen for every
+// switch is appended to it.
+ir_program build_ir(const ast_node_t&           ast,
+                    const ir_builder_options&   options  = {},
+                    std::vector<switch_report>* switches = nullptr);
@@ -0,0 +1,159 @@
+// Copyright © 2021-2022 Jonas Muehlmann
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include "loop_info.hpp"
+
+#include <algorithm>
+#include <map>
+#include <utility>
+
+loop_info::loop_info(const ir_function& function, const dominator_tree& dominators)
+    : depths(function.blocks.size(), 0), innermost_loops(function.blocks.size(), NO_LOOP)
+{
+    // Back edges grouped by header, a header with several back edges forms a single loop
+    std::map<ir_block_id, std::vector<ir_block_id>> back_edges;
+
+    for (auto block : dominators.get_reverse_postorder())
+    {
+        for (auto successor : function.blocks[block].successors)
+        {
+            if (dominators.dominates(successor, block))
+            {
+                back_edges[successor].push_back(block);
+            }
+        }
+    }
+
+    for (auto& [header, latches] : back_edges)
+    {
+        std::vector<bool>        in_loop(function.blocks.size());
+        std::vector<ir_block_id> worklist = latches;
+
+        in_loop[header] = true;
+
+        // Everything reaching a latch without passing the header belongs to the loop
+        while (!worklist.empty())
+        {
+            auto block = worklist.back();
+            worklist.pop_back();
+
+            if (in_loop[block] || !dominators.is_reachable(block))
+            {
+                continue;
+            }
+            in_loop[block] = true;
+
+            worklist.insert(worklist.end(),
+                            function.blocks[block].predecessors.begin(),
+                            function.blocks[block].predecessors.end());
+        }
+
+        natural_loop loop{header, {}, latches, NO_LOOP};
+
+        for (ir_block_id block = 0; block < function.blocks.size(); ++block)
+        {
+            if (in_loop[block])
+            {
+                loop.blocks.push_back(block);
+            }
+        }
+
+        std::ranges::sort(loop.latches);
+        loops.push_back(std::move(loop));
+    }
+
+    // Inner loops have fewer blocks than the loops containing them
+    std::ranges::stable_sort(loops, {}, [](const natural_loop& loop) {
+        return loop.blocks.size();
+    });
+
+    for (std::size_t i = 0; i < loops.size(); ++i)
+    {
+        for (std::size_t j = i + 1; j < loops.size(); ++j)
+        {
+            if (contains(j, loops[i].header))
+            {
+                loops[i].parent = j;
+                break;
+            }
+        }
+
+        for (auto block : loops[i].blocks)
+        {
+            ++depths[block];
+
+            if (innermost_loops[block] == NO_LOOP)
+            {
+                innermost_loops[block] = i;
+            }
+        }
+    }
+}
+
+const std::vector<natural_loop>& loop_info::get_loops() const
+{
+    return loops;
+}
+
+std::size_t loop_info::get_depth(ir_block_id block) const
+{
+    return depths[block];
+}
+
+std::size_t loop_info::get_innermost_loop(ir_block_id block) const
+{
+    return innermost_loops[block];
+}
+
+bool loop_info::contains(std::size_t loop, ir_block_id block) const
+{
+    return std::ranges::binary_search(loops[loop].blocks, block);
+}
+
+ir_block_id find_entering_block(const ir_function& function, const natural_loop& loop)
+{
+    ir_block_id entering = NO_BLOCK;
+
+    for (auto predecessor : function.blocks[loop.header].predecessors)
+    {
+        if (std::ranges::binary_search(loop.blocks, predecessor))
+        {
+            continue;
+        }
+        if (entering != NO_BLOCK)
+        {
+            return NO_BLOCK;
+        }
+        entering = predecessor;
+    }
+
+    return entering;
+}
+
+ir_block_id find_preheader(const ir_function& function, const natural_loop& loop)
+{
+    auto entering = find_entering_block(function, loop);
+
+    if (entering == NO_BLOCK || function.blocks[entering].successors.size() != 1)
+    {
+        return NO_BLOCK;
+    }
+
+    return entering;
+}
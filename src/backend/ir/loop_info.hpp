@@ -0,0 +1,72 @@
+// Copyright © 2021-2022 Jonas Muehlmann
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#pragma once
+
+#include <cstddef>
+#include <limits>
+#include <vector>
+
+#include "dominator_tree.hpp"
+#include "ir.hpp"
+
+inline constexpr std::size_t NO_LOOP = std::numeric_limits<std::size_t>::max();
+
+// A loop is formed by the back edges into a header, which dominates all blocks of the loop
+struct natural_loop
+{
+    ir_block_id              header;
+    // Including the header, in ascending order
+    std::vector<ir_block_id> blocks;
+    // Sources of the back edges
+    std::vector<ir_block_id> latches;
+    // Innermost loop containing this one
+    std::size_t              parent{NO_LOOP};
+};
+
+// The natural loops of a function and how they nest. Loops are ordered so that every loop
+// comes after all loops it contains.
+class loop_info
+{
+ public:
+    // Methods
+    loop_info(const ir_function& function, const dominator_tree& dominators);
+
+    [[nodiscard]] const std::vector<natural_loop>& get_loops() const;
+
+    // Number of loops containing the block, 0 outside of loops
+    [[nodiscard]] std::size_t get_depth(ir_block_id block) const;
+
+    // NO_LOOP outside of loops
+    [[nodiscard]] std::size_t get_innermost_loop(ir_block_id block) const;
+
+    [[nodiscard]] bool contains(std::size_t loop, ir_block_id block) const;
+
+ private:
+    // Variables
+    std::vector<natural_loop> loops;
+    std::vector<std::size_t>  depths;
+    std::vector<std::size_t>  innermost_loops;
+};
+
+// The only block outside of the loop jumping to its header, NO_BLOCK if there are several
+ir_block_id find_entering_block(const ir_function& function, const natural_loop& loop);
+
+// The entering block, if the header is its only successor, otherwise NO_BLOCK
+ir_block_id find_preheader(const ir_function& function, const natural_loop& loop);
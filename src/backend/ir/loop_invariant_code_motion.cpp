@@ -0,0 +1,237 @@
+// Copyright © 2021-2022 Jonas Muehlmann
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include "loop_invariant_code_motion.hpp"
+
+#include <algorithm>
+#include <numeric>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "backend/value.hpp"
+#include "dominator_tree.hpp"
+#include "effect_analysis.hpp"
+#include "loop_info.hpp"
+
+namespace
+{
+bool in_loop(const natural_loop& loop, ir_block_id block)
+{
+    return std::ranges::binary_search(loop.blocks, block);
+}
+
+// Splits the entering edge of loops, whose entering block has other successors as well
+void insert_preheaders(ir_function& function)
+{
+    dominator_tree dominators(function);
+    loop_info      loops(function, dominators);
+
+    std::vector<ir_block_id> order(function.blocks.size());
+    std::iota(order.begin(), order.end(), 0);
+    bool changed = false;
+
+    for (const auto& loop : loops.get_loops())
+    {
+        auto entering = find_entering_block(function, loop);
+
+        if (entering == NO_BLOCK || function.blocks[entering].successors.size() == 1)
+        {
+            continue;
+        }
+
+        // Laid out right before the header, so it falls through
+        auto preheader = split_edge(function, entering, loop.header);
+        order.insert(std::ranges::find(order, loop.header), preheader);
+        changed = true;
+    }
+
+    if (changed)
+    {
+        reorder_blocks(function, order);
+    }
+}
+
+class loop_hoister
+{
+ public:
+    // Methods
+    loop_hoister(ir_function& function_, const std::vector<function_effects>& effects_)
+        : function(function_), effects(effects_), constants(collect_constants(function_))
+    {
+        defining_blocks.resize(function.n_values, NO_BLOCK);
+
+        for (ir_block_id id = 0; id < function.blocks.size(); ++id)
+        {
+            for (const auto& instruction : function.blocks[id].instructions)
+            {
+                if (instruction.result != NO_VALUE)
+                {
+                    defining_blocks[instruction.result] = id;
+                }
+            }
+        }
+    }
+
+    std::size_t hoist(const natural_loop& loop, const std::vector<ir_block_id>& reverse_postorder)
+    {
+        auto preheader = find_preheader(function, loop);
+
+        if (preheader == NO_BLOCK)
+        {
+            return 0;
+        }
+
+        std::vector<ir_instruction>              hoisted;
+        std::unordered_map<value_t, ir_value_id> hoisted_constants;
+        std::size_t                              n_hoisted = 0;
+
+        auto get_constant = [&](value_t value) {
+            auto [it, inserted] = hoisted_constants.try_emplace(value, NO_VALUE);
+
+            if (inserted)
+            {
+                it->second = function.new_value();
+                hoisted.push_back({ir_opcode::CONSTANT, it->second, {}, value});
+
+                constants.push_back(value);
+                defining_blocks.push_back(preheader);
+            }
+
+            return it->second;
+        };
+
+        // Definitions are visited before their uses, except for phis
+        for (auto id : reverse_postorder)
+        {
+            if (!in_loop(loop, id))
+            {
+                continue;
+            }
+
+            auto&                       instructions = function.blocks[id].instructions;
+            std::vector<ir_instruction> kept;
+            bool                        first_to_run = id == loop.header;
+
+            for (auto& instruction : instructions)
+            {
+                if (!can_hoist(loop, instruction, first_to_run))
+                {
+                    if (is_barrier(instruction))
+                    {
+                        first_to_run = false;
+                    }
+                    kept.push_back(std::move(instruction));
+                    continue;
+                }
+
+                // Constants stay where they are, since they are cheap and the superinstructions
+                // fold them into their users. The hoisted instruction uses a copy.
+                for (auto& operand : instruction.operands)
+                {
+                    if (in_loop(loop, defining_blocks[operand]))
+                    {
+                        operand = get_constant(*constants[operand]);
+                    }
+                }
+
+                defining_blocks[instruction.result] = preheader;
+                hoisted.push_back(std::move(instruction));
+                ++n_hoisted;
+            }
+            instructions = std::move(kept);
+        }
+
+        auto& target = function.blocks[preheader].instructions;
+        target.insert(target.end() - 1,
+                      std::make_move_iterator(hoisted.begin()),
+                      std::make_move_iterator(hoisted.end()));
+
+        return n_hoisted;
+    }
+
+ private:
+    // Variables
+    ir_function&                         function;
+    const std::vector<function_effects>& effects;
+    std::vector<std::optional<value_t>>  constants;
+    std::vector<ir_block_id>             defining_blocks;
+
+    // Methods
+    bool is_invariant(const natural_loop& loop, ir_value_id value) const
+    {
+        return !in_loop(loop, defining_blocks[value]) || constants[value].has_value();
+    }
+
+    // Instructions, which nothing that might trap or not terminate may be moved across
+    bool is_barrier(const ir_instruction& instruction) const
+    {
+        return instruction.op == ir_opcode::BUILTIN || instruction.op == ir_opcode::CALL
+               || can_trap(instruction, constants);
+    }
+
+    bool can_hoist(const natural_loop& loop, const ir_instruction& instruction, bool first_to_run)
+        const
+    {
+        if (instruction.op == ir_opcode::PHI || instruction.op == ir_opcode::CONSTANT
+            || instruction.op == ir_opcode::PARAMETER || instruction.op == ir_opcode::BUILTIN
+            || is_terminator(instruction.op) || instruction.result == NO_VALUE)
+        {
+            return false;
+        }
+        if (!std::ranges::all_of(instruction.operands,
+                                 [&](ir_value_id operand) { return is_invariant(loop, operand); }))
+        {
+            return false;
+        }
+
+        if (instruction.op == ir_opcode::CALL)
+        {
+            const auto& callee = effects[static_cast<std::size_t>(instruction.immediate)];
+
+            return callee.total || (callee.pure && first_to_run);
+        }
+
+        return !can_trap(instruction, constants) || first_to_run;
+    }
+};
+}    // namespace
+
+std::size_t hoist_loop_invariants(ir_program& program)
+{
+    const auto  effects   = analyze_effects(program);
+    std::size_t n_hoisted = 0;
+
+    for (auto& function : program.functions)
+    {
+        insert_preheaders(function);
+
+        dominator_tree dominators(function);
+        loop_info      loops(function, dominators);
+        loop_hoister   hoister(function, effects);
+
+        for (const auto& loop : loops.get_loops())
+        {
+            n_hoisted += hoister.hoist(loop, dominators.get_reverse_postorder());
+        }
+    }
+
+    return n_hoisted;
+}
@@ -0,0 +1,37 @@
+// Copyright © 2021-2022 Jonas Muehlmann
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#pragma once
+
+#include <cstddef>
+
+#include "ir.hpp"
+
+// Moves computations out of loops, whose operands do not change within the loop, into the
+// loop's preheader, the single block entering it. Loops entered from a block with several
+// successors get a new preheader on that edge first. Inner loops are processed first, so
+// values can move out of several loops.
+//
+// Besides side effect free instructions, calls of total functions (see effect_analysis.hpp)
+// and divisions by nonzero constants are hoisted, even if the loop might not run at all.
+// Calls of pure functions and divisions, which might trap, are only hoisted from the loop
+// header and only if no instruction with side effects precedes them there, since the
+// header runs at least once before anything else in the loop. Procedures, calls of impure
+// functions and builtins are never hoisted. Returns the number of hoisted instructions.
+std::size_t hoist_loop_invariants(ir_program& program);
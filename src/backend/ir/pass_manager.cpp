@@ -0,0 +1,77 @@
+// Copyright © 2021-2022 Jonas Muehlmann
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include "pass_manager.hpp"
+
+#include <stdexcept>
+#include <utility>
+
+#include "verifier.hpp"
+
+pass_manager::pass_manager(bool verify_) : verify(verify_) {}
+
+void pass_manager::add_pass(std::string name, ir_pass pass)
+{
+    passes.push_back({std::move(name), std::move(pass)});
+}
+
+void pass_manager::add_function_pass(std::string name, ir_function_pass pass)
+{
+    add_pass(std::move(name), [pass = std::move(pass)](ir_program& program) {
+        std::size_t n_changes = 0;
+
+        for (auto& function : program.functions)
+        {
+            n_changes += pass(function);
+        }
+
+        return n_changes;
+    });
+}
+
+std::vector<ir_pass_statistics> pass_manager::run(ir_program& program) const
+{
+    auto check = [this, &program](const std::string& stage) {
+        if (!verify)
+        {
+            return;
+        }
+
+        try
+        {
+            verify_program(program);
+        }
+        catch (const std::runtime_error& error)
+        {
+            throw std::runtime_error(stage + ": " + error.what());
+        }
+    };
+
+    std::vector<ir_pass_statistics> statistics;
+
+    check("Before the first pass");
+
+    for (const auto& [name, pass] : passes)
+    {
+        statistics.push_back({name, pass(program)});
+        check("After pass " + name);
+    }
+
+    return statistics;
+}
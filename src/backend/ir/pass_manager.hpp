@@ -0,0 +1,80 @@
+// Copyright © 2021-2022 Jonas Muehlmann
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "ir.hpp"
+#include <nlohmann/json.hpp>
+
+using json = nlohmann::ordered_json;
+
+// A pass transforms the program in place and returns the number of changes it made
+using ir_pass = std::function<std::size_t(ir_program&)>;
+
+// Transforms a single function, see add_function_pass
+using ir_function_pass = std::function<std::size_t(ir_function&)>;
+
+struct ir_pass_statistics
+{
+    std::string name;
+    std::size_t n_changes{};
+};
+
+inline void to_json(json& j, const std::vector<ir_pass_statistics>& statistics)
+{
+    j = json::object();
+
+    for (const auto& pass : statistics)
+    {
+        j[pass.name] = j.value(pass.name, std::size_t{0}) + pass.n_changes;
+    }
+}
+
+// Runs passes in the order they were added. With verification enabled, the program is
+// checked by the verifier before the first and after every pass, so a broken pass is
+// reported by name instead of miscompiling silently.
+class pass_manager
+{
+ public:
+    // Methods
+    explicit pass_manager(bool verify_ = true);
+
+    void add_pass(std::string name, ir_pass pass);
+
+    // The pass runs on every function of the program, its changes are summed up
+    void add_function_pass(std::string name, ir_function_pass pass);
+
+    std::vector<ir_pass_statistics> run(ir_program& program) const;
+
+ private:
+    struct entry
+    {
+        std::string name;
+        ir_pass     pass;
+    };
+
+    // Variables
+    std::vector<entry> passes;
+    bool               verify;
+};
@@ -0,0 +1,389 @@
+// Copyright © 2021-2022 Jonas Muehlmann
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include "strength_reduction.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "backend/value.hpp"
+#include "dominator_tree.hpp"
+#include "effect_analysis.hpp"
+#include "loop_info.hpp"
+
+namespace
+{
+// A phi in the loop header, which is incremented by a constant step along the back edge
+struct induction_variable
+{
+    ir_value_id value;
+    ir_value_id initial_value;
+    ir_value_id next_value;
+    ir_block_id increment_block;
+    value_t     step;
+};
+
+class induction_variable_reducer
+{
+ public:
+    // Methods
+    explicit induction_variable_reducer(ir_function& function_)
+        : function(function_),
+          dominators(function_),
+          loops(function_, dominators),
+          constants(collect_constants(function_)),
+          defining_blocks(function_.n_values, NO_BLOCK),
+          replacements(function_.n_values, NO_VALUE)
+    {
+        for (ir_block_id id = 0; id < function.blocks.size(); ++id)
+        {
+            for (const auto& instruction : function.blocks[id].instructions)
+            {
+                if (instruction.result != NO_VALUE)
+                {
+                    defining_blocks[instruction.result] = id;
+                }
+            }
+        }
+    }
+
+    std::size_t reduce()
+    {
+        std::size_t n_reduced = 0;
+
+        for (const auto& loop : loops.get_loops())
+        {
+            n_reduced += reduce(loop);
+        }
+
+        for (auto& block : function.blocks)
+        {
+            std::erase_if(block.instructions, [this](const ir_instruction& instruction) {
+                return instruction.result != NO_VALUE
+                       && replacements[instruction.result] != NO_VALUE;
+            });
+        }
+        replace_values(function, replacements);
+
+        return n_reduced;
+    }
+
+ private:
+    // Variables
+    ir_function&                        function;
+    dominator_tree                      dominators;
+    loop_info                           loops;
+    std::vector<std::optional<value_t>> constants;
+    std::vector<ir_block_id>            defining_blocks;
+    std::vector<ir_value_id>            replacements;
+
+    // Methods
+    bool in_loop(const natural_loop& loop, ir_value_id value) const
+    {
+        return std::ranges::binary_search(loop.blocks, defining_blocks[value]);
+    }
+
+    ir_instruction* find_definition(ir_block_id block, ir_value_id value)
+    {
+        auto& instructions = function.blocks[block].instructions;
+        auto  it           = std::ranges::find(instructions, value, &ir_instruction::result);
+
+        return it == instructions.end() ? nullptr : &*it;
+    }
+
+    std::vector<induction_variable> find_induction_variables(const natural_loop& loop,
+                                                             ir_block_id         preheader)
+    {
+        const auto& header  = function.blocks[loop.header];
+        const auto  latch   = loop.latches[0];
+        const auto  n_phis  = header.count_phis();
+        const auto  entry   = std::ranges::find(header.predecessors, preheader);
+        const auto  back    = std::ranges::find(header.predecessors, latch);
+        const auto  i_entry = static_cast<std::size_t>(entry - header.predecessors.begin());
+        const auto  i_back  = static_cast<std::size_t>(back - header.predecessors.begin());
+
+        std::vector<induction_variable> variables;
+
+        for (std::size_t i = 0; i < n_phis; ++i)
+        {
+            const auto& phi  = header.instructions[i];
+            const auto  next = phi.operands[i_back];
+
+            if (!in_loop(loop, next))
+            {
+                continue;
+            }
+
+            const auto* increment = find_definition(defining_blocks[next], next);
+
+            if (increment == nullptr
+                || (increment->op != ir_opcode::ADD && increment->op != ir_opcode::SUB))
+            {
+                continue;
+            }
+
+            auto lhs = increment->operands[0];
+            auto rhs = increment->operands[1];
+
+            if (increment->op == ir_opcode::ADD && lhs != phi.result)
+            {
+                std::swap(lhs, rhs);
+            }
+            if (lhs != phi.result || !constants[rhs].has_value())
+            {
+                continue;
+            }
+
+            const auto step = increment->op == ir_opcode::ADD ? *constants[rhs]
+                                                              : wrapping_sub(0, *constants[rhs]);
+
+            variables.push_back(
+                {phi.result, phi.operands[i_entry], next, defining_blocks[next], step});
+        }
+
+        return variables;
+    }
+
+    ir_value_id emit(ir_block_id block, std::size_t position, ir_instruction instruction)
+    {
+        auto& instructions = function.blocks[block].instructions;
+
+        const auto result = function.new_value();
+
+        defining_blocks.push_back(block);
+        replacements.push_back(NO_VALUE);
+        constants.push_back(instruction.op == ir_opcode::CONSTANT
+                                ? std::optional{instruction.immediate}
+                                : std::nullopt);
+
+        instruction.result = result;
+        instructions.insert(instructions.begin() + static_cast<std::ptrdiff_t>(position),
+                            std::move(instruction));
+
+        return result;
+    }
+
+    // Emits a * b at the end of the preheader, products with constants are folded where
+    // possible
+    ir_value_id emit_product(ir_block_id preheader, ir_value_id a, ir_value_id b)
+    {
+        const auto end = function.blocks[preheader].instructions.size() - 1;
+
+        if (constants[a].has_value() && constants[b].has_value())
+        {
+            const auto product = wrapping_mul(*constants[a], *constants[b]);
+
+            return emit(preheader, end, {ir_opcode::CONSTANT, NO_VALUE, {}, product});
+        }
+
+        for (auto [x, y] : {std::pair{a, b}, std::pair{b, a}})
+        {
+            if (constants[x] == 0)
+            {
+                return x;
+            }
+            if (constants[x] == 1)
+            {
+                return y;
+            }
+        }
+
+        return emit(preheader, end, {ir_opcode::MUL, NO_VALUE, {a, b}, 0});
+    }
+
+    std::size_t reduce(const natural_loop& loop)
+    {
+        const auto preheader = find_preheader(function, loop);
+
+        if (preheader == NO_BLOCK || loop.latches.size() != 1
+            || function.blocks[loop.header].predecessors.size() != 2)
+        {
+            return 0;
+        }
+
+        const auto variables = find_induction_variables(loop, preheader);
+
+        if (variables.empty())
+        {
+            return 0;
+        }
+
+        std::size_t n_reduced = 0;
+
+        // Multiplications running in every iteration
+        for (auto id : loop.blocks)
+        {
+            if (!dominators.dominates(id, loop.latches[0]))
+            {
+                continue;
+            }
+
+            // Copied, the instructions of the block change below
+            const auto instructions = function.blocks[id].instructions;
+
+            for (const auto& instruction : instructions)
+            {
+                // Inner loops come first and may have replaced it already
+                if (instruction.op != ir_opcode::MUL
+                    || replacements[instruction.result] != NO_VALUE)
+                {
+                    continue;
+                }
+
+                for (std::size_t side = 0; side < 2; ++side)
+                {
+                    auto variable = std::ranges::find(
+                        variables, instruction.operands[side], &induction_variable::value);
+                    auto factor = instruction.operands[1 - side];
+
+                    if (variable == variables.end()
+                        || (in_loop(loop, factor) && !constants[factor].has_value()))
+                    {
+                        continue;
+                    }
+
+                    replacements[instruction.result] = reduce(loop, preheader, *variable, factor);
+                    ++n_reduced;
+                    break;
+                }
+            }
+        }
+
+        return n_reduced;
+    }
+
+    // Creates the induction variable i * factor and returns its phi
+    ir_value_id reduce(const natural_loop&       loop,
+                       ir_block_id               preheader,
+                       const induction_variable& variable,
+                       ir_value_id               factor)
+    {
+        const auto factor_value = constants[factor];
+
+        // Constants defined in the loop do not dominate the preheader
+        if (factor_value.has_value() && in_loop(loop, factor))
+        {
+            factor = emit(preheader,
+                          function.blocks[preheader].instructions.size() - 1,
+                          {ir_opcode::CONSTANT, NO_VALUE, {}, *factor_value});
+        }
+
+        const auto initial = emit_product(preheader, variable.initial_value, factor);
+
+        auto step_constant = emit(preheader,
+                                  function.blocks[preheader].instructions.size() - 1,
+                                  {ir_opcode::CONSTANT, NO_VALUE, {}, variable.step});
+        auto step          = emit_product(preheader, step_constant, factor);
+
+        // The phi is placed first and the increment before the one of the variable and its
+        // constant step. The variable's increment is usually followed by the loop test, which
+        // can then still be fused with it.
+        auto& header   = function.blocks[loop.header];
+        auto  phi      = emit(loop.header, 0, {ir_opcode::PHI, NO_VALUE, {}, 0});
+        auto& block    = function.blocks[variable.increment_block].instructions;
+        auto  position = static_cast<std::size_t>(
+            std::ranges::find(block, variable.next_value, &ir_instruction::result)
+            - block.begin());
+
+        while (position > 0 && block[position - 1].op == ir_opcode::CONSTANT)
+        {
+            --position;
+        }
+        auto next = emit(variable.increment_block,
+                         position,
+                         {ir_opcode::ADD, NO_VALUE, {phi, step}, 0});
+
+        for (auto predecessor : header.predecessors)
+        {
+            header.instructions[0].operands.push_back(predecessor == preheader ? initial : next);
+        }
+
+        return phi;
+    }
+};
+
+// Rewrites x * 2^k to x << k
+std::size_t shift_multiplications(ir_function& function)
+{
+    const auto  constants = collect_constants(function);
+    std::size_t n_shifted = 0;
+
+    for (auto& block : function.blocks)
+    {
+        std::vector<ir_instruction> instructions;
+
+        for (auto& instruction : block.instructions)
+        {
+            if (instruction.op == ir_opcode::MUL)
+            {
+                auto is_power_of_two = [&constants](ir_value_id value) {
+                    const auto factor = constants[value];
+
+                    return factor.has_value() && *factor > 1
+                           && std::has_single_bit(static_cast<std::uint64_t>(*factor));
+                };
+
+                if (!is_power_of_two(instruction.operands[1])
+                    && is_power_of_two(instruction.operands[0]))
+                {
+                    std::swap(instruction.operands[0], instruction.operands[1]);
+                }
+
+                if (is_power_of_two(instruction.operands[1]))
+                {
+                    const auto factor = *constants[instruction.operands[1]];
+                    auto shift = function.new_value();
+
+                    instructions.push_back(
+                        {ir_opcode::CONSTANT,
+                         shift,
+                         {},
+                         std::countr_zero(static_cast<std::uint64_t>(factor))});
+
+                    instruction.op          = ir_opcode::LSHIFT;
+                    instruction.operands[1] = shift;
+                    ++n_shifted;
+                }
+            }
+            instructions.push_back(std::move(instruction));
+        }
+        block.instructions = std::move(instructions);
+    }
+
+    return n_shifted;
+}
+}    // namespace
+
+std::size_t reduce_strength(ir_program& program)
+{
+    std::size_t n_reduced = 0;
+
+    for (auto& function : program.functions)
+    {
+        n_reduced += induction_variable_reducer(function).reduce();
+        n_reduced += shift_multiplications(function);
+    }
+
+    return n_reduced;
+}
@@ -0,0 +1,157 @@
+// Copyright © 2021-2022 Jonas Muehlmann
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include "switch_strategy.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <limits>
+
+namespace
+{
+// Odd factors fitting into an immediate operand, 1 just selects bits of the value
+constexpr std::array<value_t, 5> HASH_MULTIPLIERS{
+    1, 0x2545F491, 0x5BD1E995, 0x01000193, 0x7FEB352D};
+
+// range is 0, if it covers all 2^64 values
+std::string describe_density(std::size_t n_cases, std::uint64_t range)
+{
+    auto permille = range == 0 ? 0 : n_cases * 1000 / range;
+
+    return std::to_string(permille / 10) + "." + std::to_string(permille % 10) + "% dense";
+}
+
+// Searches the multiplier and shift, which spread the values most evenly over a table with
+// at least twice as many slots as there are values. Slots may hold up to
+// MAX_HASH_SLOT_CASES values, which are compared in order.
+std::optional<switch_plan> find_hash(const std::vector<value_t>& values)
+{
+    switch_plan plan{.strategy   = switch_strategy::HASH,
+                     .table_size = std::bit_ceil(2 * values.size())};
+    switch_plan best;
+
+    std::vector<std::size_t> slot_sizes(plan.table_size);
+    // Comparisons needed to find every value once
+    std::size_t best_cost = std::numeric_limits<std::size_t>::max();
+    std::size_t best_max_size{};
+
+    for (auto multiplier : HASH_MULTIPLIERS)
+    {
+        plan.multiplier = multiplier;
+
+        for (value_t shift = 0; shift < 48 && best_cost > values.size(); ++shift)
+        {
+            plan.shift = shift;
+            std::ranges::fill(slot_sizes, 0);
+
+            std::size_t cost     = 0;
+            std::size_t max_size = 0;
+
+            for (auto value : values)
+            {
+                auto size = ++slot_sizes[hash_switch_value(plan, value)];
+
+                cost += size;
+                max_size = std::max(max_size, size);
+            }
+
+            if (max_size <= MAX_HASH_SLOT_CASES && cost < best_cost)
+            {
+                best          = plan;
+                best_cost     = cost;
+                best_max_size = max_size;
+            }
+        }
+    }
+
+    if (best_cost == std::numeric_limits<std::size_t>::max())
+    {
+        return std::nullopt;
+    }
+
+    best.reason = "hash into " + std::to_string(best.table_size) + " slots with at most "
+                  + std::to_string(best_max_size) + (best_max_size == 1 ? " case" : " cases")
+                  + " each";
+
+    return best;
+}
+}    // namespace
+
+switch_plan plan_switch(const std::vector<std::optional<value_t>>& case_values)
+{
+    if (std::ranges::any_of(case_values, [](const auto& value) { return !value.has_value(); }))
+    {
+        return {.reason = "not all case values are literals"};
+    }
+
+    std::vector<value_t> values;
+
+    for (const auto& value : case_values)
+    {
+        values.push_back(*value);
+    }
+    std::ranges::sort(values);
+    values.erase(std::ranges::unique(values).begin(), values.end());
+
+    auto n_cases = std::to_string(values.size()) + " cases";
+
+    if (values.size() < MIN_SWITCH_TABLE_CASES)
+    {
+        return {.reason = n_cases + ", too few for a table"};
+    }
+
+    // The difference of the extremes always fits, the number of values in between might not
+    auto span    = static_cast<std::uint64_t>(values.back())
+                - static_cast<std::uint64_t>(values.front());
+    auto range   = span + 1;
+    auto density = describe_density(values.size(), range);
+
+    if (span < MAX_JUMP_TABLE_SIZE && values.size() * 100 >= range * MIN_JUMP_TABLE_DENSITY)
+    {
+        return {.strategy = switch_strategy::JUMP_TABLE,
+                .reason   = n_cases + " in " + std::to_string(range) + " values from "
+                          + std::to_string(values.front()) + " to " + std::to_string(values.back())
+                          + ", " + density,
+                .offset   = values.front()};
+    }
+
+    if (values.size() >= MIN_HASH_CASES)
+    {
+        if (auto plan = find_hash(values))
+        {
+            plan->reason = n_cases + ", " + density + ", " + plan->reason;
+
+            return *plan;
+        }
+
+        return {.strategy = switch_strategy::BINARY_SEARCH,
+                .reason   = n_cases + ", " + density + ", no hash spreads them evenly"};
+    }
+
+    return {.strategy = switch_strategy::BINARY_SEARCH,
+            .reason   = n_cases + ", " + density + ", too few for hashing"};
+}
+
+std::size_t hash_switch_value(const switch_plan& plan, value_t value)
+{
+    auto hash = shift_right(wrapping_mul(value, plan.multiplier), plan.shift);
+
+    return static_cast<std::size_t>(hash & static_cast<value_t>(plan.table_size - 1));
+}
@@ -0,0 +1,122 @@
+// Copyright © 2021-2022 Jonas Muehlmann
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "backend/value.hpp"
+#include "enum_range.hpp"
+#include <nlohmann/json.hpp>
+
+using json = nlohmann::ordered_json;
+
+// How a switch selects the case matching its value. Comparing the cases in order costs a
+// dispatch per case, the other strategies need the case values at compile time.
+enum class switch_strategy
+{
+    // Compare the value with every case in order
+    COMPARISONS,
+    // Index a table covering all values from the smallest to the largest case
+    JUMP_TABLE,
+    // Narrow down the sorted cases with one comparison per level
+    BINARY_SEARCH,
+    // Index a table with a hash of the value and compare with the few cases in the slot
+    HASH
+};
+
+const auto LUT_SWITCH_STRATEGY_TO_STRING = []() {
+    using namespace std::literals::string_view_literals;
+
+    constexpr auto arr = []() {
+        std::array<std::string_view, EnumRange<switch_strategy, switch_strategy::HASH>().size()>
+            arr{};
+        arr.fill(""sv);
+
+        arr[static_cast<size_t>(switch_strategy::COMPARISONS)]   = "COMPARISONS"sv;
+        arr[static_cast<size_t>(switch_strategy::JUMP_TABLE)]    = "JUMP_TABLE"sv;
+        arr[static_cast<size_t>(switch_strategy::BINARY_SEARCH)] = "BINARY_SEARCH"sv;
+        arr[static_cast<size_t>(switch_strategy::HASH)]          = "HASH"sv;
+
+        return arr;
+    }();
+
+    static_assert(
+        std::ranges::count_if(arr, [](std::string_view str) { return str == ""sv; })
+            == 0,
+        "switch_strategy missing string representation");
+
+    return arr;
+}();
+
+inline void to_json(json& j, const switch_strategy& strategy)
+{
+    j = LUT_SWITCH_STRATEGY_TO_STRING[static_cast<size_t>(strategy)];
+}
+
+// Below this many distinct cases, comparing them in order is at least as fast as any table
+inline constexpr std::size_t MIN_SWITCH_TABLE_CASES = 4;
+// Jump tables are used, if at least this percentage of the covered values are cases
+inline constexpr std::size_t MIN_JUMP_TABLE_DENSITY = 40;
+inline constexpr std::size_t MAX_JUMP_TABLE_SIZE    = 4096;
+// A hash costs about as many dispatches as a binary search over this many cases
+inline constexpr std::size_t MIN_HASH_CASES      = 32;
+inline constexpr std::size_t MAX_HASH_SLOT_CASES = 3;
+
+struct switch_plan
+{
+    switch_strategy strategy{switch_strategy::COMPARISONS};
+    std::string     reason;
+    // JUMP_TABLE: slot = value - offset
+    value_t         offset{};
+    // HASH: slot = ((value * multiplier) >> shift) & (table_size - 1)
+    value_t         multiplier{1};
+    value_t         shift{};
+    std::size_t     table_size{};
+};
+
+// Which strategy the code generator chose for a switch, and why
+struct switch_report
+{
+    std::string     function;
+    std::size_t     n_cases{};
+    switch_strategy strategy{};
+    std::string     reason;
+};
+
+inline void to_json(json& j, const switch_report& report)
+{
+    j = json{{"function", report.function},
+             {"n_cases", report.n_cases},
+             {"strategy", report.strategy},
+             {"reason", report.reason}};
+}
+
+// Chooses the strategy for a switch with the given case values, in source order. Cases,
+// which are no literals, are nullopt. Later duplicates of a value can never be selected and
+// do not count.
+switch_plan plan_switch(const std::vector<std::optional<value_t>>& case_values);
+
+// Table slot of value for the HASH strategy, computed like the bytecode does
+std::size_t hash_switch_value(const switch_plan& plan, value_t value);
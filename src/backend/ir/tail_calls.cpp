@@ -0,0 +1,149 @@
+// Copyright © 2021-2022 Jonas Muehlmann
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include "tail_calls.hpp"
+
+#include <numeric>
+#include <vector>
+
+#include "cleanup_passes.hpp"
+
+namespace
+{
+std::size_t eliminate_tail_recursion(ir_function& function, std::size_t index)
+{
+    std::vector<ir_block_id> tail_calls;
+
+    for (ir_block_id id = 0; id < function.blocks.size(); ++id)
+    {
+        const auto& block = function.blocks[id];
+        auto        call  = find_tail_call(block);
+
+        if (call && block.instructions[*call].immediate == static_cast<value_t>(index))
+        {
+            tail_calls.push_back(id);
+        }
+    }
+
+    if (tail_calls.empty())
+    {
+        return 0;
+    }
+
+    // The parameters move to a new entry block, the old one becomes the loop header
+    const auto entry  = function.new_block();
+    auto&      header = function.blocks[0];
+
+    std::vector<ir_value_id> parameters(function.n_parameters, NO_VALUE);
+    std::vector<ir_value_id> replacements;
+
+    std::erase_if(header.instructions, [&](const ir_instruction& instruction) {
+        if (instruction.op != ir_opcode::PARAMETER)
+        {
+            return false;
+        }
+        parameters[static_cast<std::size_t>(instruction.immediate)] = instruction.result;
+        function.blocks[entry].instructions.push_back(instruction);
+
+        return true;
+    });
+
+    std::vector<ir_instruction> phis;
+
+    for (std::size_t i = 0; i < parameters.size(); ++i)
+    {
+        // Parameters, which are never read, are not defined either
+        if (parameters[i] == NO_VALUE)
+        {
+            parameters[i] = function.new_value();
+            function.blocks[entry].instructions.push_back(
+                {ir_opcode::PARAMETER, parameters[i], {}, static_cast<value_t>(i)});
+        }
+
+        auto phi = function.new_value();
+
+        replacements.resize(function.n_values, NO_VALUE);
+        replacements[parameters[i]] = phi;
+        phis.push_back({ir_opcode::PHI, phi, {parameters[i]}, 0});
+    }
+    replace_values(function, replacements);
+
+    function.blocks[entry].instructions.push_back({ir_opcode::JUMP, NO_VALUE, {}, 0});
+    add_edge(function, entry, 0);
+
+    for (auto id : tail_calls)
+    {
+        auto& instructions = function.blocks[id].instructions;
+        auto  arguments    = instructions[instructions.size() - 2].operands;
+
+        instructions.resize(instructions.size() - 2);
+        instructions.push_back({ir_opcode::JUMP, NO_VALUE, {}, 0});
+        add_edge(function, id, 0);
+
+        for (std::size_t i = 0; i < phis.size(); ++i)
+        {
+            phis[i].operands.push_back(arguments[i]);
+        }
+    }
+
+    auto& instructions = function.blocks[0].instructions;
+    instructions.insert(instructions.begin(), phis.begin(), phis.end());
+
+    std::vector<ir_block_id> order(function.blocks.size() - 1);
+    std::iota(order.begin(), order.end(), 0);
+    order.insert(order.begin(), entry);
+
+    reorder_blocks(function, order);
+    remove_trivial_phis(function);
+
+    return tail_calls.size();
+}
+}    // namespace
+
+std::optional<std::size_t> find_tail_call(const ir_block& block)
+{
+    const auto& instructions = block.instructions;
+
+    if (instructions.size() < 2 || instructions.back().op != ir_opcode::RET)
+    {
+        return std::nullopt;
+    }
+
+    const auto  index = instructions.size() - 2;
+    const auto& call  = instructions[index];
+
+    if (call.op != ir_opcode::CALL || instructions.back().operands[0] != call.result)
+    {
+        return std::nullopt;
+    }
+
+    return index;
+}
+
+std::size_t eliminate_tail_recursion(ir_program& program)
+{
+    std::size_t n_changes = 0;
+
+    for (std::size_t i = 0; i < program.functions.size(); ++i)
+    {
+        n_changes += eliminate_tail_recursion(program.functions[i], i);
+    }
+
+    return n_changes;
+}
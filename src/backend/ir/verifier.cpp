@@ -0,0 +1,415 @@
+// Copyright © 2021-2022 Jonas Muehlmann
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include "verifier.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "dominator_tree.hpp"
+
+namespace
+{
+struct definition
+{
+    ir_block_id block{NO_BLOCK};
+    std::size_t index{};
+};
+
+// Expected number of operands, or nullopt if it depends on the context
+std::optional<std::size_t> get_operand_count(ir_opcode op)
+{
+    switch (op)
+    {
+        case ir_opcode::CONSTANT:
+        case ir_opcode::PARAMETER:
+        case ir_opcode::JUMP:
+            return 0;
+        case ir_opcode::COPY:
+        case ir_opcode::NOT:
+        case ir_opcode::SWITCH:
+        case ir_opcode::RET:
+            return 1;
+        case ir_opcode::ADD:
+        case ir_opcode::SUB:
+        case ir_opcode::MUL:
+        case ir_opcode::DIV:
+        case ir_opcode::MOD:
+        case ir_opcode::AND:
+        case ir_opcode::OR:
+        case ir_opcode::XOR:
+        case ir_opcode::LSHIFT:
+        case ir_opcode::RSHIFT:
+        case ir_opcode::COMPARE:
+        case ir_opcode::BRANCH:
+            return 2;
+        default:
+            return std::nullopt;
+    }
+}
+
+std::size_t get_successor_count(ir_opcode op)
+{
+    return op == ir_opcode::JUMP ? 1 : op == ir_opcode::BRANCH ? 2 : 0;
+}
+
+class verifier
+{
+ public:
+    // Methods
+    verifier(const ir_program& program_, const ir_function& function_)
+        : program(program_), function(function_), definitions(function_.n_values)
+    {
+    }
+
+    void run()
+    {
+        for (ir_block_id block = 0; block < function.blocks.size(); ++block)
+        {
+            check_block(block);
+        }
+
+        if (!function.blocks.empty() && !function.blocks[0].predecessors.empty())
+        {
+            error("entry block has predecessors");
+        }
+
+        // Dominance is only meaningful once the edges are consistent
+        if (errors.empty())
+        {
+            check_dominance();
+        }
+
+        if (!errors.empty())
+        {
+            std::string message = "Invalid IR in function " + function.name + ":";
+
+            for (const auto& error : errors)
+            {
+                message += "\n    " + error;
+            }
+
+            throw std::runtime_error(message + "\n" + to_string(function));
+        }
+    }
+
+ private:
+    // Variables
+    const ir_program&        program;
+    const ir_function&       function;
+    std::vector<definition>  definitions;
+    std::vector<std::string> errors;
+
+    // Methods
+    void error(const std::string& message)
+    {
+        errors.push_back(message);
+    }
+
+    static std::string name(ir_block_id block)
+    {
+        return "b" + std::to_string(block);
+    }
+
+    void check_block(ir_block_id id)
+    {
+        const auto& block = function.blocks[id];
+
+        if (block.instructions.empty() || !is_terminator(block.terminator().op))
+        {
+            error(name(id) + " does not end with a terminator");
+
+            return;
+        }
+
+        if (block.terminator().op == ir_opcode::SWITCH)
+        {
+            check_switch(id);
+        }
+        else if (get_successor_count(block.terminator().op) != block.successors.size())
+        {
+            error(name(id) + " has " + std::to_string(block.successors.size())
+                  + " successors, which does not match its terminator");
+        }
+
+        check_edges(id);
+
+        bool phis_allowed = true;
+
+        for (std::size_t i = 0; i < block.instructions.size(); ++i)
+        {
+            const auto& instruction = block.instructions[i];
+            auto        where       = name(id) + ":" + std::to_string(i) + " ";
+
+            if (is_terminator(instruction.op) && i + 1 != block.instructions.size())
+            {
+                error(where + "terminator in the middle of the block");
+            }
+
+            if (instruction.op != ir_opcode::PHI)
+            {
+                phis_allowed = false;
+            }
+            else if (!phis_allowed)
+            {
+                error(where + "phi after another instruction");
+            }
+
+            check_instruction(id, i, where);
+        }
+    }
+
+    // Tables may only refer to existing successors, which must be distinct
+    void check_switch(ir_block_id id)
+    {
+        const auto& block   = function.blocks[id];
+        const auto& targets = block.terminator().targets;
+
+        if (block.successors.empty())
+        {
+            error(name(id) + " switches without a default successor");
+        }
+
+        if (std::ranges::any_of(targets, [&block](std::uint32_t target) {
+                return target >= block.successors.size();
+            }))
+        {
+            error(name(id) + " switches to a successor, which it does not have");
+        }
+
+        for (auto successor = block.successors.begin(); successor != block.successors.end();
+             ++successor)
+        {
+            if (std::find(block.successors.begin(), successor, *successor) != successor)
+            {
+                error(name(id) + " switches to " + name(*successor) + " twice");
+            }
+        }
+    }
+
+    void check_edges(ir_block_id id)
+    {
+        const auto& block = function.blocks[id];
+
+        auto count = [](const std::vector<ir_block_id>& blocks, ir_block_id block) {
+            return std::ranges::count(blocks, block);
+        };
+
+        for (auto successor : block.successors)
+        {
+            if (successor >= function.blocks.size())
+            {
+                error(name(id) + " has an invalid successor");
+            }
+            else if (count(block.successors, successor)
+                     != count(function.blocks[successor].predecessors, id))
+            {
+                error("edge " + name(id) + " -> " + name(successor)
+                      + " is missing from the predecessors");
+            }
+        }
+
+        for (auto predecessor : block.predecessors)
+        {
+            if (predecessor >= function.blocks.size())
+            {
+                error(name(id) + " has an invalid predecessor");
+            }
+            else if (count(block.predecessors, predecessor)
+                     != count(function.blocks[predecessor].successors, id))
+            {
+                error("edge " + name(predecessor) + " -> " + name(id)
+                      + " is missing from the successors");
+            }
+        }
+    }
+
+    void check_instruction(ir_block_id id, std::size_t index, const std::string& where)
+    {
+        const auto& instruction = function.blocks[id].instructions[index];
+        auto        op_name     = std::string(
+            LUT_IR_OPCODE_TO_STRING[static_cast<std::size_t>(instruction.op)]);
+
+        auto expected = get_operand_count(instruction.op);
+
+        if (instruction.op == ir_opcode::PHI)
+        {
+            expected = function.blocks[id].predecessors.size();
+        }
+        if (instruction.op == ir_opcode::CALL && instruction.immediate >= 0
+            && static_cast<std::size_t>(instruction.immediate) < program.functions.size())
+        {
+            expected = program.functions[static_cast<std::size_t>(instruction.immediate)]
+                           .n_parameters;
+        }
+
+        if (expected.has_value() && instruction.operands.size() != *expected)
+        {
+            error(where + op_name + " has " + std::to_string(instruction.operands.size())
+                  + " operands instead of " + std::to_string(*expected));
+        }
+
+        for (auto operand : instruction.operands)
+        {
+            if (operand >= function.n_values)
+            {
+                error(where + "operand is not a value");
+            }
+        }
+
+        check_immediate(id, instruction, where + op_name + " ");
+
+        const bool needs_result = has_result(instruction.op, instruction.immediate);
+
+        if (needs_result != (instruction.result != NO_VALUE))
+        {
+            error(where + op_name + (needs_result ? " needs" : " must not have") + " a result");
+        }
+
+        if (instruction.result == NO_VALUE)
+        {
+            return;
+        }
+
+        if (instruction.result >= function.n_values)
+        {
+            error(where + "result is not a value");
+        }
+        else if (definitions[instruction.result].block != NO_BLOCK)
+        {
+            error(where + "v" + std::to_string(instruction.result) + " is defined twice");
+        }
+        else
+        {
+            definitions[instruction.result] = {id, index};
+        }
+    }
+
+    void check_immediate(ir_block_id           id,
+                         const ir_instruction& instruction,
+                         const std::string&    where)
+    {
+        auto immediate = instruction.immediate;
+
+        switch (instruction.op)
+        {
+            case ir_opcode::PARAMETER:
+                if (id != 0 || immediate < 0
+                    || static_cast<std::size_t>(immediate) >= function.n_parameters)
+                {
+                    error(where + "is not a parameter of the entry block");
+                }
+                break;
+            case ir_opcode::CALL:
+                if (immediate < 0
+                    || static_cast<std::size_t>(immediate) >= program.functions.size())
+                {
+                    error(where + "calls an undefined function");
+                }
+                break;
+            case ir_opcode::COMPARE:
+            case ir_opcode::BRANCH:
+                if (immediate < 0 || immediate > static_cast<value_t>(ir_condition::GREATEREQ))
+                {
+                    error(where + "has an invalid condition");
+                }
+                break;
+            default:
+                break;
+        }
+    }
+
+    void check_dominance()
+    {
+        dominator_tree dominators(function);
+
+        for (ir_block_id id = 0; id < function.blocks.size(); ++id)
+        {
+            if (!dominators.is_reachable(id))
+            {
+                continue;
+            }
+
+            const auto& block = function.blocks[id];
+
+            for (std::size_t i = 0; i < block.instructions.size(); ++i)
+            {
+                const auto& instruction = block.instructions[i];
+
+                for (std::size_t j = 0; j < instruction.operands.size(); ++j)
+                {
+                    auto operand = instruction.operands[j];
+
+                    if (operand >= function.n_values)
+                    {
+                        continue;
+                    }
+
+                    const auto& def = definitions[operand];
+                    auto where =
+                        name(id) + ":" + std::to_string(i) + " v" + std::to_string(operand);
+
+                    if (def.block == NO_BLOCK)
+                    {
+                        error(where + " is never defined");
+                    }
+                    else if (instruction.op == ir_opcode::PHI)
+                    {
+                        // Phi operands are used at the end of the predecessor
+                        auto predecessor = block.predecessors[j];
+
+                        if (dominators.is_reachable(predecessor)
+                            && !dominators.dominates(def.block, predecessor))
+                        {
+                            error(where + " does not dominate the end of " + name(predecessor));
+                        }
+                    }
+                    else if (def.block == id ? def.index >= i
+                                             : !dominators.dominates(def.block, id))
+                    {
+                        error(where + " does not dominate its use");
+                    }
+                }
+            }
+        }
+    }
+};
+}    // namespace
+
+void verify_function(const ir_program& program, const ir_function& function)
+{
+    verifier(program, function).run();
+}
+
+void verify_program(const ir_program& program)
+{
+    if (program.main_function >= program.functions.size())
+    {
+        throw std::runtime_error("Invalid IR: main function does not exist");
+    }
+
+    for (const auto& function : program.functions)
+    {
+        verify_function(program, function);
+    }
+}
@@ -19,6 +19,50 @@
 // OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 #pragma once
+
+#include <array>
+#include <cstddef>
+#include <string_view>
+
+#include "enum_range.hpp"
+#include <nlohmann/json.hpp>
+
+using json = nlohmann::ordered_json;
+
+// Operand layout (see instruction.hpp):
+//   arithmetic/binary: a = destination, b = lhs, c = rhs
+//   INC/DEC:           a = register to modify in place
+//   NOT:               a = destination, b = operand (logical negation, the language's !)
+//   conditional jumps: a = target, b = lhs, c = rhs
+//   JUMP:              a = target
+//   SET:               a = destination, b = source
+//   SETLIT:            a = destination, b = index into the constant pool
+//   PRINT:             a = register to print
+//   READ:              a = destination of the next integer of the input
+//   CALL:              a = destination, b = function index, c = first argument register,
+//                      the callee's registers start there, so the call clobbers the
+//                      caller's registers from c on
+//   RET:               a = register holding the return value
+//   TAILCALL:          b = function index, c = first argument register, the callee reuses
+//                      the caller's frame and returns to the caller's caller
+//
+// Superinstructions replace frequent instruction sequences (see
+// code_generator/superinstructions.hpp), the immediate is stored in the instruction itself:
+//   arithmetic/binary with immediate: a = destination, b = lhs, c = immediate rhs
+//   conditional jumps with immediate: a = target, b = lhs, c = immediate rhs
+//   INCJUMPLESS:                      a = target, b = register to increment, c = bound
+//   INCJUMPLESSI:                     a = target, b = register to increment, c = immediate
+//
+// Division and modulo by constants (see code_generator/constant_division.hpp):
+//   DIVPOW2I/MODPOW2I: a = destination, b = dividend, c = log2 of the divisor
+//   DIVMAGIC/MODMAGIC: a = destination, b = dividend, c = index of the divisor's magic
+//                      multiplier in the constant pool, followed by the shift and the
+//                      divisor itself
+//
+// Switches (see ir/switch_strategy.hpp):
+//   JUMPTABLE: a = index register, b = index of the table in the constant pool, c = number
+//              of entries. Jumps to the entry at the index, if it is in range, otherwise
+//              continues with the next instruction.
 enum class opcode
 {
     // Arithmetic
@@ -49,4 +93,112 @@ enum class opcode
     SETLIT,
     JUMP,
     PRINT,
+    READ,
+    CALL,
+    RET,
+    TAILCALL,
+    // Superinstructions
+    ADDI,
+    MULI,
+    DIVI,
+    MODI,
+    ANDI,
+    LSHIFTI,
+    RSHIFTI,
+    JUMPEQI,
+    JUMPNEQI,
+    JUMPLESSI,
+    JUMPGREATERI,
+    JUMPLEQI,
+    JUMPGEQI,
+    INCJUMPLESS,
+    INCJUMPLESSI,
+    // Division by constants
+    DIVPOW2I,
+    MODPOW2I,
+    DIVMAGIC,
+    MODMAGIC,
+    // Switches
+    JUMPTABLE,
 };
+
+inline constexpr opcode LAST_OPCODE = opcode::JUMPTABLE;
+
+const int NUM_OPCODES = []() {
+    EnumRange<opcode, LAST_OPCODE> range;
+
+    return range.size();
+}();
+
+const auto ALL_OPCODES = enum_to_array<opcode, LAST_OPCODE>();
+
+const auto LUT_OPCODE_TO_STRING = []() {
+    using namespace std::literals::string_view_literals;
+
+    constexpr auto arr = []() {
+        std::array<std::string_view, EnumRange<opcode, LAST_OPCODE>().size()> arr{};
+        arr.fill(""sv);
+
+        arr[static_cast<size_t>(opcode::ADD)]          = "ADD"sv;
+        arr[static_cast<size_t>(opcode::SUB)]          = "SUB"sv;
+        arr[static_cast<size_t>(opcode::MUL)]          = "MUL"sv;
+        arr[static_cast<size_t>(opcode::DIV)]          = "DIV"sv;
+        arr[static_cast<size_t>(opcode::MOD)]          = "MOD"sv;
+        arr[static_cast<size_t>(opcode::INC)]          = "INC"sv;
+        arr[static_cast<size_t>(opcode::DEC)]          = "DEC"sv;
+        arr[static_cast<size_t>(opcode::AND)]          = "AND"sv;
+        arr[static_cast<size_t>(opcode::OR)]           = "OR"sv;
+        arr[static_cast<size_t>(opcode::NOT)]          = "NOT"sv;
+        arr[static_cast<size_t>(opcode::LSHIFT)]       = "LSHIFT"sv;
+        arr[static_cast<size_t>(opcode::RSHIFT)]       = "RSHIFT"sv;
+        arr[static_cast<size_t>(opcode::XOR)]          = "XOR"sv;
+        arr[static_cast<size_t>(opcode::JUMPEQ)]       = "JUMPEQ"sv;
+        arr[static_cast<size_t>(opcode::JUMPNEQ)]      = "JUMPNEQ"sv;
+        arr[static_cast<size_t>(opcode::JUMPLESS)]     = "JUMPLESS"sv;
+        arr[static_cast<size_t>(opcode::JUMPGREATER)]  = "JUMPGREATER"sv;
+        arr[static_cast<size_t>(opcode::JUMPLEQ)]      = "JUMPLEQ"sv;
+        arr[static_cast<size_t>(opcode::JUMPGEQ)]      = "JUMPGEQ"sv;
+        arr[static_cast<size_t>(opcode::SET)]          = "SET"sv;
+        arr[static_cast<size_t>(opcode::SETLIT)]       = "SETLIT"sv;
+        arr[static_cast<size_t>(opcode::JUMP)]         = "JUMP"sv;
+        arr[static_cast<size_t>(opcode::PRINT)]        = "PRINT"sv;
+        arr[static_cast<size_t>(opcode::READ)]         = "READ"sv;
+        arr[static_cast<size_t>(opcode::CALL)]         = "CALL"sv;
+        arr[static_cast<size_t>(opcode::RET)]          = "RET"sv;
+        arr[static_cast<size_t>(opcode::TAILCALL)]     = "TAILCALL"sv;
+        arr[static_cast<size_t>(opcode::ADDI)]         = "ADDI"sv;
+        arr[static_cast<size_t>(opcode::MULI)]         = "MULI"sv;
+        arr[static_cast<size_t>(opcode::DIVI)]         = "DIVI"sv;
+        arr[static_cast<size_t>(opcode::MODI)]         = "MODI"sv;
+        arr[static_cast<size_t>(opcode::ANDI)]         = "ANDI"sv;
+        arr[static_cast<size_t>(opcode::LSHIFTI)]      = "LSHIFTI"sv;
+        arr[static_cast<size_t>(opcode::RSHIFTI)]      = "RSHIFTI"sv;
+        arr[static_cast<size_t>(opcode::JUMPEQI)]      = "JUMPEQI"sv;
+        arr[static_cast<size_t>(opcode::JUMPNEQI)]     = "JUMPNEQI"sv;
+        arr[static_cast<size_t>(opcode::JUMPLESSI)]    = "JUMPLESSI"sv;
+        arr[static_cast<size_t>(opcode::JUMPGREATERI)] = "JUMPGREATERI"sv;
+        arr[static_cast<size_t>(opcode::JUMPLEQI)]     = "JUMPLEQI"sv;
+        arr[static_cast<size_t>(opcode::JUMPGEQI)]     = "JUMPGEQI"sv;
+        arr[static_cast<size_t>(opcode::INCJUMPLESS)]  = "INCJUMPLESS"sv;
+        arr[static_cast<size_t>(opcode::INCJUMPLESSI)] = "INCJUMPLESSI"sv;
+        arr[static_cast<size_t>(opcode::DIVPOW2I)]     = "DIVPOW2I"sv;
+        arr[static_cast<size_t>(opcode::MODPOW2I)]     = "MODPOW2I"sv;
+        arr[static_cast<size_t>(opcode::DIVMAGIC)]     = "DIVMAGIC"sv;
+        arr[static_cast<size_t>(opcode::MODMAGIC)]     = "MODMAGIC"sv;
+        arr[static_cast<size_t>(opcode::JUMPTABLE)]    = "JUMPTABLE"sv;
+
+        return arr;
+    }();
+
+    static_assert(
+        std::ranges::count_if(arr, [](std::string_view str) { return str == ""sv; })
+            == 0,
+        "opcode missing string representation");
+
+    return arr;
+}();
+
+inline void to_json(json& j, const opcode& op)
+{
+    j = LUT_OPCODE_TO_STRING[static_cast<size_t>(op)];
+}
@@ -19,6 +19,9 @@
 // OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 #pragma once
+
+// Requests of a program to its environment, which the register machine serves through its
+// buffers (see interpreter/buffered_io.hpp): READ is the builtin read, WRITE is print.
 enum class trap
 {
     READ,
@@ -0,0 +1,147 @@
+// Copyright © 2021-2022 Jonas Muehlmann
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+
+// MVPL only knows 64 bit integers. Overflow wraps around (two's complement), so every
+// operation is defined here once and shared by the interpreter and compile time
+// evaluation.
+using value_t = std::int64_t;
+
+inline value_t wrapping_add(value_t lhs, value_t rhs)
+{
+    return static_cast<value_t>(static_cast<std::uint64_t>(lhs) + static_cast<std::uint64_t>(rhs));
+}
+
+inline value_t wrapping_sub(value_t lhs, value_t rhs)
+{
+    return static_cast<value_t>(static_cast<std::uint64_t>(lhs) - static_cast<std::uint64_t>(rhs));
+}
+
+inline value_t wrapping_mul(value_t lhs, value_t rhs)
+{
+    return static_cast<value_t>(static_cast<std::uint64_t>(lhs) * static_cast<std::uint64_t>(rhs));
+}
+
+inline value_t checked_div(value_t lhs, value_t rhs)
+{
+    if (rhs == 0)
+    {
+        throw std::runtime_error("Division by zero");
+    }
+    // The only quotient, which does not fit into 64 bits
+    if (rhs == -1)
+    {
+        return wrapping_sub(0, lhs);
+    }
+
+    return lhs / rhs;
+}
+
+inline value_t checked_mod(value_t lhs, value_t rhs)
+{
+    if (rhs == 0)
+    {
+        throw std::runtime_error("Modulo by zero");
+    }
+    if (rhs == -1)
+    {
+        return 0;
+    }
+
+    return lhs % rhs;
+}
+
+// Shift amounts are taken modulo the bit width, like on x86-64
+inline value_t shift_left(value_t lhs, value_t rhs)
+{
+    return static_cast<value_t>(static_cast<std::uint64_t>(lhs) << (rhs & 63));
+}
+
+inline value_t shift_right(value_t lhs, value_t rhs)
+{
+    return lhs >> (rhs & 63);
+}
+
+// Upper 64 bits of the 128 bit product
+inline value_t multiply_high(value_t lhs, value_t rhs)
+{
+#ifdef __SIZEOF_INT128__
+    __extension__ using int128_t = __int128;
+
+    return static_cast<value_t>((static_cast<int128_t>(lhs) * rhs) >> 64);
+#else
+    // Unsigned product from 32 bit halves, corrected for the signs (Hacker's Delight 8-3)
+    const auto u = static_cast<std::uint64_t>(lhs);
+    const auto v = static_cast<std::uint64_t>(rhs);
+
+    const std::uint64_t low_low   = (u & 0xFFFF'FFFF) * (v & 0xFFFF'FFFF);
+    const std::uint64_t high_low  = (u >> 32) * (v & 0xFFFF'FFFF) + (low_low >> 32);
+    const std::uint64_t low_high  = (u & 0xFFFF'FFFF) * (v >> 32) + (high_low & 0xFFFF'FFFF);
+    const std::uint64_t high_high = (u >> 32) * (v >> 32) + (high_low >> 32) + (low_high >> 32);
+
+    return wrapping_sub(wrapping_sub(static_cast<value_t>(high_high), lhs < 0 ? rhs : 0),
+                        rhs < 0 ? lhs : 0);
+#endif
+}
+
+// Division and modulo by constant divisors, see code_generator/constant_division.hpp. They
+// round towards zero like checked_div and checked_mod.
+
+// lhs / 2^shift for 0 < shift < 63: negative dividends are biased by 2^shift - 1, so the
+// arithmetic shift rounds towards zero
+inline value_t divide_by_power_of_two(value_t lhs, value_t shift)
+{
+    const value_t bias = (lhs >> 63) & ((value_t{1} << shift) - 1);
+
+    return (lhs + bias) >> shift;
+}
+
+// lhs % 2^shift for 0 < shift < 63, the result has the sign of the dividend
+inline value_t modulo_by_power_of_two(value_t lhs, value_t shift)
+{
+    const value_t mask = (value_t{1} << shift) - 1;
+    const value_t bias = (lhs >> 63) & mask;
+
+    return ((lhs + bias) & mask) - bias;
+}
+
+// lhs / divisor with the divisor's magic multiplier and shift (Hacker's Delight 10-4)
+inline value_t divide_by_magic(value_t lhs, value_t multiplier, value_t shift, value_t divisor)
+{
+    value_t quotient = multiply_high(lhs, multiplier);
+
+    if (divisor > 0 && multiplier < 0)
+    {
+        quotient = wrapping_add(quotient, lhs);
+    }
+    else if (divisor < 0 && multiplier > 0)
+    {
+        quotient = wrapping_sub(quotient, lhs);
+    }
+    quotient >>= shift;
+
+    // Rounds negative quotients towards zero
+    return quotient + static_cast<value_t>(static_cast<std::uint64_t>(quotient) >> 63);
+}
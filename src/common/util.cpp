@@ -44,6 +44,34 @@ json ast_to_json(const ast_node_t& ast)
     return {{"ast", ast}};
 }
 
+json generated_code_to_json(const bytecode_program& program)
+{
+    // Double brackets to define as key-value pair instead of list
+    return {{"generated_code", program}};
+}
+
+json optimized_ast_to_json(const ast_node_t& ast)
+{
+    // Double brackets to define as key-value pair instead of list
+    return {{"optimized_ast", ast}};
+}
+
+json optimization_report_to_json(const ast_optimization_report& ast_report,
+                                 const code_generator_report&   code_generator_report)
+{
+    json report = ast_report;
+    report.update(json(code_generator_report));
+
+    // Double brackets to define as key-value pair instead of list
+    return {{"optimization_report", report}};
+}
+
+json program_output_to_json(std::string_view program_output)
+{
+    // Double brackets to define as key-value pair instead of list
+    return {{"program_output", program_output}};
+}
+
 void write_json_to_file(std::string_view file_path, json j)
 {
     std::ofstream file(file_path.data());
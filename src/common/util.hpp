@@ -23,14 +23,22 @@
 #include <string_view>
 #include <vector>
 
+#include "backend/bytecode_program.hpp"
+#include "backend/code_generator/code_generator.hpp"
 #include "frontend/lexer/token.hpp"
 #include "frontend/lexer/token_type.hpp"
 #include "frontend/parser/ast_node.hpp"
+#include "optimizer/ast_optimizer.hpp"
 #include "source_location.hpp"
 
 using json = nlohmann::ordered_json;
 
 json token_stream_to_json(const std::vector<token>& token_stream);
 json ast_to_json(const ast_node_t& ast);
+json generated_code_to_json(const bytecode_program& program);
+json optimized_ast_to_json(const ast_node_t& ast);
+json optimization_report_to_json(const ast_optimization_report& ast_report,
+                                 const code_generator_report&   code_generator_report);
+json program_output_to_json(std::string_view program_output);
 
 void write_json_to_file(std::string_view file_path, json j);
@@ -217,9 +217,9 @@ struct expression_parser
                               int              previous_operator_precedence = 0);
 };
 
-parse_result binary_op_parser::parse(std::span<token> ts,
-                                     parse_result&    lhs,
-                                     int              previous_operator_precedence)
+inline parse_result binary_op_parser::parse(std::span<token> ts,
+                                            parse_result&    lhs,
+                                            int              previous_operator_precedence)
 {
     if (ts.empty())
     {
@@ -278,8 +278,8 @@ parse_result binary_op_parser::parse(std::span<token> ts,
                         std::move(new_node));
 }
 
-parse_result expression_parser::parse(std::span<token> ts,
-                                      int              previous_operator_precedence)
+inline parse_result expression_parser::parse(std::span<token> ts,
+                                             int              previous_operator_precedence)
 {
     if (ts.empty())
     {
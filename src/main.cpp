@@ -17,17 +17,34 @@
 // DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
 // TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
 // OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <filesystem>
 #include <fstream>
 #include <iostream>
 #include <iterator>
 #include <map>
 #include <memory>
+#include <optional>
 #include <ostream>
+#include <sstream>
 #include <stdexcept>
 #include <streambuf>
 #include <string>
 #include <unordered_set>
+#include <utility>
+#include <vector>
 
+#include "backend/bytecode_image.hpp"
+#include "backend/c_backend/c_compiler.hpp"
+#include "backend/c_backend/c_translator.hpp"
+#include "backend/code_generator/code_generator.hpp"
+#include "backend/interpreter/profiler.hpp"
+#include "backend/interpreter/sampling_profiler.hpp"
+#include "backend/interpreter/register_machine.hpp"
+#include "backend/interpreter/worker_pool.hpp"
+#include "common/string_pool.hpp"
 #include "common/util.hpp"
 #include "docopt.h"
 #include "frontend/lexer/lexer.hpp"
@@ -36,36 +53,51 @@
 #include "frontend/parser/ast_node.hpp"
 #include "frontend/parser/ast_node_type.hpp"
 #include "frontend/parser/parser.hpp"
+#include "optimizer/ast_optimizer.hpp"
+
+#ifdef MVPL_WORKER_POOL
+#    include <unistd.h>
+#endif
 
 std::map<std::string, int> STAGES{
     {"token_stream", 0},
     {"ast", 1},
     {"symbol_table", 2},
     {"semantic_validator", 3},
-    {"code_generation", 4},
+    {"optimization", 4},
+    {"code_generation", 5},
 };
 
 std::unordered_set<std::string> ARTIFACTS{
-    "token_stream", "ast", "symbol_table", "generated_code", "program_output"};
+    "token_stream",
+    "ast",
+    "symbol_table",
+    "optimized_ast",
+    "generated_code",
+    "optimization_report",
+    "program_output"};
 
 static const std::string options =
     R"(MVPL - The minimum viable programming language.
 
     Usage:
         mvpl -h
-        mvpl [-S STAGE] [-t OUT_FILE] [-a OUT_FILE] [-s OUT_FILE] [-g OUT_FILE] [-p OUT_FILE] [-o ARTIFACT]...  -i FILE
-        mvpl -r -i FILE
+        mvpl [-S STAGE] [-t OUT_FILE] [-a OUT_FILE] [-s OUT_FILE] [-g OUT_FILE] [-p OUT_FILE] [-O LEVEL] [-n OUT_FILE [--shared]] [-b OUT_FILE [--strip]] [--stack-limit=BYTES] [-w N] [--profile=OUT_FILE] [--sample=OUT_FILE] [-o ARTIFACT]...  -i FILE
+        mvpl -r [--stack-limit=BYTES] [-w N] [--profile=OUT_FILE] [--sample=OUT_FILE] -i FILE
 
     Arguments:
         STAGE:    token_stream
                   ast
                   symbol_table
                   semantic_validator
+                  optimization
                   code_generation
         ARTIFACT: token_stream
                   ast
                   symbol_table
+                  optimized_ast
                   generated_code
+                  optimization_report
                   program_output
 
     Options:
@@ -79,9 +111,80 @@ static const std::string options =
         -s OUT_FILE --symbol-table=OUT_FILE      redirect program's symbol tabke to file
         -g OUT_FILE --generated-code=OUT_FILE    redirect generated code to file
         -p OUT_FILE --program-output=OUT_FILE    redirect run program's output to file
+        -O LEVEL --optimization-level=LEVEL      0 disables all optimizations [default: 1]
+        -n OUT_FILE --native=OUT_FILE            compile through C instead of running
+        --shared                                 build a shared object with --native
+        -b OUT_FILE --bytecode=OUT_FILE          write compiled bytecode (.mvplc) instead of running
+        --strip                                  leave out debug information with --bytecode
+        --stack-limit=BYTES                      size the interpreter's stacks may grow to
+        -w N --workers=N                         run once per line of stdin in N processes
+        --profile=OUT_FILE                       write the run's folded call stacks to the file
+                                                 and a summary to OUT_FILE.json
+        --sample=OUT_FILE                        write samples per function and line of the run
 
     )";
 
+// Writes the folded call stacks to path, see profiler::write_folded_stacks, and the counts
+// per opcode, function and source line to path.json
+void write_profile(const profiler& profile, const std::string& path)
+{
+    std::ofstream folded_stacks(path);
+    profile.write_folded_stacks(folded_stacks);
+
+    write_json_to_file(path + ".json", profile.get_summary());
+}
+
+#ifdef MVPL_WORKER_POOL
+// Runs the program once per line of stdin, the line names the job. Each run's output follows
+// a line "JOB: RETURN_VALUE" or "JOB: error MESSAGE" in the order the runs finish. Finally
+// the memory of every worker is reported to stderr.
+void serve_jobs(const bytecode_image& image, std::size_t n_workers, std::size_t stack_limit)
+{
+    worker_pool_options options;
+    options.n_workers   = n_workers;
+    options.stack_limit = stack_limit;
+
+    worker_pool              pool(image, options);
+    std::vector<std::string> jobs;
+    std::size_t              n_running = 0;
+
+    auto print_result = [&pool, &jobs, &n_running] {
+        const auto result = pool.wait_result();
+
+        std::cout << jobs[result.job] << ": "
+                  << (result.succeeded ? std::to_string(result.value) : "error " + result.error)
+                  << '\n'
+                  << result.output;
+        --n_running;
+    };
+
+    // A few jobs per worker keep them busy, without filling up the queue
+    for (std::string line; std::getline(std::cin, line);)
+    {
+        if (n_running == 2 * pool.get_n_workers())
+        {
+            print_result();
+        }
+
+        pool.submit(jobs.size());
+        jobs.push_back(line);
+        ++n_running;
+    }
+
+    while (n_running > 0)
+    {
+        print_result();
+    }
+
+    for (const auto& worker : pool.get_memory())
+    {
+        std::cerr << "worker " << worker.pid << ": " << worker.jobs << " jobs, "
+                  << worker.private_bytes / 1024 << " KiB private, "
+                  << worker.shared_bytes / 1024 << " KiB shared, "
+                  << worker.proportional_bytes / 1024 << " KiB proportional\n";
+    }
+}
+#endif
 
 int main(int argc, char* argv[])
 {
@@ -116,6 +219,118 @@ int main(int argc, char* argv[])
         throw std::invalid_argument("Invalid stage passed");
     }
 
+    //********************    --optimization-level    *******************//
+    if (!std::ranges::all_of(args["--optimization-level"].asString(),
+                             [](char c) { return std::isdigit(c) != 0; }))
+    {
+        throw std::invalid_argument("Invalid optimization level passed");
+    }
+
+    //***********************    --stack-limit    **********************//
+    if (args["--stack-limit"].isString()
+        && (args["--stack-limit"].asString().empty()
+            || !std::ranges::all_of(args["--stack-limit"].asString(),
+                                    [](char c) { return std::isdigit(c) != 0; })))
+    {
+        throw std::invalid_argument("Invalid stack limit passed");
+    }
+
+    const auto stack_limit = args["--stack-limit"].isString()
+                                 ? std::stoull(args["--stack-limit"].asString())
+                                 : register_machine::DEFAULT_STACK_LIMIT;
+
+    //*************************    --workers    ************************//
+    if (args["--workers"].isString()
+        && (args["--workers"].asString().empty()
+            || !std::ranges::all_of(args["--workers"].asString(),
+                                    [](char c) { return std::isdigit(c) != 0; })
+            || std::stoull(args["--workers"].asString()) == 0))
+    {
+        throw std::invalid_argument("Invalid number of workers passed");
+    }
+
+#ifndef MVPL_WORKER_POOL
+    if (args["--workers"].isString())
+    {
+        throw std::invalid_argument("Workers are not supported on this platform");
+    }
+#endif
+
+    //*************************    --profile    ************************//
+    if ((args["--profile"].isString() || args["--sample"].isString())
+        && args["--workers"].isString())
+    {
+        throw std::invalid_argument("Workers can not be profiled");
+    }
+
+#ifndef MVPL_SAMPLING_PROFILER
+    if (args["--sample"].isString())
+    {
+        throw std::invalid_argument("Sampling is not supported on this platform");
+    }
+#endif
+
+    //******************************************************************//
+    //                        Compiled program: -r                      //
+    //******************************************************************//
+    // The image is executed where it is mapped, without running any stage
+    if (args["--run"].asBool())
+    {
+        bytecode_image image(args["--input"].asString());
+
+#ifdef MVPL_WORKER_POOL
+        if (args["--workers"].isString())
+        {
+            serve_jobs(image, std::stoull(args["--workers"].asString()), stack_limit);
+
+            return 0;
+        }
+#endif
+
+        register_machine         vm(image.get_program(), std::cout, default_jit_options(), stack_limit);
+        std::optional<profiler>  profile;
+        std::vector<std::string> names;
+
+        for (std::size_t i = 0; i < image.get_program().functions.size(); ++i)
+        {
+            names.emplace_back(image.get_function_name(i));
+        }
+
+        if (args["--profile"].isString())
+        {
+            profile.emplace(image.get_program(), names);
+            vm.attach_profiler(&*profile);
+        }
+
+#ifdef MVPL_SAMPLING_PROFILER
+        std::optional<sampling_profiler> sampler;
+
+        if (args["--sample"].isString())
+        {
+            sampler.emplace(image.get_program(), names);
+            vm.publish_position(&sampler->get_position());
+            sampler->start();
+        }
+#endif
+
+        vm.run();
+
+        if (profile)
+        {
+            write_profile(*profile, args["--profile"].asString());
+        }
+
+#ifdef MVPL_SAMPLING_PROFILER
+        if (sampler)
+        {
+            sampler->stop();
+            write_json_to_file(args["--sample"].asString(), sampler->get_summary());
+        }
+#endif
+
+        return 0;
+    }
+
     std::ifstream source_stream(args["--input"].asString());
     std::string   source_code((std::istreambuf_iterator<char>(source_stream)),
                             std::istreambuf_iterator<char>());
@@ -142,11 +357,13 @@ int main(int argc, char* argv[])
     //******************************************************************//
     //                            Stage: AST                            //
     //******************************************************************//
+    std::shared_ptr<ast_node_t> ast;
+
     if (!args["--stage"].isString()
         || STAGES[args["--stage"].asString()] > STAGES["token_stream"])
     {
-        std::shared_ptr<ast_node_t> ast                 = parse(token_stream);
-        auto                        ast_output_artifact = ast_to_json(*ast);
+        ast                      = parse(token_stream);
+        auto ast_output_artifact = ast_to_json(*ast);
 
         if (output_artifacts_set.contains("ast"))
         {
@@ -159,6 +376,162 @@ int main(int argc, char* argv[])
         }
     }
 
+    //******************************************************************//
+    //                        Stage: optimization                       //
+    //******************************************************************//
+    const auto optimization_level =
+        static_cast<std::size_t>(std::stoul(args["--optimization-level"].asString()));
+
+    // Owns literals computed by the optimizations, so it has to outlive the AST
+    string_pool             ast_strings;
+    ast_optimization_report ast_report;
+
+    if (!args["--stage"].isString()
+        || STAGES[args["--stage"].asString()] >= STAGES["optimization"])
+    {
+        ast_report = optimize_ast(*ast, ast_strings, optimization_level);
+
+        if (output_artifacts_set.contains("optimized_ast"))
+        {
+            artifact_output.update(optimized_ast_to_json(*ast));
+        }
+    }
+
+    //******************************************************************//
+    //                      Stage: code_generation                      //
+    //******************************************************************//
+    if (!args["--stage"].isString()
+        || STAGES[args["--stage"].asString()] >= STAGES["code_generation"])
+    {
+        code_generator_options generator_options;
+        code_generator_report  report;
+
+        generator_options.optimization_level = optimization_level;
+
+        bytecode_program program = generate_code(*ast, generator_options, &report);
+        auto             generated_code_output_artifact = generated_code_to_json(program);
+
+        if (output_artifacts_set.contains("optimization_report"))
+        {
+            artifact_output.update(optimization_report_to_json(ast_report, report));
+        }
+
+        if (output_artifacts_set.contains("generated_code"))
+        {
+            artifact_output.update(generated_code_output_artifact);
+        }
+
+        if (args["--generated-code"].isString())
+        {
+            write_json_to_file(args["--generated-code"].asString(),
+                               generated_code_output_artifact);
+        }
+
+        //*************************    Native code    ************************//
+        if (args["--native"].isString())
+        {
+            c_compiler_options compiler_options;
+
+            if (args["--shared"].asBool())
+            {
+                compiler_options.kind = c_output_kind::SHARED_OBJECT;
+            }
+
+            compile_c(translate_to_c(*ast), args["--native"].asString(), compiler_options);
+        }
+
+        //************************    Bytecode image    **********************//
+        else if (args["--bytecode"].isString())
+        {
+            write_bytecode_image(program, args["--bytecode"].asString(), !args["--strip"].asBool());
+        }
+
+#ifdef MVPL_WORKER_POOL
+        //*************************    Worker pool    ************************//
+        // The workers share the program through an image, which is only needed until it is
+        // mapped
+        else if (args["--workers"].isString() && !args["--stage"].isString())
+        {
+            const auto image_path = (std::filesystem::temp_directory_path()
+                                     / ("mvpl_" + std::to_string(getpid()) + ".mvplc"))
+                                        .string();
+
+            write_bytecode_image(program, image_path);
+            bytecode_image image(image_path);
+            std::filesystem::remove(image_path);
+
+            serve_jobs(image, std::stoull(args["--workers"].asString()), stack_limit);
+        }
+#endif
+
+        //**************************    Execution    *************************//
+        // The program's output is only captured, if it is requested as an artifact
+        else if (!args["--stage"].isString())
+        {
+            std::ostringstream program_output;
+            const bool         capture_output = output_artifacts_set.contains("program_output")
+                                        || args["--program-output"].isString();
+
+            register_machine vm(program,
+                                capture_output ? program_output : std::cout,
+                                default_jit_options(),
+                                stack_limit);
+            std::optional<profiler> profile;
+
+            if (args["--profile"].isString())
+            {
+                profile.emplace(program);
+                vm.attach_profiler(&*profile);
+            }
+
+#ifdef MVPL_SAMPLING_PROFILER
+            std::optional<sampling_profiler> sampler;
+
+            if (args["--sample"].isString())
+            {
+                sampler.emplace(program);
+                vm.publish_position(&sampler->get_position());
+                sampler->start();
+            }
+#endif
+
+            vm.run();
+
+            if (profile)
+            {
+                write_profile(*profile, args["--profile"].asString());
+            }
+
+#ifdef MVPL_SAMPLING_PROFILER
+            if (sampler)
+            {
+                sampler->stop();
+                write_json_to_file(args["--sample"].asString(), sampler->get_summary());
+            }
+#endif
+
+#ifdef MVPL_DISPATCH_STATISTICS
+            vm.get_dispatch_statistics().print_report(std::cerr);
+#endif
+
+            if (capture_output)
+            {
+                auto program_output_artifact = program_output_to_json(program_output.str());
+
+                if (output_artifacts_set.contains("program_output"))
+                {
+                    artifact_output.update(program_output_artifact);
+                }
+
+                if (args["--program-output"].isString())
+                {
+                    write_json_to_file(args["--program-output"].asString(),
+                                       program_output_artifact);
+                }
+            }
+        }
+    }
+
 
     if (!artifact_output.empty())
     {
@@ -0,0 +1,46 @@
+// Copyright © 2021-2022 Jonas Muehlmann
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#pragma once
+
+#include <cstddef>
+
+#include "common/macros.hpp"
+#include "common/string_pool.hpp"
+#include "constant_folder.hpp"
+#include "dead_code_eliminator.hpp"
+#include "frontend/parser/ast_node.hpp"
+#include <nlohmann/json.hpp>
+
+using json = nlohmann::ordered_json;
+
+// What the AST level optimizations did
+struct ast_optimization_report
+{
+    constant_folding_statistics constant_folding;
+    dead_code_statistics        dead_code;
+};
+
+NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE_UNORDERED(ast_optimization_report, constant_folding, dead_code);
+
+// Runs the AST level optimizations enabled at optimization_level (0 disables all of them) on
+// program. Strings of nodes created by them are stored in strings, which must outlive the
+// AST.
+ast_optimization_report
+optimize_ast(ast_node_t& program, string_pool& strings, std::size_t optimization_level);
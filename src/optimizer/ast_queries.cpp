@@ -0,0 +1,80 @@
+// Copyright © 2021-2022 Jonas Muehlmann
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include "ast_queries.hpp"
+
+#include <charconv>
+#include <string_view>
+#include <system_error>
+#include <variant>
+
+token_type get_operator(const std::shared_ptr<ast_node_t>& operator_)
+{
+    return std::get<leaf_node>(*operator_).token;
+}
+
+std::optional<value_t> get_literal_value(const ast_node_t& node)
+{
+    const auto* leaf = std::get_if<leaf_node>(&node);
+
+    if (leaf == nullptr || leaf->token != token_type::LITERAL)
+    {
+        return std::nullopt;
+    }
+
+    std::string_view literal = leaf->value;
+    value_t          value{};
+    auto [end, error] = std::from_chars(literal.data(), literal.data() + literal.size(), value);
+
+    if (error != std::errc{} || end != literal.data() + literal.size())
+    {
+        return std::nullopt;
+    }
+
+    return value;
+}
+
+bool has_side_effects(const ast_node_t& node)
+{
+    if (const auto* binary_op = std::get_if<binary_op_node>(&node))
+    {
+        auto token = get_operator(binary_op->operator_);
+
+        if (token == token_type::DIVISION || token == token_type::MODULO)
+        {
+            auto divisor = get_literal_value(*binary_op->rhs);
+
+            if (!divisor.has_value() || *divisor == 0)
+            {
+                return true;
+            }
+        }
+
+        return has_side_effects(*binary_op->lhs) || has_side_effects(*binary_op->rhs);
+    }
+
+    if (const auto* unary_op = std::get_if<unary_op_node>(&node))
+    {
+        return get_operator(unary_op->operator_) != token_type::NOT
+               || has_side_effects(*unary_op->operand);
+    }
+
+    return !std::holds_alternative<leaf_node>(node)
+           && !std::holds_alternative<missing_optional_node>(node);
+}
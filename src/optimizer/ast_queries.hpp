@@ -0,0 +1,37 @@
+// Copyright © 2021-2022 Jonas Muehlmann
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#pragma once
+
+#include <memory>
+#include <optional>
+
+#include "backend/value.hpp"
+#include "frontend/lexer/token_type.hpp"
+#include "frontend/parser/ast_node.hpp"
+
+// Token of the leaf holding the operator of a unary or binary operation
+token_type get_operator(const std::shared_ptr<ast_node_t>& operator_);
+
+// Value of integer literals, nothing for every other node
+std::optional<value_t> get_literal_value(const ast_node_t& node);
+
+// Whether evaluating the expression might do more than computing a value: calls,
+// increments, decrements and divisions, which might trap, have side effects.
+bool has_side_effects(const ast_node_t& node);
@@ -0,0 +1,655 @@
+// Copyright © 2021-2022 Jonas Muehlmann
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include "constant_folder.hpp"
+
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "ast_queries.hpp"
+#include "backend/value.hpp"
+#include "frontend/lexer/token_type.hpp"
+#include "frontend/parser/ast_operations/retrieve_source_location.hpp"
+
+namespace
+{
+//****************************************************************************//
+//                                 Evaluation                                 //
+//****************************************************************************//
+// Returns nothing for operators, which can not be evaluated at compile time
+std::optional<value_t> evaluate_binary_operator(token_type token, value_t lhs, value_t rhs)
+{
+    switch (token)
+    {
+        case token_type::PLUS:
+            return wrapping_add(lhs, rhs);
+        case token_type::MINUS:
+            return wrapping_sub(lhs, rhs);
+        case token_type::MULTIPLICATION:
+            return wrapping_mul(lhs, rhs);
+        case token_type::DIVISION:
+            return rhs != 0 ? std::optional(checked_div(lhs, rhs)) : std::nullopt;
+        case token_type::MODULO:
+            return rhs != 0 ? std::optional(checked_mod(lhs, rhs)) : std::nullopt;
+        case token_type::BINARY_AND:
+            return lhs & rhs;
+        case token_type::BINARY_OR:
+            return lhs | rhs;
+        case token_type::XOR:
+            return lhs ^ rhs;
+        case token_type::LSHIFT:
+            return shift_left(lhs, rhs);
+        case token_type::RSHIFT:
+            return shift_right(lhs, rhs);
+        case token_type::LESS:
+            return lhs < rhs;
+        case token_type::LESSEQ:
+            return lhs <= rhs;
+        case token_type::GREATER:
+            return lhs > rhs;
+        case token_type::GREATEREQ:
+            return lhs >= rhs;
+        case token_type::EQUAL:
+            return lhs == rhs;
+        case token_type::NEQUAL:
+            return lhs != rhs;
+        case token_type::LOGICAL_AND:
+            return lhs != 0 && rhs != 0;
+        case token_type::LOGICAL_OR:
+            return lhs != 0 || rhs != 0;
+        default:
+            return std::nullopt;
+    }
+}
+
+//****************************************************************************//
+//                               Written locals                               //
+//****************************************************************************//
+// Collects the identifiers of all variables, which are assigned, incremented or
+// decremented. Shadowing is ignored, which only makes the propagation more conservative.
+struct write_collector_visitor
+{
+    std::unordered_set<std::string_view>& written;
+
+    void visit(const std::shared_ptr<ast_node_t>& node)
+    {
+        if (node != nullptr)
+        {
+            std::visit(*this, *node);
+        }
+    }
+
+    void operator()(const block_node& node)
+    {
+        for (const auto& statement : node.statements)
+        {
+            visit(statement);
+        }
+    }
+
+    void operator()(const var_init_node& node)
+    {
+        visit(node.value);
+    }
+
+    void operator()(const var_assignment_node& node)
+    {
+        written.insert(node.identifier);
+        visit(node.value);
+    }
+
+    void operator()(const unary_op_node& node)
+    {
+        auto token = get_operator(node.operator_);
+
+        if (token == token_type::INCREMENT || token == token_type::DECREMENT)
+        {
+            written.insert(std::get<leaf_node>(*node.operand).value);
+        }
+        visit(node.operand);
+    }
+
+    void operator()(const binary_op_node& node)
+    {
+        visit(node.lhs);
+        visit(node.rhs);
+    }
+
+    void operator()(const return_stmt_node& node)
+    {
+        visit(node.value);
+    }
+
+    void operator()(const if_stmt_node& node)
+    {
+        visit(node.condition);
+        visit(node.body);
+    }
+
+    void operator()(const else_if_stmt_node& node)
+    {
+        visit(node.condition);
+        visit(node.body);
+    }
+
+    void operator()(const else_stmt_node& node)
+    {
+        visit(node.body);
+    }
+
+    void operator()(const for_loop_node& node)
+    {
+        visit(node.init_stmt);
+        visit(node.test_expression);
+        visit(node.update_expression);
+        visit(node.body);
+    }
+
+    void operator()(const while_loop_node& node)
+    {
+        visit(node.condition);
+        visit(node.body);
+    }
+
+    void operator()(const switch_node& node)
+    {
+        visit(node.expression);
+        visit(node.body);
+    }
+
+    void operator()(const case_node& node)
+    {
+        visit(node.value);
+        visit(node.body);
+    }
+
+    void operator()([[maybe_unused]] const auto& node) {}
+};
+
+//****************************************************************************//
+//                                   Folder                                   //
+//****************************************************************************//
+class constant_folder
+{
+ public:
+    // Variables
+    string_pool&                 literals;
+    constant_folding_statistics& statistics;
+
+    // Methods
+    constant_folder(string_pool& literals_, constant_folding_statistics& statistics_) :
+        literals{literals_}, statistics{statistics_}
+    {}
+
+    template <typename TDefinition>
+    void fold_function(TDefinition& definition)
+    {
+        const auto& signature  = std::get<signature_node>(*definition.signature);
+        const auto& parameters = std::get<parameter_def_node>(*signature.parameter_list);
+
+        written.clear();
+        write_collector_visitor{written}.visit(definition.body);
+
+        scopes.clear();
+        scopes.emplace_back();
+
+        for (auto parameter : parameters.parameter_list)
+        {
+            scopes.back()[parameter] = std::nullopt;
+        }
+
+        fold_block(std::get<block_node>(*definition.body));
+    }
+
+ private:
+    // Variables
+    // Identifiers of variables, which are written in the current function
+    std::unordered_set<std::string_view> written;
+    // Identifier -> value, if the variable is constant
+    std::vector<std::unordered_map<std::string_view, std::optional<value_t>>> scopes;
+
+    // Methods
+    void declare(std::string_view identifier, std::optional<value_t> value)
+    {
+        scopes.back()[identifier] = written.contains(identifier) ? std::nullopt : value;
+    }
+
+    std::optional<value_t> lookup(std::string_view identifier) const
+    {
+        for (auto scope = scopes.rbegin(); scope != scopes.rend(); ++scope)
+        {
+            if (auto it = scope->find(identifier); it != scope->end())
+            {
+                return it->second;
+            }
+        }
+
+        return std::nullopt;
+    }
+
+    std::shared_ptr<ast_node_t> make_literal(value_t value, source_location location)
+    {
+        return std::make_shared<ast_node_t>(std::in_place_type<leaf_node>,
+                                            token_type::LITERAL,
+                                            literals.intern(std::to_string(value)),
+                                            location);
+    }
+
+    static source_location get_location(ast_node_t& node)
+    {
+        return std::visit(source_location_retriever_visitor{}, node);
+    }
+
+    //**************************    Expressions    *************************//
+    // Returns the value of the expression, if it is constant. Constant subexpressions are
+    // replaced by literals.
+    std::optional<value_t> fold_expression(std::shared_ptr<ast_node_t>& node)
+    {
+        if (node == nullptr)
+        {
+            return std::nullopt;
+        }
+
+        if (auto* leaf = std::get_if<leaf_node>(node.get()))
+        {
+            if (leaf->token == token_type::LITERAL)
+            {
+                return get_literal_value(*node);
+            }
+            if (leaf->token != token_type::IDENTIFIER)
+            {
+                return std::nullopt;
+            }
+
+            auto value = lookup(leaf->value);
+
+            if (value.has_value())
+            {
+                node = make_literal(*value, leaf->source_location_);
+                ++statistics.n_propagated_uses;
+            }
+
+            return value;
+        }
+
+        if (auto* binary_op = std::get_if<binary_op_node>(node.get()))
+        {
+            auto lhs = fold_expression(binary_op->lhs);
+            auto rhs = fold_expression(binary_op->rhs);
+
+            if (!lhs.has_value() || !rhs.has_value())
+            {
+                return std::nullopt;
+            }
+
+            return replace_by_result(
+                node, evaluate_binary_operator(get_operator(binary_op->operator_), *lhs, *rhs));
+        }
+
+        if (auto* unary_op = std::get_if<unary_op_node>(node.get()))
+        {
+            // The operand of increment and decrement is a variable, not a value
+            if (get_operator(unary_op->operator_) != token_type::NOT)
+            {
+                return std::nullopt;
+            }
+
+            auto operand = fold_expression(unary_op->operand);
+
+            if (!operand.has_value())
+            {
+                return std::nullopt;
+            }
+
+            return replace_by_result(node, static_cast<value_t>(*operand == 0));
+        }
+
+        if (auto* call = std::get_if<call_node>(node.get()))
+        {
+            auto& arguments = std::get<parameter_pass_node>(*call->parameter_pass);
+
+            // Arguments are identifiers or literals
+            for (auto& argument : arguments.parameter_list)
+            {
+                if (auto value = lookup(argument))
+                {
+                    argument = literals.intern(std::to_string(*value));
+                    ++statistics.n_propagated_uses;
+                }
+            }
+        }
+
+        return std::nullopt;
+    }
+
+    std::optional<value_t> replace_by_result(std::shared_ptr<ast_node_t>& node,
+                                             std::optional<value_t>       result)
+    {
+        if (result.has_value())
+        {
+            node = make_literal(*result, get_location(*node));
+            ++statistics.n_folded_expressions;
+        }
+
+        return result;
+    }
+
+    //**************************    Statements    **************************//
+    // Returns false, if the statement can be removed
+    bool fold_statement(std::shared_ptr<ast_node_t>& node)
+    {
+        if (node == nullptr)
+        {
+            return true;
+        }
+
+        if (auto* block = std::get_if<block_node>(node.get()))
+        {
+            fold_block(*block);
+        }
+        else if (auto* var_decl = std::get_if<var_decl_node>(node.get()))
+        {
+            declare(var_decl->identifier, 0);
+        }
+        else if (auto* var_init = std::get_if<var_init_node>(node.get()))
+        {
+            // Folded before declaring, the initializer might refer to a shadowed variable
+            declare(var_init->identifier, fold_expression(var_init->value));
+        }
+        else if (auto* assignment = std::get_if<var_assignment_node>(node.get()))
+        {
+            fold_expression(assignment->value);
+        }
+        else if (auto* return_stmt = std::get_if<return_stmt_node>(node.get()))
+        {
+            fold_expression(return_stmt->value);
+        }
+        else if (auto* while_loop = std::get_if<while_loop_node>(node.get()))
+        {
+            return fold_while_loop(node, *while_loop);
+        }
+        else if (auto* for_loop = std::get_if<for_loop_node>(node.get()))
+        {
+            fold_for_loop(node, *for_loop);
+        }
+        else if (auto* switch_ = std::get_if<switch_node>(node.get()))
+        {
+            fold_expression(switch_->expression);
+
+            for (auto& case_ : std::get<block_node>(*switch_->body).statements)
+            {
+                auto& case_node_ = std::get<case_node>(*case_);
+
+                fold_expression(case_node_.value);
+                fold_statement(case_node_.body);
+            }
+        }
+        else
+        {
+            // Expression statements
+            fold_expression(node);
+        }
+
+        return true;
+    }
+
+    bool fold_while_loop(std::shared_ptr<ast_node_t>& node, while_loop_node& while_loop)
+    {
+        auto condition = fold_expression(while_loop.condition);
+
+        if (condition.has_value())
+        {
+            ++statistics.n_resolved_conditions;
+
+            if (*condition == 0)
+            {
+                return false;
+            }
+
+            // A for loop without a test is an unconditional loop
+            node = std::make_shared<ast_node_t>(std::in_place_type<for_loop_node>,
+                                                nullptr,
+                                                nullptr,
+                                                nullptr,
+                                                while_loop.body,
+                                                while_loop.source_location_);
+
+            return fold_statement(node);
+        }
+
+        fold_statement(while_loop.body);
+
+        return true;
+    }
+
+    void fold_for_loop(std::shared_ptr<ast_node_t>& node, for_loop_node& for_loop)
+    {
+        scopes.emplace_back();
+        fold_statement(for_loop.init_stmt);
+
+        std::optional<value_t> test;
+
+        if (for_loop.test_expression != nullptr
+            && !std::holds_alternative<missing_optional_node>(*for_loop.test_expression))
+        {
+            test = fold_expression(for_loop.test_expression);
+        }
+
+        if (test.has_value())
+        {
+            ++statistics.n_resolved_conditions;
+            for_loop.test_expression = nullptr;
+        }
+
+        if (test == 0)
+        {
+            // Only the initialization is executed, it keeps its own scope
+            std::vector<std::shared_ptr<ast_node_t>> statements;
+
+            if (for_loop.init_stmt != nullptr)
+            {
+                statements.push_back(for_loop.init_stmt);
+            }
+            node = std::make_shared<ast_node_t>(
+                std::in_place_type<block_node>, std::move(statements), for_loop.source_location_);
+        }
+        else
+        {
+            fold_expression(for_loop.update_expression);
+            fold_statement(for_loop.body);
+        }
+
+        scopes.pop_back();
+    }
+
+    void fold_block(block_node& node)
+    {
+        scopes.emplace_back();
+
+        auto& statements = node.statements;
+
+        for (std::size_t i = 0; i < statements.size();)
+        {
+            if (std::holds_alternative<if_stmt_node>(*statements[i]))
+            {
+                i = fold_if_chain(statements, i);
+            }
+            else if (fold_statement(statements[i]))
+            {
+                ++i;
+            }
+            else
+            {
+                statements.erase(statements.begin() + static_cast<std::ptrdiff_t>(i));
+            }
+        }
+
+        scopes.pop_back();
+    }
+
+    // Folds the if statement at begin and the else if and else statements following it.
+    // Returns the index of the first statement after the chain.
+    std::size_t fold_if_chain(std::vector<std::shared_ptr<ast_node_t>>& statements,
+                              std::size_t                               begin)
+    {
+        struct branch
+        {
+            std::shared_ptr<ast_node_t> condition;
+            std::shared_ptr<ast_node_t> body;
+            source_location             location;
+        };
+
+        std::vector<branch>         branches;
+        std::shared_ptr<ast_node_t> else_body;
+        bool                        resolved_any = false;
+        std::size_t                 end          = begin;
+
+        for (; end < statements.size(); ++end)
+        {
+            auto& statement = *statements[end];
+
+            if (auto* else_stmt = std::get_if<else_stmt_node>(&statement);
+                else_stmt != nullptr && end != begin)
+            {
+                // The chain might already be terminated by a condition known to be true
+                if (else_body == nullptr)
+                {
+                    fold_statement(else_stmt->body);
+                    else_body = else_stmt->body;
+                }
+                ++end;
+                break;
+            }
+
+            auto* if_stmt      = std::get_if<if_stmt_node>(&statement);
+            auto* else_if_stmt = std::get_if<else_if_stmt_node>(&statement);
+
+            if ((end == begin && if_stmt == nullptr) || (end != begin && else_if_stmt == nullptr))
+            {
+                break;
+            }
+
+            // Branches after one, which is always taken, are unreachable
+            if (else_body != nullptr)
+            {
+                continue;
+            }
+
+            auto& condition = if_stmt != nullptr ? if_stmt->condition : else_if_stmt->condition;
+            auto& body      = if_stmt != nullptr ? if_stmt->body : else_if_stmt->body;
+            auto  value     = fold_expression(condition);
+
+            if (value.has_value())
+            {
+                ++statistics.n_resolved_conditions;
+                resolved_any = true;
+            }
+
+            if (value == 0)
+            {
+                continue;
+            }
+
+            fold_statement(body);
+
+            if (value.has_value())
+            {
+                else_body = body;
+            }
+            else
+            {
+                branches.push_back({condition, body, get_location(statement)});
+            }
+        }
+
+        if (!resolved_any)
+        {
+            return end;
+        }
+
+        // Rebuild the chain from the remaining branches
+        std::vector<std::shared_ptr<ast_node_t>> chain;
+
+        for (auto& [condition, body, location] : branches)
+        {
+            if (chain.empty())
+            {
+                chain.push_back(std::make_shared<ast_node_t>(
+                    std::in_place_type<if_stmt_node>, condition, body, location));
+            }
+            else
+            {
+                chain.push_back(std::make_shared<ast_node_t>(
+                    std::in_place_type<else_if_stmt_node>, condition, body, location));
+            }
+        }
+
+        if (else_body != nullptr)
+        {
+            if (chain.empty())
+            {
+                chain.push_back(else_body);
+            }
+            else
+            {
+                chain.push_back(std::make_shared<ast_node_t>(
+                    std::in_place_type<else_stmt_node>, else_body, get_location(*else_body)));
+            }
+        }
+
+        statements.erase(statements.begin() + static_cast<std::ptrdiff_t>(begin),
+                         statements.begin() + static_cast<std::ptrdiff_t>(end));
+        statements.insert(statements.begin() + static_cast<std::ptrdiff_t>(begin),
+                          chain.begin(),
+                          chain.end());
+
+        return begin + chain.size();
+    }
+};
+}    // namespace
+
+//****************************************************************************//
+//                                Entry point                                 //
+//****************************************************************************//
+constant_folding_statistics fold_constants(ast_node_t& program, string_pool& literals)
+{
+    constant_folding_statistics statistics;
+    constant_folder             folder(literals, statistics);
+
+    for (auto& global : std::get<program_node>(program).globals)
+    {
+        if (auto* function = std::get_if<func_def_node>(global.get()))
+        {
+            folder.fold_function(*function);
+        }
+        else if (auto* procedure = std::get_if<procedure_def_node>(global.get()))
+        {
+            folder.fold_function(*procedure);
+        }
+    }
+
+    return statistics;
+}
@@ -0,0 +1,52 @@
+// Copyright © 2021-2022 Jonas Muehlmann
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#pragma once
+
+#include <cstddef>
+
+#include "common/macros.hpp"
+#include "common/string_pool.hpp"
+#include "frontend/parser/ast_node.hpp"
+#include <nlohmann/json.hpp>
+
+using json = nlohmann::ordered_json;
+
+struct constant_folding_statistics
+{
+    // Operators with constant operands replaced by their result
+    std::size_t n_folded_expressions{};
+    // Uses of never written locals replaced by their value
+    std::size_t n_propagated_uses{};
+    // Conditions of if, else if, while and for statements, which were known to be true or
+    // false and removed together with the branches they guard
+    std::size_t n_resolved_conditions{};
+};
+
+NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE_UNORDERED(constant_folding_statistics,
+                                             n_folded_expressions,
+                                             n_propagated_uses,
+                                             n_resolved_conditions);
+
+// Evaluates operators with constant operands with the semantics of the interpreter, replaces
+// uses of locals, which are never written after their initialization, by their value and
+// resolves statements with constant conditions in every function of program.
+// Division and modulo by zero are left to trap at runtime.
+// New literals are stored in literals, which must outlive the AST.
+constant_folding_statistics fold_constants(ast_node_t& program, string_pool& literals);
@@ -0,0 +1,518 @@
+// Copyright © 2021-2022 Jonas Muehlmann
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include "dead_code_eliminator.hpp"
+
+#include <algorithm>
+#include <memory>
+#include <optional>
+#include <string_view>
+#include <unordered_set>
+#include <variant>
+#include <vector>
+
+#include "ast_queries.hpp"
+#include "backend/value.hpp"
+#include "frontend/lexer/token_type.hpp"
+
+namespace
+{
+//****************************************************************************//
+//                                 Read locals                                //
+//****************************************************************************//
+bool is_increment_or_decrement(const ast_node_t& node)
+{
+    const auto* unary_op = std::get_if<unary_op_node>(&node);
+
+    return unary_op != nullptr && get_operator(unary_op->operator_) != token_type::NOT;
+}
+
+// Collects the identifiers of all declared and all read variables. Like the constant
+// folder, shadowing is ignored. Increments and decrements only read their operand, if their
+// value is used and assignments do not read the variable they are assigning to.
+struct read_collector_visitor
+{
+    std::unordered_set<std::string_view>& declared;
+    std::unordered_set<std::string_view>& read;
+    // Variable being assigned to while visiting the assigned value
+    std::string_view                      assigned{};
+
+    void statement(const std::shared_ptr<ast_node_t>& node)
+    {
+        if (node == nullptr)
+        {
+            return;
+        }
+
+        // Increment and decrement statements only write their operand
+        if (is_increment_or_decrement(*node))
+        {
+            return;
+        }
+
+        std::visit(*this, *node);
+    }
+
+    void expression(const std::shared_ptr<ast_node_t>& node)
+    {
+        if (node != nullptr)
+        {
+            std::visit(*this, *node);
+        }
+    }
+
+    void mark_read(std::string_view identifier)
+    {
+        if (identifier != assigned)
+        {
+            read.insert(identifier);
+        }
+    }
+
+    //**************************    Statements    **************************//
+    void operator()(const block_node& node)
+    {
+        for (const auto& statement_ : node.statements)
+        {
+            statement(statement_);
+        }
+    }
+
+    void operator()(const var_decl_node& node)
+    {
+        declared.insert(node.identifier);
+    }
+
+    void operator()(const var_init_node& node)
+    {
+        declared.insert(node.identifier);
+        expression(node.value);
+    }
+
+    void operator()(const var_assignment_node& node)
+    {
+        auto outer_assigned = assigned;
+
+        assigned = node.identifier;
+        expression(node.value);
+        assigned = outer_assigned;
+    }
+
+    void operator()(const return_stmt_node& node)
+    {
+        expression(node.value);
+    }
+
+    void operator()(const if_stmt_node& node)
+    {
+        expression(node.condition);
+        statement(node.body);
+    }
+
+    void operator()(const else_if_stmt_node& node)
+    {
+        expression(node.condition);
+        statement(node.body);
+    }
+
+    void operator()(const else_stmt_node& node)
+    {
+        statement(node.body);
+    }
+
+    void operator()(const for_loop_node& node)
+    {
+        statement(node.init_stmt);
+        expression(node.test_expression);
+        statement(node.update_expression);
+        statement(node.body);
+    }
+
+    void operator()(const while_loop_node& node)
+    {
+        expression(node.condition);
+        statement(node.body);
+    }
+
+    void operator()(const switch_node& node)
+    {
+        expression(node.expression);
+
+        for (const auto& case_ : std::get<block_node>(*node.body).statements)
+        {
+            const auto& case_node_ = std::get<case_node>(*case_);
+
+            expression(case_node_.value);
+            statement(case_node_.body);
+        }
+    }
+
+    //*************************    Expressions    **************************//
+    void operator()(const leaf_node& node)
+    {
+        if (node.token == token_type::IDENTIFIER)
+        {
+            mark_read(node.value);
+        }
+    }
+
+    void operator()(const binary_op_node& node)
+    {
+        expression(node.lhs);
+        expression(node.rhs);
+    }
+
+    void operator()(const unary_op_node& node)
+    {
+        expression(node.operand);
+    }
+
+    void operator()(const call_node& node)
+    {
+        for (auto argument : std::get<parameter_pass_node>(*node.parameter_pass).parameter_list)
+        {
+            mark_read(argument);
+        }
+    }
+
+    void operator()([[maybe_unused]] const auto& node) {}
+};
+
+//****************************************************************************//
+//                                 Eliminator                                 //
+//****************************************************************************//
+class dead_code_eliminator
+{
+ public:
+    // Variables
+    dead_code_statistics& statistics;
+
+    // Methods
+    explicit dead_code_eliminator(dead_code_statistics& statistics_) : statistics{statistics_} {}
+
+    template <typename TDefinition>
+    void eliminate_in_function(TDefinition& definition)
+    {
+        const auto& signature  = std::get<signature_node>(*definition.signature);
+        const auto& parameters = std::get<parameter_def_node>(*signature.parameter_list);
+        auto&       body       = std::get<block_node>(*definition.body);
+
+        // Removing a local might make the locals used by its initializer unread
+        for (bool changed = true; changed;)
+        {
+            declared.clear();
+            read.clear();
+            declared.insert(parameters.parameter_list.begin(), parameters.parameter_list.end());
+            read_collector_visitor{declared, read}(body);
+
+            n_changes = 0;
+            eliminate_in_block(body);
+            changed = n_changes != 0;
+        }
+    }
+
+ private:
+    // Variables
+    std::unordered_set<std::string_view> declared;
+    std::unordered_set<std::string_view> read;
+    std::size_t                          n_changes{};
+
+    // Methods
+    // Undeclared variables are kept to be reported by the code generator
+    [[nodiscard]] bool is_dead(std::string_view identifier) const
+    {
+        return declared.contains(identifier) && !read.contains(identifier);
+    }
+
+    // Replaces the store by its side effects
+    void remove_store(std::shared_ptr<ast_node_t>& node, std::shared_ptr<ast_node_t> value)
+    {
+        node = value != nullptr && has_side_effects(*value) ? std::move(value) : nullptr;
+        ++n_changes;
+    }
+
+    static bool is_always_true(const std::shared_ptr<ast_node_t>& condition)
+    {
+        if (condition == nullptr || std::holds_alternative<missing_optional_node>(*condition))
+        {
+            return true;
+        }
+
+        auto value = get_literal_value(*condition);
+
+        return value.has_value() && *value != 0;
+    }
+
+    // Removes dead parts of the statement and sets node to nullptr, if nothing is left.
+    // Returns whether the statement never completes, so the statements following it are
+    // unreachable. There are no break statements, so loops only end through their condition.
+    bool eliminate_in_statement(std::shared_ptr<ast_node_t>& node)
+    {
+        if (node == nullptr)
+        {
+            return false;
+        }
+
+        if (auto* block = std::get_if<block_node>(node.get()))
+        {
+            return eliminate_in_block(*block);
+        }
+        if (std::holds_alternative<return_stmt_node>(*node))
+        {
+            return true;
+        }
+        if (auto* var_decl = std::get_if<var_decl_node>(node.get()))
+        {
+            if (is_dead(var_decl->identifier))
+            {
+                remove_store(node, nullptr);
+                ++statistics.n_removed_locals;
+            }
+        }
+        else if (auto* var_init = std::get_if<var_init_node>(node.get()))
+        {
+            if (is_dead(var_init->identifier))
+            {
+                remove_store(node, var_init->value);
+                ++statistics.n_removed_locals;
+            }
+        }
+        else if (auto* assignment = std::get_if<var_assignment_node>(node.get()))
+        {
+            if (is_dead(assignment->identifier))
+            {
+                remove_store(node, assignment->value);
+                ++statistics.n_removed_stores;
+            }
+        }
+        else if (auto* while_loop = std::get_if<while_loop_node>(node.get()))
+        {
+            eliminate_in_statement(while_loop->body);
+
+            return is_always_true(while_loop->condition);
+        }
+        else if (auto* for_loop = std::get_if<for_loop_node>(node.get()))
+        {
+            eliminate_in_statement(for_loop->init_stmt);
+            eliminate_in_statement(for_loop->update_expression);
+            eliminate_in_statement(for_loop->body);
+
+            return is_always_true(for_loop->test_expression);
+        }
+        else if (std::holds_alternative<switch_node>(*node))
+        {
+            eliminate_in_switch(node);
+        }
+        else if (is_increment_or_decrement(*node))
+        {
+            const auto& operand = std::get<leaf_node>(*std::get<unary_op_node>(*node).operand);
+
+            if (is_dead(operand.value))
+            {
+                remove_store(node, nullptr);
+                ++statistics.n_removed_stores;
+            }
+        }
+        else if (!has_side_effects(*node))
+        {
+            // Expression statements, whose value is unused
+            remove_store(node, nullptr);
+            ++statistics.n_removed_stores;
+        }
+
+        return false;
+    }
+
+    // Returns whether the block never completes
+    bool eliminate_in_block(block_node& node)
+    {
+        auto& statements = node.statements;
+        bool  terminates = false;
+        auto  end        = statements.size();
+
+        for (std::size_t i = 0; i < statements.size() && !terminates; ++i)
+        {
+            if (std::holds_alternative<if_stmt_node>(*statements[i]))
+            {
+                i   = eliminate_in_if_chain(statements, i, terminates);
+                end = i + 1;
+                continue;
+            }
+
+            terminates = eliminate_in_statement(statements[i]);
+            end        = i + 1;
+        }
+
+        if (end < statements.size())
+        {
+            statistics.n_unreachable_statements += statements.size() - end;
+            n_changes += statements.size() - end;
+            statements.resize(end);
+        }
+
+        std::erase(statements, nullptr);
+
+        return terminates;
+    }
+
+    // Returns the index of the last statement of the if chain starting at begin. terminates
+    // is set, if every branch of the chain never completes and there is an else branch.
+    std::size_t eliminate_in_if_chain(std::vector<std::shared_ptr<ast_node_t>>& statements,
+                                      std::size_t                               begin,
+                                      bool&                                     terminates)
+    {
+        bool        all_branches_terminate = true;
+        bool        has_else               = false;
+        std::size_t i                      = begin;
+
+        for (; i < statements.size(); ++i)
+        {
+            auto& statement = *statements[i];
+
+            if (auto* if_stmt = std::get_if<if_stmt_node>(&statement);
+                if_stmt != nullptr && i == begin)
+            {
+                all_branches_terminate &= eliminate_in_branch(if_stmt->body);
+            }
+            else if (auto* else_if_stmt = std::get_if<else_if_stmt_node>(&statement);
+                     else_if_stmt != nullptr && i != begin)
+            {
+                all_branches_terminate &= eliminate_in_branch(else_if_stmt->body);
+            }
+            else if (auto* else_stmt = std::get_if<else_stmt_node>(&statement);
+                     else_stmt != nullptr && i != begin)
+            {
+                all_branches_terminate &= eliminate_in_branch(else_stmt->body);
+                has_else = true;
+                break;
+            }
+            else
+            {
+                break;
+            }
+        }
+
+        terminates = has_else && all_branches_terminate;
+
+        return has_else ? i : i - 1;
+    }
+
+    // Bodies of branches are kept, even if nothing is left of them
+    bool eliminate_in_branch(std::shared_ptr<ast_node_t>& body)
+    {
+        if (auto* block = std::get_if<block_node>(body.get()))
+        {
+            return eliminate_in_block(*block);
+        }
+
+        return eliminate_in_statement(body);
+    }
+
+    void eliminate_in_switch(std::shared_ptr<ast_node_t>& node)
+    {
+        auto& switch_ = std::get<switch_node>(*node);
+        auto& cases   = std::get<block_node>(*switch_.body).statements;
+
+        // The first case matching the value is taken, so later cases with the same literal
+        // can never be selected. Cases with other values might have side effects.
+        std::unordered_set<value_t> seen;
+        bool                        all_literals = true;
+
+        for (auto& case_ : cases)
+        {
+            auto& case_node_ = std::get<case_node>(*case_);
+            auto  value      = get_literal_value(*case_node_.value);
+
+            if (!value.has_value())
+            {
+                all_literals = false;
+            }
+            else if (!seen.insert(*value).second)
+            {
+                case_ = nullptr;
+                ++statistics.n_unreachable_cases;
+                ++n_changes;
+                continue;
+            }
+
+            eliminate_in_branch(case_node_.body);
+        }
+        std::erase(cases, nullptr);
+
+        // A switch over a constant only executes the first matching case, if all cases before
+        // it are literals. If no case matches, nothing is executed at all.
+        auto value = get_literal_value(*switch_.expression);
+
+        if (!value.has_value())
+        {
+            return;
+        }
+
+        for (std::size_t i = 0; i < cases.size(); ++i)
+        {
+            auto& case_node_ = std::get<case_node>(*cases[i]);
+            auto  label      = get_literal_value(*case_node_.value);
+
+            if (!label.has_value())
+            {
+                return;
+            }
+
+            if (*label == *value)
+            {
+                statistics.n_unreachable_cases += cases.size() - 1;
+                ++n_changes;
+                node = case_node_.body;
+
+                return;
+            }
+        }
+
+        if (all_literals)
+        {
+            statistics.n_unreachable_cases += cases.size();
+            ++n_changes;
+            node = nullptr;
+        }
+    }
+};
+}    // namespace
+
+//****************************************************************************//
+//                                Entry point                                 //
+//****************************************************************************//
+dead_code_statistics eliminate_dead_code(ast_node_t& program)
+{
+    dead_code_statistics statistics;
+    dead_code_eliminator eliminator(statistics);
+
+    for (auto& global : std::get<program_node>(program).globals)
+    {
+        if (auto* function = std::get_if<func_def_node>(global.get()))
+        {
+            eliminator.eliminate_in_function(*function);
+        }
+        else if (auto* procedure = std::get_if<procedure_def_node>(global.get()))
+        {
+            eliminator.eliminate_in_function(*procedure);
+        }
+    }
+
+    return statistics;
+}
@@ -0,0 +1,53 @@
+// Copyright © 2021-2022 Jonas Muehlmann
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#pragma once
+
+#include <cstddef>
+
+#include "common/macros.hpp"
+#include "frontend/parser/ast_node.hpp"
+#include <nlohmann/json.hpp>
+
+using json = nlohmann::ordered_json;
+
+struct dead_code_statistics
+{
+    // Statements following a statement, which never completes (e.g. return)
+    std::size_t n_unreachable_statements{};
+    // Cases of switch statements, which can never be selected
+    std::size_t n_unreachable_cases{};
+    // Declarations of locals, which are never read
+    std::size_t n_removed_locals{};
+    // Assignments to locals, which are never read, and expression statements without side
+    // effects
+    std::size_t n_removed_stores{};
+};
+
+NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE_UNORDERED(dead_code_statistics,
+                                             n_unreachable_statements,
+                                             n_unreachable_cases,
+                                             n_removed_locals,
+                                             n_removed_stores);
+
+// Removes unreachable statements and switch cases and locals, which are never read, from
+// every function of program. Side effects of removed initializers and assignments are kept
+// as expression statements. Best run after constant folding, which resolves constant
+// conditions and turns locals, which are never written, into unread ones.
+dead_code_statistics eliminate_dead_code(ast_node_t& program);
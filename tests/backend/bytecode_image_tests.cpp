@@ -0,0 +1,147 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+#include "../src/backend/bytecode_image.hpp"
+#include "../src/backend/code_generator/code_generator.hpp"
+#include "../src/backend/interpreter/register_machine.hpp"
+#include "../src/frontend/lexer/lexer.hpp"
+#include "../src/frontend/parser/parser.hpp"
+
+namespace
+{
+const std::string SOURCE = R"(
+function square(x)
+{
+    return x * x;
+}
+function main()
+{
+    let sum = 0;
+    for (let i = 0; i < 10; ++i)
+    {
+        let s = square(i);
+        print(s);
+        sum = sum + s;
+    }
+    switch (sum)
+    {
+        case 1: sum = 0;
+        case 285: sum = sum + 1000000007;
+        case 3: sum = 1;
+    }
+    return sum;
+}
+)";
+
+bytecode_program compile(const std::string& source)
+{
+    lexer lexer(source);
+    auto  token_stream = lexer.lex();
+
+    return generate_code(*parse(token_stream));
+}
+
+// Removes the image again
+struct temporary_image
+{
+    std::string path;
+
+    explicit temporary_image(const std::string& name)
+        : path((std::filesystem::temp_directory_path() / ("mvpl_image_" + name)).string())
+    {
+    }
+
+    ~temporary_image()
+    {
+        std::filesystem::remove(path);
+    }
+};
+}    // namespace
+
+//****************************************************************************//
+//                               Bytecode image                               //
+//****************************************************************************//
+TEST(TestBytecodeImage, RunsInPlace)
+{
+    const auto      program = compile(SOURCE);
+    temporary_image file("runs_in_place.mvplc");
+
+    write_bytecode_image(program, file.path);
+
+    bytecode_image image(file.path);
+    const auto     view = image.get_program();
+
+    ASSERT_TRUE(std::ranges::equal(view.code, program.code));
+    ASSERT_TRUE(std::ranges::equal(view.constants, program.constants));
+    ASSERT_TRUE(std::ranges::equal(view.lines, program.lines));
+    ASSERT_EQ(view.lines.size(), view.code.size());
+    ASSERT_EQ(view.functions.size(), program.functions.size());
+    ASSERT_EQ(view.main_function, program.main_function);
+
+    for (std::size_t i = 0; i < program.functions.size(); ++i)
+    {
+        ASSERT_EQ(view.functions[i].entry, program.functions[i].entry);
+        ASSERT_EQ(view.functions[i].n_registers, program.functions[i].n_registers);
+        ASSERT_EQ(image.get_function_name(i), program.functions[i].name);
+    }
+
+    // Sections start on their own page
+    ASSERT_EQ(reinterpret_cast<std::uintptr_t>(view.code.data()) % BYTECODE_IMAGE_ALIGNMENT, 0U);
+    ASSERT_EQ(
+        reinterpret_cast<std::uintptr_t>(view.constants.data()) % BYTECODE_IMAGE_ALIGNMENT, 0U);
+
+    std::ostringstream expected_output;
+    std::ostringstream output;
+
+    ASSERT_EQ(register_machine(view, output).run(),
+              register_machine(program, expected_output).run());
+    ASSERT_EQ(output.str(), expected_output.str());
+}
+
+TEST(TestBytecodeImage, WithoutDebugInformation)
+{
+    const auto      program = compile(SOURCE);
+    temporary_image file("without_debug_information.mvplc");
+
+    write_bytecode_image(program, file.path, false);
+
+    bytecode_image image(file.path);
+
+    ASSERT_EQ(image.get_function_name(0), "");
+    ASSERT_TRUE(image.get_program().lines.empty());
+    ASSERT_EQ(register_machine(image.get_program()).run(), 1000000292);
+}
+
+TEST(TestBytecodeImage, RejectsInvalidImages)
+{
+    temporary_image file("invalid.mvplc");
+
+    ASSERT_THROW(bytecode_image image(file.path), std::runtime_error);
+
+    write_bytecode_image(compile(SOURCE), file.path);
+
+    // Truncated in the middle of the sections
+    std::filesystem::resize_file(file.path, BYTECODE_IMAGE_ALIGNMENT + 8);
+    ASSERT_THROW(bytecode_image image(file.path), std::runtime_error);
+
+    // A newer version
+    write_bytecode_image(compile(SOURCE), file.path);
+    {
+        std::fstream stream(file.path, std::ios::binary | std::ios::in | std::ios::out);
+        stream.seekp(offsetof(bytecode_image_header, version));
+        stream.put(static_cast<char>(BYTECODE_IMAGE_VERSION + 1));
+    }
+    ASSERT_THROW(bytecode_image image(file.path), std::runtime_error);
+
+    // Not an image at all
+    std::ofstream(file.path) << SOURCE;
+    ASSERT_THROW(bytecode_image image(file.path), std::runtime_error);
+}
@@ -0,0 +1,303 @@
+#include <gtest/gtest.h>
+
+#include <csetjmp>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+#include "../src/backend/c_backend/c_compiler.hpp"
+#include "../src/backend/c_backend/c_translator.hpp"
+#include "../src/backend/code_generator/code_generator.hpp"
+#include "../src/backend/interpreter/register_machine.hpp"
+#include "../src/frontend/lexer/lexer.hpp"
+#include "../src/frontend/parser/parser.hpp"
+
+#ifdef __unix__
+#    include <dlfcn.h>
+#    include <sys/wait.h>
+#    include <unistd.h>
+
+namespace
+{
+struct run_result
+{
+    std::string output;
+    int         exit_status;
+};
+
+std::string translate(const std::string& source)
+{
+    lexer lexer(source);
+    auto  token_stream = lexer.lex();
+
+    return translate_to_c(*parse(token_stream));
+}
+
+std::string interpret(const std::string& source)
+{
+    lexer lexer(source);
+    auto  token_stream = lexer.lex();
+    auto  program      = generate_code(*parse(token_stream));
+
+    std::ostringstream output;
+    register_machine(program, output).run();
+
+    return output.str();
+}
+
+bool has_c_compiler()
+{
+    return std::system("cc --version > /dev/null 2>&1") == 0;
+}
+
+// Removes the output and the C source kept next to it
+struct temporary_output
+{
+    std::string path;
+
+    explicit temporary_output(const std::string& name)
+        : path((std::filesystem::temp_directory_path()
+                / ("mvpl_" + std::to_string(getpid()) + "_" + name))
+                   .string())
+    {
+    }
+
+    ~temporary_output()
+    {
+        std::filesystem::remove(path);
+        std::filesystem::remove(path + ".c");
+    }
+};
+
+// Stderr is discarded, traps print their message there
+run_result run_executable(const std::string& path)
+{
+    auto* pipe = popen((path + " 2> /dev/null").c_str(), "r");
+
+    std::string output;
+    char        buffer[256];
+
+    for (std::size_t n; (n = std::fread(buffer, 1, sizeof(buffer), pipe)) > 0;)
+    {
+        output.append(buffer, n);
+    }
+
+    auto status = pclose(pipe);
+
+    return {output, WIFEXITED(status) ? WEXITSTATUS(status) : -1};
+}
+
+run_result compile_and_run(const std::string& source, const std::string& name)
+{
+    temporary_output executable(name);
+
+    compile_c(translate(source), executable.path);
+
+    return run_executable(executable.path);
+}
+
+std::jmp_buf trap_buffer;
+std::string  trap_message;
+
+void on_trap(const char* message)
+{
+    trap_message = message;
+    std::longjmp(trap_buffer, 1);
+}
+}    // namespace
+
+//****************************************************************************//
+//                                C translator                                //
+//****************************************************************************//
+TEST(TestCTranslator, MatchesTheInterpreter)
+{
+    if (!has_c_compiler())
+    {
+        GTEST_SKIP() << "No C compiler";
+    }
+
+    // The language has no unary minus and its relational operators bind weaker than the
+    // logical ones, hence the parentheses
+    const std::string source = R"(
+function check(x)
+{
+    print(x);
+    return x;
+}
+function mix(x, y)
+{
+    let r = (x * y) - (x / y) + (x % y);
+    r = (r ^ (x << 67)) | (y >> 1);
+    let minus_one = y - y - 1;
+    let big = 1 << 63;
+    r = r + (big / minus_one) + (x % minus_one) + (big * 3);
+    switch (x % 4)
+    {
+        case 0: r = r + 3;
+        case 1: r = r * 5;
+        case 1: r = 0;
+        case 3: r = r - 7;
+    }
+    return r;
+}
+function count_down(n, steps)
+{
+    if (n == 0)
+    {
+        return steps;
+    }
+    --n;
+    ++steps;
+    return count_down(n, steps);
+}
+function main()
+{
+    let x = 2;
+    let y = x + (++x);
+    print(y);
+    if (x < 0)
+    {
+        print(0);
+    }
+    else if ((x == 3) && check(7))
+    {
+        let x = x * 10;
+        let x = x + 1;
+        print(x);
+    }
+    else
+    {
+        print(2);
+    }
+    print(x);
+    let sum = 0;
+    for (let i = 0 - 5; i < 5; ++i)
+    {
+        sum = (sum * 31) + mix(i, 3);
+    }
+    print(sum);
+    let either = check(0) || check(4);
+    print(either);
+    let not_x = !x;
+    print(not_x);
+    let steps = count_down(1000000, 0);
+    print(steps);
+    return 0;
+}
+)";
+
+    auto result = compile_and_run(source, "matches");
+
+    ASSERT_EQ(result.exit_status, 0);
+    ASSERT_EQ(result.output, interpret(source));
+}
+
+TEST(TestCTranslator, TrapsLikeTheInterpreter)
+{
+    if (!has_c_compiler())
+    {
+        GTEST_SKIP() << "No C compiler";
+    }
+
+    auto division = compile_and_run(R"(
+function main()
+{
+    let zero = 0;
+    print(1);
+    let quotient = 1 / zero;
+    print(quotient);
+    return 0;
+}
+)",
+                                    "division");
+
+    ASSERT_NE(division.exit_status, 0);
+    ASSERT_EQ(division.output, "1\n");
+
+    const std::string recursion = R"(
+function deep(n)
+{
+    let result = deep(n) + 1;
+    return result;
+}
+function main()
+{
+    return deep(0);
+}
+)";
+
+    ASSERT_THROW(interpret(recursion), std::runtime_error);
+    ASSERT_NE(compile_and_run(recursion, "recursion").exit_status, 0);
+}
+
+TEST(TestCTranslator, SharedObject)
+{
+    if (!has_c_compiler())
+    {
+        GTEST_SKIP() << "No C compiler";
+    }
+
+    temporary_output   library("shared.so");
+    c_compiler_options options;
+    options.kind = c_output_kind::SHARED_OBJECT;
+
+    compile_c(translate(R"(
+function main()
+{
+    let x = 6;
+    let y = x * 7;
+    print(y);
+    let zero = x - 6;
+    return x % zero;
+}
+)"),
+              library.path,
+              options);
+
+    auto* handle = dlopen(library.path.c_str(), RTLD_NOW | RTLD_LOCAL);
+    ASSERT_NE(handle, nullptr);
+
+    auto* run        = reinterpret_cast<std::int64_t (*)()>(dlsym(handle, "mvpl_run"));
+    auto* set_output = reinterpret_cast<void (*)(FILE*)>(dlsym(handle, "mvpl_set_output"));
+    auto* set_trap_handler =
+        reinterpret_cast<void (*)(void (*)(const char*))>(dlsym(handle, "mvpl_set_trap_handler"));
+
+    ASSERT_NE(run, nullptr);
+    ASSERT_NE(set_output, nullptr);
+    ASSERT_NE(set_trap_handler, nullptr);
+    ASSERT_EQ(dlsym(handle, "main"), nullptr);
+
+    auto* output = std::tmpfile();
+    set_output(output);
+    set_trap_handler(on_trap);
+
+    if (setjmp(trap_buffer) == 0)
+    {
+        run();
+        FAIL() << "Modulo by zero did not trap";
+    }
+
+    std::rewind(output);
+    char buffer[16]{};
+    ASSERT_NE(std::fgets(buffer, sizeof(buffer), output), nullptr);
+    ASSERT_EQ(std::string(buffer), "42\n");
+    ASSERT_EQ(trap_message, "Modulo by zero");
+
+    std::fclose(output);
+    dlclose(handle);
+}
+
+TEST(TestCTranslator, RejectsInvalidPrograms)
+{
+    ASSERT_THROW(translate("function f()\n{\n    return 0;\n}\n"), std::runtime_error);
+    ASSERT_THROW(translate("function main()\n{\n    return x;\n}\n"), std::runtime_error);
+    ASSERT_THROW(translate("procedure p()\n{\n}\nfunction main()\n{\n    return p();\n}\n"),
+                 std::runtime_error);
+}
+
+#endif
@@ -0,0 +1,368 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../src/backend/bytecode_program.hpp"
+#include "../src/backend/code_generator/code_generator.hpp"
+#include "../src/backend/code_generator/lowered_function.hpp"
+#include "../src/backend/code_generator/peephole_optimizer.hpp"
+#include "../src/backend/code_generator/register_allocator.hpp"
+#include "../src/backend/code_generator/superinstructions.hpp"
+#include "../src/backend/interpreter/register_machine.hpp"
+#include "../src/frontend/lexer/lexer.hpp"
+#include "../src/frontend/parser/parser.hpp"
+
+namespace
+{
+struct run_result
+{
+    value_t     return_value;
+    std::string output;
+};
+
+bytecode_program compile(const std::string& source, const code_generator_options& options = {})
+{
+    lexer lexer(source);
+    auto  token_stream = lexer.lex();
+
+    return generate_code(*parse(token_stream), options);
+}
+
+run_result run(const std::string& source, const code_generator_options& options = {})
+{
+    auto               program = compile(source, options);
+    std::ostringstream output;
+
+    auto return_value = register_machine(program, output).run();
+
+    return {return_value, output.str()};
+}
+}    // namespace
+
+//****************************************************************************//
+//                               Code generation                              //
+//****************************************************************************//
+TEST(TestCodeGenerator, Arithmetic)
+{
+    auto result = run(R"(
+function main()
+{
+    let x = 1 + 2 * 3 - 4;
+    return x * (x << 2) % 7;
+}
+)");
+
+    ASSERT_EQ(result.return_value, 1);
+}
+
+TEST(TestCodeGenerator, RecursiveCall)
+{
+    auto result = run(R"(
+function fib(n)
+{
+    if (n < 2)
+    {
+        return n;
+    }
+    let a = n - 1;
+    let b = n - 2;
+    return fib(a) + fib(b);
+}
+function main()
+{
+    return fib(20);
+}
+)");
+
+    ASSERT_EQ(result.return_value, 6765);
+}
+
+TEST(TestCodeGenerator, Loops)
+{
+    auto result = run(R"(
+function main()
+{
+    let sum = 0;
+    for (let i = 0; i < 10; ++i)
+    {
+        sum = sum + i;
+    }
+    let j = 3;
+    while (j > 0)
+    {
+        sum = sum + 100;
+        --j;
+    }
+    return sum;
+}
+)");
+
+    ASSERT_EQ(result.return_value, 345);
+}
+
+TEST(TestCodeGenerator, IfElseChainAndSwitch)
+{
+    auto result = run(R"(
+procedure classify(x)
+{
+    if (x < 0)
+    {
+        print(1);
+    }
+    else if (x == 0)
+    {
+        print(2);
+    }
+    else
+    {
+        print(3);
+    }
+    switch (x)
+    {
+        case 5: print(5);
+        case 7: print(7); print(8);
+    }
+}
+function main()
+{
+    classify(0);
+    classify(5);
+    classify(7);
+    return 0;
+}
+)");
+
+    ASSERT_EQ(result.output, "2\n3\n5\n3\n7\n8\n");
+}
+
+TEST(TestCodeGenerator, LogicalOperatorsShortCircuit)
+{
+    const std::string source = R"(
+function check(x)
+{
+    print(x);
+    return x;
+}
+function main()
+{
+    let zero = 0;
+    let count = 0;
+    if ((zero != 0) && (10 / zero > 1))
+    {
+        count = 100;
+    }
+    if (check(1) || check(2))
+    {
+        ++count;
+    }
+    while ((count < 5) && check(count))
+    {
+        ++count;
+    }
+    let both = check(0) && check(3);
+    let either = check(0) || check(4);
+    return count * 100 + both * 10 + either;
+}
+)";
+
+    for (std::size_t level : {0, 1})
+    {
+        auto result = run(source, {.optimization_level = level});
+
+        ASSERT_EQ(result.return_value, 501);
+        ASSERT_EQ(result.output, "1\n1\n2\n3\n4\n0\n0\n4\n");
+    }
+}
+
+TEST(TestCodeGenerator, SpillsUnderRegisterPressure)
+{
+    std::string source = "function main()\n{\n";
+
+    for (int i = 0; i < 20; ++i)
+    {
+        source += "    let v" + std::to_string(i) + " = " + std::to_string(i) + ";\n";
+    }
+    source += "    let sum = 0;\n";
+
+    for (int i = 0; i < 20; ++i)
+    {
+        source += "    sum = sum + v" + std::to_string(i) + " * v" + std::to_string(19 - i) + ";\n";
+    }
+    source += "    return sum;\n}\n";
+
+    auto unconstrained = run(source);
+    auto constrained   = run(source, {.register_budget = 6});
+
+    ASSERT_EQ(unconstrained.return_value, constrained.return_value);
+    ASSERT_EQ(constrained.return_value, 1140);
+}
+
+TEST(TestCodeGenerator, UndeclaredVariableThrows)
+{
+    ASSERT_THROW(compile("function main()\n{\n    return x;\n}\n"), std::runtime_error);
+}
+
+//****************************************************************************//
+//                             Register allocation                            //
+//****************************************************************************//
+TEST(TestRegisterAllocator, ReusesRegistersOfDeadValues)
+{
+    // v0 = 1; v1 = v0 + v0; v2 = v1 + v1; return v2
+    lowered_function function;
+    function.name                = "main";
+    function.n_virtual_registers = 3;
+    function.code                = {{opcode::SETLIT, 0, 0, 0},
+                                    {opcode::ADD, 1, 0, 0},
+                                    {opcode::ADD, 2, 1, 1},
+                                    {opcode::RET, 2, 0, 0}};
+
+    auto intervals = compute_live_intervals(function);
+    ASSERT_EQ(intervals.size(), 3);
+
+    auto allocation = allocate_registers(function);
+
+    ASSERT_EQ(allocation.n_physical_registers, 1);
+    ASSERT_EQ(allocation.n_spill_slots, 0);
+
+    apply_register_allocation(function, allocation);
+    ASSERT_EQ(function.n_registers, 1);
+}
+
+//****************************************************************************//
+//                             Superinstructions                              //
+//****************************************************************************//
+TEST(TestSuperinstructions, CountingLoop)
+{
+    const std::string source = R"(
+function main()
+{
+    let sum = 0;
+    for (let i = 0; i < 10; ++i)
+    {
+        // Not i * 3, which strength reduction turns into a new induction variable
+        sum = sum * 3 + i - 1;
+    }
+    return sum;
+}
+)";
+
+    auto plain = compile(source, {.form_superinstructions = false});
+    auto fused = compile(source);
+
+    auto contains = [](const bytecode_program& program, opcode op) {
+        return std::ranges::any_of(program.code, [op](const instruction& i) { return i.op == op; });
+    };
+
+    ASSERT_TRUE(contains(fused, opcode::MULI));
+    ASSERT_TRUE(contains(fused, opcode::ADDI));
+    ASSERT_TRUE(contains(fused, opcode::INCJUMPLESSI));
+    ASSERT_LT(fused.code.size(), plain.code.size());
+
+    std::ostringstream output;
+    ASSERT_EQ(register_machine(plain, output).run(), -14767);
+    ASSERT_EQ(register_machine(fused, output).run(), -14767);
+}
+
+TEST(TestSuperinstructions, LiteralOnTheLeft)
+{
+    auto result = run(R"(
+function main()
+{
+    let x = 7;
+    let count = 0;
+    if (3 < x)
+    {
+        ++count;
+    }
+    if (10 - x == 3)
+    {
+        ++count;
+    }
+    return count * (2 * x);
+}
+)");
+
+    ASSERT_EQ(result.return_value, 28);
+}
+
+TEST(TestSuperinstructions, SpilledLoopCounter)
+{
+    std::string source = "function main()\n{\n    let sum = 0;\n";
+
+    for (int i = 0; i < 12; ++i)
+    {
+        source += "    let v" + std::to_string(i) + " = sum + " + std::to_string(i) + ";\n";
+    }
+    source += "    for (let i = 0; i < 5; ++i)\n    {\n";
+
+    for (int i = 0; i < 12; ++i)
+    {
+        source += "        sum = sum + v" + std::to_string(i) + ";\n";
+    }
+    source += "    }\n    return sum;\n}\n";
+
+    ASSERT_EQ(run(source, {.register_budget = 5}).return_value, 330);
+    ASSERT_EQ(run(source).return_value, 330);
+}
+
+//****************************************************************************//
+//                             Peephole optimizer                             //
+//****************************************************************************//
+TEST(TestPeepholeOptimizer, PreservesSemantics)
+{
+    const std::string source = R"(
+function collatz(n)
+{
+    let steps = 0;
+    while (n != 1)
+    {
+        if (n % 2 == 0)
+        {
+            n = n / 2;
+        }
+        else
+        {
+            n = 3 * n + 1;
+        }
+        steps = steps + 1;
+    }
+    return steps;
+}
+function main()
+{
+    let total = 0;
+    for (let i = 1; i < 30; ++i)
+    {
+        let unused = i * 7;
+        total = total + collatz(i);
+    }
+    print(total);
+    return total;
+}
+)";
+
+    auto plain     = compile(source, {.optimization_level = 0});
+    auto optimized = compile(source);
+
+    std::ostringstream plain_output;
+    std::ostringstream optimized_output;
+
+    ASSERT_EQ(register_machine(plain, plain_output).run(),
+              register_machine(optimized, optimized_output).run());
+    ASSERT_EQ(plain_output.str(), optimized_output.str());
+    ASSERT_LT(optimized.code.size(), plain.code.size());
+
+    code_generator_report report;
+    lexer                 lexer(source);
+    auto                  token_stream = lexer.lex();
+
+    generate_code(*parse(token_stream), {}, &report);
+
+    // The unused local is already removed in SSA form, before the peephole optimizer runs
+    ASSERT_GT(json(report.ir_passes)["eliminate_dead_values"], 0);
+}
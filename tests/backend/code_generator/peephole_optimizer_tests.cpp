@@ -0,0 +1,151 @@
+#include <gtest/gtest.h>
+
+#include <utility>
+#include <vector>
+
+#include "../src/backend/code_generator/lowered_function.hpp"
+#include "../src/backend/code_generator/peephole_optimizer.hpp"
+
+namespace
+{
+const std::vector<value_t> CONSTANTS{0, 1, -1, 42};
+
+lowered_function make_function(std::vector<instruction> code,
+                               std::vector<std::size_t> labels,
+                               std::size_t              n_virtual_registers,
+                               std::size_t              n_parameters = 0)
+{
+    return {"f", n_parameters, std::move(code), std::move(labels), n_virtual_registers};
+}
+}    // namespace
+
+//****************************************************************************//
+//                                   Rules                                    //
+//****************************************************************************//
+TEST(TestPeepholeOptimizer, RedundantSet)
+{
+    // r2 = r0 + r1 is computed into a temporary and copied into r2
+    auto function = make_function({{opcode::ADD, 3, 0, 1},
+                                   {opcode::SET, 2, 3, 0},
+                                   {opcode::SET, 2, 2, 0},
+                                   {opcode::RET, 2, 0, 0}},
+                                  {},
+                                  4,
+                                  2);
+
+    auto statistics = optimize_peephole(function, CONSTANTS);
+
+    std::vector<instruction> expected{{opcode::ADD, 2, 0, 1}, {opcode::RET, 2, 0, 0}};
+
+    ASSERT_EQ(function.code, expected);
+    ASSERT_EQ(statistics[peephole_rule::REDUNDANT_SET], 2);
+}
+
+TEST(TestPeepholeOptimizer, JumpThreading)
+{
+    // Label 0 -> JUMP 1, label 1 -> JUMP 2, label 2 -> RET
+    auto function = make_function({{opcode::JUMPLESS, 0, 0, 1},
+                                   {opcode::PRINT, 0, 0, 0},
+                                   {opcode::JUMP, 1, 0, 0},
+                                   {opcode::JUMP, 2, 0, 0},
+                                   {opcode::RET, 1, 0, 0}},
+                                  {2, 3, 4},
+                                  2,
+                                  2);
+
+    optimize_peephole(function, CONSTANTS);
+
+    ASSERT_EQ(function.code[0].op, opcode::JUMPLESS);
+    ASSERT_EQ(function.labels[function.code[0].a], 2);
+    // The jump to the next instruction is gone
+    ASSERT_EQ(function.code.size(), 3);
+    ASSERT_EQ(function.code[2].op, opcode::RET);
+}
+
+TEST(TestPeepholeOptimizer, MaterializedBooleanIsFused)
+{
+    // r2 = r0 < r1; if (r2 != 0) goto label 1
+    auto function = make_function({{opcode::SETLIT, 2, 1, 0},
+                                   {opcode::JUMPLESS, 0, 0, 1},
+                                   {opcode::SETLIT, 2, 0, 0},
+                                   {opcode::JUMPNEQI, 1, 2, 0},
+                                   {opcode::RET, 0, 0, 0},
+                                   {opcode::RET, 1, 0, 0}},
+                                  {3, 5},
+                                  3,
+                                  2);
+
+    auto statistics = optimize_peephole(function, CONSTANTS);
+
+    std::vector<instruction> expected{
+        {opcode::JUMPLESS, 1, 0, 1}, {opcode::RET, 0, 0, 0}, {opcode::RET, 1, 0, 0}};
+
+    ASSERT_EQ(function.code, expected);
+    ASSERT_EQ(function.labels[1], 2);
+    ASSERT_EQ(statistics[peephole_rule::FUSED_COMPARE], 1);
+}
+
+TEST(TestPeepholeOptimizer, NegatedTestAndJumpOverJump)
+{
+    // if (!r0) goto label 0 else goto label 1, written as a jump over a jump
+    auto function = make_function({{opcode::SETLIT, 2, 0, 0},
+                                   {opcode::NOT, 1, 0, 0},
+                                   {opcode::JUMPEQ, 0, 1, 2},
+                                   {opcode::JUMP, 1, 0, 0},
+                                   {opcode::RET, 0, 0, 0},
+                                   {opcode::RET, 2, 0, 0}},
+                                  {4, 5},
+                                  3,
+                                  1);
+
+    optimize_peephole(function, CONSTANTS);
+
+    // JUMPEQ skip, !r0, 0; JUMP target -> JUMPNEQ target, !r0, 0 -> JUMPEQ target, r0, 0
+    ASSERT_EQ(function.code[1].op, opcode::JUMPEQ);
+    ASSERT_EQ(function.code[1].b, 0);
+    ASSERT_EQ(function.labels[function.code[1].a], 3);
+    ASSERT_EQ(function.code.size(), 4);
+}
+
+TEST(TestPeepholeOptimizer, DeadStoresKeepTraps)
+{
+    auto function = make_function({{opcode::SETLIT, 1, 3, 0},
+                                   {opcode::MUL, 2, 0, 1},
+                                   {opcode::DIV, 2, 0, 1},
+                                   {opcode::MODI, 2, 0, 0},
+                                   {opcode::RET, 0, 0, 0}},
+                                  {},
+                                  3,
+                                  1);
+
+    auto statistics = optimize_peephole(function, CONSTANTS);
+
+    std::vector<instruction> expected{{opcode::SETLIT, 1, 3, 0},
+                                      {opcode::DIV, 2, 0, 1},
+                                      {opcode::MODI, 2, 0, 0},
+                                      {opcode::RET, 0, 0, 0}};
+
+    ASSERT_EQ(function.code, expected);
+    ASSERT_EQ(statistics[peephole_rule::DEAD_STORE], 1);
+}
+
+TEST(TestPeepholeOptimizer, IncrementsAndDecrements)
+{
+    auto function = make_function({{opcode::SETLIT, 1, 2, 0},
+                                   {opcode::SUB, 0, 0, 1},
+                                   {opcode::ADDI, 0, 0, 1},
+                                   {opcode::INC, 0, 0, 0},
+                                   {opcode::DEC, 0, 0, 0},
+                                   {opcode::ADDI, 0, 0, -1},
+                                   {opcode::RET, 0, 0, 0}},
+                                  {},
+                                  2,
+                                  1);
+
+    optimize_peephole(function, CONSTANTS);
+
+    // r0 - (-1) + 1 - 1 = r0 + 1
+    std::vector<instruction> expected{{opcode::INC, 0, 0, 0}, {opcode::RET, 0, 0, 0}};
+
+    ASSERT_EQ(function.code, expected);
+}
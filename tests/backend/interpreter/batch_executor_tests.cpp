@@ -0,0 +1,117 @@
+#include <gtest/gtest.h>
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "../src/backend/code_generator/code_generator.hpp"
+#include "../src/backend/interpreter/batch_executor.hpp"
+#include "../src/frontend/lexer/lexer.hpp"
+#include "../src/frontend/parser/parser.hpp"
+
+namespace
+{
+bytecode_program compile(const std::string& source)
+{
+    lexer lexer(source);
+    auto  token_stream = lexer.lex();
+
+    return generate_code(*parse(token_stream));
+}
+}    // namespace
+
+//****************************************************************************//
+//                               Batch executor                               //
+//****************************************************************************//
+TEST(TestBatchExecutor, RunsEveryJob)
+{
+    const auto sum = compile(R"(
+function main()
+{
+    let n = read();
+    let sum = 0;
+    for (let i = 1; i <= n; ++i)
+    {
+        sum = sum + i;
+    }
+    print(n);
+    return sum;
+}
+)");
+    const auto square = compile(R"(
+function main()
+{
+    let x = read();
+    let square = x * x;
+    return square;
+}
+)");
+
+    batch_executor executor({.n_threads = 4});
+
+    ASSERT_EQ(executor.get_n_threads(), 4);
+
+    std::vector<batch_job> jobs;
+
+    for (int i = 0; i < 200; ++i)
+    {
+        // Uneven jobs, so that threads run out of their own ones at different times
+        jobs.push_back({i % 2 == 0 ? &sum : &square, std::to_string(i % 10 == 0 ? 100000 : i)});
+    }
+
+    // Machines are reused by the second batch
+    for (int batch = 0; batch < 2; ++batch)
+    {
+        const auto results = executor.run(jobs);
+
+        ASSERT_EQ(results.size(), jobs.size());
+
+        for (std::size_t i = 0; i < jobs.size(); ++i)
+        {
+            const value_t n = i % 10 == 0 ? 100000 : static_cast<value_t>(i);
+
+            ASSERT_TRUE(results[i].succeeded);
+
+            if (i % 2 == 0)
+            {
+                ASSERT_EQ(results[i].value, n * (n + 1) / 2);
+                ASSERT_EQ(results[i].output, std::to_string(n) + "\n");
+            }
+            else
+            {
+                ASSERT_EQ(results[i].value, n * n);
+                ASSERT_EQ(results[i].output, "");
+            }
+        }
+    }
+
+    ASSERT_TRUE(executor.run({}).empty());
+}
+
+TEST(TestBatchExecutor, ReportsErrors)
+{
+    const auto program = compile(R"(
+function main()
+{
+    let divisor = read();
+    print(1);
+    let quotient = 1 / divisor;
+    return quotient;
+}
+)");
+
+    batch_executor               executor({.n_threads = 2});
+    const std::vector<batch_job> jobs{{&program, "0"}, {&program, "1"}, {&program, "x"}};
+    const auto                   results = executor.run(jobs);
+
+    ASSERT_FALSE(results[0].succeeded);
+    ASSERT_EQ(results[0].error, "Division by zero");
+    ASSERT_EQ(results[0].output, "1\n");
+
+    ASSERT_TRUE(results[1].succeeded);
+    ASSERT_EQ(results[1].value, 1);
+
+    ASSERT_FALSE(results[2].succeeded);
+    ASSERT_EQ(results[2].error, "Invalid input");
+    ASSERT_EQ(results[2].output, "");
+}
@@ -0,0 +1,227 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+#include "../src/backend/code_generator/code_generator.hpp"
+#include "../src/backend/interpreter/buffered_io.hpp"
+#include "../src/backend/interpreter/register_machine.hpp"
+#include "../src/frontend/lexer/lexer.hpp"
+#include "../src/frontend/parser/parser.hpp"
+
+#ifdef MVPL_FILE_DESCRIPTORS
+#    include <fcntl.h>
+#    include <unistd.h>
+#endif
+
+namespace
+{
+bytecode_program compile(const std::string& source)
+{
+    lexer lexer(source);
+    auto  token_stream = lexer.lex();
+
+    return generate_code(*parse(token_stream));
+}
+}    // namespace
+
+//****************************************************************************//
+//                                   Output                                   //
+//****************************************************************************//
+TEST(TestBufferedIO, WritesWhenFull)
+{
+    std::ostringstream stream;
+    output_buffer      output(stream, 48);
+    std::string        expected;
+
+    output.write(std::numeric_limits<value_t>::min());
+    output.write(std::numeric_limits<value_t>::max());
+    expected = "-9223372036854775808\n9223372036854775807\n";
+
+    ASSERT_EQ(stream.str(), "");
+
+    // Does not fit anymore
+    output.write(1234567890123);
+    expected += "1234567890123\n";
+
+    ASSERT_EQ(stream.str(), "-9223372036854775808\n9223372036854775807\n");
+
+    output.flush();
+
+    ASSERT_EQ(stream.str(), expected);
+}
+
+#ifdef MVPL_FILE_DESCRIPTORS
+TEST(TestBufferedIO, WritesFileDescriptors)
+{
+    int files[2];
+    ASSERT_EQ(pipe(files), 0);
+
+    {
+        output_buffer output(files[1]);
+
+        for (value_t i = 0; i < 1000; ++i)
+        {
+            output.write(i);
+        }
+    }
+
+    close(files[1]);
+
+    input_buffer       input(files[0], 7);
+    std::ostringstream unused;
+    output_buffer      pending(unused);
+
+    for (value_t i = 0; i < 1000; ++i)
+    {
+        ASSERT_EQ(input.read(pending), i);
+    }
+
+    ASSERT_EQ(input.read(pending), 0);
+
+    close(files[0]);
+}
+#endif
+
+//****************************************************************************//
+//                                   Input                                    //
+//****************************************************************************//
+TEST(TestBufferedIO, ParsesAcrossRefills)
+{
+    std::istringstream stream(" 12\n-345 +6\t9223372036854775807  -9223372036854775808\n\n");
+    std::ostringstream unused;
+    output_buffer      pending(unused);
+    input_buffer       input(stream, 3);
+
+    ASSERT_EQ(input.read(pending), 12);
+    ASSERT_EQ(input.read(pending), -345);
+    ASSERT_EQ(input.read(pending), 6);
+    ASSERT_EQ(input.read(pending), std::numeric_limits<value_t>::max());
+    ASSERT_EQ(input.read(pending), std::numeric_limits<value_t>::min());
+    ASSERT_EQ(input.read(pending), 0);
+    ASSERT_EQ(input.read(pending), 0);
+}
+
+TEST(TestBufferedIO, RejectsInvalidInput)
+{
+    std::ostringstream unused;
+    output_buffer      pending(unused);
+
+    for (const auto* text : {"12a", "-", "x", "9223372036854775808", "-9223372036854775809"})
+    {
+        std::istringstream stream(text);
+        input_buffer       input(stream);
+
+        ASSERT_THROW(input.read(pending), std::runtime_error) << text;
+    }
+}
+
+TEST(TestBufferedIO, FlushesBeforeWaitingForInput)
+{
+    std::ostringstream stream;
+    std::istringstream input_stream("7");
+    output_buffer      output(stream);
+    input_buffer       input(input_stream);
+
+    output.write(42);
+
+    ASSERT_EQ(input.read(output), 7);
+    ASSERT_EQ(stream.str(), "42\n");
+}
+
+//****************************************************************************//
+//                              Register machine                              //
+//****************************************************************************//
+TEST(TestBufferedIO, ReadsAndPrints)
+{
+    const auto program = compile(R"(
+function main()
+{
+    let n = read();
+    let sum = 0;
+    for (let i = 0; i < n; ++i)
+    {
+        let value = read();
+        print(value);
+        sum = sum + value;
+    }
+    print(sum);
+    return sum;
+}
+)");
+
+    std::ostringstream output;
+    std::istringstream input("4\n10 20\n30 -5\n");
+    register_machine   vm(program, output);
+
+    vm.set_input(input);
+
+    ASSERT_EQ(vm.run(), 55);
+    ASSERT_EQ(output.str(), "10\n20\n30\n-5\n55\n");
+}
+
+TEST(TestBufferedIO, WritesOutputBeforeTraps)
+{
+    const auto program = compile(R"(
+function main()
+{
+    let zero = read();
+    print(1);
+    let quotient = 1 / zero;
+    return quotient;
+}
+)");
+
+    std::ostringstream output;
+    std::istringstream input("");
+    register_machine   vm(program, output);
+
+    vm.set_input(input);
+
+    ASSERT_THROW(vm.run(), std::runtime_error);
+    ASSERT_EQ(output.str(), "1\n");
+}
+
+#ifdef MVPL_FILE_DESCRIPTORS
+TEST(TestBufferedIO, SuspendsOnNonBlockingInput)
+{
+    const auto program = compile(R"(
+function main()
+{
+    let a = read();
+    print(a);
+    let b = read();
+    return a + b;
+}
+)");
+
+    int files[2];
+    ASSERT_EQ(pipe(files), 0);
+    ASSERT_EQ(fcntl(files[0], F_SETFL, O_NONBLOCK), 0);
+
+    std::ostringstream output;
+    register_machine   vm(program, output);
+
+    vm.set_input(files[0]);
+
+    ASSERT_EQ(vm.resume(1000), register_machine::run_status::WAITING_FOR_INPUT);
+
+    // Half a value is no value yet
+    ASSERT_EQ(write(files[1], "4", 1), 1);
+    ASSERT_EQ(vm.resume(1000), register_machine::run_status::WAITING_FOR_INPUT);
+
+    ASSERT_EQ(write(files[1], "2 1", 3), 3);
+    ASSERT_EQ(vm.resume(1000), register_machine::run_status::WAITING_FOR_INPUT);
+    ASSERT_EQ(output.str(), "42\n");
+
+    // The end of the input completes the value
+    close(files[1]);
+    ASSERT_EQ(vm.resume(1000), register_machine::run_status::FINISHED);
+    ASSERT_EQ(vm.get_result(), 43);
+
+    close(files[0]);
+}
+#endif
@@ -0,0 +1,240 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+#include "../src/backend/code_generator/code_generator.hpp"
+#include "../src/backend/interpreter/executable_memory.hpp"
+#include "../src/backend/interpreter/jit_compiler.hpp"
+#include "../src/backend/interpreter/register_machine.hpp"
+#include "../src/frontend/lexer/lexer.hpp"
+#include "../src/frontend/parser/parser.hpp"
+
+#ifdef MVPL_JIT
+
+namespace
+{
+// Compiles every function on its first call
+const jit_options EAGER{.enabled = true, .threshold = 1};
+const jit_options DISABLED{.enabled = false};
+
+bytecode_program compile(const std::string& source, std::size_t optimization_level = 1)
+{
+    lexer lexer(source);
+    auto  token_stream = lexer.lex();
+
+    return generate_code(*parse(token_stream), {.optimization_level = optimization_level});
+}
+
+std::size_t find_function(const bytecode_program& program, const std::string& name)
+{
+    return static_cast<std::size_t>(
+        std::ranges::find(program.functions, name, &function_entry::name)
+        - program.functions.begin());
+}
+}    // namespace
+
+//****************************************************************************//
+//                              Executable memory                             //
+//****************************************************************************//
+TEST(TestExecutableMemory, IsWritableOrExecutable)
+{
+    // mov eax, 42; ret
+    const std::uint8_t code[] = {0xB8, 42, 0, 0, 0, 0xC3};
+
+    executable_memory memory(sizeof(code));
+    ASSERT_FALSE(memory.is_executable());
+    ASSERT_GE(memory.size(), sizeof(code));
+
+    std::memcpy(memory.data(), code, sizeof(code));
+    memory.make_executable();
+    ASSERT_TRUE(memory.is_executable());
+    ASSERT_EQ(reinterpret_cast<int (*)()>(memory.data())(), 42);
+
+    memory.make_writable();
+    memory.data()[1] = 7;
+    memory.make_executable();
+    ASSERT_EQ(reinterpret_cast<int (*)()>(memory.data())(), 7);
+}
+
+//****************************************************************************//
+//                                JIT compiler                                //
+//****************************************************************************//
+TEST(TestJitCompiler, CompilesHotFunctions)
+{
+    auto program = compile(R"(
+function sum_up(n)
+{
+    let sum = 0;
+    for (let i = 0; i < n; ++i)
+    {
+        sum = sum + i;
+    }
+    return sum;
+}
+function main()
+{
+    let total = 0;
+    for (let i = 0; i < 5; ++i)
+    {
+        let partial = sum_up(i);
+        total = total + partial;
+    }
+    return total;
+}
+)",
+                           0);
+
+    register_machine vm(program, std::cout, {.enabled = true, .threshold = 3});
+
+    ASSERT_EQ(vm.run(), 10);
+    ASSERT_TRUE(vm.is_jit_compiled(find_function(program, "sum_up")));
+    // Only entered once
+    ASSERT_FALSE(vm.is_jit_compiled(program.main_function));
+
+    register_machine interpreter(program, std::cout, DISABLED);
+
+    ASSERT_EQ(interpreter.run(), 10);
+    ASSERT_FALSE(interpreter.is_jit_compiled(find_function(program, "sum_up")));
+}
+
+TEST(TestJitCompiler, HotLoopsContinueAsMachineCode)
+{
+    auto program = compile(R"(
+function main()
+{
+    let x = 1;
+    for (let i = 0; i < 1000; ++i)
+    {
+        x = (x * 6364136223846793005) + 1442695040888963407;
+        x = x ^ (x >> 29);
+    }
+    print(x);
+    return x;
+}
+)");
+
+    std::ostringstream jit_output;
+    std::ostringstream interpreter_output;
+
+    register_machine jit(program, jit_output, {.threshold = 1000, .loop_threshold = 100});
+    register_machine interpreter(program, interpreter_output, DISABLED);
+
+    ASSERT_EQ(jit.run(), interpreter.run());
+    ASSERT_EQ(jit_output.str(), interpreter_output.str());
+    ASSERT_TRUE(jit.is_jit_compiled(program.main_function));
+}
+
+TEST(TestJitCompiler, MatchesTheInterpreter)
+{
+    // The language has no unary minus and its relational operators bind weaker than the
+    // logical ones, hence the parentheses
+    const std::string source = R"(
+function mix(x, y)
+{
+    let r = (x * y) - (x / y) + (x % y);
+    r = (r ^ (x << 3)) | (y >> 1);
+    r = r + (x & 255) + (x / 7) + (x % 7) + (x / 8) + (x % 8) + (x / 1000003);
+    let minus_one = y - y - 1;
+    let big = 1 << 63;
+    r = r + (big / minus_one) + (x % minus_one) + (x / minus_one);
+    let n = !x;
+    if (!(x < y) && (y != 3))
+    {
+        r = r + n + 1;
+    }
+    switch (x % 10)
+    {
+        case 0: r = r + 3;
+        case 1: r = r * 5;
+        case 2: r = r - 7;
+        case 3: r = r + 11;
+        case 5: r = r ^ 13;
+        case 6: r = r + 17;
+        case 8: r = r * 19;
+    }
+    return r;
+}
+function main()
+{
+    let sum = 0;
+    for (let i = 0 - 60; i < 60; ++i)
+    {
+        let j = (i * 3) + 1;
+        let m = mix(i, j);
+        sum = (sum * 31) + m;
+    }
+    return sum;
+}
+)";
+
+    for (std::size_t level : {0, 1})
+    {
+        auto program = compile(source, level);
+
+        register_machine jit(program, std::cout, EAGER);
+        register_machine interpreter(program, std::cout, DISABLED);
+
+        ASSERT_EQ(jit.run(), interpreter.run());
+        ASSERT_TRUE(jit.is_jit_compiled(find_function(program, "mix")));
+    }
+}
+
+TEST(TestJitCompiler, SideExitsToTheInterpreter)
+{
+    const std::string source = R"(
+function divide(x, y)
+{
+    print(x);
+    let q = x / y;
+    print(q);
+    return q;
+}
+function main()
+{
+    let a = divide(10, 2);
+    let b = divide(a, 0);
+    return b;
+}
+)";
+    auto program = compile(source, 0);
+
+    std::ostringstream output;
+    register_machine   vm(program, output, EAGER);
+
+    ASSERT_THROW(vm.run(), std::runtime_error);
+    ASSERT_TRUE(vm.is_jit_compiled(find_function(program, "divide")));
+    ASSERT_EQ(output.str(), "10\n5\n5\n");
+}
+
+TEST(TestJitCompiler, FunctionsWithCallsAreInterpreted)
+{
+    auto program = compile(R"(
+function fib(n)
+{
+    if (n < 2)
+    {
+        return n;
+    }
+    let a = n - 1;
+    let b = n - 2;
+    return fib(a) + fib(b);
+}
+function main()
+{
+    return fib(20);
+}
+)");
+
+    register_machine vm(program, std::cout, EAGER);
+
+    ASSERT_EQ(vm.run(), 6765);
+    ASSERT_FALSE(vm.is_jit_compiled(find_function(program, "fib")));
+}
+
+#endif
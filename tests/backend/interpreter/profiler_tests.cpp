@@ -0,0 +1,186 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../src/backend/code_generator/code_generator.hpp"
+#include "../src/backend/interpreter/profiler.hpp"
+#include "../src/backend/interpreter/register_machine.hpp"
+#include "../src/frontend/lexer/lexer.hpp"
+#include "../src/frontend/parser/parser.hpp"
+
+namespace
+{
+// Without optimizations square is called rather than inlined
+const std::string SOURCE = R"(
+function square(x)
+{
+    return x * x;
+}
+function main()
+{
+    let sum = 0;
+    for (let i = 0; i < 10; ++i)
+    {
+        let s = square(i);
+        sum = sum + s;
+    }
+    print(sum);
+    return sum;
+}
+)";
+
+bytecode_program compile(const std::string& source)
+{
+    lexer lexer(source);
+    auto  token_stream = lexer.lex();
+
+    return generate_code(*parse(token_stream), {.optimization_level = 0});
+}
+
+json find(const json& entries, const std::string& key, const json& value)
+{
+    for (const auto& entry : entries)
+    {
+        if (entry[key] == value)
+        {
+            return entry;
+        }
+    }
+
+    return nullptr;
+}
+}    // namespace
+
+//****************************************************************************//
+//                                  Profiler                                  //
+//****************************************************************************//
+TEST(TestProfiler, CountsOpcodesFunctionsAndLines)
+{
+    const auto         program = compile(SOURCE);
+    std::ostringstream output;
+    register_machine   vm(program, output);
+    profiler           profile(program);
+
+    vm.attach_profiler(&profile);
+
+    ASSERT_EQ(vm.run(), 285);
+    ASSERT_EQ(output.str(), "285\n");
+
+    const auto summary = profile.get_summary();
+
+    ASSERT_EQ(summary["opcodes"]["CALL"], 10);
+    ASSERT_EQ(summary["opcodes"]["RET"], 11);
+    ASSERT_EQ(summary["opcodes"]["PRINT"], 1);
+
+    std::uint64_t n_instructions = 0;
+
+    for (const auto& [op, count] : summary["opcodes"].items())
+    {
+        n_instructions += count.get<std::uint64_t>();
+    }
+    ASSERT_EQ(summary["instructions"], n_instructions);
+
+    const auto main   = find(summary["functions"], "name", "main");
+    const auto square = find(summary["functions"], "name", "square");
+
+    ASSERT_EQ(main["calls"], 1);
+    ASSERT_EQ(square["calls"], 10);
+    ASSERT_EQ(square["instructions"].get<std::uint64_t>() % 10, 0U);
+    ASSERT_EQ(main["instructions"].get<std::uint64_t>()
+                  + square["instructions"].get<std::uint64_t>(),
+              n_instructions);
+    ASSERT_GE(main["total_cycles"], square["total_cycles"]);
+
+    // square consists of line 4, the loop body of main of lines 11 and 12
+    const auto line = find(summary["lines"], "line", 4);
+
+    ASSERT_EQ(line["function"], "square");
+    ASSERT_EQ(line["instructions"], square["instructions"]);
+    ASSERT_NE(find(summary["lines"], "line", 11), nullptr);
+    ASSERT_NE(find(summary["lines"], "line", 12), nullptr);
+
+    // Counts accumulate over runs
+    vm.run();
+    ASSERT_EQ(profile.get_summary()["opcodes"]["CALL"], 20);
+}
+
+TEST(TestProfiler, WritesFoldedStacks)
+{
+    const auto       program = compile(R"(
+function leaf(x)
+{
+    let sum = 0;
+    for (let i = 0; i < x; ++i)
+    {
+        sum = sum + i;
+    }
+    return sum;
+}
+function inner(x)
+{
+    let value = leaf(x);
+    return value;
+}
+function main()
+{
+    let a = inner(1000);
+    let b = leaf(1000);
+    return a + b;
+}
+)");
+    register_machine vm(program);
+    profiler         profile(program);
+
+    vm.attach_profiler(&profile);
+    ASSERT_EQ(vm.run(), 999000);
+
+    std::ostringstream folded;
+    profile.write_folded_stacks(folded);
+
+    std::vector<std::string> stacks;
+    std::istringstream       lines(folded.str());
+
+    for (std::string stack, cycles; lines >> stack >> cycles;)
+    {
+        ASSERT_GT(std::stoull(cycles), 0U);
+        stacks.push_back(stack);
+    }
+
+    std::ranges::sort(stacks);
+    ASSERT_EQ(stacks,
+              (std::vector<std::string>{"main", "main;inner", "main;inner;leaf", "main;leaf"}));
+}
+
+TEST(TestProfiler, RecoversFromErrors)
+{
+    const auto       program = compile(R"(
+function divide(x, y)
+{
+    return x / y;
+}
+function main()
+{
+    let zero = 0;
+    let one  = divide(1, 1);
+    let fail = divide(one, zero);
+    return fail;
+}
+)");
+    register_machine vm(program);
+    profiler         profile(program);
+
+    vm.attach_profiler(&profile);
+
+    ASSERT_THROW(vm.run(), std::runtime_error);
+    ASSERT_THROW(vm.run(), std::runtime_error);
+
+    const auto divide = find(profile.get_summary()["functions"], "name", "divide");
+
+    ASSERT_EQ(divide["calls"], 4);
+}
@@ -0,0 +1,376 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+#include "../src/backend/bytecode_program.hpp"
+#include "../src/backend/instruction.hpp"
+#include "../src/backend/interpreter/register_machine.hpp"
+#include "../src/backend/opcode.hpp"
+
+namespace
+{
+bytecode_program make_program(std::vector<instruction> code,
+                              std::vector<value_t>     constants,
+                              std::size_t              n_registers)
+{
+    bytecode_program program;
+    program.code      = std::move(code);
+    program.constants = std::move(constants);
+    program.functions.push_back({"main", 0, 0, n_registers});
+
+    return program;
+}
+}    // namespace
+
+//****************************************************************************//
+//                                 Arithmetic                                 //
+//****************************************************************************//
+TEST(TestRegisterMachine, ReturnConstant)
+{
+    auto program = make_program(
+        {{opcode::SETLIT, 0, 0, 0}, {opcode::RET, 0, 0, 0}}, {42}, 1);
+
+    register_machine vm(program);
+
+    ASSERT_EQ(vm.run(), 42);
+}
+
+TEST(TestRegisterMachine, Arithmetic)
+{
+    // (7 + 5) * 3 - 10 / 2 % 3
+    auto program = make_program({{opcode::SETLIT, 0, 0, 0},
+                                 {opcode::SETLIT, 1, 1, 0},
+                                 {opcode::SETLIT, 2, 2, 0},
+                                 {opcode::SETLIT, 3, 3, 0},
+                                 {opcode::SETLIT, 4, 4, 0},
+                                 {opcode::ADD, 0, 0, 1},
+                                 {opcode::MUL, 0, 0, 2},
+                                 {opcode::DIV, 3, 3, 4},
+                                 {opcode::MOD, 3, 3, 2},
+                                 {opcode::SUB, 0, 0, 3},
+                                 {opcode::RET, 0, 0, 0}},
+                                {7, 5, 3, 10, 2},
+                                5);
+
+    register_machine vm(program);
+
+    ASSERT_EQ(vm.run(), 34);
+}
+
+TEST(TestRegisterMachine, OverflowWrapsAround)
+{
+    auto program = make_program(
+        {{opcode::SETLIT, 0, 0, 0}, {opcode::INC, 0, 0, 0}, {opcode::RET, 0, 0, 0}},
+        {INT64_MAX},
+        1);
+
+    register_machine vm(program);
+
+    ASSERT_EQ(vm.run(), INT64_MIN);
+}
+
+TEST(TestRegisterMachine, DivisionByZeroThrows)
+{
+    auto program = make_program({{opcode::SETLIT, 0, 0, 0},
+                                 {opcode::SETLIT, 1, 1, 0},
+                                 {opcode::DIV, 0, 0, 1},
+                                 {opcode::RET, 0, 0, 0}},
+                                {1, 0},
+                                2);
+
+    register_machine vm(program);
+
+    ASSERT_THROW(vm.run(), std::runtime_error);
+}
+
+TEST(TestRegisterMachine, LogicalNot)
+{
+    auto program = make_program({{opcode::SETLIT, 0, 0, 0},
+                                 {opcode::NOT, 1, 0, 0},
+                                 {opcode::NOT, 2, 1, 0},
+                                 {opcode::ADD, 0, 1, 2},
+                                 {opcode::RET, 0, 0, 0}},
+                                {5},
+                                3);
+
+    register_machine vm(program);
+
+    ASSERT_EQ(vm.run(), 1);
+}
+
+//****************************************************************************//
+//                                Control flow                                //
+//****************************************************************************//
+TEST(TestRegisterMachine, CountingLoop)
+{
+    // let sum = 0; for (let i = 0; i < 100; ++i) { sum = sum + i; } return sum;
+    auto program = make_program({{opcode::SETLIT, 0, 0, 0},
+                                 {opcode::SETLIT, 1, 0, 0},
+                                 {opcode::SETLIT, 2, 1, 0},
+                                 {opcode::JUMPGEQ, 7, 1, 2},
+                                 {opcode::ADD, 0, 0, 1},
+                                 {opcode::INC, 1, 0, 0},
+                                 {opcode::JUMP, 3, 0, 0},
+                                 {opcode::RET, 0, 0, 0}},
+                                {0, 100},
+                                3);
+
+    register_machine vm(program);
+
+    ASSERT_EQ(vm.run(), 4950);
+}
+
+TEST(TestRegisterMachine, Print)
+{
+    auto program = make_program({{opcode::SETLIT, 0, 0, 0},
+                                 {opcode::PRINT, 0, 0, 0},
+                                 {opcode::DEC, 0, 0, 0},
+                                 {opcode::PRINT, 0, 0, 0},
+                                 {opcode::RET, 0, 0, 0}},
+                                {2},
+                                1);
+
+    std::stringstream output;
+    register_machine  vm(program, output);
+
+    vm.run();
+
+    ASSERT_EQ(output.str(), "2\n1\n");
+}
+
+TEST(TestRegisterMachine, RecursiveCall)
+{
+    // function fib(n) { if (n < 2) { return n; } return fib(n - 1) + fib(n - 2); }
+    bytecode_program program;
+    program.constants = {2, 1, 20};
+    program.code      = {
+        // main
+        {opcode::SETLIT, 0, 2, 0},
+        {opcode::CALL, 0, 1, 0},
+        {opcode::RET, 0, 0, 0},
+        // fib: r0 = n
+        {opcode::SETLIT, 1, 0, 0},
+        {opcode::JUMPGEQ, 6, 0, 1},
+        {opcode::RET, 0, 0, 0},
+        {opcode::SETLIT, 2, 1, 0},
+        {opcode::SUB, 3, 0, 2},
+        {opcode::CALL, 3, 1, 3},
+        {opcode::SUB, 4, 0, 1},
+        {opcode::CALL, 4, 1, 4},
+        {opcode::ADD, 0, 3, 4},
+        {opcode::RET, 0, 0, 0},
+    };
+    program.functions = {{"main", 0, 0, 1}, {"fib", 3, 1, 5}};
+
+    register_machine vm(program);
+
+    ASSERT_EQ(vm.run(), 6765);
+    // Decoded code is reused across runs
+    ASSERT_EQ(vm.run(), 6765);
+}
+
+TEST(TestRegisterMachine, UnboundedRecursionThrows)
+{
+    bytecode_program program;
+    program.code      = {{opcode::CALL, 0, 0, 0}, {opcode::RET, 0, 0, 0}};
+    program.functions = {{"main", 0, 0, 1}};
+
+    register_machine vm(program);
+
+    ASSERT_THROW(vm.run(), std::runtime_error);
+}
+
+TEST(TestRegisterMachine, TailCallsReuseTheFrame)
+{
+    // function count(n, acc) { if (n == 0) { return acc; } return count(n - 1, acc + 1); }
+    bytecode_program program;
+    program.constants = {100'000, 0};
+    program.code      = {
+        // main
+        {opcode::SETLIT, 0, 0, 0},
+        {opcode::SETLIT, 1, 1, 0},
+        {opcode::CALL, 0, 1, 0},
+        {opcode::RET, 0, 0, 0},
+        // count: r0 = n, r1 = acc, arguments in r2 and r3
+        {opcode::JUMPNEQI, 6, 0, 0},
+        {opcode::RET, 1, 0, 0},
+        {opcode::ADDI, 2, 0, -1},
+        {opcode::ADDI, 3, 1, 1},
+        {opcode::TAILCALL, 0, 1, 2},
+    };
+    program.functions = {{"main", 0, 0, 2}, {"count", 4, 2, 4}};
+
+    register_machine vm(program);
+
+    // Far deeper than the stack allows for non tail calls
+    ASSERT_EQ(vm.run(), 100'000);
+}
+
+TEST(TestRegisterMachine, CalleeWindowStartsAtTheArguments)
+{
+    bytecode_program program;
+    program.constants = {7, 5};
+    program.code      = {
+        // main: r0 = 7, r1 = f(5), the argument in r2
+        {opcode::SETLIT, 0, 0, 0},
+        {opcode::SETLIT, 2, 1, 0},
+        {opcode::CALL, 1, 1, 2},
+        {opcode::ADD, 0, 0, 1},
+        {opcode::RET, 0, 0, 0},
+        // f: r0 = x, r1 extends past the caller's window
+        {opcode::ADD, 1, 0, 0},
+        {opcode::RET, 1, 0, 0},
+    };
+    program.functions = {{"main", 0, 0, 3}, {"f", 5, 1, 2}};
+
+    ASSERT_EQ(register_machine(program).run(), 17);
+
+    // The arguments have to lie within the caller's window
+    program.code[2] = {opcode::CALL, 1, 1, 3};
+
+    ASSERT_THROW(register_machine(program).run(), std::invalid_argument);
+}
+
+TEST(TestRegisterMachine, RecursionUpToTheStackLimit)
+{
+    // function down(n) { if (n == 0) { return 0; } return down(n - 1) + 1; }
+    bytecode_program program;
+    program.code = {
+        // main
+        {opcode::SETLIT, 1, 0, 0},
+        {opcode::CALL, 0, 1, 1},
+        {opcode::RET, 0, 0, 0},
+        // down: r0 = n, the argument in r2
+        {opcode::JUMPNEQI, 5, 0, 0},
+        {opcode::RET, 0, 0, 0},
+        {opcode::ADDI, 2, 0, -1},
+        {opcode::CALL, 1, 1, 2},
+        {opcode::ADDI, 1, 1, 1},
+        {opcode::RET, 1, 0, 0},
+    };
+    program.functions = {{"main", 0, 0, 2}, {"down", 3, 1, 3}};
+
+    program.constants = {1'000'000};
+    ASSERT_EQ(register_machine(program).run(), 1'000'000);
+
+    // 64 KiB hold a few thousand frames, the machine stays usable after an overflow
+    register_machine vm(program, std::cout, default_jit_options(), 64 * 1024);
+
+    program.constants = {100'000};
+    ASSERT_THROW(vm.run(), std::runtime_error);
+
+    program.constants = {1'000};
+    ASSERT_EQ(vm.run(), 1'000);
+}
+
+#ifdef MVPL_GUARD_PAGES
+TEST(TestGuardedStack, GrowsUntilTheGuardPages)
+{
+    guarded_stack stack(1024 * 1024, 4096);
+    auto*         memory = static_cast<volatile char*>(stack.data());
+
+    ASSERT_EQ(stack.limit(), 1024 * 1024);
+    ASSERT_LT(stack.committed(), stack.limit());
+
+    stack_fault_handler handler({&stack});
+
+    if (sigsetjmp(handler.get_overflow_target(), 1) == 0)
+    {
+        memory[300'000] = 1;
+        ASSERT_EQ(memory[300'000], 1);
+        ASSERT_GT(stack.committed(), 300'000);
+
+        memory[stack.limit()] = 1;
+        FAIL() << "Touching the guard page did not overflow";
+    }
+}
+#endif
+
+//****************************************************************************//
+//                             Superinstructions                              //
+//****************************************************************************//
+TEST(TestRegisterMachine, Superinstructions)
+{
+    // let sum = 0; for (let i = 0; i < 100; ++i) { sum = sum + i * 2 - 1; } return sum;
+    auto program = make_program({{opcode::SETLIT, 0, 0, 0},
+                                 {opcode::SETLIT, 1, 0, 0},
+                                 {opcode::JUMPGEQI, 7, 1, 100},
+                                 {opcode::MULI, 2, 1, 2},
+                                 {opcode::ADD, 0, 0, 2},
+                                 {opcode::ADDI, 0, 0, -1},
+                                 {opcode::INCJUMPLESSI, 3, 1, 100},
+                                 {opcode::RET, 0, 0, 0}},
+                                {0},
+                                3);
+
+    register_machine vm(program);
+
+    ASSERT_EQ(vm.run(), 9800);
+}
+
+//****************************************************************************//
+//                                 Suspension                                 //
+//****************************************************************************//
+TEST(TestRegisterMachine, ResumesPreemptedLoops)
+{
+    // The counting loop from above
+    auto program = make_program({{opcode::SETLIT, 0, 0, 0},
+                                 {opcode::SETLIT, 1, 0, 0},
+                                 {opcode::SETLIT, 2, 1, 0},
+                                 {opcode::JUMPGEQ, 7, 1, 2},
+                                 {opcode::ADD, 0, 0, 1},
+                                 {opcode::INC, 1, 0, 0},
+                                 {opcode::JUMP, 3, 0, 0},
+                                 {opcode::RET, 0, 0, 0}},
+                                {0, 100},
+                                3);
+
+    register_machine vm(program, std::cout, {.enabled = false});
+    std::size_t      n_turns = 1;
+
+    while (vm.resume(10) == register_machine::run_status::PREEMPTED)
+    {
+        ++n_turns;
+    }
+
+    // Every iteration charges the four instructions of the loop
+    ASSERT_EQ(vm.get_result(), 4950);
+    ASSERT_EQ(n_turns, 34);
+
+    // The next run starts over
+    ASSERT_EQ(vm.run(), 4950);
+}
+
+TEST(TestRegisterMachine, ResumesPreemptedCalls)
+{
+    // The tail calls from above
+    bytecode_program program;
+    program.constants = {100'000, 0};
+    program.code      = {
+        {opcode::SETLIT, 0, 0, 0},
+        {opcode::SETLIT, 1, 1, 0},
+        {opcode::CALL, 0, 1, 0},
+        {opcode::RET, 0, 0, 0},
+        {opcode::JUMPNEQI, 6, 0, 0},
+        {opcode::RET, 1, 0, 0},
+        {opcode::ADDI, 2, 0, -1},
+        {opcode::ADDI, 3, 1, 1},
+        {opcode::TAILCALL, 0, 1, 2},
+    };
+    program.functions = {{"main", 0, 0, 2}, {"count", 4, 2, 4}};
+
+    register_machine vm(program, std::cout, {.enabled = false});
+    std::size_t      n_turns = 1;
+
+    while (vm.resume(1000) == register_machine::run_status::PREEMPTED)
+    {
+        ++n_turns;
+    }
+
+    ASSERT_EQ(vm.get_result(), 100'000);
+    ASSERT_EQ(n_turns, 101);
+}
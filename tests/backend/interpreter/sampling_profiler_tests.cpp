@@ -0,0 +1,112 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstdint>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+#include "../src/backend/code_generator/code_generator.hpp"
+#include "../src/backend/interpreter/register_machine.hpp"
+#include "../src/backend/interpreter/sampling_profiler.hpp"
+#include "../src/frontend/lexer/lexer.hpp"
+#include "../src/frontend/parser/parser.hpp"
+
+#ifdef MVPL_SAMPLING_PROFILER
+
+namespace
+{
+// Almost all of the time is spent in fib, which can not be inlined
+const std::string SOURCE = R"(
+function fib(n)
+{
+    if (n < 2)
+    {
+        return n;
+    }
+    let a = n - 1;
+    let b = n - 2;
+    return fib(a) + fib(b);
+}
+function main()
+{
+    let n = 27;
+    let result = fib(n);
+    return result;
+}
+)";
+
+bytecode_program compile(const std::string& source)
+{
+    lexer lexer(source);
+    auto  token_stream = lexer.lex();
+
+    return generate_code(*parse(token_stream));
+}
+}    // namespace
+
+//****************************************************************************//
+//                             Sampling profiler                              //
+//****************************************************************************//
+TEST(TestSamplingProfiler, SamplesFunctionsAndLines)
+{
+    const auto        program = compile(SOURCE);
+    sampling_profiler sampler(program);
+    register_machine  vm(program, std::cout, {.enabled = false});
+
+    vm.publish_position(&sampler.get_position());
+
+    sampler.start(std::chrono::microseconds{200});
+    const auto result = vm.run();
+    sampler.stop();
+
+    ASSERT_EQ(vm.run(), result);
+    ASSERT_EQ(sampler.get_position(), NOT_EXECUTING);
+
+    const auto summary = sampler.get_summary();
+
+    ASSERT_GT(sampler.get_n_samples(), 0U);
+    ASSERT_EQ(summary["samples"], sampler.get_n_samples());
+    ASSERT_EQ(summary["functions"][0]["name"], "fib");
+    ASSERT_EQ(summary["lines"][0]["function"], "fib");
+    ASSERT_GE(summary["lines"][0]["line"], 4);
+    ASSERT_LE(summary["lines"][0]["line"], 10);
+}
+
+TEST(TestSamplingProfiler, CountsIdleSamples)
+{
+    const auto        program = compile(SOURCE);
+    sampling_profiler sampler(program);
+
+    sampler.start(std::chrono::microseconds{200});
+
+    // Burns CPU time outside of any machine
+    const auto   end = std::chrono::steady_clock::now() + std::chrono::milliseconds{20};
+    volatile int spins{};
+
+    while (std::chrono::steady_clock::now() < end)
+    {
+        spins = spins + 1;
+    }
+
+    sampler.stop();
+
+    ASSERT_GT(sampler.get_n_samples(), 0U);
+    ASSERT_EQ(sampler.get_summary()["idle"], sampler.get_n_samples());
+    ASSERT_TRUE(sampler.get_summary()["functions"].empty());
+}
+
+TEST(TestSamplingProfiler, SamplesOneProfilerAtATime)
+{
+    const auto        program = compile(SOURCE);
+    sampling_profiler first(program);
+    sampling_profiler second(program);
+
+    first.start();
+    ASSERT_THROW(second.start(), std::runtime_error);
+    first.stop();
+
+    second.start();
+    second.stop();
+}
+#endif
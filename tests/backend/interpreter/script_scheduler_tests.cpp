@@ -0,0 +1,181 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../src/backend/code_generator/code_generator.hpp"
+#include "../src/backend/interpreter/script_scheduler.hpp"
+#include "../src/frontend/lexer/lexer.hpp"
+#include "../src/frontend/parser/parser.hpp"
+
+#ifdef MVPL_SCRIPT_SCHEDULER
+#    include <sys/socket.h>
+#    include <unistd.h>
+
+namespace
+{
+bytecode_program compile(const std::string& source)
+{
+    lexer lexer(source);
+    auto  token_stream = lexer.lex();
+
+    return generate_code(*parse(token_stream));
+}
+
+// Connected sockets, the script gets the second one
+struct socket_pair
+{
+    int files[2];
+
+    socket_pair()
+    {
+        EXPECT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, files), 0);
+    }
+
+    ~socket_pair()
+    {
+        close(files[0]);
+        close(files[1]);
+    }
+
+    void send(const std::string& text) const
+    {
+        ASSERT_EQ(write(files[0], text.data(), text.size()),
+                  static_cast<ssize_t>(text.size()));
+    }
+
+    [[nodiscard]] std::string receive() const
+    {
+        char buffer[256];
+        auto n_read = read(files[0], buffer, sizeof(buffer));
+
+        return {buffer, static_cast<std::size_t>(std::max<ssize_t>(n_read, 0))};
+    }
+};
+
+const std::string SUM_SOURCE = R"(
+function main()
+{
+    let n = read();
+    let sum = 0;
+    for (let i = 0; i < n; ++i)
+    {
+        let value = read();
+        sum = sum + value;
+    }
+    print(sum);
+    return n;
+}
+)";
+}    // namespace
+
+//****************************************************************************//
+//                              Script scheduler                              //
+//****************************************************************************//
+TEST(TestScriptScheduler, MultiplexesWaitingScripts)
+{
+    const auto program = compile(SUM_SOURCE);
+
+    constexpr std::size_t    n_scripts = 200;
+    std::vector<socket_pair> connections(n_scripts);
+    script_scheduler         scheduler;
+
+    for (const auto& connection : connections)
+    {
+        scheduler.add(program, connection.files[1], connection.files[1]);
+    }
+
+    ASSERT_EQ(scheduler.get_n_scripts(), n_scripts);
+
+    // The input arrives in pieces, which split values, while the scripts wait for it
+    std::thread sender([&] {
+        for (const auto* piece : {"3 1", "0 20 "})
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+            for (const auto& connection : connections)
+            {
+                connection.send(piece);
+            }
+        }
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+        for (std::size_t i = 0; i < n_scripts; ++i)
+        {
+            connections[i].send(std::to_string(i) + "\n");
+        }
+    });
+
+    scheduler.run();
+    sender.join();
+
+    for (std::size_t i = 0; i < n_scripts; ++i)
+    {
+        const auto& result = scheduler.get_result(i);
+
+        ASSERT_TRUE(result.succeeded) << result.error;
+        ASSERT_EQ(result.value, 3);
+        ASSERT_EQ(connections[i].receive(), std::to_string(30 + i) + "\n");
+    }
+}
+
+TEST(TestScriptScheduler, TimeSlicesAndReportsErrors)
+{
+    const auto sum     = compile(SUM_SOURCE);
+    const auto counter = compile(R"(
+function main()
+{
+    let sum = 0;
+    for (let i = 0; i < 100000; ++i)
+    {
+        sum = sum + i;
+    }
+    return sum;
+}
+)");
+    const auto divider = compile(R"(
+function main()
+{
+    let zero = 0;
+    print(1);
+    let quotient = 1 / zero;
+    return quotient;
+}
+)");
+
+    script_scheduler_options options;
+    options.time_slice = 100;
+
+    socket_pair      connections[4];
+    script_scheduler scheduler(options);
+
+    scheduler.add(counter, connections[0].files[1], connections[0].files[1]);
+    scheduler.add(divider, connections[1].files[1], connections[1].files[1]);
+    scheduler.add(sum, connections[2].files[1], connections[2].files[1]);
+    scheduler.add(sum, connections[3].files[1], connections[3].files[1]);
+
+    connections[2].send("1 x ");
+    // The end of the input completes the last value
+    connections[3].send("2 5 6");
+    shutdown(connections[3].files[0], SHUT_WR);
+
+    scheduler.run();
+
+    ASSERT_TRUE(scheduler.get_result(0).succeeded);
+    ASSERT_EQ(scheduler.get_result(0).value, 4999950000);
+
+    ASSERT_FALSE(scheduler.get_result(1).succeeded);
+    ASSERT_EQ(scheduler.get_result(1).error, "Division by zero");
+    ASSERT_EQ(connections[1].receive(), "1\n");
+
+    ASSERT_FALSE(scheduler.get_result(2).succeeded);
+    ASSERT_EQ(scheduler.get_result(2).error, "Invalid input");
+
+    ASSERT_TRUE(scheduler.get_result(3).succeeded);
+    ASSERT_EQ(connections[3].receive(), "11\n");
+}
+#endif
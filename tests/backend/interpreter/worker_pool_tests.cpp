@@ -0,0 +1,142 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../src/backend/bytecode_image.hpp"
+#include "../src/backend/code_generator/code_generator.hpp"
+#include "../src/backend/interpreter/worker_pool.hpp"
+#include "../src/frontend/lexer/lexer.hpp"
+#include "../src/frontend/parser/parser.hpp"
+
+#ifdef MVPL_WORKER_POOL
+#    include <unistd.h>
+
+namespace
+{
+// Writes the program to an image, which is removed again with the object
+struct temporary_image
+{
+    std::string path;
+
+    explicit temporary_image(const std::string& source)
+        : path((std::filesystem::temp_directory_path()
+                / ("mvpl_pool_" + std::to_string(getpid()) + ".mvplc"))
+                   .string())
+    {
+        lexer lexer(source);
+        auto  token_stream = lexer.lex();
+
+        write_bytecode_image(generate_code(*parse(token_stream)), path);
+    }
+
+    ~temporary_image()
+    {
+        std::filesystem::remove(path);
+    }
+};
+}    // namespace
+
+//****************************************************************************//
+//                                Worker pool                                 //
+//****************************************************************************//
+TEST(TestWorkerPool, ServesEveryJobOnce)
+{
+    temporary_image file(R"(
+function main()
+{
+    let sum = 0;
+    for (let i = 0; i < 100; ++i)
+    {
+        sum = sum + i;
+    }
+    print(sum);
+    return 42;
+}
+)");
+    bytecode_image  image(file.path);
+
+    worker_pool_options options;
+    options.n_workers = 3;
+
+    worker_pool pool(image, options);
+
+    ASSERT_EQ(pool.get_n_workers(), 3);
+
+    constexpr std::uint64_t n_jobs = 20;
+    std::vector<int>        served(n_jobs, 0);
+
+    for (std::uint64_t job = 0; job < n_jobs; ++job)
+    {
+        pool.submit(job);
+    }
+
+    for (std::uint64_t i = 0; i < n_jobs; ++i)
+    {
+        const auto result = pool.wait_result();
+
+        ASSERT_LT(result.job, n_jobs);
+        ASSERT_LT(result.worker, 3);
+        ASSERT_TRUE(result.succeeded);
+        ASSERT_EQ(result.value, 42);
+        ASSERT_EQ(result.output, "4950\n");
+
+        ++served[result.job];
+    }
+
+    ASSERT_EQ(served, std::vector<int>(n_jobs, 1));
+
+    const auto memory = pool.get_memory();
+
+    ASSERT_EQ(memory.size(), 3);
+    ASSERT_EQ(std::accumulate(memory.begin(),
+                              memory.end(),
+                              std::size_t{0},
+                              [](std::size_t jobs, const worker_memory& worker) {
+                                  return jobs + worker.jobs;
+                              }),
+              n_jobs);
+
+    for (const auto& worker : memory)
+    {
+        ASSERT_GT(worker.pid, 0);
+
+        if (std::filesystem::exists("/proc/self/smaps_rollup"))
+        {
+            ASSERT_GT(worker.private_bytes, 0U);
+            ASSERT_GT(worker.shared_bytes, 0U);
+        }
+    }
+}
+
+TEST(TestWorkerPool, ReportsErrors)
+{
+    temporary_image file(R"(
+function main()
+{
+    let zero = 0;
+    print(1);
+    let quotient = 1 / zero;
+    return quotient;
+}
+)");
+    bytecode_image  image(file.path);
+    worker_pool     pool(image, {});
+
+    pool.submit(7);
+    pool.submit(8);
+
+    for (int i = 0; i < 2; ++i)
+    {
+        const auto result = pool.wait_result();
+
+        ASSERT_FALSE(result.succeeded);
+        ASSERT_EQ(result.output, "1\n");
+        ASSERT_EQ(result.error, "Division by zero");
+    }
+}
+#endif
@@ -0,0 +1,204 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <sstream>
+#include <string>
+
+#include "../src/backend/code_generator/code_generator.hpp"
+#include "../src/backend/interpreter/register_machine.hpp"
+#include "../src/backend/ir/inliner.hpp"
+#include "../src/backend/ir/ir.hpp"
+#include "../src/backend/ir/ir_builder.hpp"
+#include "../src/backend/ir/verifier.hpp"
+#include "../src/frontend/lexer/lexer.hpp"
+#include "../src/frontend/parser/parser.hpp"
+
+namespace
+{
+ir_program build(const std::string& source)
+{
+    lexer lexer(source);
+    auto  token_stream = lexer.lex();
+
+    return build_ir(*parse(token_stream));
+}
+
+std::size_t count_calls(const ir_function& function)
+{
+    std::size_t n = 0;
+
+    for (const auto& block : function.blocks)
+    {
+        n += static_cast<std::size_t>(std::ranges::count_if(
+            block.instructions,
+            [](const ir_instruction& i) { return i.op == ir_opcode::CALL; }));
+    }
+
+    return n;
+}
+
+const ir_function& get_function(const ir_program& program, const std::string& name)
+{
+    return *std::ranges::find(program.functions, name, &ir_function::name);
+}
+
+struct run_result
+{
+    value_t     return_value;
+    std::string output;
+};
+
+run_result run(const std::string& source, const code_generator_options& options = {})
+{
+    lexer lexer(source);
+    auto  token_stream = lexer.lex();
+    auto  program      = generate_code(*parse(token_stream), options);
+
+    std::ostringstream output;
+    auto               return_value = register_machine(program, output).run();
+
+    return {return_value, output.str()};
+}
+
+const std::string HELPERS = R"(
+function clamp(x, low, high)
+{
+    if (x < low)
+    {
+        return low;
+    }
+    if (x > high)
+    {
+        return high;
+    }
+    return x;
+}
+procedure report(x)
+{
+    if (x % 10 == 0)
+    {
+        print(x);
+    }
+}
+function square(x)
+{
+    return x * x;
+}
+function main()
+{
+    let sum = 0;
+    for (let i = 0; i < 50; ++i)
+    {
+        let low = 5;
+        let high = 40;
+        let c = clamp(i, low, high);
+        let s = square(c);
+        sum = sum + s;
+        report(i);
+    }
+    return sum;
+}
+)";
+}    // namespace
+
+TEST(TestInliner, InlinesSmallCallees)
+{
+    auto program = build(HELPERS);
+
+    ASSERT_EQ(inline_calls(program), 3);
+    ASSERT_NO_THROW(verify_program(program));
+    ASSERT_EQ(count_calls(get_function(program, "main")), 0);
+}
+
+TEST(TestInliner, ReturnsBecomeJumpsToAPhi)
+{
+    auto program = build(HELPERS);
+
+    inline_calls(program);
+
+    // The three returns of clamp join in a single phi
+    const auto& main_function = get_function(program, "main");
+
+    auto has_return_phi = std::ranges::any_of(main_function.blocks, [](const ir_block& block) {
+        return block.count_phis() != 0 && block.instructions[0].operands.size() == 3;
+    });
+
+    ASSERT_TRUE(has_return_phi);
+    ASSERT_EQ(std::ranges::count_if(main_function.blocks,
+                                    [](const ir_block& block) {
+                                        return block.terminator().op == ir_opcode::RET;
+                                    }),
+              1);
+}
+
+TEST(TestInliner, PreservesSemantics)
+{
+    auto inlined = run(HELPERS);
+    auto called  = run(HELPERS, {.optimization_level = 0});
+
+    ASSERT_EQ(inlined.return_value, called.return_value);
+    ASSERT_EQ(inlined.output, called.output);
+    ASSERT_EQ(inlined.output, "0\n10\n20\n30\n40\n");
+}
+
+TEST(TestInliner, KeepsRecursiveCalls)
+{
+    auto program = build(R"(
+function even(n)
+{
+    if (n == 0)
+    {
+        return 1;
+    }
+    let m = n - 1;
+    return odd(m);
+}
+function odd(n)
+{
+    if (n == 0)
+    {
+        return 0;
+    }
+    let m = n - 1;
+    return even(m);
+}
+function fact(n)
+{
+    if (n < 2)
+    {
+        return 1;
+    }
+    let m = n - 1;
+    return n * fact(m);
+}
+function main()
+{
+    let a = 10;
+    let e = even(a);
+    return fact(a) + e;
+}
+)");
+
+    inline_calls(program);
+
+    ASSERT_NO_THROW(verify_program(program));
+    ASSERT_EQ(count_calls(get_function(program, "even")), 1);
+    ASSERT_EQ(count_calls(get_function(program, "odd")), 1);
+    ASSERT_EQ(count_calls(get_function(program, "fact")), 1);
+    // Calls into a recursive function can still be inlined
+    ASSERT_EQ(count_calls(get_function(program, "main")), 2);
+}
+
+TEST(TestInliner, RespectsSizeLimits)
+{
+    auto program = build(HELPERS);
+
+    // Only square fits
+    ASSERT_EQ(inline_calls(program, {.max_callee_size = 4, .max_hot_callee_size = 4}), 1);
+    ASSERT_EQ(count_calls(get_function(program, "main")), 2);
+
+    auto no_budget = build(HELPERS);
+
+    ASSERT_EQ(inline_calls(no_budget, {.max_growth_percent = 0, .min_growth = 0}), 0);
+}
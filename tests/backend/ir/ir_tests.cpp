@@ -0,0 +1,386 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+#include "../src/backend/code_generator/code_generator.hpp"
+#include "../src/backend/interpreter/register_machine.hpp"
+#include "../src/backend/ir/cleanup_passes.hpp"
+#include "../src/backend/ir/dominator_tree.hpp"
+#include "../src/backend/ir/ir.hpp"
+#include "../src/backend/ir/ir_builder.hpp"
+#include "../src/backend/ir/pass_manager.hpp"
+#include "../src/backend/ir/verifier.hpp"
+#include "../src/frontend/lexer/lexer.hpp"
+#include "../src/frontend/parser/parser.hpp"
+
+namespace
+{
+ir_program build(const std::string& source)
+{
+    lexer lexer(source);
+    auto  token_stream = lexer.lex();
+
+    return build_ir(*parse(token_stream));
+}
+
+std::size_t count(const ir_function& function, ir_opcode op)
+{
+    std::size_t n = 0;
+
+    for (const auto& block : function.blocks)
+    {
+        n += static_cast<std::size_t>(std::ranges::count_if(
+            block.instructions, [op](const ir_instruction& i) { return i.op == op; }));
+    }
+
+    return n;
+}
+
+// b0: v0 = CONSTANT #1, JUMP -> b1
+// b1: RET v0
+ir_program make_valid_program()
+{
+    ir_program program;
+    auto&      function = program.functions.emplace_back();
+
+    function.name = "main";
+
+    auto entry = function.new_block();
+    auto exit  = function.new_block();
+    auto value = function.new_value();
+
+    function.blocks[entry].instructions = {{ir_opcode::CONSTANT, value, {}, 1},
+                                           {ir_opcode::JUMP, NO_VALUE, {}, 0}};
+    function.blocks[exit].instructions  = {{ir_opcode::RET, NO_VALUE, {value}, 0}};
+    add_edge(function, entry, exit);
+
+    return program;
+}
+}    // namespace
+
+//****************************************************************************//
+//                                SSA building                                //
+//****************************************************************************//
+TEST(TestIRBuilder, StraightLineCodeHasNoPhis)
+{
+    auto program = build(R"(
+function main()
+{
+    let x = 1;
+    x = x + 2;
+    if (x < 5)
+    {
+        print(x);
+    }
+    return x;
+}
+)");
+
+    ASSERT_NO_THROW(verify_program(program));
+    ASSERT_EQ(count(program.functions[0], ir_opcode::PHI), 0);
+}
+
+TEST(TestIRBuilder, JoinsAssignmentsWithPhis)
+{
+    auto program = build(R"(
+function main()
+{
+    let x = 0;
+    let y = 7;
+    if (y < 10)
+    {
+        x = 1;
+    }
+    else
+    {
+        x = 2;
+    }
+    return x + y;
+}
+)");
+    const auto& function = program.functions[0];
+
+    ASSERT_NO_THROW(verify_program(program));
+    // y is the same on both paths
+    ASSERT_EQ(count(function, ir_opcode::PHI), 1);
+
+    const auto& join = *std::ranges::find_if(function.blocks, [](const ir_block& block) {
+        return block.count_phis() == 1;
+    });
+
+    ASSERT_EQ(join.predecessors.size(), 2);
+    ASSERT_EQ(join.instructions[0].operands.size(), 2);
+}
+
+TEST(TestIRBuilder, LoopVariablesGetPhisInTheHeader)
+{
+    auto program = build(R"(
+function main()
+{
+    let sum = 0;
+    let unchanged = 3;
+    for (let i = 0; i < 10; ++i)
+    {
+        sum = sum + i * unchanged;
+    }
+    while (sum > 100)
+    {
+        sum = sum - 7;
+    }
+    return sum;
+}
+)");
+
+    ASSERT_NO_THROW(verify_program(program));
+    // sum and i in the for loop, sum in the while loop
+    ASSERT_EQ(count(program.functions[0], ir_opcode::PHI), 3);
+}
+
+TEST(TestIRBuilder, RemovesCodeAfterReturn)
+{
+    auto program = build(R"(
+function main()
+{
+    let x = 1;
+    return x;
+    x = 5;
+    print(x);
+}
+)");
+
+    ASSERT_NO_THROW(verify_program(program));
+    ASSERT_EQ(program.functions[0].blocks.size(), 1);
+    ASSERT_EQ(count(program.functions[0], ir_opcode::BUILTIN), 0);
+}
+
+TEST(TestIRBuilder, ConditionsBranchWithoutMaterializingBooleans)
+{
+    auto program = build(R"(
+function main()
+{
+    let a = 1;
+    let b = 2;
+    let c = 3;
+    while ((a < b) && (c > 0) || (a == 5))
+    {
+        c = c - 1;
+    }
+    return c;
+}
+)");
+    const auto& function = program.functions[0];
+
+    ASSERT_NO_THROW(verify_program(program));
+    ASSERT_EQ(count(function, ir_opcode::BRANCH), 3);
+
+    for (auto op : {ir_opcode::COMPARE, ir_opcode::NOT, ir_opcode::AND, ir_opcode::OR})
+    {
+        ASSERT_EQ(count(function, op), 0);
+    }
+}
+
+//****************************************************************************//
+//                                 Dominators                                 //
+//****************************************************************************//
+TEST(TestDominatorTree, IfElseDiamond)
+{
+    auto program = build(R"(
+function main()
+{
+    let x = 0;
+    if (x < 1)
+    {
+        x = 1;
+    }
+    else
+    {
+        x = 2;
+    }
+    return x;
+}
+)");
+    const auto& function = program.functions[0];
+
+    // Entry, then, else and join
+    ASSERT_EQ(function.blocks.size(), 4);
+
+    dominator_tree dominators(function);
+
+    ir_block_id join = 3;
+    ASSERT_EQ(function.blocks[join].predecessors.size(), 2);
+    ASSERT_EQ(dominators.get_immediate_dominator(join), 0);
+    ASSERT_EQ(dominators.get_immediate_dominator(0), NO_BLOCK);
+    ASSERT_EQ(dominators.get_children(0).size(), 3);
+
+    for (ir_block_id block = 0; block < function.blocks.size(); ++block)
+    {
+        ASSERT_TRUE(dominators.dominates(0, block));
+        ASSERT_TRUE(dominators.dominates(block, block));
+    }
+    ASSERT_FALSE(dominators.dominates(1, join));
+    ASSERT_FALSE(dominators.dominates(2, join));
+    ASSERT_FALSE(dominators.dominates(join, 1));
+}
+
+TEST(TestDominatorTree, LoopHeaderDominatesBody)
+{
+    auto program = build(R"(
+function main()
+{
+    let i = 0;
+    while (i < 10)
+    {
+        if (i == 5)
+        {
+            print(i);
+        }
+        ++i;
+    }
+    return i;
+}
+)");
+    const auto& function = program.functions[0];
+
+    dominator_tree dominators(function);
+
+    // The header holds the phi of i
+    auto header = static_cast<ir_block_id>(
+        std::ranges::find_if(function.blocks,
+                             [](const ir_block& block) { return block.count_phis() != 0; })
+        - function.blocks.begin());
+
+    // Everything after the entry block is only reached through the header
+    for (ir_block_id block = 1; block < function.blocks.size(); ++block)
+    {
+        ASSERT_TRUE(dominators.dominates(header, block));
+        ASSERT_EQ(dominators.dominates(block, header), block == header);
+    }
+    ASSERT_EQ(dominators.get_reverse_postorder().front(), 0);
+}
+
+//****************************************************************************//
+//                                  Verifier                                  //
+//****************************************************************************//
+TEST(TestVerifier, AcceptsValidProgram)
+{
+    ASSERT_NO_THROW(verify_program(make_valid_program()));
+}
+
+TEST(TestVerifier, RejectsBrokenPrograms)
+{
+    auto missing_terminator = make_valid_program();
+    missing_terminator.functions[0].blocks[1].instructions.clear();
+    ASSERT_THROW(verify_program(missing_terminator), std::runtime_error);
+
+    auto missing_edge = make_valid_program();
+    missing_edge.functions[0].blocks[1].predecessors.clear();
+    ASSERT_THROW(verify_program(missing_edge), std::runtime_error);
+
+    auto double_definition = make_valid_program();
+    double_definition.functions[0].blocks[0].instructions.insert(
+        double_definition.functions[0].blocks[0].instructions.begin(),
+        {ir_opcode::CONSTANT, 0, {}, 2});
+    ASSERT_THROW(verify_program(double_definition), std::runtime_error);
+
+    auto use_before_definition = make_valid_program();
+    auto& entry = use_before_definition.functions[0].blocks[0].instructions;
+    std::swap(entry[0], entry[1]);
+    ASSERT_THROW(verify_program(use_before_definition), std::runtime_error);
+
+    auto phi_operands = make_valid_program();
+    auto& function    = phi_operands.functions[0];
+    function.blocks[1].instructions.insert(function.blocks[1].instructions.begin(),
+                                           {ir_opcode::PHI, function.new_value(), {0, 0}, 0});
+    ASSERT_THROW(verify_program(phi_operands), std::runtime_error);
+}
+
+//****************************************************************************//
+//                                Pass manager                                //
+//****************************************************************************//
+TEST(TestPassManager, ReportsChangesPerPass)
+{
+    auto program = build(R"(
+function main()
+{
+    let unused = 3 * 4;
+    let x = 5;
+    return x;
+}
+)");
+
+    pass_manager passes;
+    passes.add_function_pass("eliminate_dead_values", eliminate_dead_values);
+    passes.add_function_pass("remove_unreachable_blocks", remove_unreachable_blocks);
+
+    auto statistics = passes.run(program);
+
+    ASSERT_EQ(statistics.size(), 2);
+    ASSERT_EQ(statistics[0].name, "eliminate_dead_values");
+    ASSERT_EQ(statistics[0].n_changes, 3);
+    ASSERT_EQ(statistics[1].n_changes, 0);
+    ASSERT_EQ(json(statistics)["eliminate_dead_values"], 3);
+}
+
+TEST(TestPassManager, NamesPassBreakingTheIR)
+{
+    auto program = make_valid_program();
+
+    pass_manager passes;
+    passes.add_function_pass("broken", [](ir_function& function) -> std::size_t {
+        function.blocks[0].instructions.pop_back();
+
+        return 1;
+    });
+
+    try
+    {
+        passes.run(program);
+        FAIL() << "Expected the verifier to fail";
+    }
+    catch (const std::runtime_error& error)
+    {
+        ASSERT_TRUE(std::string(error.what()).starts_with("After pass broken"));
+    }
+}
+
+//****************************************************************************//
+//                                Out of SSA                                  //
+//****************************************************************************//
+TEST(TestIRLowering, ResolvesPhiCycles)
+{
+    // a and b swap every iteration, so their phis copy in a cycle
+    const std::string source = R"(
+function main()
+{
+    let a = 1;
+    let b = 2;
+    let c = 3;
+    for (let i = 0; i < 7; ++i)
+    {
+        let t = a;
+        a = b;
+        b = c;
+        c = t;
+        let digits = a * 100 + b * 10 + c;
+        print(digits);
+    }
+    return a;
+}
+)";
+
+    for (std::size_t level = 0; level <= 1; ++level)
+    {
+        lexer              lexer(source);
+        auto               token_stream = lexer.lex();
+        auto               program =
+            generate_code(*parse(token_stream), {.optimization_level = level});
+        std::ostringstream output;
+
+        ASSERT_EQ(register_machine(program, output).run(), 2);
+        ASSERT_EQ(output.str(), "231\n312\n123\n231\n312\n123\n231\n");
+    }
+}
@@ -0,0 +1,184 @@
+#include <gtest/gtest.h>
+
+#include <cstddef>
+#include <functional>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+#include "../src/backend/code_generator/code_generator.hpp"
+#include "../src/backend/interpreter/register_machine.hpp"
+#include "../src/backend/ir/dominator_tree.hpp"
+#include "../src/backend/ir/ir.hpp"
+#include "../src/backend/ir/ir_builder.hpp"
+#include "../src/backend/ir/loop_info.hpp"
+#include "../src/backend/ir/loop_invariant_code_motion.hpp"
+#include "../src/backend/ir/verifier.hpp"
+#include "../src/frontend/lexer/lexer.hpp"
+#include "../src/frontend/parser/parser.hpp"
+
+namespace
+{
+const std::string SOURCE = R"(
+function square(x)
+{
+    let y = x * x;
+    return y;
+}
+function halvings(x)
+{
+    let n = 0;
+    while (x > 1)
+    {
+        x = x / 2;
+        ++n;
+    }
+    return n;
+}
+procedure report(x)
+{
+    print(x);
+}
+function scaled(a, b, n)
+{
+    let sum = 0;
+    for (let i = 0; i < n; ++i)
+    {
+        let k = a * b;
+        let s = square(a);
+        sum = sum + k + s + i;
+        report(a);
+    }
+    return sum;
+}
+function divide(a, b, n)
+{
+    let sum = 0;
+    let i = 0;
+    while (i < halvings(n))
+    {
+        let q = a / b;
+        sum = sum + q;
+        ++i;
+    }
+    return sum;
+}
+function main()
+{
+    let x = scaled(3, 4, 5);
+    print(x);
+    let y = divide(1, 0, 0);
+    print(y);
+    let z = divide(12, 4, 64);
+    return z;
+}
+)";
+
+ir_program build(const std::string& source)
+{
+    lexer lexer(source);
+    auto  token_stream = lexer.lex();
+
+    return build_ir(*parse(token_stream));
+}
+
+std::size_t count_in_loops(const ir_function&                               function,
+                           const std::function<bool(const ir_instruction&)>& predicate)
+{
+    dominator_tree dominators(function);
+    loop_info      loops(function, dominators);
+    std::size_t    n = 0;
+
+    for (ir_block_id id = 0; id < function.blocks.size(); ++id)
+    {
+        if (loops.get_depth(id) == 0)
+        {
+            continue;
+        }
+        for (const auto& instruction : function.blocks[id].instructions)
+        {
+            n += predicate(instruction) ? 1 : 0;
+        }
+    }
+
+    return n;
+}
+
+std::function<bool(const ir_instruction&)> is(ir_opcode op)
+{
+    return [op](const ir_instruction& instruction) { return instruction.op == op; };
+}
+
+std::function<bool(const ir_instruction&)> calls(const ir_program& program,
+                                                 const std::string& name)
+{
+    return [&program, name](const ir_instruction& instruction) {
+        return instruction.op == ir_opcode::CALL
+               && program.functions[static_cast<std::size_t>(instruction.immediate)].name == name;
+    };
+}
+
+const ir_function& find(const ir_program& program, const std::string& name)
+{
+    for (const auto& function : program.functions)
+    {
+        if (function.name == name)
+        {
+            return function;
+        }
+    }
+
+    throw std::runtime_error("No function " + name);
+}
+}    // namespace
+
+//****************************************************************************//
+//                          Loop invariant code motion                        //
+//****************************************************************************//
+TEST(TestLoopInvariantCodeMotion, HoistsArithmeticAndTotalCalls)
+{
+    auto program = build(SOURCE);
+
+    ASSERT_GT(hoist_loop_invariants(program), 0);
+    verify_program(program);
+
+    const auto& scaled = find(program, "scaled");
+
+    ASSERT_EQ(count_in_loops(scaled, is(ir_opcode::MUL)), 0);
+    ASSERT_EQ(count_in_loops(scaled, calls(program, "square")), 0);
+    // Procedures are barriers, even with invariant arguments
+    ASSERT_EQ(count_in_loops(scaled, calls(program, "report")), 1);
+}
+
+TEST(TestLoopInvariantCodeMotion, OnlyHoistsTrapsRunningOnEveryEntry)
+{
+    auto program = build(SOURCE);
+
+    hoist_loop_invariants(program);
+
+    const auto& divide = find(program, "divide");
+
+    // halvings() contains a loop, so it is only hoisted from the loop header, which runs at
+    // least once, the division in the body might never run
+    ASSERT_EQ(count_in_loops(divide, calls(program, "halvings")), 0);
+    ASSERT_EQ(count_in_loops(divide, is(ir_opcode::DIV)), 1);
+}
+
+TEST(TestLoopInvariantCodeMotion, PreservesSemantics)
+{
+    lexer lexer(SOURCE);
+    auto  token_stream = lexer.lex();
+    auto  ast          = parse(token_stream);
+
+    code_generator_report report;
+    auto                  plain     = generate_code(*ast, {.optimization_level = 0});
+    auto                  optimized = generate_code(*ast, {}, &report);
+
+    std::ostringstream plain_output;
+    std::ostringstream optimized_output;
+
+    ASSERT_EQ(register_machine(plain, plain_output).run(), 18);
+    ASSERT_EQ(register_machine(optimized, optimized_output).run(), 18);
+    ASSERT_EQ(plain_output.str(), optimized_output.str());
+    ASSERT_GT(json(report.ir_passes)["hoist_loop_invariants"], 0);
+}
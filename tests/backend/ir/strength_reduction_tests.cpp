@@ -0,0 +1,208 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../src/backend/code_generator/code_generator.hpp"
+#include "../src/backend/code_generator/constant_division.hpp"
+#include "../src/backend/interpreter/register_machine.hpp"
+#include "../src/backend/ir/ir.hpp"
+#include "../src/backend/ir/ir_builder.hpp"
+#include "../src/backend/ir/strength_reduction.hpp"
+#include "../src/backend/ir/verifier.hpp"
+#include "../src/backend/value.hpp"
+#include "../src/frontend/lexer/lexer.hpp"
+#include "../src/frontend/parser/parser.hpp"
+
+namespace
+{
+ir_program build(const std::string& source)
+{
+    lexer lexer(source);
+    auto  token_stream = lexer.lex();
+
+    return build_ir(*parse(token_stream));
+}
+
+bytecode_program compile(const std::string& source, const code_generator_options& options = {})
+{
+    lexer lexer(source);
+    auto  token_stream = lexer.lex();
+
+    return generate_code(*parse(token_stream), options);
+}
+
+std::size_t count(const ir_function& function, ir_opcode op)
+{
+    std::size_t n = 0;
+
+    for (const auto& block : function.blocks)
+    {
+        n += static_cast<std::size_t>(
+            std::ranges::count(block.instructions, op, &ir_instruction::op));
+    }
+
+    return n;
+}
+
+bool contains(const bytecode_program& program, opcode op)
+{
+    return std::ranges::any_of(program.code, [op](const instruction& i) { return i.op == op; });
+}
+
+std::vector<value_t> dividends()
+{
+    std::vector<value_t> values{0,
+                                1,
+                                -1,
+                                2,
+                                -2,
+                                std::numeric_limits<value_t>::max(),
+                                std::numeric_limits<value_t>::min(),
+                                std::numeric_limits<value_t>::max() - 1,
+                                std::numeric_limits<value_t>::min() + 1};
+    std::uint64_t        state = 12345;
+
+    for (int i = 0; i < 2000; ++i)
+    {
+        state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+        // Small and large magnitudes
+        values.push_back(static_cast<value_t>(state) >> (i % 64));
+    }
+
+    return values;
+}
+}    // namespace
+
+//****************************************************************************//
+//                               Multiplication                               //
+//****************************************************************************//
+TEST(TestStrengthReduction, ShiftsMultiplicationsByPowersOfTwo)
+{
+    auto program = build(R"(
+function main()
+{
+    let x = 5;
+    let y = x * 8;
+    let z = 3 * y;
+    return z;
+}
+)");
+
+    ASSERT_EQ(reduce_strength(program), 1);
+    verify_program(program);
+
+    ASSERT_EQ(count(program.functions[0], ir_opcode::LSHIFT), 1);
+    ASSERT_EQ(count(program.functions[0], ir_opcode::MUL), 1);
+}
+
+TEST(TestStrengthReduction, InductionVariableMultiplicationBecomesAnAddition)
+{
+    const std::string source = R"(
+function sum(n, k)
+{
+    let s = 0;
+    for (let i = 2; i < n; ++i)
+    {
+        let t = i * 7;
+        let u = k * i;
+        s = s + t + u;
+    }
+    return s;
+}
+function main()
+{
+    let s = sum(100, 3);
+    return s;
+}
+)";
+
+    auto program = build(source);
+
+    // Both multiplications, and the doubling of k for the start value of k * i becomes a shift
+    ASSERT_EQ(reduce_strength(program), 3);
+    verify_program(program);
+
+    // New phis for i * 7 and k * i, whose step k * 1 is just k
+    const auto& sum = program.functions[0];
+    ASSERT_EQ(count(sum, ir_opcode::PHI), 4);
+    ASSERT_EQ(count(sum, ir_opcode::MUL), 0);
+
+    std::ostringstream output;
+    ASSERT_EQ(register_machine(compile(source), output).run(),
+              register_machine(compile(source, {.optimization_level = 0}), output).run());
+}
+
+//****************************************************************************//
+//                                  Division                                  //
+//****************************************************************************//
+TEST(TestStrengthReduction, MagicNumbersDivideExactly)
+{
+    const auto values = dividends();
+
+    for (value_t divisor : {3, 5, 6, 7, 10, 12, 641, 1'000'000'007, -3, -7, -10, -2, -4, -1024,
+                            std::numeric_limits<std::int32_t>::max(),
+                            std::numeric_limits<std::int32_t>::min()})
+    {
+        const auto magic = compute_magic_divisor(divisor);
+
+        for (auto x : values)
+        {
+            ASSERT_EQ(divide_by_magic(x, magic.multiplier, magic.shift, divisor),
+                      checked_div(x, divisor))
+                << x << " / " << divisor;
+        }
+    }
+
+    for (value_t shift = 1; shift < 31; ++shift)
+    {
+        for (auto x : values)
+        {
+            ASSERT_EQ(divide_by_power_of_two(x, shift), checked_div(x, value_t{1} << shift));
+            ASSERT_EQ(modulo_by_power_of_two(x, shift), checked_mod(x, value_t{1} << shift));
+        }
+    }
+}
+
+TEST(TestStrengthReduction, DivisionsByConstantsAvoidDividing)
+{
+    const std::string source = R"(
+function main()
+{
+    let sum = 0;
+    for (let i = 0; i < 200; ++i)
+    {
+        let x = i * 37 - 3000;
+        let a = x / 3;
+        let b = x % 8;
+        let c = x / 16;
+        let d = x % 10;
+        sum = sum + a + b + c + d;
+        print(sum);
+    }
+    return sum;
+}
+)";
+
+    auto optimized = compile(source);
+    auto plain     = compile(source, {.optimization_level = 0});
+
+    ASSERT_TRUE(contains(optimized, opcode::DIVMAGIC));
+    ASSERT_TRUE(contains(optimized, opcode::MODMAGIC));
+    ASSERT_TRUE(contains(optimized, opcode::DIVPOW2I));
+    ASSERT_TRUE(contains(optimized, opcode::MODPOW2I));
+    ASSERT_FALSE(contains(optimized, opcode::DIVI));
+    ASSERT_FALSE(contains(optimized, opcode::MODI));
+
+    std::ostringstream plain_output;
+    std::ostringstream optimized_output;
+
+    ASSERT_EQ(register_machine(optimized, optimized_output).run(),
+              register_machine(plain, plain_output).run());
+    ASSERT_EQ(optimized_output.str(), plain_output.str());
+}
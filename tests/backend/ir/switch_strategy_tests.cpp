@@ -0,0 +1,145 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <map>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../src/backend/code_generator/code_generator.hpp"
+#include "../src/backend/interpreter/register_machine.hpp"
+#include "../src/backend/ir/switch_strategy.hpp"
+#include "../src/backend/value.hpp"
+#include "../src/frontend/lexer/lexer.hpp"
+#include "../src/frontend/parser/parser.hpp"
+
+namespace
+{
+std::vector<std::optional<value_t>> to_cases(const std::vector<value_t>& values)
+{
+    return {values.begin(), values.end()};
+}
+
+// The language has no unary minus, so negative values are written as subtractions
+std::string to_source(value_t value)
+{
+    return value < 0 ? "0 - " + std::to_string(-value) : std::to_string(value);
+}
+
+// Sums up the case selected for every value in [first, last)
+std::string make_program(const std::vector<value_t>& case_values, value_t first, value_t last)
+{
+    std::string source = "function classify(x)\n{\n    let r = 0;\n    switch (x)\n    {\n";
+
+    for (std::size_t i = 0; i < case_values.size(); ++i)
+    {
+        source += "        case " + to_source(case_values[i]) + ": r = " + std::to_string(i + 1)
+                  + ";\n";
+    }
+    source += "    }\n    return r;\n}\n";
+    source += "function main()\n{\n    let sum = 0;\n";
+    source += "    for (let i = " + to_source(first) + "; i < " + to_source(last) + "; ++i)\n";
+    source += "    {\n        let c = classify(i);\n        sum = sum * 31 + c;\n    }\n";
+    source += "    return sum;\n}\n";
+
+    return source;
+}
+
+bytecode_program compile(const std::string&            source,
+                         const code_generator_options& options,
+                         code_generator_report*        report = nullptr)
+{
+    lexer lexer(source);
+    auto  token_stream = lexer.lex();
+
+    return generate_code(*parse(token_stream), options, report);
+}
+}    // namespace
+
+TEST(TestSwitchStrategy, PlansByDensity)
+{
+    ASSERT_EQ(plan_switch(to_cases({1, 2, 3})).strategy, switch_strategy::COMPARISONS);
+    ASSERT_EQ(plan_switch({1, std::nullopt, 3, 4, 5}).strategy, switch_strategy::COMPARISONS);
+
+    auto dense = plan_switch(to_cases({7, 3, 4, 6, 9, 10}));
+    ASSERT_EQ(dense.strategy, switch_strategy::JUMP_TABLE);
+    ASSERT_EQ(dense.offset, 3);
+
+    ASSERT_EQ(plan_switch(to_cases({0, 1000, 2000, 3000, 4000})).strategy,
+              switch_strategy::BINARY_SEARCH);
+
+    // Duplicates do not count towards the cases
+    ASSERT_EQ(plan_switch(to_cases({1, 1, 2, 2})).strategy, switch_strategy::COMPARISONS);
+}
+
+TEST(TestSwitchStrategy, HashesSpreadTheCases)
+{
+    std::vector<value_t> values;
+
+    for (value_t i = 0; i < 300; ++i)
+    {
+        values.push_back(i * i * 7919 - 50'000);
+    }
+
+    auto plan = plan_switch(to_cases(values));
+    ASSERT_EQ(plan.strategy, switch_strategy::HASH) << plan.reason;
+    ASSERT_GE(plan.table_size, 2 * values.size());
+
+    std::map<std::size_t, std::size_t> slot_sizes;
+
+    for (auto value : values)
+    {
+        auto slot = hash_switch_value(plan, value);
+
+        ASSERT_LT(slot, plan.table_size);
+        ASSERT_LE(++slot_sizes[slot], MAX_HASH_SLOT_CASES);
+    }
+}
+
+TEST(TestSwitchStrategy, StrategiesPreserveSemantics)
+{
+    struct test_case
+    {
+        std::vector<value_t> case_values;
+        switch_strategy      strategy;
+    };
+
+    std::vector<value_t> sparse;
+
+    for (value_t i = 0; i < 40; ++i)
+    {
+        sparse.push_back(i * 37 + (i % 3));
+    }
+
+    // Case values are literals, so they can not be negative. Duplicates belong to the first
+    // case.
+    const std::vector<test_case> test_cases{
+        {{3, 1, 2}, switch_strategy::COMPARISONS},
+        {{3, 0, 5, 12, 1, 2, 5, 4, 11, 10}, switch_strategy::JUMP_TABLE},
+        {{400, 80, 0, 13, 99, 250, 13, 600}, switch_strategy::BINARY_SEARCH},
+        {sparse, switch_strategy::HASH}};
+
+    for (const auto& [case_values, strategy] : test_cases)
+    {
+        auto source = make_program(case_values, -100, 1600);
+
+        code_generator_report report;
+
+        auto plain     = compile(source, {.optimization_level = 0});
+        auto optimized = compile(source, {}, &report);
+
+        ASSERT_EQ(report.switches.size(), 1);
+        ASSERT_EQ(report.switches[0].strategy, strategy) << report.switches[0].reason;
+        ASSERT_EQ(std::ranges::any_of(optimized.code,
+                                      [](const instruction& i) {
+                                          return i.op == opcode::JUMPTABLE;
+                                      }),
+                  strategy == switch_strategy::JUMP_TABLE || strategy == switch_strategy::HASH);
+
+        std::ostringstream output;
+        ASSERT_EQ(register_machine(plain, output).run(),
+                  register_machine(optimized, output).run());
+    }
+}
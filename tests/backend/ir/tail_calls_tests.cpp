@@ -0,0 +1,158 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+#include "../src/backend/code_generator/code_generator.hpp"
+#include "../src/backend/interpreter/register_machine.hpp"
+#include "../src/backend/ir/ir.hpp"
+#include "../src/backend/ir/ir_builder.hpp"
+#include "../src/backend/ir/tail_calls.hpp"
+#include "../src/backend/ir/verifier.hpp"
+#include "../src/frontend/lexer/lexer.hpp"
+#include "../src/frontend/parser/parser.hpp"
+
+namespace
+{
+const std::string COUNT = R"(
+function count(n, acc)
+{
+    if (n == 0)
+    {
+        return acc;
+    }
+    let m = n - 1;
+    let a = acc + 1;
+    return count(m, a);
+}
+function main()
+{
+    return count(1000000, 0);
+}
+)";
+
+const std::string PARITY = R"(
+function is_even(n)
+{
+    if (n == 0)
+    {
+        return 1;
+    }
+    let m = n - 1;
+    return is_odd(m);
+}
+function is_odd(n)
+{
+    if (n == 0)
+    {
+        return 0;
+    }
+    let m = n - 1;
+    return is_even(m);
+}
+function main()
+{
+    return is_even(100001);
+}
+)";
+
+ir_program build(const std::string& source)
+{
+    lexer lexer(source);
+    auto  token_stream = lexer.lex();
+
+    return build_ir(*parse(token_stream));
+}
+
+bytecode_program compile(const std::string& source, const code_generator_options& options = {})
+{
+    lexer lexer(source);
+    auto  token_stream = lexer.lex();
+
+    return generate_code(*parse(token_stream), options);
+}
+
+std::size_t count_calls(const ir_function& function)
+{
+    std::size_t n = 0;
+
+    for (const auto& block : function.blocks)
+    {
+        n += static_cast<std::size_t>(std::ranges::count_if(
+            block.instructions,
+            [](const ir_instruction& i) { return i.op == ir_opcode::CALL; }));
+    }
+
+    return n;
+}
+}    // namespace
+
+//****************************************************************************//
+//                              Tail recursion                                //
+//****************************************************************************//
+TEST(TestTailCalls, SelfRecursionBecomesALoop)
+{
+    auto program = build(COUNT);
+
+    ASSERT_EQ(eliminate_tail_recursion(program), 1);
+    verify_program(program);
+
+    const auto& count = program.functions[0];
+
+    ASSERT_EQ(count_calls(count), 0);
+    // The new entry block jumps to the loop header holding a phi per parameter
+    ASSERT_EQ(count.blocks[0].successors.size(), 1);
+    ASSERT_EQ(count.blocks[1].count_phis(), 2);
+    ASSERT_EQ(count.blocks[1].predecessors.size(), 2);
+}
+
+TEST(TestTailCalls, KeepsCallsWhoseResultIsUsed)
+{
+    auto program = build(R"(
+function fib(n)
+{
+    if (n < 2)
+    {
+        return n;
+    }
+    let a = n - 1;
+    let b = n - 2;
+    return fib(a) + fib(b);
+}
+function main()
+{
+    return fib(10);
+}
+)");
+
+    ASSERT_EQ(eliminate_tail_recursion(program), 0);
+    ASSERT_EQ(count_calls(program.functions[0]), 2);
+}
+
+TEST(TestTailCalls, DeepRecursionRunsInConstantStack)
+{
+    std::ostringstream    output;
+    constexpr std::size_t stack_limit = 1024 * 1024;
+
+    auto optimized   = compile(COUNT);
+    auto unoptimized = compile(COUNT, {.optimization_level = 0});
+
+    ASSERT_EQ(register_machine(optimized, output, default_jit_options(), stack_limit).run(),
+              1000000);
+    ASSERT_THROW(register_machine(unoptimized, output, default_jit_options(), stack_limit).run(),
+                 std::runtime_error);
+}
+
+TEST(TestTailCalls, MutualRecursionReusesTheFrame)
+{
+    auto program = compile(PARITY);
+
+    ASSERT_TRUE(std::ranges::any_of(
+        program.code, [](const instruction& i) { return i.op == opcode::TAILCALL; }));
+
+    std::ostringstream output;
+    ASSERT_EQ(register_machine(program, output).run(), 0);
+}
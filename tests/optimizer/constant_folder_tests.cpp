@@ -0,0 +1,282 @@
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <variant>
+#include <vector>
+
+#include "../src/backend/code_generator/code_generator.hpp"
+#include "../src/backend/interpreter/register_machine.hpp"
+#include "../src/common/string_pool.hpp"
+#include "../src/frontend/lexer/lexer.hpp"
+#include "../src/frontend/parser/parser.hpp"
+#include "../src/optimizer/constant_folder.hpp"
+
+namespace
+{
+// The AST refers to the source code and the literals computed by the folder
+struct folded_program
+{
+    std::string                 source;
+    std::vector<token>          token_stream;
+    std::shared_ptr<ast_node_t> ast;
+    string_pool                 literals;
+    constant_folding_statistics statistics;
+
+    explicit folded_program(std::string source_, bool fold = true) : source{std::move(source_)}
+    {
+        lexer lexer(source);
+
+        token_stream = lexer.lex();
+        ast          = parse(token_stream);
+
+        if (fold)
+        {
+            statistics = fold_constants(*ast, literals);
+        }
+    }
+
+    value_t run() const
+    {
+        std::ostringstream output;
+
+        return register_machine(generate_code(*ast), output).run();
+    }
+
+    // Statements of the body of the first function
+    [[nodiscard]] std::vector<std::shared_ptr<ast_node_t>>& body() const
+    {
+        auto& function = std::get<func_def_node>(*std::get<program_node>(*ast).globals[0]);
+
+        return std::get<block_node>(*function.body).statements;
+    }
+};
+
+std::string_view get_literal(const std::shared_ptr<ast_node_t>& node)
+{
+    const auto& leaf = std::get<leaf_node>(*node);
+
+    if (leaf.token != token_type::LITERAL)
+    {
+        throw std::invalid_argument("Not a literal");
+    }
+
+    return leaf.value;
+}
+
+const std::shared_ptr<ast_node_t>& get_return_value(const std::shared_ptr<ast_node_t>& node)
+{
+    return std::get<return_stmt_node>(*node).value;
+}
+}    // namespace
+
+//****************************************************************************//
+//                                  Folding                                   //
+//****************************************************************************//
+TEST(TestConstantFolder, FoldsAllOperators)
+{
+    const std::string source = R"(
+function main()
+{
+    let arithmetic = ((7 + 5) * (9 - 2) / 4) % 10;
+    let bitwise = ((12 & 10) | (1 << 4)) ^ (256 >> 2);
+    let comparison = (1 < 2) + (2 <= 2) + (3 > 4) + (4 >= 5) + (5 == 5) + (5 != 5);
+    let logical = (!0 && 3) + (0 || 0) + !7;
+    return arithmetic * 1000000 + bitwise * 1000 + comparison * 10 + logical;
+}
+)";
+
+    folded_program plain(source, false);
+    folded_program folded(source);
+
+    ASSERT_EQ(get_literal(get_return_value(folded.body().back())), "1088031");
+    ASSERT_EQ(folded.run(), plain.run());
+    ASSERT_GT(folded.statistics.n_folded_expressions, 20);
+}
+
+TEST(TestConstantFolder, WrapsAroundLikeTheInterpreter)
+{
+    folded_program folded(R"(
+function main()
+{
+    return ((9223372036854775807 + 1) / (0 - 1)) + (1 << 65);
+}
+)");
+
+    ASSERT_EQ(get_literal(get_return_value(folded.body().back())), "-9223372036854775806");
+    ASSERT_EQ(folded.run(), INT64_MIN + 2);
+}
+
+TEST(TestConstantFolder, LeavesDivisionByZeroToTheInterpreter)
+{
+    folded_program folded(R"(
+function main()
+{
+    return 1 / (2 - 2);
+}
+)");
+
+    const auto& value = get_return_value(folded.body().back());
+
+    ASSERT_TRUE(std::holds_alternative<binary_op_node>(*value));
+    ASSERT_EQ(get_literal(std::get<binary_op_node>(*value).rhs), "0");
+    ASSERT_THROW(folded.run(), std::runtime_error);
+}
+
+//****************************************************************************//
+//                                Propagation                                 //
+//****************************************************************************//
+TEST(TestConstantFolder, PropagatesNeverWrittenLocals)
+{
+    const std::string source = R"(
+function main()
+{
+    let a = 3;
+    let b = a * 4;
+    let c = 0;
+    let d;
+    c = b;
+    print(b);
+    return a + b + c + d;
+}
+)";
+
+    folded_program plain(source, false);
+    folded_program folded(source);
+
+    const auto& print = std::get<call_node>(*folded.body()[5]);
+
+    // a, b and d are propagated, c is written after its initialization (by c = 12)
+    ASSERT_EQ(std::get<parameter_pass_node>(*print.parameter_pass).parameter_list[0], "12");
+    ASSERT_TRUE(std::holds_alternative<binary_op_node>(*get_return_value(folded.body().back())));
+    ASSERT_EQ(folded.statistics.n_propagated_uses, 6);
+    ASSERT_EQ(folded.run(), plain.run());
+    ASSERT_EQ(folded.run(), 27);
+}
+
+TEST(TestConstantFolder, RespectsShadowing)
+{
+    const std::string source = R"(
+function main()
+{
+    let x = 2;
+    let sum = 0;
+    for (let i = 0; i < 3; ++i)
+    {
+        let x = i;
+        sum = sum + x;
+    }
+    if (sum > 0)
+    {
+        let x = x + 5;
+        sum = sum + x;
+    }
+    return sum + x;
+}
+)";
+
+    folded_program plain(source, false);
+    folded_program folded(source);
+
+    ASSERT_EQ(folded.run(), plain.run());
+    ASSERT_EQ(folded.run(), 12);
+}
+
+//****************************************************************************//
+//                                 Conditions                                 //
+//****************************************************************************//
+TEST(TestConstantFolder, ResolvesConstantConditions)
+{
+    const std::string source = R"(
+function main()
+{
+    let debug = 0;
+    let n = 10;
+    let result = 0;
+    if (debug)
+    {
+        result = 100;
+    }
+    else if (n > 5)
+    {
+        result = 1;
+    }
+    else
+    {
+        result = 2;
+    }
+    while (debug)
+    {
+        result = result + 1;
+    }
+    for (let i = 0; debug; ++i)
+    {
+        result = result + 1;
+    }
+    while (1)
+    {
+        return result;
+    }
+}
+)";
+
+    folded_program plain(source, false);
+    folded_program folded(source);
+    const auto&    body = folded.body();
+
+    // The if chain collapsed into the block of the else if, the while loop is gone, the for
+    // loop only keeps its initialization and the infinite loop has no test anymore
+    ASSERT_EQ(body.size(), 6);
+    ASSERT_TRUE(std::holds_alternative<block_node>(*body[3]));
+    ASSERT_TRUE(std::holds_alternative<block_node>(*body[4]));
+    ASSERT_EQ(std::get<block_node>(*body[4]).statements.size(), 1);
+    ASSERT_EQ(std::get<for_loop_node>(*body[5]).test_expression, nullptr);
+    ASSERT_EQ(folded.statistics.n_resolved_conditions, 5);
+    ASSERT_EQ(folded.run(), plain.run());
+    ASSERT_EQ(folded.run(), 1);
+}
+
+TEST(TestConstantFolder, KeepsUnknownBranches)
+{
+    const std::string source = R"(
+function pick(x)
+{
+    if (x == 1)
+    {
+        return 10;
+    }
+    else if (0)
+    {
+        return 20;
+    }
+    else if (x == 2)
+    {
+        return 30;
+    }
+    else
+    {
+        return 40;
+    }
+}
+function main()
+{
+    let a = pick(1);
+    let b = pick(2);
+    let c = pick(3);
+    return a + b + c;
+}
+)";
+
+    folded_program folded(source);
+
+    const auto& pick = std::get<func_def_node>(*std::get<program_node>(*folded.ast).globals[0]);
+    const auto& body = std::get<block_node>(*pick.body).statements;
+
+    ASSERT_EQ(body.size(), 3);
+    ASSERT_TRUE(std::holds_alternative<if_stmt_node>(*body[0]));
+    ASSERT_TRUE(std::holds_alternative<else_if_stmt_node>(*body[1]));
+    ASSERT_TRUE(std::holds_alternative<else_stmt_node>(*body[2]));
+    ASSERT_EQ(folded.run(), 80);
+}
@@ -0,0 +1,303 @@
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <variant>
+#include <vector>
+
+#include "../src/backend/code_generator/code_generator.hpp"
+#include "../src/backend/interpreter/register_machine.hpp"
+#include "../src/common/string_pool.hpp"
+#include "../src/frontend/lexer/lexer.hpp"
+#include "../src/frontend/parser/parser.hpp"
+#include "../src/optimizer/ast_optimizer.hpp"
+#include "../src/optimizer/dead_code_eliminator.hpp"
+
+namespace
+{
+// The AST refers to the source code and the literals computed by the constant folder
+struct optimized_program
+{
+    std::string                 source;
+    std::vector<token>          token_stream;
+    std::shared_ptr<ast_node_t> ast;
+    string_pool                 literals;
+    ast_optimization_report     report;
+
+    explicit optimized_program(std::string source_, std::size_t optimization_level = 1) :
+        source{std::move(source_)}
+    {
+        lexer lexer(source);
+
+        token_stream = lexer.lex();
+        ast          = parse(token_stream);
+        report       = optimize_ast(*ast, literals, optimization_level);
+    }
+
+    value_t run(std::string* output = nullptr) const
+    {
+        std::ostringstream stream;
+        auto               result = register_machine(generate_code(*ast), stream).run();
+
+        if (output != nullptr)
+        {
+            *output = stream.str();
+        }
+
+        return result;
+    }
+
+    // Statements of the body of the function at index
+    [[nodiscard]] std::vector<std::shared_ptr<ast_node_t>>& body(std::size_t index = 0) const
+    {
+        auto& function = std::get<func_def_node>(*std::get<program_node>(*ast).globals[index]);
+
+        return std::get<block_node>(*function.body).statements;
+    }
+};
+
+// Runs both versions of the program and compares their results and output
+void expect_same_behavior(const optimized_program& plain, const optimized_program& optimized)
+{
+    std::string plain_output;
+    std::string optimized_output;
+
+    ASSERT_EQ(plain.run(&plain_output), optimized.run(&optimized_output));
+    ASSERT_EQ(plain_output, optimized_output);
+}
+}    // namespace
+
+//****************************************************************************//
+//                           Unreachable statements                           //
+//****************************************************************************//
+TEST(TestDeadCodeEliminator, RemovesStatementsAfterReturn)
+{
+    const std::string source = R"(
+function sign(x)
+{
+    if (x < 0)
+    {
+        return 0 - 1;
+        print(x);
+    }
+    else if (x == 0)
+    {
+        return 0;
+    }
+    else
+    {
+        return 1;
+    }
+    print(x);
+    return 2;
+}
+function main()
+{
+    let a = sign(5);
+    let b = sign(0);
+    return a + b;
+    print(a);
+}
+)";
+
+    optimized_program plain(source, 0);
+    optimized_program optimized(source);
+
+    const auto& sign     = optimized.body(0);
+    const auto& if_stmt  = std::get<if_stmt_node>(*sign[0]);
+    const auto& if_block = std::get<block_node>(*if_stmt.body).statements;
+
+    // The if chain always returns
+    ASSERT_EQ(sign.size(), 3);
+    ASSERT_EQ(if_block.size(), 1);
+    ASSERT_EQ(optimized.body(1).size(), 3);
+    ASSERT_EQ(optimized.report.dead_code.n_unreachable_statements, 4);
+    expect_same_behavior(plain, optimized);
+}
+
+TEST(TestDeadCodeEliminator, RemovesStatementsAfterInfiniteLoops)
+{
+    const std::string source = R"(
+function main()
+{
+    let i = 0;
+    while (1)
+    {
+        ++i;
+        if (i == 10)
+        {
+            return i;
+        }
+    }
+    print(i);
+    return 0;
+}
+)";
+
+    optimized_program plain(source, 0);
+    optimized_program optimized(source);
+
+    ASSERT_EQ(optimized.body().size(), 2);
+    ASSERT_EQ(optimized.report.dead_code.n_unreachable_statements, 2);
+    expect_same_behavior(plain, optimized);
+}
+
+//****************************************************************************//
+//                                   Switch                                   //
+//****************************************************************************//
+TEST(TestDeadCodeEliminator, RemovesDuplicateCases)
+{
+    const std::string source = R"(
+function classify(x)
+{
+    let result = 0;
+    switch (x)
+    {
+        case 1: result = 10;
+        case 2: result = 20;
+        case 1: result = 30;
+        case 3: result = 40;
+        case 2: result = 50;
+    }
+    return result;
+}
+function main()
+{
+    let a = classify(1);
+    let b = classify(2);
+    let c = classify(3);
+    return a + b + c;
+}
+)";
+
+    optimized_program plain(source, 0);
+    optimized_program optimized(source);
+
+    const auto& switch_ = std::get<switch_node>(*optimized.body(0)[1]);
+
+    ASSERT_EQ(std::get<block_node>(*switch_.body).statements.size(), 3);
+    ASSERT_EQ(optimized.report.dead_code.n_unreachable_cases, 2);
+    ASSERT_EQ(optimized.run(), 70);
+    expect_same_behavior(plain, optimized);
+}
+
+TEST(TestDeadCodeEliminator, ResolvesSwitchOverConstant)
+{
+    const std::string source = R"(
+function main()
+{
+    let mode = 2;
+    let result = 0;
+    switch (mode)
+    {
+        case 1: result = 10;
+        case 2: result = 20;
+        case 3: result = 30;
+    }
+    switch (mode + 5)
+    {
+        case 1: result = 0;
+    }
+    return result;
+}
+)";
+
+    optimized_program plain(source, 0);
+    optimized_program optimized(source);
+
+    const auto& body = optimized.body();
+
+    // Only the body of the selected case remains, the second switch is gone
+    ASSERT_EQ(body.size(), 3);
+    ASSERT_TRUE(std::holds_alternative<block_node>(*body[1]));
+    ASSERT_EQ(optimized.report.dead_code.n_unreachable_cases, 3);
+    expect_same_behavior(plain, optimized);
+}
+
+//****************************************************************************//
+//                                   Locals                                   //
+//****************************************************************************//
+TEST(TestDeadCodeEliminator, RemovesUnreadLocals)
+{
+    const std::string source = R"(
+function noisy()
+{
+    print(1);
+    return 5;
+}
+function compute(x)
+{
+    let unused;
+    let a = x + 1;
+    let b = a * 2;
+    let c = noisy();
+    let counter = 0;
+    for (let i = 0; i < 3; ++i)
+    {
+        counter = counter + i;
+        ++counter;
+    }
+    return 7;
+}
+function main()
+{
+    return compute(3);
+}
+)";
+
+    optimized_program plain(source, 0);
+    optimized_program optimized(source);
+
+    const auto& body = optimized.body(1);
+
+    // The call is kept for its output, the loop for its iterations
+    ASSERT_EQ(body.size(), 3);
+    ASSERT_TRUE(std::holds_alternative<call_node>(*body[0]));
+    ASSERT_TRUE(std::get<block_node>(*std::get<for_loop_node>(*body[1]).body).statements.empty());
+    ASSERT_EQ(optimized.report.dead_code.n_removed_locals, 5);
+    ASSERT_EQ(optimized.report.dead_code.n_removed_stores, 2);
+    expect_same_behavior(plain, optimized);
+}
+
+TEST(TestDeadCodeEliminator, KeepsSideEffectsOfRemovedLocals)
+{
+    const std::string source = R"(
+function divide(x, y)
+{
+    let quotient = x / y;
+    let remainder = x % 4;
+    return 0;
+}
+function main()
+{
+    let a = divide(7, 2);
+    let b = divide(7, 0);
+    return 1;
+}
+)";
+
+    optimized_program optimized(source);
+
+    const auto& body = optimized.body(0);
+
+    // The division might trap, the modulo by a non-zero literal can not
+    ASSERT_EQ(body.size(), 2);
+    ASSERT_TRUE(std::holds_alternative<binary_op_node>(*body[0]));
+    ASSERT_THROW(optimized.run(), std::runtime_error);
+}
+
+TEST(TestDeadCodeEliminator, KeepsUndeclaredVariables)
+{
+    optimized_program optimized(R"(
+function main()
+{
+    y = 5;
+    return 0;
+}
+)");
+
+    ASSERT_EQ(optimized.body().size(), 2);
+    ASSERT_THROW(optimized.run(), std::runtime_error);
+}